@@ -0,0 +1,475 @@
+/// @file AffineTransformsBench.cpp
+/// @brief headless frame time benchmark, draws every primitive in every MatrixOrder with and
+/// without wireframe and normals into an offscreen FBO using the same shaders as the app.
+/// Works without a display (e.g. Mesa llvmpipe with QT_QPA_PLATFORM=offscreen).
+/// Also reports the start up cost of building the primitives and axis with no geometry cache,
+/// a cold (empty) cache and a warm one, and the program cache hits and time saved.
+/// The normals are drawn from the precomputed line buffers unless --gs-normals selects the
+/// normalGeo geometry shader the app used to use. The TransformUBO goes through the same
+/// UniformRing as the app, --orphan-ubo uses its orphaning fallback instead.
+/// --software also draws every primitive in every order with the SoftwareRasterizer from the same
+/// TransformUBO and vertices, times it and fails if more than --max-differing percent of the
+/// pixels are more than 2 apart from the GL frame, --software-images writes the cpu frames there.
+/// usage AffineTransformsBench [-f frames] [-w width] [-h height] [--json file]
+///                             [--baseline file] [--tolerance percent]
+///                             [--cache dir] [--startup-reps n] [--startup-only]
+///                             [--gs-normals] [--orphan-ubo]
+///                             [--software] [--max-differing percent] [--software-images dir]
+#include "AffineTransform.h"
+#include "Bench.h"
+#include "Axis.h"
+#include "GeometryCache.h"
+#include "NormalLines.h"
+#include "ProgramCache.h"
+#include "SceneResources.h"
+#include "SoftwareRasterizer.h"
+#include "ThreadPool.h"
+#include "TransformBatch.h"
+#include "UniformRing.h"
+#include <ngl/NGLInit.h>
+#include <ngl/ShaderLib.h>
+#include <ngl/Util.h>
+#include <ngl/VAOPrimitives.h>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the same layout as the TransformUBO in PBRVertex.glsl
+//----------------------------------------------------------------------------------------------------------------------
+struct TransformUBO
+{
+  ngl::Mat4 MVP;
+  float normalMatrix[3][4];
+  ngl::Mat4 M;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the scale of the fixed transform, needed to make the normal matrix
+//----------------------------------------------------------------------------------------------------------------------
+constexpr float s_scale[3] = {1.0f, 1.2f, 0.8f};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief one combination of the ui options to time
+//----------------------------------------------------------------------------------------------------------------------
+struct FrameConfig
+{
+  size_t primitive;
+  MatrixOrder order;
+  bool wireframe;
+  bool normals;
+  bool axis = true;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief everything the frame needs that doesn't change between configurations
+//----------------------------------------------------------------------------------------------------------------------
+struct FrameState
+{
+  ngl::Mat4 view;
+  ngl::Mat4 project;
+  ngl::Mat4 mouseGlobalTX;
+  AffineTransform transforms[std::size(s_matrixOrders)];
+  std::unique_ptr<Axis> axis;
+  GLuint query = 0;
+  std::unique_ptr<UniformRing> transformRing;
+  bool geometryShaderNormals = false;
+  std::map<std::string, std::unique_ptr<ngl::AbstractVAO>> normalLines;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a fixed transform with every component set so all the orders give different matrices
+//----------------------------------------------------------------------------------------------------------------------
+void composeTransforms(FrameState &_state)
+{
+  TransformParams params;
+  params.resize(1);
+  params.set(0, 0.5f, -0.25f, 0.3f, 30.0f, 45.0f, 60.0f, s_scale[0], s_scale[1], s_scale[2], 45.0f, 1.0f, 1.0f, 0.0f);
+  for (size_t o = 0; o < std::size(s_matrixOrders); ++o)
+  {
+    float m[16];
+    TransformBatch::compose(s_matrixOrders[o], params, m);
+    _state.transforms[o] = AffineTransform::fromMat4(m);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the TransformUBO of the fixed transform in _order, as NGLScene::loadMatricesToShader makes it
+//----------------------------------------------------------------------------------------------------------------------
+TransformUBO frameTransforms(const FrameState &_state, MatrixOrder _order)
+{
+  TransformUBO ubo;
+  auto model = AffineTransform::fromMat4(&_state.mouseGlobalTX.m_openGL[0]) * _state.transforms[static_cast<size_t>(_order)];
+  model.toMat4(&ubo.M.m_openGL[0]);
+  ubo.MVP = _state.project * _state.view * ubo.M;
+  auto linear = AffineTransform::classify(s_scale, _order != MatrixOrder::GIMBALLOCK);
+  model.normalMatrix(linear, s_scale, &ubo.normalMatrix[0][0], 4);
+  return ubo;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the same work as NGLScene::paintGL for a single (not instanced) object
+//----------------------------------------------------------------------------------------------------------------------
+void drawFrame(const FrameState &_state, const FrameConfig &_config)
+{
+  const auto &name = SceneResources::primitiveNames()[_config.primitive];
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  ngl::ShaderLib::use(SceneResources::PBR);
+  TransformUBO ubo = frameTransforms(_state, _config.order);
+  _state.transformRing->upload(&ubo);
+  ngl::ShaderLib::setUniform("albedo", ngl::Vec3(0.5f, 0.5f, 0.5f));
+  glPolygonMode(GL_FRONT_AND_BACK, _config.wireframe ? GL_LINE : GL_FILL);
+  ngl::VAOPrimitives::draw(name);
+  if (_config.normals)
+  {
+    auto lines = _state.normalLines.find(name);
+    bool prebuilt = !_state.geometryShaderNormals && lines != _state.normalLines.end() && lines->second;
+    ngl::ShaderLib::use(prebuilt ? SceneResources::NormalLineShader : SceneResources::NormalShader);
+    ngl::ShaderLib::setUniform("MVP", ubo.MVP);
+    ngl::ShaderLib::setUniform("normalSize", 0.6f);
+    if (prebuilt)
+    {
+      lines->second->bind();
+      lines->second->draw();
+      lines->second->unbind();
+    }
+    else
+    {
+      ngl::VAOPrimitives::draw(name);
+    }
+  }
+  if (_config.axis)
+  {
+    _state.axis->draw(_state.view, _state.project, _state.mouseGlobalTX);
+  }
+  _state.transformRing->endFrame();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief name of a configuration in the results, e.g. teapot/RTS/wire+normals, the geometry
+/// shader normals are +gsnormals so the two are never compared with each other's baseline
+//----------------------------------------------------------------------------------------------------------------------
+std::string configName(const FrameState &_state, const FrameConfig &_config)
+{
+  const char *normals = _state.geometryShaderNormals ? "+gsnormals" : "+normals";
+  return SceneResources::primitiveNames()[_config.primitive] + "/" + matrixOrderName(_config.order) + "/" +
+         (_config.wireframe ? "wire" : "fill") + (_config.normals ? normals : "");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief draw _frames frames of one configuration recording the cpu submit time and the
+/// gpu time from a GL_TIME_ELAPSED query, each frame is finished before the next starts
+//----------------------------------------------------------------------------------------------------------------------
+void timeConfig(const FrameState &_state, const FrameConfig &_config, int _warmup, int _frames,
+                BenchResult &_cpu, BenchResult &_gpu)
+{
+  for (int i = 0; i < _warmup; ++i)
+  {
+    drawFrame(_state, _config);
+  }
+  glFinish();
+  for (int i = 0; i < _frames; ++i)
+  {
+    auto start = std::chrono::steady_clock::now();
+    glBeginQuery(GL_TIME_ELAPSED, _state.query);
+    drawFrame(_state, _config);
+    glEndQuery(GL_TIME_ELAPSED);
+    auto end = std::chrono::steady_clock::now();
+    // waiting for the result here is fine as the cpu time has already been taken
+    GLuint64 gpuNs = 0;
+    glGetQueryObjectui64v(_state.query, GL_QUERY_RESULT, &gpuNs);
+    _cpu.samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    _gpu.samples.push_back(static_cast<double>(gpuNs));
+  }
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the triangles of _name read back from its VAO the way NGLScene draws them in software
+/// @returns false if the mesh can't be read back or has no float3 position and normal
+//----------------------------------------------------------------------------------------------------------------------
+bool softwareMesh(const std::string &_name, std::vector<char> &o_data, SoftwareRasterizer::Mesh &o_mesh)
+{
+  auto *vao = ngl::VAOPrimitives::getVAOFromName(_name);
+  std::vector<GeometryCache::Attribute> attributes;
+  if (vao == nullptr || vao->getMode() != GL_TRIANGLES || !GeometryCache::readBack(vao, attributes, o_data))
+  {
+    return false;
+  }
+  const GeometryCache::Attribute *position = nullptr;
+  const GeometryCache::Attribute *normal = nullptr;
+  for (auto &a : attributes)
+  {
+    if (a.type == GL_FLOAT && a.size == 3 && a.location == 0)
+    {
+      position = &a;
+    }
+    else if (a.type == GL_FLOAT && a.size == 3 && a.location == 1)
+    {
+      normal = &a;
+    }
+  }
+  if (position == nullptr || normal == nullptr || position->stride != normal->stride || position->stride == 0)
+  {
+    return false;
+  }
+  const size_t end = std::max(position->offset, normal->offset) + 3 * sizeof(float);
+  o_mesh.data = o_data.data();
+  o_mesh.stride = position->stride;
+  o_mesh.position = position->offset;
+  o_mesh.normal = normal->offset;
+  o_mesh.vertices = o_data.size() < end ? 0 : std::min(vao->numIndices(), (o_data.size() - end) / position->stride + 1);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the bound framebuffer's colour, top row first like the SoftwareRasterizer's image
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<uint8_t> readFramebuffer(int _width, int _height)
+{
+  std::vector<uint8_t> pixels(size_t(_width) * _height * 4);
+  glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  const size_t row = size_t(_width) * 4;
+  for (int y = 0; y < _height / 2; ++y)
+  {
+    std::swap_ranges(pixels.begin() + y * row, pixels.begin() + (y + 1) * row, pixels.begin() + (_height - 1 - y) * row);
+  }
+  return pixels;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief draw every primitive filled in every order, without the normals and axis, with GL and
+/// with the SoftwareRasterizer and compare the two frames. The software frame is timed over _frames
+/// @returns false if a primitive can't be drawn in software or more than _maxDiffering percent of
+/// the pixels of any frame differ
+//----------------------------------------------------------------------------------------------------------------------
+bool compareSoftware(const FrameState &_state, int _width, int _height, int _frames, double _maxDiffering,
+                     const std::string &_imageDir, std::vector<BenchResult> &_results)
+{
+  ThreadPool pool;
+  SoftwareRasterizer rasterizer(pool);
+  bool matches = true;
+  std::cout << std::left << std::setw(44) << "software vs gl" << std::right << std::setw(10) << "ms"
+            << std::setw(12) << "differing %" << std::setw(6) << "max" << std::setw(8) << "mean" << '\n';
+  for (size_t p = 0; p < SceneResources::NumPrimitives; ++p)
+  {
+    const auto &name = SceneResources::primitiveNames()[p];
+    std::vector<char> data;
+    SoftwareRasterizer::Mesh mesh;
+    if (!softwareMesh(name, data, mesh))
+    {
+      std::cerr << name << " can't be read back for the software renderer\n";
+      matches = false;
+      continue;
+    }
+    for (auto order : s_matrixOrders)
+    {
+      FrameConfig config{p, order, false, false, false};
+      drawFrame(_state, config);
+      auto gl = readFramebuffer(_width, _height);
+      auto ubo = frameTransforms(_state, order);
+      SoftwareRasterizer::Transforms transforms;
+      static_assert(sizeof(transforms) == sizeof(ubo), "the software transforms must have the TransformUBO layout");
+      std::memcpy(&transforms, &ubo, sizeof(transforms));
+      const SoftwareRasterizer::Material material;
+      auto result = runBench("software/" + name + "/" + matrixOrderName(order), 1, 0, _frames, [&]()
+                             { rasterizer.render(mesh, transforms, material, _width, _height); });
+      auto difference = SoftwareRasterizer::compare(rasterizer.image().rgba.data(), gl.data(), size_t(_width) * _height, 2);
+      std::cout << std::left << std::setw(44) << result.name << std::right << std::fixed << std::setprecision(3)
+                << std::setw(10) << result.median() / 1.0e6 << std::setw(12) << difference.differingPercent()
+                << std::setw(6) << difference.maxDifference << std::setw(8) << difference.meanDifference << '\n';
+      if (difference.differingPercent() > _maxDiffering)
+      {
+        std::cerr << result.name << " differs from GL at " << difference.differing << " pixels\n";
+        matches = false;
+      }
+      if (!_imageDir.empty())
+      {
+        rasterizer.writePPM(_imageDir + "/" + name + "_" + matrixOrderName(order) + ".ppm");
+      }
+      _results.push_back(std::move(result));
+    }
+  }
+  // the tile breakdown of the last frame drawn
+  std::cout << rasterizer.stats().summary() << '\n';
+  return matches;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief time building every generated primitive and the axis the way NGLScene::initializeGL
+/// does, without a cache, with an empty cache (which also fills it) and with a full one
+//----------------------------------------------------------------------------------------------------------------------
+void timeStartup(GeometryCache &_cache, int _reps, std::vector<BenchResult> &_results)
+{
+  auto build = [](GeometryCache *_with)
+  {
+    SceneResources::createPrimitives(_with);
+    Axis axis(SceneResources::AxisShader, 1.5f, _with);
+    // make sure the uploads are part of the time
+    glFinish();
+  };
+  _results.push_back(runBench("startup/geometry/nocache", 1, 1, _reps, [&]() { build(nullptr); }));
+  _results.push_back(runBench("startup/geometry/cold", 1, 0, _reps, [&]()
+                              {
+                                _cache.clear();
+                                build(&_cache);
+                              }));
+  _cache.resetStats();
+  _results.push_back(runBench("startup/geometry/warm", 1, 0, _reps, [&]() { build(&_cache); }));
+  std::cout << "warm " << _cache.summary() << '\n';
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  // no display is needed, but let the user pick a different platform if they want
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+  {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  int frames = std::stoi(argValue(argc, argv, "-f", "30"));
+  int width = std::stoi(argValue(argc, argv, "-w", "1024"));
+  int height = std::stoi(argValue(argc, argv, "-h", "720"));
+  // -f sets the repetitions of each frame configuration instead of -r
+  const BenchOptions options = benchOptions(argc, argv);
+  std::string cacheDir = argValue(argc, argv, "--cache", "");
+  int startupReps = std::stoi(argValue(argc, argv, "--startup-reps", "5"));
+  bool startupOnly = hasArg(argc, argv, "--startup-only");
+  bool geometryShaderNormals = hasArg(argc, argv, "--gs-normals");
+  bool orphanUBO = hasArg(argc, argv, "--orphan-ubo");
+  bool software = hasArg(argc, argv, "--software");
+  double maxDiffering = std::stod(argValue(argc, argv, "--max-differing", "1"));
+  std::string softwareImages = argValue(argc, argv, "--software-images", "");
+
+  QGuiApplication app(argc, argv);
+  QSurfaceFormat format;
+  format.setMajorVersion(4);
+  format.setMinorVersion(1);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  format.setDepthBufferSize(24);
+
+  QOpenGLContext context;
+  context.setFormat(format);
+  if (!context.create())
+  {
+    std::cerr << "unable to create an OpenGL 4.1 core context\n";
+    return EXIT_FAILURE;
+  }
+  QOffscreenSurface surface;
+  surface.setFormat(context.format());
+  surface.create();
+  if (!context.makeCurrent(&surface))
+  {
+    std::cerr << "unable to make the offscreen context current\n";
+    return EXIT_FAILURE;
+  }
+  // the default framebuffer of an offscreen surface may not exist so draw into an fbo
+  QOpenGLFramebufferObject fbo(width, height, QOpenGLFramebufferObject::Depth);
+  fbo.bind();
+
+  ngl::NGLInit::initialize();
+  std::cout << "renderer " << glGetString(GL_RENDERER) << " " << width << "x" << height
+            << " " << frames << " frames per configuration\n";
+  glViewport(0, 0, width, height);
+  glClearColor(0.5f, 0.5f, 0.5f, 0.0f);
+  glEnable(GL_DEPTH_TEST);
+
+  FrameState state;
+  ngl::Vec3 from(0.0f, 0.0f, 8.0f);
+  state.view = ngl::lookAt(from, ngl::Vec3(0.0f, 0.0f, 0.0f), ngl::Vec3(0.0f, 1.0f, 0.0f));
+  state.project = ngl::perspective(45.0f, static_cast<float>(width) / height, 0.05f, 450.0f);
+  state.mouseGlobalTX = ngl::Mat4::rotateY(25.0f) * ngl::Mat4::rotateX(15.0f);
+  composeTransforms(state);
+  state.geometryShaderNormals = geometryShaderNormals;
+
+  std::vector<BenchResult> results;
+  // by default the cache lives in a directory that is removed on exit so every run starts cold
+  QTemporaryDir tempDir;
+  std::string cacheRoot = cacheDir.empty() ? tempDir.path().toStdString() : cacheDir;
+  GeometryCache cache(cacheRoot + "/geometry");
+  ProgramCache programCache(cacheRoot + "/programs");
+  timeStartup(cache, startupReps, results);
+  for (size_t i = 0; i < 3; ++i)
+  {
+    std::cout << std::left << std::setw(44) << results[i].name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << results[i].median() / 1.0e6 << " ms median\n";
+  }
+  std::cout << "warm cache start up is " << std::setprecision(1) << results[1].median() / results[2].median()
+            << "x faster than cold and " << results[0].median() / results[2].median() << "x faster than no cache\n";
+
+  SceneResources::loadShaders(from, &programCache);
+  std::cout << programCache.summary() << '\n';
+  state.transformRing = std::make_unique<UniformRing>(SceneResources::TransformBinding, sizeof(TransformUBO));
+  state.transformRing->initializeGL(!orphanUBO);
+  state.axis.reset(new Axis(SceneResources::AxisShader, 1.5f, &cache));
+  glGenQueries(1, &state.query);
+  if (!geometryShaderNormals && !startupOnly)
+  {
+    // built once up front, the app does the same the first time a mesh's normals are shown
+    ThreadPool pool;
+    auto start = std::chrono::steady_clock::now();
+    for (auto &name : SceneResources::primitiveNames())
+    {
+      state.normalLines[name] = NormalLines::create(ngl::VAOPrimitives::getVAOFromName(name), &pool);
+    }
+    std::cout << "normal lines built in " << std::setprecision(3)
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+              << " ms\n";
+  }
+
+  for (size_t p = 0; p < (startupOnly ? 0 : SceneResources::NumPrimitives); ++p)
+  {
+    for (auto order : s_matrixOrders)
+    {
+      for (int flags = 0; flags < 4; ++flags)
+      {
+        FrameConfig config{p, order, (flags & 1) != 0, (flags & 2) != 0};
+        BenchResult cpu;
+        BenchResult gpu;
+        cpu.name = configName(state, config) + "/cpu";
+        gpu.name = configName(state, config) + "/gpu";
+        timeConfig(state, config, 2, frames, cpu, gpu);
+        results.push_back(std::move(cpu));
+        results.push_back(std::move(gpu));
+      }
+    }
+  }
+  bool softwareMatches = true;
+  if (software && !startupOnly)
+  {
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    softwareMatches = compareSoftware(state, width, height, std::max(frames / 10, 1), maxDiffering, softwareImages, results);
+  }
+  glDeleteQueries(1, &state.query);
+  std::cout << state.transformRing->summary() << '\n';
+  state.transformRing->releaseGL();
+  state.normalLines.clear();
+  fbo.release();
+
+  std::cout << std::left << std::setw(44) << "frame (ms)" << std::right
+            << std::setw(10) << "min" << std::setw(10) << "median" << std::setw(10) << "p99" << '\n';
+  for (auto &r : results)
+  {
+    std::cout << std::left << std::setw(44) << r.name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << r.min() / 1.0e6 << std::setw(10) << r.median() / 1.0e6
+              << std::setw(10) << r.percentile(99.0) / 1.0e6 << '\n';
+  }
+  const bool faster = reportResults(std::cout, options, "AffineTransformsFrame", results);
+  if (!faster)
+  {
+    std::cout << "frame times regressed by more than " << options.tolerance * 100.0 << "%\n";
+  }
+  if (software && !startupOnly)
+  {
+    return benchVerdict(std::cout, softwareMatches, faster, "every software frame matches the GL one",
+                        "SOFTWARE MISMATCH");
+  }
+  return faster ? EXIT_SUCCESS : EXIT_FAILURE;
+}
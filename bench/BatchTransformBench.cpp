@@ -0,0 +1,188 @@
+/// @file BatchTransformBench.cpp
+/// @brief streams a file of random parameters of every order through the BatchTransformer, from
+/// binary and csv input and to binary and csv output. Every matrix written must have exactly the
+/// bits the scalar kernel gives for its record on its own, and a damaged csv must be reported
+/// with its line. Prints the records per second of each.
+/// usage BatchTransformBench [-n records] [-t threads] [-c chunk records] [-r repetitions] [--json file] [--baseline file] [--tolerance percent]
+#include "Bench.h"
+#include "BatchTransformer.h"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<BatchTransformer::Record> randomRecords(size_t _count)
+{
+  std::mt19937 rng(2468);
+  std::uniform_int_distribution<int32_t> order(0, 5);
+  std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+  std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+  std::vector<BatchTransformer::Record> records(_count);
+  for (size_t i = 0; i < _count; ++i)
+  {
+    auto &r = records[i];
+    // runs of one order as well as mixed chunks, so both ways through a chunk are covered
+    r.order = i < _count / 4 ? 3 : order(rng);
+    for (int c = 0; c < 3; ++c)
+    {
+      r.translate[c] = value(rng);
+      r.rotate[c] = angle(rng);
+      r.scale[c] = 0.1f + std::abs(value(rng));
+    }
+    r.euler[0] = angle(rng);
+    r.euler[1] = value(rng);
+    r.euler[2] = value(rng);
+    r.euler[3] = value(rng);
+  }
+  return records;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief each record composed on its own by the scalar kernel
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<float> reference(const std::vector<BatchTransformer::Record> &_records)
+{
+  std::vector<float> matrices(_records.size() * 16);
+  TransformParams params;
+  params.resize(1);
+  for (size_t i = 0; i < _records.size(); ++i)
+  {
+    auto &r = _records[i];
+    params.set(0, r.translate[0], r.translate[1], r.translate[2], r.rotate[0], r.rotate[1], r.rotate[2],
+               r.scale[0], r.scale[1], r.scale[2], r.euler[0], r.euler[1], r.euler[2], r.euler[3]);
+    TransformBatch::compose(s_matrixOrders[r.order], params, &matrices[i * 16], TransformBatch::Kernel::SCALAR);
+  }
+  return matrices;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<float> readBinary(const std::string &_fileName)
+{
+  std::ifstream in(_fileName, std::ios::binary | std::ios::ate);
+  std::vector<float> data(static_cast<size_t>(in.tellg()) / sizeof(float));
+  in.seekg(0);
+  in.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(float)));
+  return data;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<float> readCSV(const std::string &_fileName)
+{
+  std::ifstream in(_fileName, std::ios::binary);
+  std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::vector<float> data;
+  const char *p = text.data();
+  const char *end = p + text.size();
+  while (p < end)
+  {
+    float value;
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc())
+    {
+      break;
+    }
+    data.push_back(value);
+    p = result.ptr + 1;
+  }
+  return data;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool check(const std::string &_name, const std::vector<float> &_matrices, const std::vector<float> &_expected)
+{
+  if (_matrices.size() != _expected.size())
+  {
+    std::cerr << _name << " wrote " << _matrices.size() / 16 << " matrices of " << _expected.size() / 16 << '\n';
+    return false;
+  }
+  for (size_t i = 0; i < _expected.size(); ++i)
+  {
+    if (std::memcmp(&_matrices[i], &_expected[i], sizeof(float)) != 0)
+    {
+      std::cerr << _name << " matrix " << i / 16 << " element " << i % 16 << " is " << _matrices[i] << " expected "
+                << _expected[i] << '\n';
+      return false;
+    }
+  }
+  return true;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t count = std::stoul(argValue(argc, argv, "-n", "1000000"));
+  size_t threads = std::stoul(argValue(argc, argv, "-t", "0"));
+  size_t chunkRecords = std::stoul(argValue(argc, argv, "-c", "65536"));
+  const BenchOptions options = benchOptions(argc, argv, 5);
+  const std::string binaryIn = "BatchTransformBench.bin";
+  const std::string csvIn = "BatchTransformBench.csv";
+  const std::string binaryOut = "BatchTransformBench.out";
+  const std::string csvOut = "BatchTransformBench.out.csv";
+
+  auto records = randomRecords(count);
+  {
+    std::ofstream out(binaryIn, std::ios::binary);
+    BatchTransformer::writeHeader(out);
+    out.write(reinterpret_cast<const char *>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(records[0])));
+    std::string text = "order,tx,ty,tz,rx,ry,rz,sx,sy,sz,angle,axisx,axisy,axisz\n# a comment\n\n";
+    for (auto &r : records)
+    {
+      BatchTransformer::appendCSV(text, r);
+    }
+    std::ofstream csv(csvIn, std::ios::binary);
+    csv << text;
+  }
+  auto expected = reference(records);
+
+  ThreadPool pool(threads);
+  BatchTransformer transformer(pool, chunkRecords);
+  bool exact = true;
+  std::vector<BenchResult> results;
+  auto run = [&](const std::string &_name, const std::string &_in, const std::string &_out)
+  {
+    results.push_back(runBench(_name, count, 1, options.reps, [&]()
+                               {
+                                 if (!transformer.transform(_in, _out))
+                                 {
+                                   std::cerr << transformer.error() << '\n';
+                                   exact = false;
+                                 }
+                               }));
+    auto &stats = transformer.stats();
+    std::cout << _name << " compose " << stats.computeSeconds << " s write " << stats.writeSeconds
+              << " s, reader waited " << stats.readWaitSeconds << " s writer waited " << stats.writeWaitSeconds << " s\n";
+  };
+  run("batchtransform/binary", binaryIn, binaryOut);
+  exact = check("binary", readBinary(binaryOut), expected) && exact;
+  run("batchtransform/csv-in", csvIn, binaryOut);
+  exact = check("csv input", readBinary(binaryOut), expected) && exact;
+  run("batchtransform/csv-out", binaryIn, csvOut);
+  exact = check("csv output", readCSV(csvOut), expected) && exact;
+  printResults(std::cout, results);
+  std::cout << "records/s binary " << results[0].opsPerSecond() << " csv in " << results[1].opsPerSecond()
+            << " csv out " << results[2].opsPerSecond() << " with " << pool.size() << " threads\n";
+
+  // a bad line stops the run and names the line, counting the header, comment and blank line
+  {
+    std::ofstream csv(csvIn, std::ios::binary | std::ios::trunc);
+    csv << "order,tx,ty,tz,rx,ry,rz,sx,sy,sz,angle,axisx,axisy,axisz\n# a comment\n\nRTS,1,2,3,0,0,0,1,1,1,0,1,0,0\n"
+           "TRS,1,2,3,0,0\n";
+  }
+  if (transformer.transform(csvIn, binaryOut) || transformer.error().find("line 5") == std::string::npos)
+  {
+    std::cerr << "a damaged csv gave '" << transformer.error() << "'\n";
+    exact = false;
+  }
+  for (auto &f : {binaryIn, csvIn, binaryOut, csvOut})
+  {
+    std::remove(f.c_str());
+  }
+
+  const bool faster = reportResults(std::cout, options, "BatchTransform", results);
+  return benchVerdict(std::cout, exact, faster, "every matrix matches the scalar reference", "BATCHTRANSFORM MISMATCH");
+}
@@ -0,0 +1,298 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Bench.h
+/// @brief minimal timing harness shared by the benchmark executables, each benchmark is
+/// run a few times to warm up and then timed over a number of repetitions. The options,
+/// reports and final verdict every benchmark's main has are here too
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the timing of one benchmark
+//----------------------------------------------------------------------------------------------------------------------
+struct BenchResult
+{
+  std::string name;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief how many operations one repetition does
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t opsPerRep = 1;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief nano seconds per operation for each repetition
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<double> samples;
+
+  double mean() const
+  {
+    double sum = 0.0;
+    for (auto s : samples)
+    {
+      sum += s;
+    }
+    return samples.empty() ? 0.0 : sum / samples.size();
+  }
+  double stddev() const
+  {
+    if (samples.size() < 2)
+    {
+      return 0.0;
+    }
+    double m = mean();
+    double sum = 0.0;
+    for (auto s : samples)
+    {
+      sum += (s - m) * (s - m);
+    }
+    return std::sqrt(sum / (samples.size() - 1));
+  }
+  double min() const { return samples.empty() ? 0.0 : *std::min_element(samples.begin(), samples.end()); }
+  double median() const { return percentile(50.0); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief nearest rank percentile of the samples, _p in [0,100]
+  //----------------------------------------------------------------------------------------------------------------------
+  double percentile(double _p) const
+  {
+    if (samples.empty())
+    {
+      return 0.0;
+    }
+    auto s = samples;
+    std::sort(s.begin(), s.end());
+    size_t rank = static_cast<size_t>(std::ceil(_p / 100.0 * s.size()));
+    return s[std::min(std::max(rank, size_t(1)), s.size()) - 1];
+  }
+  double opsPerSecond() const { return min() > 0.0 ? 1.0e9 / min() : 0.0; }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief stop the compiler removing a result we don't otherwise use
+//----------------------------------------------------------------------------------------------------------------------
+template <typename T>
+inline void doNotOptimise(const T &_value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(_value) : "memory");
+#else
+  static volatile const T *sink;
+  sink = &_value;
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief time _func which performs _opsPerRep operations each call
+/// @param[in] _warmup number of untimed calls first
+/// @param[in] _reps number of timed calls
+//----------------------------------------------------------------------------------------------------------------------
+template <typename Func>
+BenchResult runBench(const std::string &_name, size_t _opsPerRep, int _warmup, int _reps, Func &&_func)
+{
+  BenchResult result;
+  result.name = _name;
+  result.opsPerRep = _opsPerRep;
+  for (int i = 0; i < _warmup; ++i)
+  {
+    _func();
+  }
+  for (int i = 0; i < _reps; ++i)
+  {
+    auto start = std::chrono::steady_clock::now();
+    _func();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    result.samples.push_back(ns / static_cast<double>(_opsPerRep));
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief human readable table of results
+//----------------------------------------------------------------------------------------------------------------------
+inline void printResults(std::ostream &_out, const std::vector<BenchResult> &_results)
+{
+  _out << std::left << std::setw(40) << "benchmark" << std::right
+       << std::setw(14) << "ns/op" << std::setw(12) << "stddev" << std::setw(18) << "ops/s" << '\n';
+  for (auto &r : _results)
+  {
+    _out << std::left << std::setw(40) << r.name << std::right << std::fixed
+         << std::setw(14) << std::setprecision(3) << r.min()
+         << std::setw(12) << std::setprecision(3) << r.stddev()
+         << std::setw(18) << std::setprecision(0) << r.opsPerSecond() << '\n';
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief machine readable version of the results so they can be tracked over time
+//----------------------------------------------------------------------------------------------------------------------
+inline void writeJSON(std::ostream &_out, const std::string &_suite, const std::vector<BenchResult> &_results)
+{
+  _out << "{\n  \"suite\": \"" << _suite << "\",\n  \"results\": [\n";
+  for (size_t i = 0; i < _results.size(); ++i)
+  {
+    auto &r = _results[i];
+    _out << "    {\"name\": \"" << r.name << "\""
+         << ", \"opsPerRep\": " << r.opsPerRep
+         << ", \"reps\": " << r.samples.size()
+         << std::setprecision(6) << std::defaultfloat
+         << ", \"minNsPerOp\": " << r.min()
+         << ", \"medianNsPerOp\": " << r.median()
+         << ", \"p99NsPerOp\": " << r.percentile(99.0)
+         << ", \"meanNsPerOp\": " << r.mean()
+         << ", \"stddevNs\": " << r.stddev()
+         << ", \"opsPerSecond\": " << r.opsPerSecond() << "}"
+         << (i + 1 < _results.size() ? ",\n" : "\n");
+  }
+  _out << "  ]\n}\n";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief read the median of each result back from a file written by writeJSON, this only
+/// understands the one result per line layout writeJSON produces
+//----------------------------------------------------------------------------------------------------------------------
+inline std::map<std::string, double> readBaseline(std::istream &_in)
+{
+  std::map<std::string, double> baseline;
+  const std::string nameKey = "\"name\": \"";
+  const std::string medianKey = "\"medianNsPerOp\": ";
+  std::string line;
+  while (std::getline(_in, line))
+  {
+    auto name = line.find(nameKey);
+    auto median = line.find(medianKey);
+    if (name == std::string::npos || median == std::string::npos)
+    {
+      continue;
+    }
+    name += nameKey.size();
+    auto nameEnd = line.find('"', name);
+    baseline[line.substr(name, nameEnd - name)] = std::strtod(line.c_str() + median + medianKey.size(), nullptr);
+  }
+  return baseline;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief print the change in median of each result against the baseline
+/// @param[in] _tolerance the fractional slow down allowed before a result counts as a regression
+/// @returns false if any result regressed
+//----------------------------------------------------------------------------------------------------------------------
+inline bool compareToBaseline(std::ostream &_out, const std::vector<BenchResult> &_results,
+                              const std::map<std::string, double> &_baseline, double _tolerance)
+{
+  bool ok = true;
+  _out << std::left << std::setw(40) << "benchmark" << std::right
+       << std::setw(14) << "baseline" << std::setw(14) << "now" << std::setw(10) << "change" << '\n';
+  for (auto &r : _results)
+  {
+    auto base = _baseline.find(r.name);
+    if (base == _baseline.end() || base->second <= 0.0)
+    {
+      _out << std::left << std::setw(40) << r.name << std::right << std::setw(38) << "new\n";
+      continue;
+    }
+    double change = r.median() / base->second - 1.0;
+    bool regressed = change > _tolerance;
+    ok = ok && !regressed;
+    _out << std::left << std::setw(40) << r.name << std::right << std::fixed
+         << std::setw(14) << std::setprecision(3) << base->second
+         << std::setw(14) << std::setprecision(3) << r.median()
+         << std::setw(9) << std::setprecision(1) << change * 100.0 << '%'
+         << (regressed ? "  REGRESSION" : "") << '\n';
+  }
+  return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief simple command line helpers, returns the value after _flag or _default
+//----------------------------------------------------------------------------------------------------------------------
+inline std::string argValue(int _argc, char **_argv, const std::string &_flag, const std::string &_default)
+{
+  for (int i = 1; i < _argc - 1; ++i)
+  {
+    if (_flag == _argv[i])
+    {
+      return _argv[i + 1];
+    }
+  }
+  return _default;
+}
+
+inline bool hasArg(int _argc, char **_argv, const std::string &_flag)
+{
+  for (int i = 1; i < _argc; ++i)
+  {
+    if (_flag == _argv[i])
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the options every benchmark takes, -r repetitions, --json file, --baseline file and
+/// --tolerance percent
+//----------------------------------------------------------------------------------------------------------------------
+struct BenchOptions
+{
+  int reps = 10;
+  std::string json;        ///< write the results here if not empty
+  std::string baseline;    ///< compare the results with this --json output if not empty
+  double tolerance = 0.1;  ///< the fractional slow down allowed against the baseline
+};
+
+inline BenchOptions benchOptions(int _argc, char **_argv, int _defaultReps = 10)
+{
+  BenchOptions options;
+  options.reps = std::stoi(argValue(_argc, _argv, "-r", std::to_string(_defaultReps)));
+  options.json = argValue(_argc, _argv, "--json", "");
+  options.baseline = argValue(_argc, _argv, "--baseline", "");
+  options.tolerance = std::stod(argValue(_argc, _argv, "--tolerance", "10")) / 100.0;
+  return options;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief write the results to the --json file and compare them with the --baseline one, each
+/// only if it was given
+/// @returns false if any result regressed
+//----------------------------------------------------------------------------------------------------------------------
+inline bool reportResults(std::ostream &_out, const BenchOptions &_options, const std::string &_suite,
+                          const std::vector<BenchResult> &_results)
+{
+  if (!_options.json.empty())
+  {
+    std::ofstream out(_options.json);
+    writeJSON(out, _suite, _results);
+  }
+  if (_options.baseline.empty())
+  {
+    return true;
+  }
+  std::ifstream in(_options.baseline);
+  return compareToBaseline(_out, _results, readBaseline(in), _options.tolerance);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief print the outcome of a benchmark's correctness checks as its last line, _passed or
+/// the upper case _mismatch
+/// @returns the exit code, a failure if the checks failed or a result regressed
+//----------------------------------------------------------------------------------------------------------------------
+inline int benchVerdict(std::ostream &_out, bool _correct, bool _faster, const std::string &_passed,
+                        const std::string &_mismatch)
+{
+  _out << (_correct ? _passed : _mismatch) << '\n';
+  return _correct && _faster ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
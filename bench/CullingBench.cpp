@@ -0,0 +1,170 @@
+/// @file CullingBench.cpp
+/// @brief frustum culling of a large grid of instances laid out the way NGLScene::updateInstances
+/// does, with the InstanceBVH against testing every box. The BVH must find exactly the same
+/// instances as the brute force test, which is checked after the build, after a full refit and
+/// after a sparse refit. Also times building the tree, a full refit and refitting a few
+/// scattered instances.
+/// usage CullingBench [-n instances] [-r repetitions] [--json file] [--baseline file] [--tolerance percent]
+#include "Bench.h"
+#include "InstanceBVH.h"
+#include "TransformBatch.h"
+#include <iostream>
+#include <random>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the instance grid of NGLScene::updateInstances with some rotation and scale, so the
+/// boxes aren't all the same
+//----------------------------------------------------------------------------------------------------------------------
+TransformParams gridParams(size_t _count, float _spacing)
+{
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+  std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+  int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(_count))));
+  float origin = -0.5f * _spacing * (side - 1);
+  TransformParams p;
+  p.resize(_count);
+  for (size_t i = 0; i < _count; ++i)
+  {
+    p.set(i, origin + _spacing * (i % side), origin + _spacing * ((i / side) % side), origin + _spacing * (i / (side * side)),
+          angle(gen), angle(gen), angle(gen), scale(gen), scale(gen), scale(gen), 0.0f, 1.0f, 0.0f, 0.0f);
+  }
+  return p;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a column major perspective * lookAt looking down -z from _z, as ngl::perspective
+//----------------------------------------------------------------------------------------------------------------------
+void cameraMatrix(float _fovy, float _aspect, float _near, float _far, float _z, float *o_clip)
+{
+  const float f = 1.0f / std::tan(_fovy * 3.14159265358979f / 360.0f);
+  std::fill(o_clip, o_clip + 16, 0.0f);
+  o_clip[0] = f / _aspect;
+  o_clip[5] = f;
+  o_clip[10] = (_far + _near) / (_near - _far);
+  o_clip[11] = -1.0f;
+  o_clip[14] = 2.0f * _far * _near / (_near - _far);
+  // the view is a translation by -_z along z, which only moves the last column
+  o_clip[14] += o_clip[10] * -_z;
+  o_clip[15] = _z;
+}
+
+void bruteForce(const Frustum &_frustum, const std::vector<Aabb> &_boxes, std::vector<uint32_t> &o_visible)
+{
+  o_visible.clear();
+  for (size_t i = 0; i < _boxes.size(); ++i)
+  {
+    if (_frustum.visible(_boxes[i]))
+    {
+      o_visible.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+bool sameSet(std::vector<uint32_t> _a, std::vector<uint32_t> _b)
+{
+  std::sort(_a.begin(), _a.end());
+  std::sort(_b.begin(), _b.end());
+  return _a == _b;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t count = std::stoul(argValue(argc, argv, "-n", "1000000"));
+  const BenchOptions options = benchOptions(argc, argv, 10);
+
+  // a unit cube mesh, the sphere and cube primitives both fit in it
+  Aabb mesh;
+  for (int a = 0; a < 3; ++a)
+  {
+    mesh.m_min[a] = -0.5f;
+    mesh.m_max[a] = 0.5f;
+  }
+  auto params = gridParams(count, 2.0f);
+  std::vector<float> matrices(count * 16);
+  TransformBatch::compose(MatrixOrder::TRS, params, matrices.data());
+  std::vector<Aabb> boxes(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    boxes[i] = mesh.transformed(&matrices[i * 16]);
+  }
+  // close enough to the grid that most of it is behind the camera or off to the side
+  float clip[16];
+  float side = 2.0f * std::ceil(std::cbrt(static_cast<double>(count)));
+  cameraMatrix(45.0f, 1024.0f / 720.0f, 0.05f, 450.0f, 0.25f * side, clip);
+  Frustum frustum(clip);
+
+  std::vector<BenchResult> results;
+  bool exact = true;
+  InstanceBVH bvh;
+  std::vector<uint32_t> visible;
+  std::vector<uint32_t> expected;
+  auto check = [&](const char *_what)
+  {
+    bvh.query(frustum, visible);
+    if (!sameSet(visible, expected))
+    {
+      std::cerr << "mismatch after " << _what << " " << visible.size() << " visible, expected " << expected.size() << '\n';
+      exact = false;
+    }
+  };
+  bruteForce(frustum, boxes, expected);
+  results.push_back(runBench("cull/build", count, 1, options.reps, [&]() { bvh.build(boxes.data(), count); }));
+  check("build");
+  std::cout << count << " instances " << bvh.nodes() << " nodes, " << expected.size() << " visible "
+            << count - expected.size() << " culled\n";
+  results.push_back(runBench("cull/bruteforce", count, 1, options.reps, [&]()
+                             {
+                               bruteForce(frustum, boxes, expected);
+                               doNotOptimise(expected.size());
+                             }));
+  bvh.resetStats();
+  results.push_back(runBench("cull/bvh", count, 1, options.reps, [&]()
+                             {
+                               bvh.query(frustum, visible);
+                               doNotOptimise(visible.size());
+                             }));
+  std::cout << "bvh query visits " << bvh.stats().nodesVisited / bvh.stats().queries << " nodes\n";
+
+  // every instance moved along by one grid step, as changing the ui translation does
+  for (auto &b : boxes)
+  {
+    b.m_min[0] += 2.0f;
+    b.m_max[0] += 2.0f;
+  }
+  results.push_back(runBench("cull/refit/full", count, 1, options.reps, [&]() { bvh.refit(boxes.data()); }));
+  bruteForce(frustum, boxes, expected);
+  check("full refit");
+
+  // one instance in ten thousand moved somewhere else in the grid
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(count - 1));
+  std::uniform_real_distribution<float> move(-4.0f, 4.0f);
+  std::vector<uint32_t> changed(std::max<size_t>(count / 10000, 1));
+  bvh.resetStats();
+  results.push_back(runBench("cull/refit/sparse", count, 1, options.reps, [&]()
+                             {
+                               for (auto &c : changed)
+                               {
+                                 c = pick(gen);
+                                 for (int a = 0; a < 3; ++a)
+                                 {
+                                   float d = move(gen);
+                                   boxes[c].m_min[a] += d;
+                                   boxes[c].m_max[a] += d;
+                                 }
+                               }
+                               bvh.refit(boxes.data(), changed.data(), changed.size());
+                             }));
+  std::cout << "sparse refit of " << changed.size() << " instances visits " << bvh.stats().nodesRefit / bvh.stats().refits
+            << " nodes\n";
+  bruteForce(frustum, boxes, expected);
+  check("sparse refit");
+
+  printResults(std::cout, results);
+  const bool faster = reportResults(std::cout, options, "Culling", results);
+  return benchVerdict(std::cout, exact, faster, "bvh matches the brute force test", "BVH MISMATCH");
+}
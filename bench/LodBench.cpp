@@ -0,0 +1,253 @@
+/// @file LodBench.cpp
+/// @brief the level of detail pieces on their own. A dense sphere laid out like ngl's scanned
+/// meshes is simplified at the cube counts SceneResources uses, and every simplified vertex
+/// must stay within one cube diagonal of the surface with its normal and uv untouched. Then a
+/// large instance grid has its levels selected serially and across a thread pool, which must
+/// agree with selecting each instance on its own, and a second pass with the same view must
+/// change nothing. Objects jittering either side of a threshold by less than the hysteresis
+/// must never change level. Prints the triangles the grid would submit with and without the
+/// levels.
+/// usage LodBench [-n instances] [-s sphere segments] [-r repetitions] [-t threads]
+///                [--json file] [--baseline file] [--tolerance percent]
+#include "Bench.h"
+#include "LodSelector.h"
+#include "MeshSimplifier.h"
+#include "ThreadPool.h"
+#include "TransformBatch.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief ngl's vertData layout, u,v nx,ny,nz x,y,z
+//----------------------------------------------------------------------------------------------------------------------
+constexpr size_t s_floats = 8;
+constexpr size_t s_stride = s_floats * sizeof(float);
+constexpr size_t s_position = 5 * sizeof(float);
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a unit radius uv sphere as a triangle list, the normal is the position
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<float> sphere(int _segments)
+{
+  const float pi = 3.14159265358979f;
+  auto vertex = [&](int _u, int _v, std::vector<float> &o_data)
+  {
+    const float theta = pi * _v / _segments;
+    const float phi = 2.0f * pi * _u / _segments;
+    const float p[3] = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+    o_data.insert(o_data.end(), {static_cast<float>(_u) / _segments, static_cast<float>(_v) / _segments,
+                                 p[0], p[1], p[2], p[0], p[1], p[2]});
+  };
+  std::vector<float> data;
+  for (int v = 0; v < _segments; ++v)
+  {
+    for (int u = 0; u < _segments; ++u)
+    {
+      vertex(u, v, data);
+      vertex(u + 1, v + 1, data);
+      vertex(u + 1, v, data);
+      vertex(u, v, data);
+      vertex(u, v + 1, data);
+      vertex(u + 1, v + 1, data);
+    }
+  }
+  return data;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief every vertex of _simplified is within _tolerance of the unit sphere and has a unit
+/// normal and a uv copied from the original
+//----------------------------------------------------------------------------------------------------------------------
+bool closeToSphere(const std::vector<char> &_simplified, float _tolerance)
+{
+  for (size_t v = 0; v < _simplified.size() / s_stride; ++v)
+  {
+    float vertex[s_floats];
+    std::memcpy(vertex, _simplified.data() + v * s_stride, s_stride);
+    const float r = std::sqrt(vertex[5] * vertex[5] + vertex[6] * vertex[6] + vertex[7] * vertex[7]);
+    const float n = std::sqrt(vertex[2] * vertex[2] + vertex[3] * vertex[3] + vertex[4] * vertex[4]);
+    if (std::abs(r - 1.0f) > _tolerance || std::abs(n - 1.0f) > 1e-5f || vertex[0] < 0.0f || vertex[0] > 1.0f)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the instance grid of NGLScene::updateInstances with some scale, so the sizes vary
+//----------------------------------------------------------------------------------------------------------------------
+TransformParams gridParams(size_t _count, float _spacing)
+{
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+  std::uniform_real_distribution<float> scale(0.25f, 2.0f);
+  int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(_count))));
+  float origin = -0.5f * _spacing * (side - 1);
+  TransformParams p;
+  p.resize(_count);
+  for (size_t i = 0; i < _count; ++i)
+  {
+    float s = scale(gen);
+    p.set(i, origin + _spacing * (i % side), origin + _spacing * ((i / side) % side), origin + _spacing * (i / (side * side)),
+          angle(gen), angle(gen), angle(gen), s, s, s, 0.0f, 1.0f, 0.0f, 0.0f);
+  }
+  return p;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a column major perspective * lookAt looking down -z from _z, as ngl::perspective
+//----------------------------------------------------------------------------------------------------------------------
+void cameraMatrix(float _fovy, float _aspect, float _near, float _far, float _z, float *o_clip)
+{
+  const float f = 1.0f / std::tan(_fovy * 3.14159265358979f / 360.0f);
+  std::fill(o_clip, o_clip + 16, 0.0f);
+  o_clip[0] = f / _aspect;
+  o_clip[5] = f;
+  o_clip[10] = (_far + _near) / (_near - _far);
+  o_clip[11] = -1.0f;
+  o_clip[14] = 2.0f * _far * _near / (_near - _far);
+  o_clip[14] += o_clip[10] * -_z;
+  o_clip[15] = _z;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief sizes jittering less than the hysteresis either side of each threshold
+/// @returns true if none of them changes level after the first selection
+//----------------------------------------------------------------------------------------------------------------------
+bool stableAtThresholds(const LodSelector &_selector)
+{
+  const float jitter = 0.5f * _selector.hysteresis();
+  for (float threshold : _selector.thresholds())
+  {
+    for (float start : {1.0f + jitter, 1.0f - jitter})
+    {
+      uint8_t level = _selector.select(threshold * start, LodSelector::NoLevel);
+      for (int i = 0; i < 100; ++i)
+      {
+        float size = threshold * (i % 2 == 0 ? 1.0f - jitter : 1.0f + jitter);
+        if (_selector.select(size, level) != level)
+        {
+          return false;
+        }
+      }
+      // and a real change of size still changes level
+      if (_selector.select(threshold * (start > 1.0f ? 0.5f : 2.0f), level) == level)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t count = std::stoul(argValue(argc, argv, "-n", "1000000"));
+  int segments = std::stoi(argValue(argc, argv, "-s", "320"));
+  const BenchOptions options = benchOptions(argc, argv, 10);
+  size_t threads = std::stoul(argValue(argc, argv, "-t", "0"));
+
+  std::vector<BenchResult> results;
+  bool exact = true;
+  // the levels SceneResources makes of the scanned meshes, the sphere is 2 units across
+  auto mesh = sphere(segments);
+  const size_t vertices = mesh.size() / s_floats;
+  std::vector<size_t> triangles = {vertices / 3};
+  std::cout << "sphere of " << triangles[0] << " triangles\n";
+  for (unsigned int cells : {64u, 32u, 16u})
+  {
+    std::vector<char> simplified;
+    results.push_back(runBench("lod/simplify/" + std::to_string(cells), vertices, 1, options.reps, [&]()
+                               {
+                                 simplified = MeshSimplifier::cluster(reinterpret_cast<const char *>(mesh.data()),
+                                                                      vertices, s_stride, s_position, cells);
+                               }));
+    triangles.push_back(simplified.size() / s_stride / 3);
+    std::cout << cells << " cubes: " << triangles.back() << " triangles\n";
+    const float diagonal = std::sqrt(3.0f) * 2.0f / cells;
+    if (!closeToSphere(simplified, diagonal) || triangles.back() >= triangles[triangles.size() - 2])
+    {
+      std::cerr << "simplified sphere at " << cells << " cubes is wrong\n";
+      exact = false;
+    }
+  }
+
+  ThreadPool pool(threads);
+  LodSelector selector;
+  Aabb box;
+  for (int a = 0; a < 3; ++a)
+  {
+    box.m_min[a] = -1.0f;
+    box.m_max[a] = 1.0f;
+  }
+  auto params = gridParams(count, 3.0f);
+  std::vector<float> matrices(count * 16);
+  TransformBatch::compose(MatrixOrder::TRS, params, matrices.data());
+  float clip[16];
+  const float side = 3.0f * std::ceil(std::cbrt(static_cast<double>(count)));
+  cameraMatrix(45.0f, 1024.0f / 720.0f, 0.05f, 450.0f, 0.6f * side, clip);
+  const float pixelScale = 0.5f * clip[5] * 720.0f;
+
+  // each instance on its own with no history
+  std::vector<uint8_t> expected(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    expected[i] = selector.select(LodSelector::screenSize(box, &matrices[i * 16], clip, pixelScale), LodSelector::NoLevel);
+  }
+  std::vector<uint8_t> levels(count);
+  size_t changed = 0;
+  auto check = [&](const char *_what, size_t _expectedChanges)
+  {
+    if (levels != expected || changed != _expectedChanges)
+    {
+      std::cerr << "mismatch after " << _what << ", " << changed << " changes\n";
+      exact = false;
+    }
+  };
+  results.push_back(runBench("lod/select/serial", count, 1, options.reps, [&]()
+                             {
+                               std::fill(levels.begin(), levels.end(), LodSelector::NoLevel);
+                               changed = selector.select(box, matrices.data(), nullptr, count, clip, pixelScale,
+                                                         levels.data());
+                             }));
+  check("serial", count);
+  results.push_back(runBench("lod/select/parallel", count, 1, options.reps, [&]()
+                             {
+                               std::fill(levels.begin(), levels.end(), LodSelector::NoLevel);
+                               changed = selector.select(box, matrices.data(), nullptr, count, clip, pixelScale,
+                                                         levels.data(), &pool);
+                             }));
+  check("parallel", count);
+  changed = selector.select(box, matrices.data(), nullptr, count, clip, pixelScale, levels.data(), &pool);
+  check("same view", 0);
+  if (!stableAtThresholds(selector))
+  {
+    std::cerr << "objects on a threshold change level\n";
+    exact = false;
+  }
+
+  std::vector<size_t> perLevel(selector.levels());
+  size_t submitted = 0;
+  for (auto level : levels)
+  {
+    ++perLevel[level];
+    submitted += triangles[level];
+  }
+  std::cout << count << " instances on " << pool.size() << " threads, per level";
+  for (auto n : perLevel)
+  {
+    std::cout << ' ' << n;
+  }
+  std::cout << "\n" << submitted << " triangles submitted instead of " << count * triangles[0] << " ("
+            << 100.0 * submitted / (count * triangles[0]) << "%)\n";
+
+  printResults(std::cout, results);
+  const bool faster = reportResults(std::cout, options, "Lod", results);
+  return benchVerdict(std::cout, exact, faster, "levels and simplified meshes are correct", "LOD MISMATCH");
+}
@@ -0,0 +1,188 @@
+/// @file MailboxBench.cpp
+/// @brief hands snapshots the size of NGLScene's parameters from a producer thread to a consumer
+/// thread that takes them as fast as it can, as the gui and render threads do, through the lock
+/// free SnapshotMailbox and through a mailbox guarded by a mutex. Every float of a snapshot is
+/// its sequence number so the consumer checks it never sees a mix of two snapshots, that the
+/// sequence only goes up and that the last snapshot it takes is the last one published. The
+/// producer waits for a take every s_pace publishes so even on one core the consumer takes
+/// enough snapshots for the checks to mean something.
+/// usage MailboxBench [-n publishes] [-r repetitions] [--json file] [--baseline file] [--tolerance percent]
+#include "Bench.h"
+#include "SnapshotMailbox.h"
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief about the size of NGLScene::SceneParams
+//----------------------------------------------------------------------------------------------------------------------
+struct Snapshot
+{
+  uint64_t sequence = 0;
+  float values[48] = {};
+};
+
+void fill(Snapshot &o_snapshot, uint64_t _sequence)
+{
+  o_snapshot.sequence = _sequence;
+  // exact while the sequence is below 2^24, which -n is kept under
+  std::fill(std::begin(o_snapshot.values), std::end(o_snapshot.values), static_cast<float>(_sequence));
+}
+
+bool whole(const Snapshot &_snapshot)
+{
+  const float expected = static_cast<float>(_snapshot.sequence);
+  return std::all_of(std::begin(_snapshot.values), std::end(_snapshot.values),
+                     [expected](float _v) { return _v == expected; });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief publishes between the producer's waits for the consumer to take something, a run
+/// takes at least _count / s_pace snapshots
+//----------------------------------------------------------------------------------------------------------------------
+constexpr uint64_t s_pace = 64;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the obvious alternative, both sides copy the snapshot under a lock
+//----------------------------------------------------------------------------------------------------------------------
+class LockedMailbox
+{
+public :
+  void publish(const Snapshot &_value)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_value = _value;
+    m_fresh = true;
+  }
+  bool take(Snapshot &o_value)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_fresh)
+    {
+      return false;
+    }
+    o_value = m_value;
+    m_fresh = false;
+    return true;
+  }
+
+private :
+  std::mutex m_mutex;
+  Snapshot m_value;
+  bool m_fresh = false;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief what the consumer saw in one run
+//----------------------------------------------------------------------------------------------------------------------
+struct Exchange
+{
+  uint64_t taken = 0;
+  uint64_t last = 0;
+  bool torn = false;
+  bool backwards = false;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief publish snapshots 1.._count while another thread takes them until it has the last one,
+/// yielding after every s_pace publishes until the consumer has taken one more
+/// @param[in] _publish called on this thread with each snapshot to hand over
+/// @param[in] _take called on the consumer thread, returns the taken snapshot or nullptr
+//----------------------------------------------------------------------------------------------------------------------
+template <typename Publish, typename Take>
+Exchange exchange(uint64_t _count, Publish &&_publish, Take &&_take)
+{
+  Exchange result;
+  std::atomic<uint64_t> taken{0};
+  std::thread consumer([&]()
+                       {
+                         while (result.last != _count)
+                         {
+                           const Snapshot *snapshot = _take();
+                           if (snapshot == nullptr)
+                           {
+                             std::this_thread::yield();
+                             continue;
+                           }
+                           taken.fetch_add(1, std::memory_order_relaxed);
+                           result.torn = result.torn || !whole(*snapshot);
+                           result.backwards = result.backwards || snapshot->sequence <= result.last;
+                           result.last = snapshot->sequence;
+                         }
+                       });
+  uint64_t waited = 0;
+  for (uint64_t s = 1; s <= _count; ++s)
+  {
+    _publish(s);
+    if (s % s_pace == 0)
+    {
+      while (taken.load(std::memory_order_relaxed) == waited)
+      {
+        std::this_thread::yield();
+      }
+      waited = taken.load(std::memory_order_relaxed);
+    }
+  }
+  consumer.join();
+  result.taken = taken.load(std::memory_order_relaxed);
+  return result;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  uint64_t count = std::min<uint64_t>(std::stoull(argValue(argc, argv, "-n", "1000000")), (1u << 24) - 1);
+  const BenchOptions options = benchOptions(argc, argv, 10);
+
+  std::vector<BenchResult> results;
+  bool exact = true;
+  auto check = [&](const char *_what, const Exchange &_result)
+  {
+    const bool few = _result.taken < count / s_pace;
+    if (_result.torn || _result.backwards || _result.last != count || few)
+    {
+      std::cerr << _what << (_result.torn ? " took a torn snapshot" : "")
+                << (_result.backwards ? " went backwards" : "") << (few ? " took too few snapshots" : "") << " took "
+                << _result.taken << " last " << _result.last << " of " << count << '\n';
+      exact = false;
+    }
+  };
+
+  Exchange lockFree;
+  results.push_back(runBench("mailbox/lockfree", count, 1, options.reps, [&]()
+                             {
+                               SnapshotMailbox<Snapshot> mailbox;
+                               lockFree = exchange(count,
+                                                   [&](uint64_t _s)
+                                                   {
+                                                     fill(mailbox.back(), _s);
+                                                     mailbox.publish();
+                                                   },
+                                                   [&]() { return mailbox.take() ? &mailbox.front() : nullptr; });
+                               check("lock free", lockFree);
+                             }));
+  Exchange locked;
+  results.push_back(runBench("mailbox/mutex", count, 1, options.reps, [&]()
+                             {
+                               LockedMailbox mailbox;
+                               Snapshot published;
+                               Snapshot taken;
+                               locked = exchange(count,
+                                                 [&](uint64_t _s)
+                                                 {
+                                                   fill(published, _s);
+                                                   mailbox.publish(published);
+                                                 },
+                                                 [&]() { return mailbox.take(taken) ? &taken : nullptr; });
+                               check("mutex", locked);
+                             }));
+  printResults(std::cout, results);
+  std::cout << "publishes/s lock free " << results[0].opsPerSecond() << " mutex " << results[1].opsPerSecond() << '\n';
+  std::cout << "snapshots taken in the last run, lock free " << lockFree.taken << " mutex " << locked.taken << " of "
+            << count << '\n';
+  const bool faster = reportResults(std::cout, options, "Mailbox", results);
+  return benchVerdict(std::cout, exact, faster, "every snapshot taken was whole and in order", "MAILBOX MISMATCH");
+}
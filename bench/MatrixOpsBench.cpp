@@ -0,0 +1,307 @@
+/// @file MatrixOpsBench.cpp
+/// @brief times each ngl::Mat4 operation the app relies on (rotateX/Y/Z, euler, translate,
+/// scale, multiplication, inverse().transpose() and openGL()), the hand built gimbal matrix
+/// of NGLScene::buildRotation and the per frame composition for every MatrixOrder. The frame
+/// is timed both as the dense 4x4 products the app used to do and as the closed form affine
+/// composition it does now, and the two must give the same model matrix.
+/// Unlike TransformBatchBench this uses the real ngl::Mat4 rather than copies of its maths.
+/// usage MatrixOpsBench [-n matrices] [-r repetitions] [-w warm up repetitions] [--json file] [--baseline file] [--tolerance percent]
+#include "AffineTransform.h"
+#include "Bench.h"
+#include "TransformBatch.h"
+#include <ngl/Mat4.h>
+#include <ngl/Util.h>
+#include <ngl/Vec3.h>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the inputs of one frame, as the ui would set them
+//----------------------------------------------------------------------------------------------------------------------
+struct FrameInput
+{
+  float translate[3];
+  float rotate[3];
+  float scale[3];
+  float euler[4];
+  float spin[2];
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<FrameInput> randomInputs(size_t _count)
+{
+  std::mt19937 rng(97531);
+  std::uniform_real_distribution<float> translate(-5.0f, 5.0f);
+  std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+  std::uniform_real_distribution<float> scale(0.2f, 3.0f);
+  std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+  std::vector<FrameInput> inputs(_count);
+  for (auto &in : inputs)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      in.translate[i] = translate(rng);
+      in.rotate[i] = angle(rng);
+      in.scale[i] = scale(rng);
+    }
+    in.euler[0] = angle(rng);
+    in.euler[1] = axis(rng);
+    in.euler[2] = axis(rng);
+    in.euler[3] = axis(rng) + 2.0f;
+    in.spin[0] = angle(rng);
+    in.spin[1] = angle(rng);
+  }
+  return inputs;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the incorrect gimbal matrix exactly as NGLScene::buildRotation makes it
+//----------------------------------------------------------------------------------------------------------------------
+ngl::Mat4 gimbalMatrix(float _x, float _y, float _z)
+{
+  ngl::Mat4 gimbal;
+  gimbal.identity();
+  ngl::Real beta = ngl::radians(_x);
+  ngl::Real sr = sinf(beta);
+  ngl::Real cr = cosf(beta);
+  gimbal.m_11 = cr;
+  gimbal.m_12 = sr;
+  gimbal.m_21 = -sr;
+  gimbal.m_22 = cr;
+  beta = ngl::radians(_y);
+  sr = sinf(beta);
+  cr = cosf(beta);
+  gimbal.m_00 = cr;
+  gimbal.m_02 = -sr;
+  gimbal.m_20 = sr;
+  gimbal.m_22 = cr;
+  beta = ngl::radians(_z);
+  sr = sinf(beta);
+  cr = cosf(beta);
+  gimbal.m_00 = cr;
+  gimbal.m_01 = sr;
+  gimbal.m_10 = -sr;
+  gimbal.m_11 = cr;
+  return gimbal;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the matrices the setters build once per change, which a frame composes
+//----------------------------------------------------------------------------------------------------------------------
+struct FrameMatrices
+{
+  ngl::Mat4 translate;
+  ngl::Mat4 scale;
+  ngl::Mat4 rotate;
+  ngl::Mat4 euler;
+  ngl::Mat4 gimbal;
+  ngl::Mat4 quaternion;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+FrameMatrices frameMatrices(const FrameInput &_in)
+{
+  FrameMatrices m;
+  m.translate = ngl::Mat4::translate(_in.translate[0], _in.translate[1], _in.translate[2]);
+  m.scale = ngl::Mat4::scale(_in.scale[0], _in.scale[1], _in.scale[2]);
+  m.rotate = ngl::Mat4::rotateZ(_in.rotate[2]) * ngl::Mat4::rotateY(_in.rotate[1]) * ngl::Mat4::rotateX(_in.rotate[0]);
+  m.euler = ngl::Mat4::euler(_in.euler[0], _in.euler[1], _in.euler[2], _in.euler[3]);
+  m.gimbal = gimbalMatrix(_in.rotate[0], _in.rotate[1], _in.rotate[2]);
+  float q[4];
+  TransformBatch::quaternionFromEuler(_in.rotate[0], _in.rotate[1], _in.rotate[2], q);
+  TransformBatch::quaternionToMatrix(q, &m.quaternion.m_openGL[0]);
+  return m;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the rotation an order uses
+//----------------------------------------------------------------------------------------------------------------------
+const ngl::Mat4 &rotation(const FrameMatrices &_m, MatrixOrder _order)
+{
+  switch (_order)
+  {
+  case MatrixOrder::EULERTS:
+  case MatrixOrder::TEULERS: return _m.euler;
+  case MatrixOrder::GIMBALLOCK: return _m.gimbal;
+  case MatrixOrder::QUATERNION: return _m.quaternion;
+  default: return _m.rotate;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the components NGLScene::composeTransform hands to composeAffine
+//----------------------------------------------------------------------------------------------------------------------
+TransformComponents components(const FrameInput &_in, const ngl::Mat4 &_rotation)
+{
+  TransformComponents components;
+  for (int c = 0; c < 3; ++c)
+  {
+    components.translate[c] = _in.translate[c];
+    components.scale[c] = _in.scale[c];
+    for (int r = 0; r < 3; ++r)
+    {
+      components.rotate[c * 3 + r] = _rotation.m_m[c][r];
+    }
+  }
+  return components;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the model matrix as the dense products paintGL used to do
+//----------------------------------------------------------------------------------------------------------------------
+ngl::Mat4 denseTransform(const FrameMatrices &_m, MatrixOrder _order)
+{
+  const ngl::Mat4 &r = rotation(_m, _order);
+  return rotatesTranslation(_order) ? r * _m.translate * _m.scale : _m.translate * r * _m.scale;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the same TransformUBO layout as the app used before the normal matrix became a mat3
+//----------------------------------------------------------------------------------------------------------------------
+struct DenseUBO
+{
+  ngl::Mat4 MVP;
+  ngl::Mat4 normalMatrix;
+  ngl::Mat4 M;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the TransformUBO of PBRVertex.glsl as the app fills it now
+//----------------------------------------------------------------------------------------------------------------------
+struct AffineUBO
+{
+  ngl::Mat4 MVP;
+  float normalMatrix[3][4];
+  ngl::Mat4 M;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+ngl::Mat4 mouseTransform(const FrameInput &_in)
+{
+  ngl::Mat4 mouse = ngl::Mat4::rotateY(_in.spin[1]) * ngl::Mat4::rotateX(_in.spin[0]);
+  mouse.m_m[3][0] = 0.1f;
+  mouse.m_m[3][1] = -0.2f;
+  mouse.m_m[3][2] = 0.3f;
+  return mouse;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t count = std::stoul(argValue(argc, argv, "-n", "4096"));
+  const BenchOptions options = benchOptions(argc, argv, 50);
+  int warmup = std::stoi(argValue(argc, argv, "-w", "5"));
+
+  auto inputs = randomInputs(count);
+  std::vector<FrameMatrices> matrices(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    matrices[i] = frameMatrices(inputs[i]);
+  }
+  const ngl::Mat4 view = ngl::lookAt(ngl::Vec3(0.0f, 1.0f, 4.0f), ngl::Vec3(0.0f, 0.0f, 0.0f), ngl::Vec3(0.0f, 1.0f, 0.0f));
+  const ngl::Mat4 project = ngl::perspective(45.0f, 1024.0f / 720.0f, 0.05f, 450.0f);
+  std::vector<ngl::Mat4> out(count);
+  std::vector<float> upload(count * 16);
+  std::vector<BenchResult> results;
+
+  // each result loops over count different inputs so nothing is folded into a constant
+  auto bench = [&](const std::string &_name, auto &&_op)
+  {
+    results.push_back(runBench(_name, count, warmup, options.reps, [&]()
+                               {
+                                 for (size_t i = 0; i < count; ++i)
+                                 {
+                                   _op(i);
+                                 }
+                                 doNotOptimise(out[count / 2]);
+                               }));
+  };
+  bench("mat4/rotateX", [&](size_t i) { out[i] = ngl::Mat4::rotateX(inputs[i].rotate[0]); });
+  bench("mat4/rotateY", [&](size_t i) { out[i] = ngl::Mat4::rotateY(inputs[i].rotate[1]); });
+  bench("mat4/rotateZ", [&](size_t i) { out[i] = ngl::Mat4::rotateZ(inputs[i].rotate[2]); });
+  bench("mat4/euler", [&](size_t i)
+        { out[i] = ngl::Mat4::euler(inputs[i].euler[0], inputs[i].euler[1], inputs[i].euler[2], inputs[i].euler[3]); });
+  bench("mat4/translate", [&](size_t i)
+        { out[i] = ngl::Mat4::translate(inputs[i].translate[0], inputs[i].translate[1], inputs[i].translate[2]); });
+  bench("mat4/scale", [&](size_t i) { out[i] = ngl::Mat4::scale(inputs[i].scale[0], inputs[i].scale[1], inputs[i].scale[2]); });
+  bench("mat4/multiply", [&](size_t i) { out[i] = matrices[i].rotate * matrices[(i + 1) % count].euler; });
+  bench("mat4/inverse-transpose", [&](size_t i)
+        {
+          ngl::Mat4 m = matrices[i].rotate;
+          out[i] = m.inverse().transpose();
+        });
+  bench("mat4/openGL", [&](size_t i) { std::memcpy(&upload[i * 16], matrices[i].euler.openGL(), 16 * sizeof(float)); });
+  bench("rotate/axis-products", [&](size_t i)
+        {
+          out[i] = ngl::Mat4::rotateZ(inputs[i].rotate[2]) * ngl::Mat4::rotateY(inputs[i].rotate[1]) *
+                   ngl::Mat4::rotateX(inputs[i].rotate[0]);
+        });
+  bench("rotate/gimbal", [&](size_t i) { out[i] = gimbalMatrix(inputs[i].rotate[0], inputs[i].rotate[1], inputs[i].rotate[2]); });
+
+  // a whole frame's matrices, from the matrices the setters built to the filled TransformUBO
+  std::vector<DenseUBO> denseUBO(count);
+  std::vector<AffineUBO> affineUBO(count);
+  for (auto order : s_matrixOrders)
+  {
+    const std::string name = matrixOrderName(order);
+    bench("frame/dense/" + name, [&](size_t i)
+          {
+            auto &ubo = denseUBO[i];
+            ubo.M = mouseTransform(inputs[i]) * denseTransform(matrices[i], order);
+            ubo.MVP = project * view * ubo.M;
+            ubo.normalMatrix = ubo.M;
+            ubo.normalMatrix = ubo.normalMatrix.inverse().transpose();
+          });
+    bench("frame/affine/" + name, [&](size_t i)
+          {
+            auto mouse = mouseTransform(inputs[i]);
+            auto model = AffineTransform::fromMat4(&mouse.m_openGL[0]) *
+                         composeAffine(order, components(inputs[i], rotation(matrices[i], order)));
+            auto &ubo = affineUBO[i];
+            model.toMat4(&ubo.M.m_openGL[0]);
+            ubo.MVP = project * view * ubo.M;
+            auto linear = AffineTransform::classify(inputs[i].scale, order != MatrixOrder::GIMBALLOCK);
+            model.normalMatrix(linear, inputs[i].scale, &ubo.normalMatrix[0][0], 4);
+          });
+    doNotOptimise(denseUBO[count / 2]);
+    doNotOptimise(affineUBO[count / 2]);
+  }
+  printResults(std::cout, results);
+
+  // the affine frame must make the model matrix the dense products did, this is only checked
+  // to a tolerance as ngl may be built with its own simd multiply
+  bool same = true;
+  float worst = 0.0f;
+  for (auto order : s_matrixOrders)
+  {
+    for (size_t i = 0; i < count && same; ++i)
+    {
+      auto dense = mouseTransform(inputs[i]) * denseTransform(matrices[i], order);
+      auto mouse = mouseTransform(inputs[i]);
+      ngl::Mat4 affine;
+      auto model = AffineTransform::fromMat4(&mouse.m_openGL[0]) *
+                   composeAffine(order, components(inputs[i], rotation(matrices[i], order)));
+      model.toMat4(&affine.m_openGL[0]);
+      for (int e = 0; e < 16; ++e)
+      {
+        const float error = std::abs(dense.m_openGL[e] - affine.m_openGL[e]);
+        worst = std::max(worst, error);
+        if (error > 1.0e-5f * (1.0f + std::abs(dense.m_openGL[e])))
+        {
+          std::cerr << matrixOrderName(order) << " matrix " << i << " element " << e << " dense " << dense.m_openGL[e]
+                    << " affine " << affine.m_openGL[e] << '\n';
+          same = false;
+        }
+      }
+    }
+  }
+  std::cout << std::setprecision(3) << std::scientific << "largest difference between the dense and affine frames "
+            << worst << std::fixed << '\n';
+
+  const bool faster = reportResults(std::cout, options, "MatrixOps", results);
+  return benchVerdict(std::cout, same, faster, "the affine frames match the ngl products", "MATRIXOPS MISMATCH");
+}
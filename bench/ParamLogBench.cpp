@@ -0,0 +1,173 @@
+/// @file ParamLogBench.cpp
+/// @brief writes a synthetic session of parameter commits like a user's (spin box drags, mouse
+/// spins and pans, the odd toggle or resize) to a parameter log and reads it back. Every
+/// decoded commit must have exactly the parameters recorded, the fields that really changed
+/// and its time to the microsecond. Prints the records written and read per second and the
+/// bytes per record.
+/// usage ParamLogBench [-n commits] [-r repetitions] [--json file] [--baseline file] [--tolerance percent]
+#include "Bench.h"
+#include "ParamLog.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a commit of the session and when it was made
+//----------------------------------------------------------------------------------------------------------------------
+struct Commit
+{
+  int64_t ns;
+  RecordedParams params;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief mostly runs of one kind of edit, as a drag of one spin box or the mouse would make
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<Commit> session(size_t _count)
+{
+  std::mt19937 rng(4321);
+  std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+  std::uniform_int_distribution<int> kind(0, 9);
+  std::uniform_int_distribution<int> gap(2000000, 20000000);
+  std::vector<Commit> commits(_count);
+  RecordedParams params;
+  params.viewport[0] = 1024;
+  params.viewport[1] = 720;
+  int64_t ns = 1000000000;
+  int current = 0;
+  for (size_t i = 0; i < _count; ++i)
+  {
+    if (i % 32 == 0)
+    {
+      current = kind(rng);
+    }
+    switch (current)
+    {
+    case 0: params.translate[i % 3] += step(rng); break;
+    case 1: params.rotate[i % 3] += 10.0f * step(rng); break;
+    case 2: params.scale[i % 3] += step(rng); break;
+    case 3: params.euler[0] += 10.0f * step(rng); break;
+    case 4:
+      params.arcball[0] = step(rng);
+      params.arcball[3] = 1.0f - std::abs(params.arcball[0]);
+      break;
+    case 5: params.modelPos[i % 2] += step(rng); break;
+    case 6: params.modelPos[2] += 0.1f; break;
+    case 7: params.wireframe = i % 2; params.drawNormals = (i / 2) % 2; break;
+    case 8: params.order = static_cast<int32_t>(i % 6); params.drawIndex = static_cast<int32_t>(i % 9); break;
+    default: params.viewport[0] = 800 + static_cast<int32_t>(i % 400); break;
+    }
+    ns += gap(rng);
+    commits[i] = Commit{ns, params};
+  }
+  return commits;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t count = std::stoul(argValue(argc, argv, "-n", "1000000"));
+  const BenchOptions options = benchOptions(argc, argv, 10);
+  const std::string fileName = "ParamLogBench.log";
+
+  auto commits = session(count);
+  std::vector<BenchResult> results;
+  bool exact = true;
+  uint64_t bytes = 0;
+  results.push_back(runBench("paramlog/write", count, 1, options.reps, [&]()
+                             {
+                               ParamLogWriter writer;
+                               if (!writer.open(fileName))
+                               {
+                                 exact = false;
+                                 return;
+                               }
+                               for (auto &commit : commits)
+                               {
+                                 writer.record(commit.ns, commit.params);
+                               }
+                               bytes = writer.bytes();
+                               exact = writer.close() && exact;
+                             }));
+  uint64_t decoded = 0;
+  results.push_back(runBench("paramlog/read", count, 1, options.reps, [&]()
+                             {
+                               ParamLogReader reader;
+                               ParamLogReader::Event event;
+                               decoded = 0;
+                               if (reader.open(fileName))
+                               {
+                                 while (reader.next(event))
+                                 {
+                                   ++decoded;
+                                 }
+                               }
+                               doNotOptimise(event.params.translate[0]);
+                             }));
+  printResults(std::cout, results);
+  std::cout << "records/s written " << results[0].opsPerSecond() << " read " << results[1].opsPerSecond() << ", "
+            << static_cast<double>(bytes) / count << " bytes per record against " << sizeof(RecordedParams)
+            << " for the whole parameters\n";
+
+  // every commit comes back bit for bit, with the fields that changed and its time
+  ParamLogReader reader;
+  ParamLogReader::Event event;
+  if (!reader.open(fileName))
+  {
+    std::cerr << reader.error() << '\n';
+    exact = false;
+  }
+  RecordedParams previous;
+  for (size_t i = 0; i < commits.size() && exact; ++i)
+  {
+    const int64_t expectedNs = (commits[i].ns - commits[0].ns) / 1000 * 1000;
+    const uint16_t expectedChanged = i == 0 ? (1u << RecordedParams::FIELDS) - 1
+                                            : RecordedParams::changed(previous, commits[i].params);
+    if (!reader.next(event) || std::memcmp(&event.params, &commits[i].params, sizeof(RecordedParams)) != 0 ||
+        event.timeNs != expectedNs || event.changed != expectedChanged)
+    {
+      std::cerr << "commit " << i << " time " << event.timeNs << " expected " << expectedNs << " changed "
+                << event.changed << " expected " << expectedChanged << " " << reader.error() << '\n';
+      exact = false;
+    }
+    previous = commits[i].params;
+  }
+  if (exact && (reader.next(event) || decoded != count))
+  {
+    std::cerr << "decoded " << decoded << " commits of " << count << '\n';
+    exact = false;
+  }
+  // a log cut short stops at the last whole record
+  const size_t cut = reader.size() - 1;
+  reader = ParamLogReader();
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    std::vector<char> data(cut);
+    in.read(data.data(), static_cast<std::streamsize>(cut));
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(cut));
+  }
+  ParamLogReader truncated;
+  size_t whole = 0;
+  if (truncated.open(fileName))
+  {
+    while (truncated.next(event))
+    {
+      ++whole;
+    }
+  }
+  if (whole + 1 != count || truncated.error().empty())
+  {
+    std::cerr << "truncated log gave " << whole << " commits, error '" << truncated.error() << "'\n";
+    exact = false;
+  }
+  std::remove(fileName.c_str());
+
+  const bool faster = reportResults(std::cout, options, "ParamLog", results);
+  return benchVerdict(std::cout, exact, faster, "every commit read back as it was recorded", "PARAMLOG MISMATCH");
+}
@@ -0,0 +1,304 @@
+/// @file RasterBench.cpp
+/// @brief draws a tessellated sphere on a ground plane that runs through the near plane with the
+/// SoftwareRasterizer, from one thread and tile size to several. Every image must have exactly the
+/// bytes of the single threaded one, a finely split plane filling the view must leave no pixel
+/// undrawn and the pixels of a flat quad must have the colour SoftwareRasterizer::shade gives at
+/// the point they show. Prints the frame time for each tile size and the slowest tiles.
+/// usage RasterBench [-w width] [-h height] [-s sphere segments] [-t threads] [-r repetitions]
+///                   [--image file.ppm] [--json file] [--baseline file] [--tolerance percent]
+#include "Bench.h"
+#include "SoftwareRasterizer.h"
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+using Rasterizer = SoftwareRasterizer;
+constexpr float PI = 3.14159265359f;
+
+//----------------------------------------------------------------------------------------------------------------------
+void addVertex(std::vector<float> &o_mesh, float _x, float _y, float _z, float _nx, float _ny, float _nz)
+{
+  o_mesh.insert(o_mesh.end(), {_x, _y, _z, _nx, _ny, _nz, 0.0f, 0.0f});
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a _cells x _cells grid of triangles on z = _z from -_size to _size facing +z
+//----------------------------------------------------------------------------------------------------------------------
+void addGrid(std::vector<float> &o_mesh, int _cells, float _size, float _z)
+{
+  auto at = [&](int _i) { return -_size + 2.0f * _size * _i / _cells; };
+  for (int j = 0; j < _cells; ++j)
+  {
+    for (int i = 0; i < _cells; ++i)
+    {
+      addVertex(o_mesh, at(i), at(j), _z, 0.0f, 0.0f, 1.0f);
+      addVertex(o_mesh, at(i + 1), at(j), _z, 0.0f, 0.0f, 1.0f);
+      addVertex(o_mesh, at(i + 1), at(j + 1), _z, 0.0f, 0.0f, 1.0f);
+      addVertex(o_mesh, at(i), at(j), _z, 0.0f, 0.0f, 1.0f);
+      addVertex(o_mesh, at(i + 1), at(j + 1), _z, 0.0f, 0.0f, 1.0f);
+      addVertex(o_mesh, at(i), at(j + 1), _z, 0.0f, 0.0f, 1.0f);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a uv sphere of radius 2 with _segments around and _segments / 2 from pole to pole, on a
+/// ground plane that reaches behind the camera
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<float> sphereScene(int _segments)
+{
+  std::vector<float> mesh;
+  const int rings = std::max(_segments / 2, 2);
+  auto point = [&](int _s, int _r, float o_p[3])
+  {
+    float theta = 2.0f * PI * _s / _segments;
+    float phi = PI * _r / rings;
+    o_p[0] = std::sin(phi) * std::cos(theta);
+    o_p[1] = std::cos(phi);
+    o_p[2] = std::sin(phi) * std::sin(theta);
+  };
+  for (int r = 0; r < rings; ++r)
+  {
+    for (int s = 0; s < _segments; ++s)
+    {
+      float p[4][3];
+      point(s, r, p[0]);
+      point(s + 1, r, p[1]);
+      point(s + 1, r + 1, p[2]);
+      point(s, r + 1, p[3]);
+      for (int corner : {0, 1, 2, 0, 2, 3})
+      {
+        addVertex(mesh, 2.0f * p[corner][0], 2.0f * p[corner][1], 2.0f * p[corner][2], p[corner][0], p[corner][1],
+                  p[corner][2]);
+      }
+    }
+  }
+  // the ground at y = -2, from well behind the camera to far in front of it
+  const float ground[4][2] = {{-40.0f, -60.0f}, {40.0f, -60.0f}, {40.0f, 20.0f}, {-40.0f, 20.0f}};
+  for (int corner : {0, 2, 1, 0, 3, 2})
+  {
+    addVertex(mesh, ground[corner][0], -2.0f, ground[corner][1], 0.0f, 1.0f, 0.0f);
+  }
+  return mesh;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the transforms for a model matrix _model that is a rotation, seen from (0,0,8) looking
+/// down -z with a 45 degree perspective as the app uses
+//----------------------------------------------------------------------------------------------------------------------
+Rasterizer::Transforms transforms(const float _model[16], int _width, int _height)
+{
+  Rasterizer::Transforms t;
+  const float nearPlane = 0.05f;
+  const float farPlane = 450.0f;
+  const float f = 1.0f / std::tan(45.0f * PI / 360.0f);
+  float project[16] = {};
+  project[0] = f / (static_cast<float>(_width) / _height);
+  project[5] = f;
+  project[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+  project[11] = -1.0f;
+  project[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+  float view[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, -8, 1};
+  float viewModel[16];
+  for (int c = 0; c < 4; ++c)
+  {
+    for (int r = 0; r < 4; ++r)
+    {
+      viewModel[c * 4 + r] = 0.0f;
+      t.MVP[c * 4 + r] = 0.0f;
+      for (int k = 0; k < 4; ++k)
+      {
+        viewModel[c * 4 + r] += view[k * 4 + r] * _model[c * 4 + k];
+      }
+    }
+  }
+  for (int c = 0; c < 4; ++c)
+  {
+    for (int r = 0; r < 4; ++r)
+    {
+      for (int k = 0; k < 4; ++k)
+      {
+        t.MVP[c * 4 + r] += project[k * 4 + r] * viewModel[c * 4 + k];
+      }
+    }
+  }
+  std::memcpy(t.M, _model, sizeof(t.M));
+  // a rotation is its own normal matrix
+  for (int c = 0; c < 3; ++c)
+  {
+    for (int r = 0; r < 4; ++r)
+    {
+      t.normalMatrix[c][r] = r < 3 ? _model[c * 4 + r] : 0.0f;
+    }
+  }
+  return t;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief rotate 25 degrees about y then 15 about x, the bench's mouse rotation
+//----------------------------------------------------------------------------------------------------------------------
+void rotation(float o_m[16])
+{
+  const float y = 25.0f * PI / 180.0f;
+  const float x = 15.0f * PI / 180.0f;
+  // rotY * rotX, column major
+  const float m[16] = {std::cos(y), 0.0f, -std::sin(y), 0.0f,
+                       std::sin(y) * std::sin(x), std::cos(x), std::cos(y) * std::sin(x), 0.0f,
+                       std::sin(y) * std::cos(x), -std::sin(x), std::cos(y) * std::cos(x), 0.0f,
+                       0.0f, 0.0f, 0.0f, 1.0f};
+  std::memcpy(o_m, m, sizeof(m));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+Rasterizer::Mesh meshOf(const std::vector<float> &_vertices)
+{
+  Rasterizer::Mesh mesh;
+  mesh.data = reinterpret_cast<const char *>(_vertices.data());
+  mesh.vertices = _vertices.size() / 8;
+  return mesh;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a plane of 2 x 64 x 64 triangles larger than the view, any crack between them shows
+/// the clear colour, whose alpha is 0
+//----------------------------------------------------------------------------------------------------------------------
+bool watertight(ThreadPool &_pool, int _width, int _height)
+{
+  std::vector<float> plane;
+  addGrid(plane, 64, 5.0f, 0.0f);
+  const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+  Rasterizer rasterizer(_pool, 32);
+  rasterizer.render(meshOf(plane), transforms(identity, _width, _height), Rasterizer::Material(), _width, _height);
+  const auto &image = rasterizer.image();
+  size_t holes = 0;
+  for (size_t p = 0; p < image.rgba.size() / 4; ++p)
+  {
+    holes += image.rgba[p * 4 + 3] == 0 ? 1 : 0;
+  }
+  if (holes != 0)
+  {
+    std::cerr << holes << " pixels of the split plane were not drawn\n";
+  }
+  return holes == 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a quad on z = 0 facing the camera, each pixel shows the point of the plane under its
+/// centre so its colour is known without the rasterizer
+//----------------------------------------------------------------------------------------------------------------------
+bool shading(ThreadPool &_pool, int _width, int _height)
+{
+  std::vector<float> quad;
+  addGrid(quad, 1, 2.0f, 0.0f);
+  const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+  Rasterizer::Material material;
+  material.albedo[0] = 0.95f;
+  material.albedo[1] = 0.71f;
+  material.albedo[2] = 0.29f;
+  Rasterizer rasterizer(_pool, 32);
+  rasterizer.render(meshOf(quad), transforms(identity, _width, _height), material, _width, _height);
+  const auto &image = rasterizer.image();
+  const float tanHalf = std::tan(45.0f * PI / 360.0f);
+  const float aspect = static_cast<float>(_width) / _height;
+  int worst = 0;
+  for (int j = 1; j < 8; ++j)
+  {
+    for (int i = 1; i < 8; ++i)
+    {
+      int x = _width / 2 + (i - 4) * _height / 40;
+      int y = _height / 2 + (j - 4) * _height / 40;
+      float ndcX = (x + 0.5f) / _width * 2.0f - 1.0f;
+      float ndcY = 1.0f - (y + 0.5f) / _height * 2.0f;
+      // the plane is 8 units in front of the camera
+      const float world[3] = {ndcX * tanHalf * aspect * 8.0f, ndcY * tanHalf * 8.0f, 0.0f};
+      const float normal[3] = {0.0f, 0.0f, 1.0f};
+      float colour[3];
+      Rasterizer::shade(material, world, normal, colour);
+      for (int c = 0; c < 3; ++c)
+      {
+        int expected = static_cast<int>(std::clamp(colour[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+        worst = std::max(worst, std::abs(expected - image.rgba[(size_t(y) * _width + x) * 4 + c]));
+      }
+    }
+  }
+  // the interpolated position is not exactly the point under the centre
+  if (worst > 1)
+  {
+    std::cerr << "the quad's colour is up to " << worst << " from the shading model\n";
+  }
+  return worst <= 1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the slowest few tiles of the last frame
+//----------------------------------------------------------------------------------------------------------------------
+void printTiles(const Rasterizer::Stats &_stats, size_t _count)
+{
+  auto tiles = _stats.tiles;
+  std::sort(tiles.begin(), tiles.end(), [](const auto &_a, const auto &_b) { return _a.ms > _b.ms; });
+  std::cout << "slowest tiles (x,y triangles pixels worker ms)\n";
+  for (size_t i = 0; i < std::min(_count, tiles.size()); ++i)
+  {
+    auto &t = tiles[i];
+    std::cout << "  " << t.x << "," << t.y << " " << t.triangles << " " << t.pixels << " " << t.worker << " "
+              << std::setprecision(3) << t.ms << '\n';
+  }
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  int width = std::stoi(argValue(argc, argv, "-w", "1024"));
+  int height = std::stoi(argValue(argc, argv, "-h", "720"));
+  int segments = std::stoi(argValue(argc, argv, "-s", "256"));
+  size_t threads = std::stoul(argValue(argc, argv, "-t", "0"));
+  const BenchOptions options = benchOptions(argc, argv, 10);
+  std::string imageFile = argValue(argc, argv, "--image", "");
+
+  auto scene = sphereScene(segments);
+  float model[16];
+  rotation(model);
+  const auto sceneTransforms = transforms(model, width, height);
+  const Rasterizer::Material material;
+
+  // the reference is drawn by the calling thread and one worker in the default tile size
+  ThreadPool single(1);
+  Rasterizer reference(single);
+  reference.render(meshOf(scene), sceneTransforms, material, width, height);
+  if (!imageFile.empty() && !reference.writePPM(imageFile))
+  {
+    std::cerr << "unable to write " << imageFile << '\n';
+  }
+
+  ThreadPool pool(threads);
+  bool exact = true;
+  std::vector<BenchResult> results;
+  for (int tileSize : {16, 32, 64})
+  {
+    Rasterizer rasterizer(pool, tileSize);
+    results.push_back(runBench("raster/sphere/tile" + std::to_string(tileSize), 1, 1, options.reps, [&]()
+                               { rasterizer.render(meshOf(scene), sceneTransforms, material, width, height); }));
+    std::cout << "tile " << tileSize << " " << rasterizer.stats().summary() << '\n';
+    if (rasterizer.image().rgba != reference.image().rgba || rasterizer.image().depth != reference.image().depth)
+    {
+      auto difference = Rasterizer::compare(rasterizer.image().rgba.data(), reference.image().rgba.data(),
+                                            size_t(width) * height, 0);
+      std::cerr << "tile " << tileSize << " with " << pool.size() << " threads differs at " << difference.differing
+                << " pixels, up to " << difference.maxDifference << '\n';
+      exact = false;
+    }
+    if (tileSize == 32)
+    {
+      printTiles(rasterizer.stats(), 5);
+    }
+  }
+  exact = watertight(pool, width, height) && exact;
+  exact = shading(pool, width, height) && exact;
+
+  printResults(std::cout, results);
+  std::cout << "frames/s " << 1.0e9 / results[1].median() << " at " << width << "x" << height << " with "
+            << pool.size() << " threads and the calling thread, " << reference.stats().triangles << " triangles\n";
+  const bool faster = reportResults(std::cout, options, "Raster", results);
+  return benchVerdict(std::cout, exact, faster, "every image matches the single threaded one", "RASTER MISMATCH");
+}
@@ -0,0 +1,205 @@
+/// @file SceneGraphBench.cpp
+/// @brief world matrix propagation through a SceneGraph of a million or so nodes, serially and
+/// across a thread pool, with everything dirty, a few scattered nodes dirty and nothing dirty.
+/// Two shapes are timed, a wide tree with a fixed fan out built breadth first and a crowd of
+/// small rigs (a spine with a limb off each joint) built one rig at a time, which has to be
+/// sorted into levels at the first update. After each update every world matrix is checked
+/// against a plain walk down from the roots, which must match exactly.
+/// usage SceneGraphBench [-n nodes] [-r repetitions] [-t threads] [--fanout n]
+///                       [--json file] [--baseline file] [--tolerance percent]
+#include "Bench.h"
+#include "SceneGraph.h"
+#include "ThreadPool.h"
+#include "TransformBatch.h"
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a random joint transform, the scales stay close to one so long chains don't overflow
+//----------------------------------------------------------------------------------------------------------------------
+TransformComponents randomJoint(std::mt19937 &_gen)
+{
+  std::uniform_real_distribution<float> translate(-2.0f, 2.0f);
+  std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+  std::uniform_real_distribution<float> scale(0.9f, 1.1f);
+  TransformComponents c;
+  float q[4];
+  float m[16];
+  TransformBatch::quaternionFromEuler(angle(_gen), angle(_gen), angle(_gen), q);
+  TransformBatch::quaternionToMatrix(q, m);
+  for (int col = 0; col < 3; ++col)
+  {
+    c.translate[col] = translate(_gen);
+    c.scale[col] = scale(_gen);
+    for (int row = 0; row < 3; ++row)
+    {
+      c.rotate[col * 3 + row] = m[col * 4 + row];
+    }
+  }
+  return c;
+}
+
+MatrixOrder randomOrder(std::mt19937 &_gen)
+{
+  return s_matrixOrders[std::uniform_int_distribution<size_t>(0, std::size(s_matrixOrders) - 1)(_gen)];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief node i is a child of node (i - 1) / _fanout, so the nodes arrive a level at a time
+//----------------------------------------------------------------------------------------------------------------------
+void buildWide(SceneGraph &_graph, size_t _nodes, size_t _fanout)
+{
+  std::mt19937 gen(1234);
+  _graph.clear();
+  _graph.reserve(_nodes);
+  for (size_t i = 0; i < _nodes; ++i)
+  {
+    auto parent = i == 0 ? SceneGraph::NoParent : static_cast<SceneGraph::NodeId>((i - 1) / _fanout);
+    _graph.addNode(parent, randomOrder(gen), randomJoint(gen));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief rigs of a 10 joint spine with a 5 joint limb off every spine joint, each rig is added
+/// depth first as a rig loader would, so most nodes are shallower than the one before
+//----------------------------------------------------------------------------------------------------------------------
+void buildRigs(SceneGraph &_graph, size_t _nodes)
+{
+  constexpr size_t spine = 10;
+  constexpr size_t limb = 5;
+  std::mt19937 gen(5678);
+  _graph.clear();
+  _graph.reserve(_nodes);
+  while (_graph.size() + spine * (limb + 1) <= _nodes)
+  {
+    auto joint = SceneGraph::NoParent;
+    for (size_t s = 0; s < spine; ++s)
+    {
+      joint = _graph.addNode(joint, randomOrder(gen), randomJoint(gen));
+      auto bone = joint;
+      for (size_t l = 0; l < limb; ++l)
+      {
+        bone = _graph.addNode(bone, randomOrder(gen), randomJoint(gen));
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the world matrices from a plain walk in id order, parents always have smaller ids
+/// @returns true if every one equals the graph's
+//----------------------------------------------------------------------------------------------------------------------
+bool matchesReference(const SceneGraph &_graph)
+{
+  std::vector<AffineTransform> world(_graph.size());
+  for (SceneGraph::NodeId id = 0; id < _graph.size(); ++id)
+  {
+    auto parent = _graph.parent(id);
+    auto local = composeAffine(_graph.order(id), _graph.local(id));
+    world[id] = (parent == SceneGraph::NoParent ? _graph.rootTransform() : world[parent]) * local;
+    if (std::memcmp(&world[id], &_graph.world(id), sizeof(AffineTransform)) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a small rotation about y for the root transform, a new one each call so every node
+/// really does change
+//----------------------------------------------------------------------------------------------------------------------
+AffineTransform spin(float _degrees)
+{
+  float s;
+  float c;
+  TransformBatch::sinCosDegrees(_degrees, s, c);
+  auto a = AffineTransform::identity();
+  a.m_m[0][0] = c;
+  a.m_m[0][2] = -s;
+  a.m_m[2][0] = s;
+  a.m_m[2][2] = c;
+  return a;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief time one graph shape, _exact is cleared if any update disagrees with the reference
+//----------------------------------------------------------------------------------------------------------------------
+void benchGraph(const std::string &_name, SceneGraph &_graph, ThreadPool &_pool, int _reps,
+                std::vector<BenchResult> &_results, bool &_exact)
+{
+  auto check = [&](const char *_what)
+  {
+    if (!matchesReference(_graph))
+    {
+      std::cerr << "mismatch " << _name << ' ' << _what << '\n';
+      _exact = false;
+    }
+  };
+  const size_t n = _graph.size();
+  _graph.resetStats();
+  // the first update sorts the rigs, time it separately
+  auto start = std::chrono::steady_clock::now();
+  _graph.update(&_pool);
+  std::cout << _name << ": " << n << " nodes " << _graph.levels() << " levels, first update "
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+            << " ms (" << _graph.stats().sorts << " sorts)\n";
+  check("first update");
+
+  float angle = 0.0f;
+  _results.push_back(runBench(_name + "/full/serial", n, 1, _reps, [&]()
+                              {
+                                _graph.setRootTransform(spin(angle += 1.0f));
+                                _graph.update(nullptr);
+                              }));
+  check("full serial");
+  _results.push_back(runBench(_name + "/full/parallel", n, 1, _reps, [&]()
+                              {
+                                _graph.setRootTransform(spin(angle += 1.0f));
+                                _graph.update(&_pool);
+                              }));
+  check("full parallel");
+
+  // one node in a thousand changed, anywhere in the graph
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<SceneGraph::NodeId> pick(0, static_cast<SceneGraph::NodeId>(n - 1));
+  _graph.resetStats();
+  _results.push_back(runBench(_name + "/sparse/parallel", n, 1, _reps, [&]()
+                              {
+                                for (size_t i = 0; i < n / 1000; ++i)
+                                {
+                                  _graph.setLocal(pick(gen), randomJoint(gen));
+                                }
+                                _graph.update(&_pool);
+                              }));
+  check("sparse");
+  std::cout << _name << " sparse " << _graph.summary() << '\n';
+  _results.push_back(runBench(_name + "/clean", n, 1, _reps, [&]() { _graph.update(&_pool); }));
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t count = std::stoul(argValue(argc, argv, "-n", "1000000"));
+  const BenchOptions options = benchOptions(argc, argv, 10);
+  size_t threads = std::stoul(argValue(argc, argv, "-t", "0"));
+  size_t fanout = std::stoul(argValue(argc, argv, "--fanout", "4"));
+
+  ThreadPool pool(threads);
+  std::cout << "scene graph propagation on " << pool.size() << " threads\n";
+  std::vector<BenchResult> results;
+  bool exact = true;
+  SceneGraph graph;
+  buildWide(graph, count, fanout);
+  benchGraph("wide", graph, pool, options.reps, results, exact);
+  buildRigs(graph, count);
+  benchGraph("rigs", graph, pool, options.reps, results, exact);
+
+  printResults(std::cout, results);
+  const bool faster = reportResults(std::cout, options, "SceneGraph", results);
+  return benchVerdict(std::cout, exact, faster, "all world matrices match the reference", "WORLD MATRIX MISMATCH");
+}
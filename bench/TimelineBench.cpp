@@ -0,0 +1,276 @@
+/// @file TimelineBench.cpp
+/// @brief a timeline with many tracks of randomly keyed curves is baked, then played back a tick
+/// at a time through the baked samples and, for comparison, straight from the keys of every
+/// curve. At the baked frame times the playback must give the values of the keys to within
+/// rounding and unit orientations matching the baked angles, between them the largest error
+/// of the baked curves is printed. A timeline whose duration isn't a whole number of frames
+/// must blend towards the sample baked at the duration across its shorter last interval. Prints how many animated transforms per second playback
+/// sustains with and without composing the matrices.
+/// usage TimelineBench [-n tracks] [-k keys per curve] [-d duration] [-s sample rate] [-r repetitions]
+///                     [--json file] [--baseline file] [--tolerance percent]
+#include "Bench.h"
+#include "Timeline.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the range the ui spin boxes give each channel
+//----------------------------------------------------------------------------------------------------------------------
+void channelRange(Timeline::Channel _channel, float &o_min, float &o_max)
+{
+  switch (_channel)
+  {
+  case Timeline::RX:
+  case Timeline::RY:
+  case Timeline::RZ:
+  case Timeline::EULERANGLE:
+    o_min = -180.0f;
+    o_max = 180.0f;
+    break;
+  case Timeline::SX:
+  case Timeline::SY:
+  case Timeline::SZ:
+    o_min = 0.5f;
+    o_max = 2.0f;
+    break;
+  case Timeline::EULERX:
+  case Timeline::EULERY:
+  case Timeline::EULERZ:
+    o_min = -1.0f;
+    o_max = 1.0f;
+    break;
+  default:
+    o_min = -5.0f;
+    o_max = 5.0f;
+    break;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief up to _keys keys at random times on every curve, the first track is keyed at
+/// _duration so the timeline is exactly that long
+//----------------------------------------------------------------------------------------------------------------------
+void randomKeys(Timeline &o_timeline, size_t _keys, float _duration)
+{
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  std::uniform_int_distribution<size_t> keyCount(1, std::max<size_t>(_keys, 1));
+  for (size_t track = 0; track < o_timeline.tracks(); ++track)
+  {
+    for (size_t c = 0; c < Timeline::CHANNELS; ++c)
+    {
+      auto channel = static_cast<Timeline::Channel>(c);
+      float low;
+      float high;
+      channelRange(channel, low, high);
+      const size_t count = keyCount(rng);
+      for (size_t k = 0; k < count; ++k)
+      {
+        const float time = track == 0 && k == 0 ? _duration : unit(rng) * _duration;
+        auto ease = unit(rng) < 0.25f ? Timeline::Ease::LINEAR : Timeline::Ease::SMOOTH;
+        o_timeline.setKey(track, channel, time, low + unit(rng) * (high - low), ease);
+      }
+    }
+  }
+}
+
+const std::vector<float> &channelValues(const TransformParams &_params, Timeline::Channel _channel)
+{
+  const std::vector<float> *channels[Timeline::CHANNELS] = {&_params.tx, &_params.ty, &_params.tz,
+                                                            &_params.rx, &_params.ry, &_params.rz,
+                                                            &_params.sx, &_params.sy, &_params.sz,
+                                                            &_params.eulerAngle, &_params.eulerX, &_params.eulerY,
+                                                            &_params.eulerZ};
+  return *channels[_channel];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief what playback costs without the bake, every curve searched and blended from its keys
+//----------------------------------------------------------------------------------------------------------------------
+void evaluateDirect(const Timeline &_timeline, float _time, TransformParams &o_params)
+{
+  const float time = _timeline.wrap(_time);
+  float q[4];
+  for (size_t track = 0; track < _timeline.tracks(); ++track)
+  {
+    float values[Timeline::CHANNELS];
+    for (size_t c = 0; c < Timeline::CHANNELS; ++c)
+    {
+      values[c] = _timeline.valueAt(track, static_cast<Timeline::Channel>(c), time);
+    }
+    o_params.set(track, values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7],
+                 values[8], values[9], values[10], values[11], values[12]);
+    TransformBatch::quaternionFromEuler(values[Timeline::RX], values[Timeline::RY], values[Timeline::RZ], q);
+    o_params.setOrientation(track, q[0], q[1], q[2], q[3]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief between two baked frames playback is a linear blend of their samples, which are the
+/// curves' values at the frame times. Checked at points through the last two intervals of a
+/// timeline whose last one is cut short by the duration
+/// @returns false at the first channel that differs
+//----------------------------------------------------------------------------------------------------------------------
+bool checkLastIntervals(Timeline &_timeline)
+{
+  const float rate = _timeline.sampleRate();
+  const float duration = _timeline.duration();
+  _timeline.bake();
+  TransformParams params;
+  const size_t last = _timeline.frames() - 1;
+  for (size_t frame = last >= 2 ? last - 2 : 0; frame < last; ++frame)
+  {
+    const float start = frame / rate;
+    const float end = std::min((frame + 1) / rate, duration);
+    for (float fraction : {0.25f, 0.5f, 0.75f, 0.999f})
+    {
+      const float time = start + (end - start) * fraction;
+      _timeline.evaluate(time, params);
+      for (size_t track = 0; track < _timeline.tracks(); ++track)
+      {
+        for (size_t c = 0; c < Timeline::CHANNELS; ++c)
+        {
+          auto channel = static_cast<Timeline::Channel>(c);
+          const float a = _timeline.valueAt(track, channel, start);
+          const float b = _timeline.valueAt(track, channel, end);
+          const float expected = a + (b - a) * fraction;
+          const float value = channelValues(params, channel)[track];
+          if (std::abs(value - expected) > 1e-3f * std::max(1.0f, std::abs(expected)))
+          {
+            std::cerr << "time " << time << " of " << duration << " track " << track << " channel " << c << " "
+                      << value << " expected " << expected << '\n';
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t tracks = std::stoul(argValue(argc, argv, "-n", "10000"));
+  size_t keys = std::stoul(argValue(argc, argv, "-k", "8"));
+  float duration = std::stof(argValue(argc, argv, "-d", "2"));
+  float rate = std::stof(argValue(argc, argv, "-s", "60"));
+  const BenchOptions options = benchOptions(argc, argv, 10);
+  // a second of playback at 60Hz per repetition
+  const size_t ticks = 60;
+  const float tick = 1.0f / 60.0f;
+
+  Timeline timeline(tracks, rate);
+  randomKeys(timeline, keys, duration);
+  std::cout << tracks << " tracks " << timeline.keyCount() << " keys " << timeline.duration() << "s at " << rate
+            << "Hz\n";
+
+  std::vector<BenchResult> results;
+  results.push_back(runBench("timeline/bake", tracks, 1, options.reps, [&]() { timeline.bake(); }));
+  std::cout << timeline.frames() << " frames baked, "
+            << timeline.frames() * tracks * (Timeline::CHANNELS + 4) * sizeof(float) / (1024.0 * 1024.0) << "MB\n";
+
+  TransformParams params;
+  timeline.resetStats();
+  results.push_back(runBench("timeline/evaluate", tracks * ticks, 1, options.reps, [&]()
+                             {
+                               for (size_t i = 0; i < ticks; ++i)
+                               {
+                                 timeline.evaluate(i * tick, params);
+                               }
+                               doNotOptimise(params.qw[0]);
+                             }));
+  const double sustained = timeline.stats().transformsPerSecond();
+  TransformParams direct;
+  direct.resize(tracks);
+  results.push_back(runBench("timeline/direct", tracks * ticks, 1, options.reps, [&]()
+                             {
+                               for (size_t i = 0; i < ticks; ++i)
+                               {
+                                 evaluateDirect(timeline, i * tick, direct);
+                               }
+                               doNotOptimise(direct.qw[0]);
+                             }));
+  std::vector<float> matrices(tracks * 16);
+  results.push_back(runBench("timeline/evaluate+compose", tracks * ticks, 1, options.reps, [&]()
+                             {
+                               for (size_t i = 0; i < ticks; ++i)
+                               {
+                                 timeline.evaluate(i * tick, params);
+                                 TransformBatch::compose(MatrixOrder::TRS, params, matrices.data());
+                               }
+                               doNotOptimise(matrices[0]);
+                             }));
+  printResults(std::cout, results);
+  std::cout << "animated transforms/s baked " << sustained << " direct " << results[2].opsPerSecond()
+            << " with compose " << results[3].opsPerSecond() << '\n';
+
+  // at the frame times the baked samples are the curves themselves, the last frame is at the
+  // duration which wraps back to the first
+  bool exact = true;
+  float q[4];
+  for (size_t frame = 0; frame + 1 < timeline.frames() && exact; ++frame)
+  {
+    const float time = frame / rate;
+    timeline.evaluate(time, params);
+    evaluateDirect(timeline, time, direct);
+    for (size_t track = 0; track < tracks && exact; ++track)
+    {
+      for (size_t c = 0; c < Timeline::CHANNELS; ++c)
+      {
+        const float expected = channelValues(direct, static_cast<Timeline::Channel>(c))[track];
+        const float value = channelValues(params, static_cast<Timeline::Channel>(c))[track];
+        if (std::abs(value - expected) > 1e-3f * std::max(1.0f, std::abs(expected)))
+        {
+          std::cerr << "frame " << frame << " track " << track << " channel " << c << " " << value << " expected "
+                    << expected << '\n';
+          exact = false;
+        }
+      }
+      q[0] = params.qx[track];
+      q[1] = params.qy[track];
+      q[2] = params.qz[track];
+      q[3] = params.qw[track];
+      const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+      const float dot = q[0] * direct.qx[track] + q[1] * direct.qy[track] + q[2] * direct.qz[track] +
+                        q[3] * direct.qw[track];
+      if (std::abs(length - 1.0f) > 1e-5f || 1.0f - std::abs(dot) > 1e-5f)
+      {
+        std::cerr << "frame " << frame << " track " << track << " orientation length " << length << " dot " << dot
+                  << '\n';
+        exact = false;
+      }
+    }
+  }
+  // between the frames the samples only approximate the curves, report how closely
+  float worst = 0.0f;
+  double total = 0.0;
+  for (size_t i = 0; i < ticks; ++i)
+  {
+    const float time = (i + 0.5f) * tick;
+    timeline.evaluate(time, params);
+    evaluateDirect(timeline, time, direct);
+    for (size_t c = 0; c < Timeline::CHANNELS; ++c)
+    {
+      const auto &a = channelValues(params, static_cast<Timeline::Channel>(c));
+      const auto &b = channelValues(direct, static_cast<Timeline::Channel>(c));
+      for (size_t track = 0; track < tracks; ++track)
+      {
+        worst = std::max(worst, std::abs(a[track] - b[track]));
+        total += std::abs(a[track] - b[track]);
+      }
+    }
+  }
+  // half a frame longer so the last baked interval is half as long as the others
+  Timeline shortEnd(std::min<size_t>(tracks, 256), rate);
+  randomKeys(shortEnd, keys, duration + 0.5f / rate);
+  exact = checkLastIntervals(shortEnd) && exact;
+  std::cout << std::setprecision(4) << "error between frames mean " << total / (ticks * tracks * Timeline::CHANNELS) << " largest " << worst
+            << '\n';
+
+  const bool faster = reportResults(std::cout, options, "Timeline", results);
+  return benchVerdict(std::cout, exact, faster, "baked playback matches the keys at every frame", "TIMELINE MISMATCH");
+}
@@ -0,0 +1,554 @@
+/// @file TransformBatchBench.cpp
+/// @brief throughput of the TransformBatch kernels for every MatrixOrder, also checks the
+/// simd kernels give exactly the same matrices as the scalar reference.
+/// The quaternion rotation is timed against the three multiplied axis matrices NGLScene
+/// used to build, and the batched nlerp / slerp are checked against the scalar kernel and a
+/// double precision slerp.
+/// The closed form AffineTransform composition NGLScene uses is checked against the dense
+/// 4x4 products it replaced, which it must match exactly, and timed against them. The
+/// analytic normal matrices are checked against a double precision inverse and timed against
+/// the general 4x4 inverse NGLScene used to do and a 3x3 cofactor inverse.
+/// usage TransformBatchBench [-n transforms] [-r repetitions] [--json file] [--baseline file] [--tolerance percent]
+#include "AffineTransform.h"
+#include "Bench.h"
+#include "TransformBatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace
+{
+constexpr TransformBatch::Kernel s_kernels[] = {TransformBatch::Kernel::SCALAR, TransformBatch::Kernel::SSE,
+                                                TransformBatch::Kernel::AVX2};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief random parameters in the same ranges as the ui spin boxes
+//----------------------------------------------------------------------------------------------------------------------
+TransformParams randomParams(size_t _n, unsigned int _seed = 1234)
+{
+  std::mt19937 gen(_seed);
+  std::uniform_real_distribution<float> translate(-20.0f, 20.0f);
+  std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+  std::uniform_real_distribution<float> scale(-20.0f, 20.0f);
+  std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+  TransformParams p;
+  p.resize(_n);
+  for (size_t i = 0; i < _n; ++i)
+  {
+    p.set(i, translate(gen), translate(gen), translate(gen),
+          angle(gen), angle(gen), angle(gen),
+          scale(gen), scale(gen), scale(gen),
+          angle(gen) + 180.0f, axis(gen), axis(gen), axis(gen));
+  }
+  return p;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a rotation about axis _axis (0 x, 1 y, 2 z) as ngl::Mat4::rotateX etc
+//----------------------------------------------------------------------------------------------------------------------
+void axisRotation(int _axis, float _degrees, float *_m)
+{
+  const float r = _degrees * 3.14159265358979f / 180.0f;
+  const float s = std::sin(r);
+  const float c = std::cos(r);
+  std::fill(_m, _m + 16, 0.0f);
+  _m[0] = _m[5] = _m[10] = _m[15] = 1.0f;
+  const int a = (_axis + 1) % 3;
+  const int b = (_axis + 2) % 3;
+  _m[a * 4 + a] = c;
+  _m[a * 4 + b] = s;
+  _m[b * 4 + a] = -s;
+  _m[b * 4 + b] = c;
+}
+
+void multiply(const float *_a, const float *_b, float *_out)
+{
+  for (int c = 0; c < 4; ++c)
+  {
+    for (int r = 0; r < 4; ++r)
+    {
+      _out[c * 4 + r] = _a[r] * _b[c * 4] + _a[4 + r] * _b[c * 4 + 1] + _a[8 + r] * _b[c * 4 + 2] +
+                        _a[12 + r] * _b[c * 4 + 3];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the rotation the way NGLScene::setRotate used to build it, three full 4x4 axis
+/// rotations multiplied rz * ry * rx
+//----------------------------------------------------------------------------------------------------------------------
+void eulerMatrices(float _rx, float _ry, float _rz, float *_out)
+{
+  float rx[16], ry[16], rz[16], zy[16];
+  axisRotation(0, _rx, rx);
+  axisRotation(1, _ry, ry);
+  axisRotation(2, _rz, rz);
+  multiply(rz, ry, zy);
+  multiply(zy, rx, _out);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the transform the way NGLScene::composeTransform used to build it, the components
+/// expanded to full 4x4 matrices and multiplied in the order given
+//----------------------------------------------------------------------------------------------------------------------
+void denseCompose(MatrixOrder _order, const TransformComponents &_c, float *_out)
+{
+  float t[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, _c.translate[0], _c.translate[1], _c.translate[2], 1};
+  float s[16] = {_c.scale[0], 0, 0, 0, 0, _c.scale[1], 0, 0, 0, 0, _c.scale[2], 0, 0, 0, 0, 1};
+  float r[16] = {};
+  for (int c = 0; c < 3; ++c)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      r[c * 4 + k] = _c.rotate[c * 3 + k];
+    }
+  }
+  r[15] = 1.0f;
+  float first[16];
+  if (rotatesTranslation(_order))
+  {
+    multiply(r, t, first);
+  }
+  else
+  {
+    multiply(t, r, first);
+  }
+  multiply(first, s, _out);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the components of each transform in _params, the rotation from its quaternion
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<TransformComponents> randomComponents(const TransformParams &_params)
+{
+  std::vector<TransformComponents> components(_params.size());
+  for (size_t i = 0; i < _params.size(); ++i)
+  {
+    auto &c = components[i];
+    c.translate[0] = _params.tx[i];
+    c.translate[1] = _params.ty[i];
+    c.translate[2] = _params.tz[i];
+    c.scale[0] = _params.sx[i];
+    c.scale[1] = _params.sy[i];
+    c.scale[2] = _params.sz[i];
+    const float q[4] = {_params.qx[i], _params.qy[i], _params.qz[i], _params.qw[i]};
+    float m[16];
+    TransformBatch::quaternionToMatrix(q, m);
+    for (int col = 0; col < 3; ++col)
+    {
+      for (int row = 0; row < 3; ++row)
+      {
+        c.rotate[col * 3 + row] = m[col * 4 + row];
+      }
+    }
+  }
+  return components;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief true if two matrices are equal, == rather than memcmp so +0 and -0 are the same
+//----------------------------------------------------------------------------------------------------------------------
+bool sameMatrix(const float *_a, const float *_b)
+{
+  for (int k = 0; k < 16; ++k)
+  {
+    if (!(_a[k] == _b[k]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the inverse transpose of the upper 3x3 of a 4x4 matrix from the cofactors
+//----------------------------------------------------------------------------------------------------------------------
+template <typename T>
+void cofactorNormal(const float *_m, T *_out)
+{
+  const T c0[3] = {_m[0], _m[1], _m[2]};
+  const T c1[3] = {_m[4], _m[5], _m[6]};
+  const T c2[3] = {_m[8], _m[9], _m[10]};
+  const T n[9] = {c1[1] * c2[2] - c1[2] * c2[1], c1[2] * c2[0] - c1[0] * c2[2], c1[0] * c2[1] - c1[1] * c2[0],
+                  c2[1] * c0[2] - c2[2] * c0[1], c2[2] * c0[0] - c2[0] * c0[2], c2[0] * c0[1] - c2[1] * c0[0],
+                  c0[1] * c1[2] - c0[2] * c1[1], c0[2] * c1[0] - c0[0] * c1[2], c0[0] * c1[1] - c0[1] * c1[0]};
+  const T det = c0[0] * n[0] + c0[1] * n[1] + c0[2] * n[2];
+  const T invDet = det != T(0) ? T(1) / det : T(0);
+  for (int k = 0; k < 9; ++k)
+  {
+    _out[k] = n[k] * invDet;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the normal matrix the way NGLScene used to make it, a full 4x4 inverse (as
+/// ngl::Mat4::inverse) then the transpose, of which only the upper 3x3 is used
+//----------------------------------------------------------------------------------------------------------------------
+void inverseTransposeNormal(const float *_m, float *_out)
+{
+  // reading the column major matrix as row major gives the transpose, whose inverse is the
+  // inverse transpose, a[r][c] is row r of that
+  auto a = [_m](int _r, int _c) { return _m[_r * 4 + _c]; };
+  const float s0 = a(0, 0) * a(1, 1) - a(1, 0) * a(0, 1);
+  const float s1 = a(0, 0) * a(1, 2) - a(1, 0) * a(0, 2);
+  const float s2 = a(0, 0) * a(1, 3) - a(1, 0) * a(0, 3);
+  const float s3 = a(0, 1) * a(1, 2) - a(1, 1) * a(0, 2);
+  const float s4 = a(0, 1) * a(1, 3) - a(1, 1) * a(0, 3);
+  const float s5 = a(0, 2) * a(1, 3) - a(1, 2) * a(0, 3);
+  const float c5 = a(2, 2) * a(3, 3) - a(3, 2) * a(2, 3);
+  const float c4 = a(2, 1) * a(3, 3) - a(3, 1) * a(2, 3);
+  const float c3 = a(2, 1) * a(3, 2) - a(3, 1) * a(2, 2);
+  const float c2 = a(2, 0) * a(3, 3) - a(3, 0) * a(2, 3);
+  const float c1 = a(2, 0) * a(3, 2) - a(3, 0) * a(2, 2);
+  const float c0 = a(2, 0) * a(3, 1) - a(3, 0) * a(2, 1);
+  const float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  const float id = det != 0.0f ? 1.0f / det : 0.0f;
+  float inv[16];
+  inv[0] = (a(1, 1) * c5 - a(1, 2) * c4 + a(1, 3) * c3) * id;
+  inv[1] = (-a(0, 1) * c5 + a(0, 2) * c4 - a(0, 3) * c3) * id;
+  inv[2] = (a(3, 1) * s5 - a(3, 2) * s4 + a(3, 3) * s3) * id;
+  inv[3] = (-a(2, 1) * s5 + a(2, 2) * s4 - a(2, 3) * s3) * id;
+  inv[4] = (-a(1, 0) * c5 + a(1, 2) * c2 - a(1, 3) * c1) * id;
+  inv[5] = (a(0, 0) * c5 - a(0, 2) * c2 + a(0, 3) * c1) * id;
+  inv[6] = (-a(3, 0) * s5 + a(3, 2) * s2 - a(3, 3) * s1) * id;
+  inv[7] = (a(2, 0) * s5 - a(2, 2) * s2 + a(2, 3) * s1) * id;
+  inv[8] = (a(1, 0) * c4 - a(1, 1) * c2 + a(1, 3) * c0) * id;
+  inv[9] = (-a(0, 0) * c4 + a(0, 1) * c2 - a(0, 3) * c0) * id;
+  inv[10] = (a(3, 0) * s4 - a(3, 1) * s2 + a(3, 3) * s0) * id;
+  inv[11] = (-a(2, 0) * s4 + a(2, 1) * s2 - a(2, 3) * s0) * id;
+  inv[12] = (-a(1, 0) * c3 + a(1, 1) * c1 - a(1, 2) * c0) * id;
+  inv[13] = (a(0, 0) * c3 - a(0, 1) * c1 + a(0, 2) * c0) * id;
+  inv[14] = (-a(3, 0) * s3 + a(3, 1) * s1 - a(3, 2) * s0) * id;
+  inv[15] = (a(2, 0) * s3 - a(2, 1) * s1 + a(2, 2) * s0) * id;
+  // inv is the inverse transpose stored row major, so row r column c is inv[r * 4 + c]
+  for (int c = 0; c < 3; ++c)
+  {
+    for (int r = 0; r < 3; ++r)
+    {
+      _out[c * 3 + r] = inv[r * 4 + c];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the largest element difference of two 3x3 matrices relative to the largest element of _expected
+//----------------------------------------------------------------------------------------------------------------------
+double relativeError(const double *_expected, const float *_value)
+{
+  double largest = 0.0;
+  double error = 0.0;
+  for (int k = 0; k < 9; ++k)
+  {
+    largest = std::max(largest, std::abs(_expected[k]));
+    error = std::max(error, std::abs(_expected[k] - _value[k]));
+  }
+  return largest > 0.0 ? error / largest : error;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the largest component error of the blended orientations against a double precision slerp
+//----------------------------------------------------------------------------------------------------------------------
+double slerpError(const TransformParams &_from, const TransformParams &_to, float _t, const TransformParams &_blend)
+{
+  double worst = 0.0;
+  for (size_t i = 0; i < _from.size(); ++i)
+  {
+    double a[4] = {_from.qx[i], _from.qy[i], _from.qz[i], _from.qw[i]};
+    double b[4] = {_to.qx[i], _to.qy[i], _to.qz[i], _to.qw[i]};
+    double d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    double sign = d < 0.0 ? -1.0 : 1.0;
+    double theta = std::acos(std::min(std::abs(d), 1.0));
+    double wa = 1.0 - _t;
+    double wb = _t;
+    if (std::sin(theta) > 1.0e-6)
+    {
+      wa = std::sin((1.0 - _t) * theta) / std::sin(theta);
+      wb = std::sin(_t * theta) / std::sin(theta);
+    }
+    double q[4];
+    double len = 0.0;
+    for (int k = 0; k < 4; ++k)
+    {
+      q[k] = wa * a[k] + wb * sign * b[k];
+      len += q[k] * q[k];
+    }
+    const float *out[4] = {&_blend.qx[i], &_blend.qy[i], &_blend.qz[i], &_blend.qw[i]};
+    for (int k = 0; k < 4; ++k)
+    {
+      worst = std::max(worst, std::abs(q[k] / std::sqrt(len) - *out[k]));
+    }
+  }
+  return worst;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t count = std::stoul(argValue(argc, argv, "-n", "1000003"));
+  const BenchOptions options = benchOptions(argc, argv, 10);
+
+  auto params = randomParams(count);
+  std::vector<float> reference(count * 16);
+  std::vector<float> result(count * 16);
+  std::vector<BenchResult> results;
+  bool exact = true;
+
+  std::cout << "composing " << count << " transforms, best kernel "
+            << TransformBatch::kernelName(TransformBatch::bestKernel()) << '\n';
+  for (auto order : s_matrixOrders)
+  {
+    TransformBatch::compose(order, params, reference.data(), TransformBatch::Kernel::SCALAR);
+    for (auto kernel : s_kernels)
+    {
+      if (!TransformBatch::isSupported(kernel))
+      {
+        continue;
+      }
+      std::fill(result.begin(), result.end(), 0.0f);
+      TransformBatch::compose(order, params, result.data(), kernel);
+      if (std::memcmp(reference.data(), result.data(), result.size() * sizeof(float)) != 0)
+      {
+        std::cerr << "mismatch " << matrixOrderName(order) << ' ' << TransformBatch::kernelName(kernel) << '\n';
+        exact = false;
+      }
+      std::string name = std::string(matrixOrderName(order)) + "/" + TransformBatch::kernelName(kernel);
+      results.push_back(runBench(name, count, 1, options.reps, [&]()
+                                 {
+                                   TransformBatch::compose(order, params, result.data(), kernel);
+                                   doNotOptimise(result[0]);
+                                 }));
+    }
+  }
+
+  // QUATERNION is TRS with the same angles, so the matrices may only differ by rounding
+  std::vector<float> trs(count * 16);
+  TransformBatch::compose(MatrixOrder::TRS, params, trs.data(), TransformBatch::Kernel::SCALAR);
+  TransformBatch::compose(MatrixOrder::QUATERNION, params, reference.data(), TransformBatch::Kernel::SCALAR);
+  float quaternionError = 0.0f;
+  for (size_t i = 0; i < trs.size(); ++i)
+  {
+    // relative to the scale, which goes up to 20
+    quaternionError = std::max(quaternionError, std::abs(trs[i] - reference[i]) / 20.0f);
+  }
+
+  // the rotation alone as NGLScene::setRotate makes it, old and new
+  float eulerError = 0.0f;
+  for (size_t i = 0; i < count; ++i)
+  {
+    float q[4];
+    float euler[16];
+    float quaternion[16];
+    eulerMatrices(params.rx[i], params.ry[i], params.rz[i], euler);
+    TransformBatch::quaternionFromEuler(params.rx[i], params.ry[i], params.rz[i], q);
+    TransformBatch::quaternionToMatrix(q, quaternion);
+    for (int k = 0; k < 16; ++k)
+    {
+      eulerError = std::max(eulerError, std::abs(euler[k] - quaternion[k]));
+    }
+  }
+  results.push_back(runBench("rotation/euler-matrices", count, 1, options.reps, [&]()
+                             {
+                               for (size_t i = 0; i < count; ++i)
+                               {
+                                 eulerMatrices(params.rx[i], params.ry[i], params.rz[i], result.data() + i * 16);
+                               }
+                               doNotOptimise(result[0]);
+                             }));
+  results.push_back(runBench("rotation/euler-quaternion", count, 1, options.reps, [&]()
+                             {
+                               for (size_t i = 0; i < count; ++i)
+                               {
+                                 float q[4];
+                                 TransformBatch::quaternionFromEuler(params.rx[i], params.ry[i], params.rz[i], q);
+                                 TransformBatch::quaternionToMatrix(q, result.data() + i * 16);
+                               }
+                               doNotOptimise(result[0]);
+                             }));
+  results.push_back(runBench("rotation/quaternion", count, 1, options.reps, [&]()
+                             {
+                               for (size_t i = 0; i < count; ++i)
+                               {
+                                 const float q[4] = {params.qx[i], params.qy[i], params.qz[i], params.qw[i]};
+                                 TransformBatch::quaternionToMatrix(q, result.data() + i * 16);
+                               }
+                               doNotOptimise(result[0]);
+                             }));
+
+  // blend towards a second random set of orientations
+  auto target = randomParams(count, 4321);
+  TransformParams expected;
+  TransformParams blended;
+  double slerpWorst = 0.0;
+  constexpr float t = 0.3f;
+  for (auto mode : {TransformBatch::Interpolation::NLERP, TransformBatch::Interpolation::SLERP})
+  {
+    const char *modeName = mode == TransformBatch::Interpolation::SLERP ? "slerp" : "nlerp";
+    TransformBatch::interpolate(mode, params, target, t, expected, TransformBatch::Kernel::SCALAR);
+    if (mode == TransformBatch::Interpolation::SLERP)
+    {
+      slerpWorst = slerpError(params, target, t, expected);
+    }
+    for (auto kernel : s_kernels)
+    {
+      if (!TransformBatch::isSupported(kernel))
+      {
+        continue;
+      }
+      blended.resize(0);
+      TransformBatch::interpolate(mode, params, target, t, blended, kernel);
+      if (blended.qx != expected.qx || blended.qy != expected.qy || blended.qz != expected.qz ||
+          blended.qw != expected.qw)
+      {
+        std::cerr << "mismatch " << modeName << ' ' << TransformBatch::kernelName(kernel) << '\n';
+        exact = false;
+      }
+      std::string name = std::string(modeName) + "/" + TransformBatch::kernelName(kernel);
+      results.push_back(runBench(name, count, 1, options.reps, [&]()
+                                 {
+                                   TransformBatch::interpolate(mode, params, target, t, blended, kernel);
+                                   doNotOptimise(blended.qw[0]);
+                                 }));
+    }
+  }
+
+  // the single scene transform, closed form against the dense products it replaced
+  auto components = randomComponents(params);
+  std::vector<AffineTransform> affine(count);
+  // any affine matrix will do for the mouse transform, use the first QUATERNION result
+  const auto mouse = AffineTransform::fromMat4(reference.data());
+  for (auto order : s_matrixOrders)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      float dense[16];
+      float closed[16];
+      denseCompose(order, components[i], dense);
+      composeAffine(order, components[i]).toMat4(closed);
+      if (!sameMatrix(dense, closed))
+      {
+        std::cerr << "affine mismatch " << matrixOrderName(order) << " transform " << i << '\n';
+        exact = false;
+        break;
+      }
+      // and the model matrix, the mouse transform times the scene transform
+      float mouseDense[16];
+      float model[16];
+      mouse.toMat4(mouseDense);
+      multiply(mouseDense, dense, model);
+      (mouse * composeAffine(order, components[i])).toMat4(closed);
+      if (!sameMatrix(model, closed))
+      {
+        std::cerr << "affine product mismatch " << matrixOrderName(order) << " transform " << i << '\n';
+        exact = false;
+        break;
+      }
+    }
+    std::string name = std::string("affine/") + matrixOrderName(order);
+    results.push_back(runBench(name + "/dense", count, 1, options.reps, [&]()
+                               {
+                                 for (size_t i = 0; i < count; ++i)
+                                 {
+                                   denseCompose(order, components[i], result.data() + i * 16);
+                                 }
+                                 doNotOptimise(result[0]);
+                               }));
+    results.push_back(runBench(name + "/closed", count, 1, options.reps, [&]()
+                               {
+                                 for (size_t i = 0; i < count; ++i)
+                                 {
+                                   affine[i] = composeAffine(order, components[i]);
+                                 }
+                                 doNotOptimise(affine[0].m_m[0][0]);
+                               }));
+  }
+
+  // normal matrices of every order, the shape comes from the scale as it does in NGLScene. A
+  // third each have unit, uniform and the random non uniform scales so every shape is covered
+  auto shaped = params;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (i % 3 == 0)
+    {
+      shaped.sx[i] = shaped.sy[i] = shaped.sz[i] = 1.0f;
+    }
+    else if (i % 3 == 1)
+    {
+      shaped.sy[i] = shaped.sz[i] = shaped.sx[i];
+    }
+  }
+  std::vector<float> normals(count * 9);
+  std::vector<AffineTransform::Linear> shapes(count);
+  double normalWorst = 0.0;
+  double inverseWorst = 0.0;
+  size_t shapeCounts[4] = {};
+  for (auto order : s_matrixOrders)
+  {
+    TransformBatch::compose(order, shaped, reference.data(), TransformBatch::Kernel::SCALAR);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const float *m = reference.data() + i * 16;
+      const float scale[3] = {shaped.sx[i], shaped.sy[i], shaped.sz[i]};
+      shapes[i] = AffineTransform::classify(scale, order != MatrixOrder::GIMBALLOCK);
+      ++shapeCounts[static_cast<int>(shapes[i])];
+      double expected[9];
+      float n[9];
+      cofactorNormal(m, expected);
+      AffineTransform::fromMat4(m).normalMatrix(shapes[i], scale, n);
+      // the general case is the same float cofactor inverse as before, a sheared matrix can be
+      // badly conditioned so only the analytic cases are held to the tolerance
+      if (shapes[i] != AffineTransform::Linear::GENERAL)
+      {
+        normalWorst = std::max(normalWorst, relativeError(expected, n));
+      }
+      inverseTransposeNormal(m, n);
+      inverseWorst = std::max(inverseWorst, relativeError(expected, n));
+    }
+    std::string name = std::string("normal/") + matrixOrderName(order);
+    results.push_back(runBench(name + "/inverse4x4", count, 1, options.reps, [&]()
+                               {
+                                 for (size_t i = 0; i < count; ++i)
+                                 {
+                                   inverseTransposeNormal(reference.data() + i * 16, normals.data() + i * 9);
+                                 }
+                                 doNotOptimise(normals[0]);
+                               }));
+    results.push_back(runBench(name + "/cofactor", count, 1, options.reps, [&]()
+                               {
+                                 for (size_t i = 0; i < count; ++i)
+                                 {
+                                   cofactorNormal(reference.data() + i * 16, normals.data() + i * 9);
+                                 }
+                                 doNotOptimise(normals[0]);
+                               }));
+    results.push_back(runBench(name + "/analytic", count, 1, options.reps, [&]()
+                               {
+                                 for (size_t i = 0; i < count; ++i)
+                                 {
+                                   const float scale[3] = {shaped.sx[i], shaped.sy[i], shaped.sz[i]};
+                                   AffineTransform::fromMat4(reference.data() + i * 16)
+                                       .normalMatrix(shapes[i], scale, normals.data() + i * 9);
+                                 }
+                                 doNotOptimise(normals[0]);
+                               }));
+  }
+
+  printResults(std::cout, results);
+  std::cout << std::scientific << std::setprecision(2) << "QUATERNION vs TRS max error " << quaternionError
+            << ", quaternion vs euler matrices max error " << eulerError << ", slerp vs double precision max error "
+            << slerpWorst << '\n'
+            << "normal matrix max relative error, analytic " << normalWorst << " 4x4 inverse " << inverseWorst
+            << std::fixed << '\n';
+  std::cout << "normal matrices " << shapeCounts[0] << " rotation " << shapeCounts[1] << " uniform scale "
+            << shapeCounts[2] << " scale " << shapeCounts[3] << " general\n";
+  bool accurate = quaternionError < 1.0e-5f && eulerError < 1.0e-5f && slerpWorst < 1.0e-5 && normalWorst < 1.0e-5;
+  const bool faster = reportResults(std::cout, options, "TransformBatch", results);
+  int status = benchVerdict(std::cout, exact, faster, "all kernels match the scalar reference", "KERNEL MISMATCH");
+  if (!accurate)
+  {
+    std::cout << "QUATERNION ACCURACY FAILURE\n";
+    status = EXIT_FAILURE;
+  }
+  return status;
+}
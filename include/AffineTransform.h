@@ -0,0 +1,292 @@
+#ifndef AFFINETRANSFORM_H_
+#define AFFINETRANSFORM_H_
+
+#include "MatrixOrder.h"
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AffineTransform.h
+/// @brief a compact 3x4 affine matrix and closed form composition of the NGLScene transform
+/// components
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class AffineTransform
+/// @brief the top three rows of a 4x4 matrix whose bottom row is always 0,0,0,1. The columns
+/// are stored in the same order as ngl::Mat4::openGL() so m_m[3] is the translation.
+/// The products skip the terms that multiply the implicit bottom row but otherwise sum in the
+/// same order as ngl::Mat4::operator*, so the results equal the dense 4x4 product exactly
+/// (apart from the sign of a zero).
+//----------------------------------------------------------------------------------------------------------------------
+class AffineTransform
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief [column][row]
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_m[4][3];
+
+  static AffineTransform identity()
+  {
+    AffineTransform a;
+    for (int c = 0; c < 4; ++c)
+    {
+      for (int r = 0; r < 3; ++r)
+      {
+        a.m_m[c][r] = c == r ? 1.0f : 0.0f;
+      }
+    }
+    return a;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the affine part of a column major 4x4 matrix, the bottom row is assumed to be 0,0,0,1
+  //----------------------------------------------------------------------------------------------------------------------
+  static AffineTransform fromMat4(const float *_m)
+  {
+    AffineTransform a;
+    for (int c = 0; c < 4; ++c)
+    {
+      a.m_m[c][0] = _m[c * 4];
+      a.m_m[c][1] = _m[c * 4 + 1];
+      a.m_m[c][2] = _m[c * 4 + 2];
+    }
+    return a;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief expand to a column major 4x4 matrix, only needed where a full matrix is required
+  /// such as the TransformUBO upload
+  /// @param[out] o_m 16 floats
+  //----------------------------------------------------------------------------------------------------------------------
+  void toMat4(float *o_m) const
+  {
+    for (int c = 0; c < 4; ++c)
+    {
+      o_m[c * 4] = m_m[c][0];
+      o_m[c * 4 + 1] = m_m[c][1];
+      o_m[c * 4 + 2] = m_m[c][2];
+      o_m[c * 4 + 3] = c == 3 ? 1.0f : 0.0f;
+    }
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @enum the shape of the linear (upper 3x3) part, which decides how the normal matrix is made
+  //----------------------------------------------------------------------------------------------------------------------
+  enum class Linear{
+                    ROTATION,      ///< a rotation, the normal matrix is the linear part itself
+                    UNIFORM_SCALE, ///< a rotation times s, the normal matrix is the linear part over s^2
+                    SCALE,         ///< a rotation times diag(sx,sy,sz), each column is divided by its scale squared
+                    GENERAL        ///< sheared, needs the full cofactor inverse
+                   };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the shape of a rotation times diag(_scale) from the components themselves, so no
+  /// work is needed to find it
+  /// @param[in] _scale the scale applied before the rotation
+  /// @param[in] _rotation false if the "rotation" isn't orthonormal, as with the hand built
+  /// GIMBALLOCK matrix
+  //----------------------------------------------------------------------------------------------------------------------
+  static Linear classify(const float _scale[3], bool _rotation)
+  {
+    if (!_rotation || _scale[0] == 0.0f || _scale[1] == 0.0f || _scale[2] == 0.0f)
+    {
+      return Linear::GENERAL;
+    }
+    if (_scale[0] == _scale[1] && _scale[0] == _scale[2])
+    {
+      return _scale[0] == 1.0f || _scale[0] == -1.0f ? Linear::ROTATION : Linear::UNIFORM_SCALE;
+    }
+    return Linear::SCALE;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the inverse transpose of the linear part for transforming normals when its shape is
+  /// known. For a rotation R times diag(s) the inverse transpose is R diag(1/s), which is the
+  /// linear part with each column divided by s^2, so only GENERAL needs an inverse.
+  /// @param[in] _linear the shape from classify
+  /// @param[in] _scale the scale passed to classify, not used for ROTATION and GENERAL
+  /// @param[out] o_n the 3x3 result, column major
+  /// @param[in] _columnStride the floats between the start of each column, 4 for a std140 mat3
+  //----------------------------------------------------------------------------------------------------------------------
+  void normalMatrix(Linear _linear, const float _scale[3], float *o_n, int _columnStride = 3) const
+  {
+    switch (_linear)
+    {
+    case Linear::ROTATION:
+    {
+      const float one[3] = {1.0f, 1.0f, 1.0f};
+      scaleColumns(one, o_n, _columnStride);
+      break;
+    }
+    case Linear::UNIFORM_SCALE:
+    {
+      const float inv = 1.0f / (_scale[0] * _scale[0]);
+      const float invs[3] = {inv, inv, inv};
+      scaleColumns(invs, o_n, _columnStride);
+      break;
+    }
+    case Linear::SCALE:
+    {
+      const float invs[3] = {1.0f / (_scale[0] * _scale[0]), 1.0f / (_scale[1] * _scale[1]),
+                             1.0f / (_scale[2] * _scale[2])};
+      scaleColumns(invs, o_n, _columnStride);
+      break;
+    }
+    case Linear::GENERAL:
+      cofactorNormal(o_n, _columnStride);
+      break;
+    }
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief as above for a matrix whose shape isn't known, the columns are checked for
+  /// orthogonality and their lengths used as the scale. Costs about as much as the cofactor
+  /// inverse so only use it when the components aren't available.
+  /// @returns the shape that was found
+  //----------------------------------------------------------------------------------------------------------------------
+  Linear normalMatrix(float *o_n, int _columnStride = 3) const
+  {
+    const float len[3] = {dot(m_m[0], m_m[0]), dot(m_m[1], m_m[1]), dot(m_m[2], m_m[2])};
+    // relative tolerances, the rounding in the composed rotations is around 1e-7
+    constexpr float tolerance = 1.0e-5f;
+    const float d01 = dot(m_m[0], m_m[1]);
+    const float d02 = dot(m_m[0], m_m[2]);
+    const float d12 = dot(m_m[1], m_m[2]);
+    const float t2 = tolerance * tolerance;
+    if (len[0] == 0.0f || len[1] == 0.0f || len[2] == 0.0f || d01 * d01 > t2 * len[0] * len[1] ||
+        d02 * d02 > t2 * len[0] * len[2] || d12 * d12 > t2 * len[1] * len[2])
+    {
+      cofactorNormal(o_n, _columnStride);
+      return Linear::GENERAL;
+    }
+    auto equal = [](float _a, float _b) { return std::abs(_a - _b) <= tolerance * _b; };
+    const float invs[3] = {1.0f / len[0], 1.0f / len[1], 1.0f / len[2]};
+    scaleColumns(invs, o_n, _columnStride);
+    if (!equal(len[0], len[1]) || !equal(len[0], len[2]))
+    {
+      return Linear::SCALE;
+    }
+    return equal(len[0], 1.0f) ? Linear::ROTATION : Linear::UNIFORM_SCALE;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the product of two affine transforms, 36 multiplies instead of 64
+  //----------------------------------------------------------------------------------------------------------------------
+  AffineTransform operator*(const AffineTransform &_rhs) const
+  {
+    AffineTransform a;
+    for (int c = 0; c < 4; ++c)
+    {
+      for (int r = 0; r < 3; ++r)
+      {
+        a.m_m[c][r] = m_m[0][r] * _rhs.m_m[c][0] + m_m[1][r] * _rhs.m_m[c][1] + m_m[2][r] * _rhs.m_m[c][2];
+      }
+    }
+    for (int r = 0; r < 3; ++r)
+    {
+      a.m_m[3][r] += m_m[3][r];
+    }
+    return a;
+  }
+
+private :
+  static float dot(const float *_a, const float *_b) { return _a[0] * _b[0] + _a[1] * _b[1] + _a[2] * _b[2]; }
+  void scaleColumns(const float _scale[3], float *o_n, int _columnStride) const
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      o_n[c * _columnStride] = m_m[c][0] * _scale[c];
+      o_n[c * _columnStride + 1] = m_m[c][1] * _scale[c];
+      o_n[c * _columnStride + 2] = m_m[c][2] * _scale[c];
+    }
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the columns of the inverse transpose are the cross products of the other two
+  /// columns over the determinant
+  //----------------------------------------------------------------------------------------------------------------------
+  void cofactorNormal(float *o_n, int _columnStride) const
+  {
+    const float *c0 = m_m[0];
+    const float *c1 = m_m[1];
+    const float *c2 = m_m[2];
+    const float n[9] = {c1[1] * c2[2] - c1[2] * c2[1], c1[2] * c2[0] - c1[0] * c2[2], c1[0] * c2[1] - c1[1] * c2[0],
+                        c2[1] * c0[2] - c2[2] * c0[1], c2[2] * c0[0] - c2[0] * c0[2], c2[0] * c0[1] - c2[1] * c0[0],
+                        c0[1] * c1[2] - c0[2] * c1[1], c0[2] * c1[0] - c0[0] * c1[2], c0[0] * c1[1] - c0[1] * c1[0]};
+    const float det = c0[0] * n[0] + c0[1] * n[1] + c0[2] * n[2];
+    const float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+    for (int c = 0; c < 3; ++c)
+    {
+      o_n[c * _columnStride] = n[c * 3] * invDet;
+      o_n[c * _columnStride + 1] = n[c * 3 + 1] * invDet;
+      o_n[c * _columnStride + 2] = n[c * 3 + 2] * invDet;
+    }
+  }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the separate parts of the scene transform, every MatrixOrder is some product of a
+/// translation, a pure rotation and a scale
+//----------------------------------------------------------------------------------------------------------------------
+struct TransformComponents
+{
+  float translate[3];
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief 3x3 column major, the rotate, euler, gimbal or quaternion matrix as the order needs
+  //----------------------------------------------------------------------------------------------------------------------
+  float rotate[9];
+  float scale[3];
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief true for the orders where the rotation is applied after the translation, so the
+/// translation is rotated (R*T*S), the others are T*R*S
+//----------------------------------------------------------------------------------------------------------------------
+constexpr bool rotatesTranslation(MatrixOrder _order)
+{
+  return _order == MatrixOrder::RTS || _order == MatrixOrder::TEULERS;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief compose the components in the order Order without any 4x4 multiplies. The scale is
+/// diagonal so each rotation column is scaled by one value, and only the R*T*S orders need
+/// the translation rotated. T*R*S is 9 multiplies and R*T*S 18 against 128 for the two dense
+/// products.
+//----------------------------------------------------------------------------------------------------------------------
+template <MatrixOrder Order>
+inline AffineTransform composeAffine(const TransformComponents &_c)
+{
+  AffineTransform a;
+  for (int c = 0; c < 3; ++c)
+  {
+    a.m_m[c][0] = _c.rotate[c * 3] * _c.scale[c];
+    a.m_m[c][1] = _c.rotate[c * 3 + 1] * _c.scale[c];
+    a.m_m[c][2] = _c.rotate[c * 3 + 2] * _c.scale[c];
+  }
+  if constexpr (rotatesTranslation(Order))
+  {
+    for (int r = 0; r < 3; ++r)
+    {
+      a.m_m[3][r] = _c.rotate[r] * _c.translate[0] + _c.rotate[3 + r] * _c.translate[1] + _c.rotate[6 + r] * _c.translate[2];
+    }
+  }
+  else
+  {
+    a.m_m[3][0] = _c.translate[0];
+    a.m_m[3][1] = _c.translate[1];
+    a.m_m[3][2] = _c.translate[2];
+  }
+  return a;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief pick the specialised composeAffine for a run time order
+//----------------------------------------------------------------------------------------------------------------------
+inline AffineTransform composeAffine(MatrixOrder _order, const TransformComponents &_c)
+{
+  switch (_order)
+  {
+  case MatrixOrder::RTS: return composeAffine<MatrixOrder::RTS>(_c);
+  case MatrixOrder::TRS: return composeAffine<MatrixOrder::TRS>(_c);
+  case MatrixOrder::GIMBALLOCK: return composeAffine<MatrixOrder::GIMBALLOCK>(_c);
+  case MatrixOrder::EULERTS: return composeAffine<MatrixOrder::EULERTS>(_c);
+  case MatrixOrder::TEULERS: return composeAffine<MatrixOrder::TEULERS>(_c);
+  case MatrixOrder::QUATERNION: return composeAffine<MatrixOrder::QUATERNION>(_c);
+  }
+  return AffineTransform::identity();
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef ARCBALL_H_
+#define ARCBALL_H_
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Arcball.h
+/// @brief mouse rotation as a unit quaternion (Shoemake's arcball)
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Arcball
+/// @brief the window is treated as a unit sphere seen from the front, a drag rotates the
+/// orientation by the rotation taking the point under the mouse at the start of the drag to
+/// the point under it now. Unlike accumulating angles about x and y the result doesn't depend
+/// on the path, dragging back to the start undoes the rotation, and there is no gimbal lock.
+/// The orientation is turned into a matrix with TransformBatch::quaternionToMatrix.
+//----------------------------------------------------------------------------------------------------------------------
+class Arcball
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start a drag at window position _x,_y in a window of _width x _height pixels
+  //----------------------------------------------------------------------------------------------------------------------
+  void begin(float _x, float _y, int _width, int _height);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the mouse has moved to _x,_y during a drag
+  //----------------------------------------------------------------------------------------------------------------------
+  void drag(float _x, float _y);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief back to no rotation
+  //----------------------------------------------------------------------------------------------------------------------
+  void reset();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the current orientation x,y,z,w
+  //----------------------------------------------------------------------------------------------------------------------
+  const float *orientation() const { return m_orientation; }
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the point on the sphere under window position _x,_y, points outside the sphere
+  /// are moved to its edge
+  //----------------------------------------------------------------------------------------------------------------------
+  void project(float _x, float _y, float o_p[3]) const;
+
+  float m_orientation[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the orientation and sphere point at the start of the drag
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_start[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  float m_from[3] = {0.0f, 0.0f, 1.0f};
+  int m_width = 1;
+  int m_height = 1;
+};
+
+#endif
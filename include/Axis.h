@@ -1,27 +1,36 @@
 #ifndef AXIS_H_
 #define AXIS_H_
 #include <ngl/ShaderLib.h>
-#include <ngl/Transformation.h>
-#include <ngl/VAOPrimitives.h>
+#include <ngl/AbstractVAO.h>
+#include <ngl/Vec3.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class GeometryCache;
 
 /// @file Axis.h
 /// @brief simple class to contain and draw an axis
 /// @author Jonathan Macey
-/// @version 1.0
+/// @version 1.1
 /// @date 13/10/10
 /// Revision History :
 /// Initial Version 13/10/10
+/// 1.1 the axis is baked into a single vertex coloured mesh and drawn with one call
+/// 1.2 the mesh can be kept in a GeometryCache
 /// @class Axis
 /// @brief Simple Axis drawing
 class Axis
 {
 public:
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief ctor
-  /// @param[in] _shaderName the name of the shader to invoke when drawing
+  /// @brief ctor, must be called with a valid GL context as it builds the mesh
+  /// @param[in] _shaderName the name of the shader to invoke when drawing, this must take a
+  /// position in attribute 0, a colour in attribute 1 and an MVP uniform
   /// @parma[in] _scale uniform scale for the initial construction of the axis
+  /// @param[in] _cache if set the mesh is loaded from / stored in it
   //----------------------------------------------------------------------------------------------------------------------
-  Axis(std::string _shaderName, ngl::Real _scale );
+  Axis(std::string _shaderName, ngl::Real _scale, GeometryCache *_cache=nullptr );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief dtor
   //----------------------------------------------------------------------------------------------------------------------
@@ -29,7 +38,9 @@ public:
 
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief draw method
-  /// @brief pass in the TransformStack for the shader (should have all the tx needed)
+  /// @param[in] _view the camera view matrix
+  /// @param[in] _project the camera projection matrix
+  /// @param[in] _globalTx the global mouse transform
   //----------------------------------------------------------------------------------------------------------------------
   void draw(const ngl::Mat4 &_view, const ngl::Mat4 &_project,const ngl::Mat4 &_globalTx);
 private :
@@ -42,17 +53,24 @@ private :
   //----------------------------------------------------------------------------------------------------------------------
   ngl::Real m_scale;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief load matrices to the shader
+  /// @brief the baked mesh, all three axis and their arrow heads
   //----------------------------------------------------------------------------------------------------------------------
-  void loadMatricesToShader(const ngl::Mat4 &_view, const ngl::Mat4 &_project);
+  std::unique_ptr<ngl::AbstractVAO> m_vao;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief transform stack for drawing
+  /// @brief add an open cylinder to the vertex list (x,y,z,r,g,b per vertex)
+  /// @param[in] _dir the unit axis direction
+  /// @param[in] _start distance along _dir the cylinder starts
+  /// @param[in] _end distance along _dir the cylinder ends
+  /// @param[in] _radius the radius
+  /// @param[in] _colour the colour of every vertex
   //----------------------------------------------------------------------------------------------------------------------
-  ngl::Transformation m_transform;
+  static void addCylinder(std::vector<float> &_verts, const ngl::Vec3 &_dir, ngl::Real _start, ngl::Real _end,
+                          ngl::Real _radius, const ngl::Vec3 &_colour);
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief global mouse rotation
+  /// @brief add a cone with its base at _base along _dir pointing in the direction of _height
   //----------------------------------------------------------------------------------------------------------------------
-  ngl::Mat4 m_globalMouseTx;
+  static void addCone(std::vector<float> &_verts, const ngl::Vec3 &_dir, ngl::Real _base, ngl::Real _height,
+                      ngl::Real _radius, const ngl::Vec3 &_colour);
 
 };
 
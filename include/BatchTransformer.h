@@ -0,0 +1,110 @@
+#ifndef BATCHTRANSFORMER_H_
+#define BATCHTRANSFORMER_H_
+
+#include "ThreadPool.h"
+#include "TransformBatch.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BatchTransformer.h
+/// @brief streams files of transform parameters into files of matrices without a window, for
+/// the BatchTransform command line tool
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class BatchTransformer
+/// @brief the input is memory mapped and cut into chunks of a fixed number of records. The
+/// calling thread finds the chunks and asks for their pages ahead of time, the ThreadPool
+/// parses and composes them and a writer thread writes them out in order, so the three stages
+/// overlap and only a few chunks are ever held in memory. Each chunk is sorted by MatrixOrder so
+/// every order is composed with TransformBatch's simd kernels, then put back in record order.
+///
+/// The input is either binary, a 16 byte header (magic "ATBR", version, record size, 0)
+/// followed by packed Records, or CSV with a record per line,
+/// order,tx,ty,tz,rx,ry,rz,sx,sy,sz,angle,axisx,axisy,axisz
+/// where order is the MatrixOrder's name or index, blank lines, lines starting with # and a first
+/// line starting with "order" are skipped. Binary input is recognised by its magic.
+/// The output is 16 floats per record in the column major layout of ngl::Mat4::openGL(), as raw
+/// native endian floats or, if the output name ends in .csv, 16 values a line printed so they
+/// read back to exactly the same floats. The QUATERNION order uses the quaternion of the rotate
+/// angles, as the ui does.
+//----------------------------------------------------------------------------------------------------------------------
+class BatchTransformer
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one binary input record, angles in degrees as in the ui
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Record
+  {
+    int32_t order = 0;                          ///< the MatrixOrder as its index
+    float translate[3] = {0.0f, 0.0f, 0.0f};
+    float rotate[3] = {0.0f, 0.0f, 0.0f};
+    float scale[3] = {1.0f, 1.0f, 1.0f};
+    float euler[4] = {0.0f, 1.0f, 0.0f, 0.0f}; ///< angle then axis x,y,z
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief timings of the last run, the stage times say which one held the others up
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    uint64_t records = 0;
+    uint64_t chunks = 0;
+    size_t inputBytes = 0;
+    size_t outputBytes = 0;
+    size_t threads = 0;
+    double seconds = 0.0;
+    double readWaitSeconds = 0.0;    ///< the reader waiting for a free chunk, compute or write bound
+    double computeSeconds = 0.0;     ///< parsing and composing, summed over the workers
+    double writeSeconds = 0.0;       ///< the writer in write calls
+    double writeWaitSeconds = 0.0;   ///< the writer waiting for the next chunk, read or compute bound
+    double recordsPerSecond() const { return seconds > 0.0 ? records / seconds : 0.0; }
+    double inputMBPerSecond() const { return seconds > 0.0 ? inputBytes / seconds / 1.0e6 : 0.0; }
+    double outputMBPerSecond() const { return seconds > 0.0 ? outputBytes / seconds / 1.0e6 : 0.0; }
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _pool the workers used for parsing and composing
+  /// @param[in] _chunkRecords the records (or csv lines) in a chunk
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit BatchTransformer(ThreadPool &_pool, size_t _chunkRecords = 65536);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the kernel used to compose, unsupported kernels fall back to the scalar one
+  //----------------------------------------------------------------------------------------------------------------------
+  void setKernel(TransformBatch::Kernel _kernel) { m_kernel = _kernel; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the most chunks being read, composed or written at once, 0 is two per worker
+  //----------------------------------------------------------------------------------------------------------------------
+  void setChunksInFlight(size_t _chunks) { m_inFlight = _chunks; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compose every record of _input into _output
+  /// @returns false on failure, error() says why, the output then holds the chunks before the
+  /// one that failed
+  //----------------------------------------------------------------------------------------------------------------------
+  bool transform(const std::string &_input, const std::string &_output);
+  const Stats &stats() const { return m_stats; }
+  const std::string &error() const { return m_error; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the binary header, then Records can be written straight after it
+  //----------------------------------------------------------------------------------------------------------------------
+  static void writeHeader(std::ostream &_out);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief append a record as a csv line that reads back to exactly the same floats
+  //----------------------------------------------------------------------------------------------------------------------
+  static void appendCSV(std::string &o_text, const Record &_record);
+  static constexpr size_t HeaderSize = 16;
+
+private :
+  struct Chunk;
+  void process(Chunk &_chunk, bool _binary, bool _csvOut) const;
+  ThreadPool &m_pool;
+  size_t m_chunkRecords;
+  size_t m_inFlight = 0;
+  TransformBatch::Kernel m_kernel = TransformBatch::bestKernel();
+  Stats m_stats;
+  std::string m_error;
+};
+
+#endif
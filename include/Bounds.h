@@ -0,0 +1,161 @@
+#ifndef BOUNDS_H_
+#define BOUNDS_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Bounds.h
+/// @brief axis aligned boxes and a view frustum to test them against
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Aabb
+/// @brief an axis aligned bounding box, an empty box has m_min > m_max
+//----------------------------------------------------------------------------------------------------------------------
+class Aabb
+{
+public :
+  float m_min[3];
+  float m_max[3];
+
+  static Aabb empty()
+  {
+    Aabb b;
+    for (int i = 0; i < 3; ++i)
+    {
+      b.m_min[i] = std::numeric_limits<float>::max();
+      b.m_max[i] = -std::numeric_limits<float>::max();
+    }
+    return b;
+  }
+  bool isEmpty() const { return m_min[0] > m_max[0]; }
+  void expand(const float _p[3])
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      m_min[i] = std::min(m_min[i], _p[i]);
+      m_max[i] = std::max(m_max[i], _p[i]);
+    }
+  }
+  void expand(const Aabb &_b)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      m_min[i] = std::min(m_min[i], _b.m_min[i]);
+      m_max[i] = std::max(m_max[i], _b.m_max[i]);
+    }
+  }
+  float centre(int _axis) const { return 0.5f * (m_min[_axis] + m_max[_axis]); }
+  bool operator==(const Aabb &_b) const { return std::memcmp(this, &_b, sizeof(Aabb)) == 0; }
+  bool operator!=(const Aabb &_b) const { return !(*this == _b); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the box around _count positions of 3 floats, _stride bytes apart
+  //----------------------------------------------------------------------------------------------------------------------
+  static Aabb fromPositions(const char *_data, size_t _count, size_t _stride)
+  {
+    auto b = empty();
+    for (size_t i = 0; i < _count; ++i)
+    {
+      float p[3];
+      std::memcpy(p, _data + i * _stride, sizeof(p));
+      b.expand(p);
+    }
+    return b;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the box around this one after an affine transform, each output axis is the
+  /// translation plus the smaller (or larger) end of every column times the input range
+  /// (Arvo's method) so it is tight for the transformed box without visiting the 8 corners
+  /// @param[in] _m a column major 4x4 matrix as ngl::Mat4::openGL(), the bottom row is ignored
+  //----------------------------------------------------------------------------------------------------------------------
+  Aabb transformed(const float *_m) const
+  {
+    Aabb b;
+    for (int r = 0; r < 3; ++r)
+    {
+      b.m_min[r] = b.m_max[r] = _m[12 + r];
+      for (int c = 0; c < 3; ++c)
+      {
+        float lo = _m[c * 4 + r] * m_min[c];
+        float hi = _m[c * 4 + r] * m_max[c];
+        b.m_min[r] += std::min(lo, hi);
+        b.m_max[r] += std::max(lo, hi);
+      }
+    }
+    return b;
+  }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Frustum
+/// @brief the six planes of a clip matrix (Gribb and Hartmann), each with the normal pointing
+/// inside. The planes are in whatever space the matrix maps from, so the planes of P*V*M cull
+/// boxes in M's model space.
+/// A box is tested against a plane at the corner furthest along (or against) the normal. Each
+/// corner coordinate is taken from the box unchanged, so a box inside another can never
+/// classify as more visible than the outer one, which is what lets a BVH accept or reject a
+/// whole subtree and still agree exactly with testing every box.
+//----------------------------------------------------------------------------------------------------------------------
+class Frustum
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @enum where a box is relative to the frustum
+  //----------------------------------------------------------------------------------------------------------------------
+  enum class Result{
+                    OUTSIDE,    ///< entirely outside one plane
+                    INTERSECTS, ///< may be partly inside
+                    INSIDE      ///< entirely inside every plane
+                   };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief [plane][a,b,c,d] with a*x+b*y+c*z+d >= 0 inside
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_planes[6][4];
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the planes of a column major clip matrix
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit Frustum(const float *_clip)
+  {
+    // row i of the column major matrix
+    auto row = [_clip](int _i, int _c) { return _clip[_c * 4 + _i]; };
+    for (int p = 0; p < 6; ++p)
+    {
+      const int axis = p / 2;
+      const float sign = p % 2 == 0 ? 1.0f : -1.0f;
+      for (int c = 0; c < 4; ++c)
+      {
+        m_planes[p][c] = row(3, c) + sign * row(axis, c);
+      }
+    }
+  }
+  Result classify(const Aabb &_b) const
+  {
+    Result result = Result::INSIDE;
+    for (auto &plane : m_planes)
+    {
+      float furthest = plane[3];
+      float nearest = plane[3];
+      for (int i = 0; i < 3; ++i)
+      {
+        furthest += plane[i] * (plane[i] >= 0.0f ? _b.m_max[i] : _b.m_min[i]);
+        nearest += plane[i] * (plane[i] >= 0.0f ? _b.m_min[i] : _b.m_max[i]);
+      }
+      if (furthest < 0.0f)
+      {
+        return Result::OUTSIDE;
+      }
+      if (nearest < 0.0f)
+      {
+        result = Result::INTERSECTS;
+      }
+    }
+    return result;
+  }
+  bool visible(const Aabb &_b) const { return classify(_b) != Result::OUTSIDE; }
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CACHEFILE_H_
+#define CACHEFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file CacheFile.h
+/// @brief helpers shared by the on disk caches (GeometryCache and ProgramCache)
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief 64 bit FNV-1a, used to name cache entries not for security
+/// @param[in] _seed the hash so far, lets several blocks be hashed as one
+//----------------------------------------------------------------------------------------------------------------------
+uint64_t hashBytes(const void *_data, size_t _size, uint64_t _seed = 14695981039346656037ull);
+inline uint64_t hashString(const std::string &_value, uint64_t _seed = 14695981039346656037ull)
+{
+  return hashBytes(_value.data(), _value.size(), _seed);
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief 16 hex digit version of a hash for use in a file name
+//----------------------------------------------------------------------------------------------------------------------
+std::string hashToHex(uint64_t _hash);
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief one block of bytes to write
+//----------------------------------------------------------------------------------------------------------------------
+struct CacheFilePart
+{
+  const void *data;
+  size_t size;
+};
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief write the parts one after the other to a temporary file then rename it to _path so
+/// another instance never sees half a file, the directory is created if needed
+/// @returns false if anything fails, no file is left behind
+//----------------------------------------------------------------------------------------------------------------------
+bool writeCacheFile(const std::string &_path, std::initializer_list<CacheFilePart> _parts);
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief delete every file in _directory with the extension _extension (e.g. ".geo")
+//----------------------------------------------------------------------------------------------------------------------
+void clearCacheFiles(const std::string &_directory, const std::string &_extension);
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef FRAMEPROFILER_H_
+#define FRAMEPROFILER_H_
+
+#include <ngl/Types.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameProfiler.h
+/// @brief cpu and gpu timing of the stages of a frame with a rolling history and Chrome
+/// trace_event export (load the file in chrome://tracing or https://ui.perfetto.dev)
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class FrameProfiler
+/// @brief each stage is timed on the cpu with std::chrono and on the gpu with a
+/// GL_TIME_ELAPSED query. The queries are read QueryLatency frames later, and only if the
+/// result is already available, so the profiler never waits for the gpu. Stages must not
+/// overlap as only one GL_TIME_ELAPSED query can be active at a time.
+/// The frame and stage calls belong to the thread that renders, mark and the trace calls can
+/// be made from any thread.
+//----------------------------------------------------------------------------------------------------------------------
+class FrameProfiler
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of frames of queries in flight
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t QueryLatency = 4;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _stages the names of the stages, the index is used as the stage id
+  /// @param[in] _historyFrames the number of samples kept per stage
+  //----------------------------------------------------------------------------------------------------------------------
+  FrameProfiler(std::initializer_list<const char *> _stages, size_t _historyFrames = 120);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create and delete the queries, these need a current GL context
+  //----------------------------------------------------------------------------------------------------------------------
+  void initializeGL();
+  void releaseGL();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief called at the start and end of each frame
+  //----------------------------------------------------------------------------------------------------------------------
+  void beginFrame();
+  void endFrame();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief time a stage, prefer the Scope helper
+  //----------------------------------------------------------------------------------------------------------------------
+  void beginStage(size_t _stage);
+  void endStage(size_t _stage);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief times a stage for the life of the scope
+  //----------------------------------------------------------------------------------------------------------------------
+  class Scope
+  {
+  public :
+    Scope(FrameProfiler &_profiler, size_t _stage) : m_profiler(_profiler), m_stage(_stage) { m_profiler.beginStage(m_stage); }
+    ~Scope() { m_profiler.endStage(m_stage); }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+  private :
+    FrameProfiler &m_profiler;
+    size_t m_stage;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add an instant event to the trace, used to see which ui action caused a spike
+  //----------------------------------------------------------------------------------------------------------------------
+  void mark(const char *_name);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the average and worst times in ms over the history
+  //----------------------------------------------------------------------------------------------------------------------
+  double averageCPU(size_t _stage) const { return average(m_stages[_stage].cpu); }
+  double averageGPU(size_t _stage) const { return average(m_stages[_stage].gpu); }
+  double maxCPU(size_t _stage) const { return maximum(m_stages[_stage].cpu); }
+  double maxGPU(size_t _stage) const { return maximum(m_stages[_stage].gpu); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the samples in ms oldest first
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<double> historyCPU(size_t _stage) const { return m_stages[_stage].cpu.ordered(); }
+  std::vector<double> historyGPU(size_t _stage) const { return m_stages[_stage].gpu.ordered(); }
+  size_t numStages() const { return m_stages.size(); }
+  const std::string &stageName(size_t _stage) const { return m_stages[_stage].name; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief gpu frames whose results were not ready in time and have been dropped
+  //----------------------------------------------------------------------------------------------------------------------
+  uint64_t droppedGPUFrames() const { return m_droppedGPUFrames; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the gpu time in ms of all the stages of the newest frame whose queries have been
+  /// read, this is QueryLatency frames behind the one being drawn. 0 until the first is read
+  //----------------------------------------------------------------------------------------------------------------------
+  double lastGPUFrameMs() const { return m_lastGPUFrameMs; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one line of average cpu/gpu times per stage for the status bar
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string summary() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief record every stage to memory until stopTrace writes the trace_event json
+  //----------------------------------------------------------------------------------------------------------------------
+  void startTrace();
+  bool stopTrace(const std::string &_fileName);
+  bool isTracing() const { return m_tracing; }
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fixed size ring of samples
+  //----------------------------------------------------------------------------------------------------------------------
+  struct History
+  {
+    std::vector<double> samples;
+    size_t next = 0;
+    size_t count = 0;
+    void push(double _value);
+    std::vector<double> ordered() const;
+  };
+  struct Stage
+  {
+    std::string name;
+    History cpu;
+    History gpu;
+    double startUs = 0.0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the queries issued in one frame
+  //----------------------------------------------------------------------------------------------------------------------
+  struct QueryFrame
+  {
+    std::vector<GLuint> queries;
+    std::vector<bool> issued;
+    std::vector<double> startUs;
+    uint64_t frame = 0;
+    bool pending = false;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a Chrome trace "X" (complete) or "i" (instant) event
+  //----------------------------------------------------------------------------------------------------------------------
+  struct TraceEvent
+  {
+    std::string name;
+    char phase;
+    int thread;
+    double startUs;
+    double durationUs;
+  };
+  static double average(const History &_history);
+  static double maximum(const History &_history);
+  double nowUs() const;
+  void collect(QueryFrame &_frame);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add _event to m_trace if tracing
+  //----------------------------------------------------------------------------------------------------------------------
+  void record(TraceEvent _event);
+
+  std::vector<Stage> m_stages;
+  QueryFrame m_queryFrames[QueryLatency];
+  std::chrono::steady_clock::time_point m_epoch;
+  uint64_t m_frame = 0;
+  double m_frameStartUs = 0.0;
+  uint64_t m_droppedGPUFrames = 0;
+  double m_lastGPUFrameMs = 0.0;
+  bool m_glReady = false;
+  std::atomic<bool> m_tracing{false};
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the trace, guarded by m_traceMutex as the ui marks can come from another thread
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<TraceEvent> m_trace;
+  std::mutex m_traceMutex;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef GEOMETRYCACHE_H_
+#define GEOMETRYCACHE_H_
+
+#include "MappedFile.h"
+#include <ngl/AbstractVAO.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GeometryCache.h
+/// @brief on disk cache of generated vertex buffers so they don't have to be rebuilt at start up
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class GeometryCache
+/// @brief each entry is one file holding a header (format version, key, draw mode, vertex
+/// count and attribute layout) followed by the raw contents of the vertex buffer. A hit maps
+/// the file and hands the data straight to glBufferSubData, a miss reads the buffer and
+/// attribute layout of the freshly built VAO back from GL and writes a new entry.
+/// The key must contain every parameter the geometry is generated from, a different key
+/// is a different file so stale entries are never used. Bump Version if the file layout or
+/// the way any of the cached meshes is generated changes.
+/// A valid GL context is needed for load, store and createPrimitive.
+//----------------------------------------------------------------------------------------------------------------------
+class GeometryCache
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the file format version, older files are treated as a miss
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr uint32_t Version = 1;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief hit and miss counts and the time spent in each since the last resetStats
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t bytesRead = 0;
+    size_t bytesWritten = 0;
+    double hitSeconds = 0.0;
+    double missSeconds = 0.0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one glVertexAttribPointer call, offset is in bytes
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Attribute
+  {
+    uint32_t location;
+    uint32_t size;
+    uint32_t type;
+    uint32_t stride;
+    uint32_t offset;
+    uint32_t normalised;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a validated entry, data points into the mapped file so it is only valid while
+  /// the entry exists
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Entry
+  {
+    MappedFile file;
+    GLenum mode = GL_TRIANGLES;
+    size_t vertices = 0;
+    std::vector<Attribute> attributes;
+    const char *data = nullptr;
+    size_t bytes = 0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _directory where the entries are kept, created on the first store. An empty
+  /// directory disables the cache, every createPrimitive is then a miss that isn't stored
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit GeometryCache(std::string _directory);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief map and validate the entry for _key, this makes no GL calls and doesn't touch the
+  /// stats so it can be used from any thread
+  /// @returns false if there is no valid entry
+  //----------------------------------------------------------------------------------------------------------------------
+  bool read(const std::string &_key, Entry &o_entry) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief make a VAO for _entry around a buffer already holding its data, the VAO owns
+  /// the buffer afterwards. Lets the upload happen on another (shared) context
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::unique_ptr<ngl::AbstractVAO> createVAO(const Entry &_entry, GLuint _buffer);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief make a VAO from the entry for _key
+  /// @returns nullptr if there is no valid entry
+  //----------------------------------------------------------------------------------------------------------------------
+  std::unique_ptr<ngl::AbstractVAO> load(const std::string &_key);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the contents of _vao as the entry for _key, only non indexed VAOs with a
+  /// single vertex buffer can be stored
+  /// @returns false if the VAO can't be cached or the file can't be written
+  //----------------------------------------------------------------------------------------------------------------------
+  bool store(const std::string &_key, ngl::AbstractVAO *_vao);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read the attribute layout and vertex buffer of _vao back from GL
+  /// @returns false if _vao is indexed, has per instance or integer attributes or uses more
+  /// than one buffer
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool readBack(ngl::AbstractVAO *_vao, std::vector<Attribute> &o_attributes, std::vector<char> &o_data);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the key createPrimitive uses for _name and _params
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::string primitiveKey(const std::string &_name, const std::string &_params) { return _name + " " + _params; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add _name to ngl::VAOPrimitives, from the cache if possible otherwise by calling
+  /// _create (which must add _name itself) and storing the result
+  /// @param[in] _name the VAOPrimitives name
+  /// @param[in] _params the generation parameters, combined with _name to make the key
+  /// @param[in] _create builds the primitive on a miss
+  /// @returns true on a hit
+  //----------------------------------------------------------------------------------------------------------------------
+  bool createPrimitive(const std::string &_name, const std::string &_params, const std::function<void()> &_create);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief delete every entry in the directory
+  //----------------------------------------------------------------------------------------------------------------------
+  void clear();
+  const std::string &directory() const { return m_directory; }
+  bool enabled() const { return !m_directory.empty(); }
+  const Stats &stats() const { return m_stats; }
+  void resetStats() { m_stats = Stats(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one line summary of the stats for the log
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string summary() const;
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the entry file name, the name part of the key followed by a hash of the whole key
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string fileName(const std::string &_key) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the attribute pointers of the bound _vao from _entry
+  //----------------------------------------------------------------------------------------------------------------------
+  static void setLayout(ngl::AbstractVAO *_vao, const Entry &_entry);
+
+  std::string m_directory;
+  Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef INSTANCEBVH_H_
+#define INSTANCEBVH_H_
+
+#include "Bounds.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file InstanceBVH.h
+/// @brief bounding volume hierarchy over the boxes of many instances for frustum culling
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class InstanceBVH
+/// @brief a binary tree of boxes built by splitting the instances at the median centre along
+/// the longest axis until at most LeafSize are left. The nodes are stored depth first, so a
+/// node's left child follows it and every subtree covers one contiguous run of instance
+/// indices, which lets a query take a node that is wholly inside the frustum in one go.
+/// When the instances move, refit recomputes the boxes without changing the tree. Given the
+/// list of instances that changed it only walks up from their leaves, and stops at the first
+/// node whose box is unchanged. The tree gets looser if the instances move a long way
+/// relative to each other, build again if that matters.
+//----------------------------------------------------------------------------------------------------------------------
+class InstanceBVH
+{
+public :
+  static constexpr size_t LeafSize = 4;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief counters since the last resetStats
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    size_t builds = 0;
+    size_t refits = 0;
+    size_t nodesRefit = 0;
+    size_t queries = 0;
+    size_t nodesVisited = 0;
+    double buildSeconds = 0.0;
+    double refitSeconds = 0.0;
+    double querySeconds = 0.0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build a new tree
+  /// @param[in] _boxes one box per instance
+  /// @param[in] _count the number of instances
+  //----------------------------------------------------------------------------------------------------------------------
+  void build(const Aabb *_boxes, size_t _count);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief recompute every node from _boxes, which must hold size() boxes in the same order
+  /// as the build
+  //----------------------------------------------------------------------------------------------------------------------
+  void refit(const Aabb *_boxes);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief recompute the nodes above the instances in _changed, falls back to a full refit
+  /// when so many have changed that walking up from each would cost more
+  //----------------------------------------------------------------------------------------------------------------------
+  void refit(const Aabb *_boxes, const uint32_t *_changed, size_t _count);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the instances whose boxes aren't outside _frustum, exactly the ones for which
+  /// Frustum::visible is true
+  /// @param[out] o_visible replaced with the indices in tree order
+  //----------------------------------------------------------------------------------------------------------------------
+  void query(const Frustum &_frustum, std::vector<uint32_t> &o_visible);
+  size_t size() const { return m_indices.size(); }
+  size_t nodes() const { return m_nodes.size(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the box around every instance, empty if there are none
+  //----------------------------------------------------------------------------------------------------------------------
+  Aabb bounds() const { return m_nodes.empty() ? Aabb::empty() : m_nodes[0].box; }
+  const Stats &stats() const { return m_stats; }
+  void resetStats() { m_stats = Stats(); }
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief first and count are the run of m_indices under the node, right is the index of
+  /// the right child or 0 for a leaf (the root is never anyone's child)
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Node
+  {
+    Aabb box;
+    uint32_t first;
+    uint32_t count;
+    uint32_t right;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief recompute one node's box from its children or instances
+  //----------------------------------------------------------------------------------------------------------------------
+  void refitNode(uint32_t _node);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build the subtree over the instances [_first,_first+_count) of m_indices
+  /// @returns the index of its root
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t buildNode(uint32_t _first, uint32_t _count, uint32_t _parent, const std::vector<float> &_centres);
+
+  std::vector<Node> m_nodes;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the instances in leaf order, and a copy of their boxes in the same order so a leaf
+  /// reads its boxes from one run of memory
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<uint32_t> m_indices;
+  std::vector<Aabb> m_boxes;
+  std::vector<uint32_t> m_parent;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief where each instance is in m_indices and the leaf holding it
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<uint32_t> m_slotOf;
+  std::vector<uint32_t> m_leafOf;
+  std::vector<uint32_t> m_stack;
+  Stats m_stats;
+};
+
+#endif
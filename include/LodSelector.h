@@ -0,0 +1,73 @@
+#ifndef LODSELECTOR_H_
+#define LODSELECTOR_H_
+
+#include "Bounds.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file LodSelector.h
+/// @brief picks a level of detail for each object from how big it is on screen
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class LodSelector
+/// @brief the size of an object is the diameter in pixels of the sphere around its mesh box
+/// after the model matrix, so it follows the translation and scale of whatever matrix order
+/// made the matrix. Level 0 is the full mesh and is used while the object is at least
+/// thresholds()[0] pixels across, level 1 down to thresholds()[1] and so on.
+/// To stop an object flicking between two levels when it sits on a threshold, it only moves to
+/// a finer level once it is hysteresis() (a fraction) bigger than the threshold, and only to a
+/// coarser one once it is that much smaller.
+//----------------------------------------------------------------------------------------------------------------------
+class LodSelector
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the most levels there can be, and the level of an object that hasn't been seen yet
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t MaxLevels = 8;
+  static constexpr uint8_t NoLevel = 0xff;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _thresholds the smallest size in pixels of each level but the last, largest first
+  /// @param[in] _hysteresis how far past a threshold an object must go to change level
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit LodSelector(std::vector<float> _thresholds = {240.0f, 96.0f, 32.0f}, float _hysteresis = 0.2f);
+  size_t levels() const { return m_thresholds.size() + 1; }
+  const std::vector<float> &thresholds() const { return m_thresholds; }
+  float hysteresis() const { return m_hysteresis; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the diameter in pixels of the sphere around _mesh transformed by _model
+  /// @param[in] _model a column major model matrix, with no projection in it
+  /// @param[in] _clip the column major projection * view, the view must be rigid so the sphere
+  /// keeps its size. Only the w row is used
+  /// @param[in] _pixelScale projection[1][1] * the viewport height in pixels / 2
+  /// @returns the largest float if the camera is inside the sphere
+  //----------------------------------------------------------------------------------------------------------------------
+  static float screenSize(const Aabb &_mesh, const float *_model, const float *_clip, float _pixelScale);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the level for an object _pixels across that used _current last time
+  /// @param[in] _current the previous level or NoLevel to ignore the hysteresis
+  //----------------------------------------------------------------------------------------------------------------------
+  uint8_t select(float _pixels, uint8_t _current) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief select a level for many instances of one mesh
+  /// @param[in] _models 16 floats per instance
+  /// @param[in] _instances the instances to update, or nullptr for the first _count
+  /// @param[in,out] io_levels the level of every instance, indexed by instance
+  /// @param[in] _pool if set large counts are split over the workers
+  /// @returns the number of instances whose level changed
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t select(const Aabb &_mesh, const float *_models, const uint32_t *_instances, size_t _count,
+                const float *_clip, float _pixelScale, uint8_t *io_levels, ThreadPool *_pool = nullptr) const;
+
+private :
+  std::vector<float> m_thresholds;
+  float m_hysteresis;
+};
+
+#endif
@@ -3,7 +3,11 @@
 
 #include "NGLScene.h"
 #include "Axis.h"
+#include "ParamReplay.h"
+#include "Timeline.h"
+#include <QLabel>
 #include <QMainWindow>
+#include <QTimer>
 /// @namespace Ui our Ui namespace created from the MainWindow class
 namespace Ui {
     class MainWindow;
@@ -25,11 +29,25 @@ class MainWindow : public QMainWindow
 
 public:
   //----------------------------------------------------------------------------------------------------------------------
+  /// @param [in] _threaded draw the scene on a render thread, see NGLScene
   //----------------------------------------------------------------------------------------------------------------------
-    explicit MainWindow(QWidget *parent = 0);
+    explicit MainWindow(QWidget *parent = 0, bool _threaded = false);
   //----------------------------------------------------------------------------------------------------------------------
   //----------------------------------------------------------------------------------------------------------------------
     ~MainWindow();
+    /// @brief load a mesh and add it to the mesh list
+    /// @param [in] _fileName an obj or ply file
+    void importMesh(const QString &_fileName);
+    /// @brief draw the object with the cpu rasterizer rather than GL, as the tick box does
+    void setSoftwareRendering(bool _value);
+    /// @brief log every parameter change the scene gets until the window closes
+    /// @returns false if the log can't be created
+    bool startRecording(const QString &_fileName);
+    /// @brief replay recorded logs into the scene one after the other, then quit with a
+    /// failure code if any of them couldn't be replayed
+    /// @param [in] _flatOut don't wait for each change's recorded time
+    /// @param [in] _json write the frame time statistics of each log here, if not empty
+    void replay(const QStringList &_fileNames, bool _flatOut, const QString &_json);
 
 private:
   //----------------------------------------------------------------------------------------------------------------------
@@ -38,6 +56,20 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     //----------------------------------------------------------------------------------------------------------------------
     NGLScene *m_gl;
+    /// @brief shows the result of the last mesh import
+    QLabel *m_importReport;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the keyed transform of the ui, one track played back by m_timelineTimer a fixed
+    /// step per tick so playback doesn't speed up or slow down with the frame rate
+    //----------------------------------------------------------------------------------------------------------------------
+    Timeline m_timeline;
+    QTimer *m_timelineTimer;
+    /// @brief the time playback has reached in seconds
+    float m_playhead=0.0f;
+    /// @brief what the timeline evaluates into each tick and set key keys from
+    TransformParams m_pose;
+    /// @brief plays recorded logs back, nullptr unless replaying
+    ParamReplay *m_replay=nullptr;
     //----------------------------------------------------------------------------------------------------------------------
     /// \brief override the keyPressEvent inherited from QObject so we can handle key presses.
     /// @param [in] _event the event to process
@@ -54,6 +86,15 @@ private slots :
     void changeColour();
     void setEuler();
     void setTab(int _value);
+    void showFrameTime(double _cpuMs, double _gpuMs, int _instances);
+    void recordTrace(bool _value);
+    void openMesh();
+    void meshImported(QString _name, QString _report);
+    void meshImportFailed(QString _error);
+    void setKey();
+    void clearKeys();
+    void playTimeline(bool _value);
+    void timelineTick();
 
 };
 
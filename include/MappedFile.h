@@ -0,0 +1,59 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MappedFile.h
+/// @brief read only memory mapping of a whole file
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MappedFile
+/// @brief maps a file with mmap (or MapViewOfFile on windows), the pages are only read from
+/// disk when touched so many threads can parse different parts of a huge file at once
+//----------------------------------------------------------------------------------------------------------------------
+class MappedFile
+{
+public :
+  MappedFile() = default;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor maps the file, check isOpen for success
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit MappedFile(const std::string &_fileName) { open(_fileName); }
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&_other) noexcept;
+  MappedFile &operator=(MappedFile &&_other) noexcept;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief map _fileName, any previous mapping is closed first
+  /// @returns false if the file can't be opened or mapped
+  //----------------------------------------------------------------------------------------------------------------------
+  bool open(const std::string &_fileName);
+  void close();
+  bool isOpen() const { return m_open; }
+  const char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief hint that the file will be read from start to end
+  //----------------------------------------------------------------------------------------------------------------------
+  void adviseSequential() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start reading the pages of [_offset,_offset+_size) from disk without waiting for them,
+  /// the range is clipped to the file
+  //----------------------------------------------------------------------------------------------------------------------
+  void prefetch(size_t _offset, size_t _size) const;
+
+private :
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+  bool m_open = false;
+#if defined(_WIN32)
+  void *m_file = nullptr;
+  void *m_mapping = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef MATRIXORDER_H_
+#define MATRIXORDER_H_
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MatrixOrder.h
+/// @brief the order the transform components are multiplied in, shared by the
+/// NGLScene display and the TransformBatch library
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @enum for the Matrix order Rotate Trans Scale, Trans Rotate Scale, Euler or Quaternion
+/// the values match the index of the matrix order combo box in the ui
+//----------------------------------------------------------------------------------------------------------------------
+enum class MatrixOrder{
+                  RTS, ///<Rotate Translate Scale
+                  TRS, ///<Translate Rotate Scale
+                  GIMBALLOCK,
+                  EULERTS, //< Use Axis Angle Euler Trans Scale
+                  TEULERS, //<  Use Translate Euler Scale
+                  QUATERNION //< Translate, unit quaternion Rotation, Scale
+
+                };
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief every order, for tools and benchmarks that loop over them all
+//----------------------------------------------------------------------------------------------------------------------
+constexpr MatrixOrder s_matrixOrders[] = {MatrixOrder::RTS, MatrixOrder::TRS, MatrixOrder::GIMBALLOCK,
+                                          MatrixOrder::EULERTS, MatrixOrder::TEULERS, MatrixOrder::QUATERNION};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the name of an order as used in benchmark results and on the command line
+//----------------------------------------------------------------------------------------------------------------------
+inline const char *matrixOrderName(MatrixOrder _order)
+{
+  switch (_order)
+  {
+  case MatrixOrder::RTS: return "RTS";
+  case MatrixOrder::TRS: return "TRS";
+  case MatrixOrder::GIMBALLOCK: return "GIMBALLOCK";
+  case MatrixOrder::EULERTS: return "EULERTS";
+  case MatrixOrder::TEULERS: return "TEULERS";
+  case MatrixOrder::QUATERNION: return "QUATERNION";
+  }
+  return "unknown";
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef MESHIMPORTER_H_
+#define MESHIMPORTER_H_
+
+#include "ThreadPool.h"
+#include <functional>
+#include <string>
+
+class MappedFile;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshImporter.h
+/// @brief parallel OBJ and PLY loading for user meshes
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MeshImporter
+/// @brief the file is memory mapped and split into chunks which are parsed on the ThreadPool.
+/// The result is an unindexed triangle list of x,y,z,nx,ny,nz,u,v floats (the attribute
+/// layout the PBR shader expects) handed to the upload callback one chunk at a time, in
+/// order, on the calling thread while the later chunks are still being parsed. Faces with
+/// more than three vertices are split into a fan, missing normals are replaced by the face
+/// normal and missing uvs by 0.
+/// OBJ v/vt/vn/f (including negative indices) and PLY ascii, binary_little_endian and
+/// binary_big_endian are supported.
+//----------------------------------------------------------------------------------------------------------------------
+class MeshImporter
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of floats per vertex in the output
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t FloatsPerVertex = 8;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief timings of the last load
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    size_t fileBytes = 0;
+    size_t vertexBytes = 0;
+    size_t triangles = 0;
+    size_t threads = 0;
+    double parseSeconds = 0.0;  ///< wall time not spent in the upload callback
+    double uploadSeconds = 0.0; ///< time spent in the upload callback
+    double parseMBPerSecond() const { return parseSeconds > 0.0 ? fileBytes / parseSeconds / 1.0e6 : 0.0; }
+    double uploadMBPerSecond() const { return uploadSeconds > 0.0 ? vertexBytes / uploadSeconds / 1.0e6 : 0.0; }
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief called once with the total number of vertices before any data is uploaded
+  //----------------------------------------------------------------------------------------------------------------------
+  using AllocateFunc = std::function<void(size_t _vertices)>;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief called for each parsed chunk with its position in the vertex list
+  //----------------------------------------------------------------------------------------------------------------------
+  using UploadFunc = std::function<void(size_t _firstVertex, const float *_data, size_t _vertices)>;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _pool the workers used for parsing
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit MeshImporter(ThreadPool &_pool) : m_pool(_pool) {}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load a mesh
+  /// @returns false on failure, error() says why
+  //----------------------------------------------------------------------------------------------------------------------
+  bool load(const std::string &_fileName, const AllocateFunc &_allocate, const UploadFunc &_upload);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief check the extension is .obj or .ply
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool isSupported(const std::string &_fileName);
+  const Stats &stats() const { return m_stats; }
+  const std::string &error() const { return m_error; }
+
+private :
+  bool loadOBJ(const MappedFile &_file, const AllocateFunc &_allocate, const UploadFunc &_upload);
+  bool loadPLY(const MappedFile &_file, const AllocateFunc &_allocate, const UploadFunc &_upload);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief wait for each chunk in order and pass it to _upload
+  //----------------------------------------------------------------------------------------------------------------------
+  void streamChunks(std::vector<std::future<std::vector<float>>> &_chunks, const UploadFunc &_upload);
+
+  ThreadPool &m_pool;
+  Stats m_stats;
+  std::string m_error;
+};
+
+#endif
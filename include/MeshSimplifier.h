@@ -0,0 +1,39 @@
+#ifndef MESHSIMPLIFIER_H_
+#define MESHSIMPLIFIER_H_
+
+#include <cstddef>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshSimplifier.h
+/// @brief coarser versions of a triangle list for the distant levels of detail
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MeshSimplifier
+/// @brief vertex clustering (Rossignac and Borrel). The box around the mesh is split into a
+/// grid of cubes and every vertex in a cube is moved to the mean position of the vertices in
+/// it. Triangles with two corners in the same cube collapse and are dropped, as are repeats
+/// of a triangle that is already kept. Each corner keeps the rest of its own vertex (normal,
+/// uv) so the shading matches the full mesh, only the positions move, and never by more
+/// than the diagonal of a cube.
+/// It works on the raw vertex buffer of a non indexed triangle list, so anything GeometryCache
+/// can read back can be simplified and the result uses the same attribute layout.
+//----------------------------------------------------------------------------------------------------------------------
+class MeshSimplifier
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief simplify a triangle list
+  /// @param[in] _data the vertex buffer, three vertices per triangle
+  /// @param[in] _vertices the number of vertices, any incomplete triangle at the end is ignored
+  /// @param[in] _stride the bytes from one vertex to the next
+  /// @param[in] _position the byte offset of the 3 float position in each vertex
+  /// @param[in] _cells the number of cubes along the longest side of the box
+  /// @returns the kept triangles in the same layout, three vertices each
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::vector<char> cluster(const char *_data, size_t _vertices, size_t _stride, size_t _position,
+                                   unsigned int _cells);
+};
+
+#endif
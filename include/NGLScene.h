@@ -3,9 +3,39 @@
 
 #include "WindowParams.h"
 #include <ngl/Transformation.h>
+#include "AffineTransform.h"
+#include "Arcball.h"
 #include "Axis.h"
+#include "MatrixOrder.h"
+#include "TransformBatch.h"
+#include "TransformState.h"
+#include "FrameProfiler.h"
+#include "InstanceBVH.h"
+#include "LodSelector.h"
+#include "ParamLog.h"
+#include "ThreadPool.h"
+#include "GeometryCache.h"
+#include "ProgramCache.h"
+#include "PrimitiveLoader.h"
+#include "SnapshotMailbox.h"
+#include "SoftwareRasterizer.h"
+#include "UniformRing.h"
 #include <QOpenGLWidget>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QTimer>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class RenderThread;
+// matrixDirty is queued to the gui when it comes from the render thread
+Q_DECLARE_METATYPE(ngl::Mat4)
 //----------------------------------------------------------------------------------------------------------------------
 /// @file NGLScene.h
 /// @brief a basic Qt GL window class for ngl demos
@@ -25,38 +55,235 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief Constructor for GLWindow
   /// @param [in] _parent the parent window to create the GL context in
+  /// @param [in] _threaded draw the scene on a render thread of its own, the widget then only
+  /// shows the finished frames. It can't be changed later as the scene's vertex arrays belong
+  /// to the context that made them
+  //----------------------------------------------------------------------------------------------------------------------
+  NGLScene(QWidget *_parent, bool _threaded = false);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor stops the render thread and removes the instance buffer
   //----------------------------------------------------------------------------------------------------------------------
-  NGLScene(QWidget *_parent );
+  ~NGLScene() override;
   //----------------------------------------------------------------------------------------------------------------------
   //----------------------------------------------------------------------------------------------------------------------
   void resetMouse();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief gather the parameter changes made until the matching commit into one transaction.
+  /// The setters only store their values in m_params, which is handed to the render side and
+  /// a frame requested once when the outermost commit is reached. The render side rebuilds
+  /// the derived matrices and marks the components that really changed dirty when it takes
+  /// them. Changes made outside beginEdit / commit are gathered into one transaction that is
+  /// committed when control gets back to the event loop, so the several signals a single ui
+  /// action fires still make one transaction
+  //----------------------------------------------------------------------------------------------------------------------
+  void beginEdit();
+  void commit();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the per stage cpu and gpu times of the frames, only the trace can be used from the gui
+  //----------------------------------------------------------------------------------------------------------------------
+  FrameProfiler &profiler() { return m_profiler; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief what the frustum culling of the instances did in the last instanced frame
+  //----------------------------------------------------------------------------------------------------------------------
+  struct CullStats
+  {
+    size_t visible = 0;
+    size_t culled = 0;
+    double refitMs = 0.0; ///< making the instance boxes and building or refitting the BVH
+    double queryMs = 0.0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief what the level of detail selection drew in the last frame
+  //----------------------------------------------------------------------------------------------------------------------
+  struct LodStats
+  {
+    size_t triangles = 0;        ///< submitted by the mesh draws, with or without level of detail
+    size_t changes = 0;          ///< objects that changed level
+    std::vector<size_t> objects; ///< drawn at each level, empty if the mesh has no levels or they are off
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a copy of the render side's counters made at the end of each frame, so the gui can
+  /// show them while the render thread is drawing the next one
+  //----------------------------------------------------------------------------------------------------------------------
+  struct FrameReport
+  {
+    TransformStats stats;  ///< counters showing how much work the dirty tracking has saved
+    CullStats cull;
+    LodStats lod;
+    std::string ring;      ///< the upload counters of the TransformUBO ring
+    std::string profile;   ///< the per stage cpu and gpu times
+    std::string software;  ///< the SoftwareRasterizer's stage and tile times, empty when GL drew the object
+    std::string startup;   ///< what setting up the scene took, fixed once the context is made
+    std::string loader;    ///< how the primitives were made, as of the last time loading finished
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the report of the latest finished frame, gui thread only
+  //----------------------------------------------------------------------------------------------------------------------
+  const FrameReport &frameReport();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief how responsive the gui is over the last frames shown. The input latency is from
+  /// the first edit of a transaction to the end of paintGL for the first frame showing it,
+  /// the stall is the time paintGL holds up the gui thread
+  //----------------------------------------------------------------------------------------------------------------------
+  struct LatencyStats
+  {
+    double inputMs = 0.0;
+    double maxInputMs = 0.0;
+    double stallMs = 0.0;
+    double maxStallMs = 0.0;
+    uint64_t framesDropped = 0; ///< drawn by the render thread but replaced before being shown
+  };
+  LatencyStats latencyStats() const;
+  bool threaded() const { return m_renderThread != nullptr; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load an obj or ply file and add it to the list of meshes, if the GL context
+  /// doesn't exist yet the load happens at the end of initializeGL, when threaded it happens on
+  /// the render thread before its next frame. Emits meshImported or
+  /// meshImportFailed when done.
+  /// @param[in] _fileName the mesh to load
+  //----------------------------------------------------------------------------------------------------------------------
+  void importMesh(const QString &_fileName);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief log every commit of the parameters and every resize, with the time it was made, so
+  /// the session can be replayed by ParamReplay
+  /// @returns false if the log can't be created
+  //----------------------------------------------------------------------------------------------------------------------
+  bool startRecording(const std::string &_fileName);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @returns false if writing the log failed
+  //----------------------------------------------------------------------------------------------------------------------
+  bool stopRecording();
+  const ParamLogWriter &recorder() const { return m_recorder; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set every recorded parameter as one transaction. The viewport is left to the
+  /// widget's size, the replay resizes the window to it. The ui is not updated to match
+  //----------------------------------------------------------------------------------------------------------------------
+  void replayParams(const RecordedParams &_params);
 private :
-
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief everything the ui sets that the frame is drawn from. The gui thread edits m_params
+  /// and publishes a copy at each commit, the render side draws from the copy it last took
+  //----------------------------------------------------------------------------------------------------------------------
+  struct SceneParams
+  {
+    ngl::Vec3 translate{0.0f, 0.0f, 0.0f};
+    ngl::Vec3 rotate{0.0f, 0.0f, 0.0f};
+    ngl::Vec3 scale{1.0f, 1.0f, 1.0f};
+    float eulerAngle = 0.0f;
+    ngl::Vec3 eulerAxis{1.0f, 0.0f, 0.0f};
+    MatrixOrder order = MatrixOrder::RTS;
+    ngl::Vec3 colour{0.5f, 0.5f, 0.5f};
+    bool wireframe = false;
+    bool drawNormals = false;
+    bool geometryShaderNormals = false;
+    int normalSize = 6;
+    size_t drawIndex = 6;       ///< into m_meshNames, clamped by the render side
+    bool instanced = false;
+    int instanceCount = 1000;
+    bool frustumCull = true;
+    bool lod = true;
+    bool software = false;      ///< draw the single object with the SoftwareRasterizer
+    bool arcballMode = true;
+    float arcball[4] = {0.0f, 0.0f, 0.0f, 1.0f}; ///< the Arcball orientation x,y,z,w
+    int spinX = 0;
+    int spinY = 0;
+    ngl::Vec3 modelPos{0.0f, 0.0f, 0.0f};
+    int width = 0;
+    int height = 0;
+    float pixelRatio = 1.0f;
+    uint64_t edits = 0;         ///< the TransformStats edit counters, kept by the gui
+    uint64_t commits = 0;
+    uint64_t lastCommitEdits = 0;
+    int64_t inputNs = 0;        ///< steady clock time of the oldest edit not yet taken, 0 if none
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the parameters being edited (gui thread) and the ones the frame is drawn from (render side)
+  //----------------------------------------------------------------------------------------------------------------------
+  SceneParams m_params;
+  SceneParams m_frame;
+  SnapshotMailbox<SceneParams> m_paramsMailbox;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the log each published m_params is written to while recording
+  //----------------------------------------------------------------------------------------------------------------------
+  ParamLogWriter m_recorder;
+  static RecordedParams recordedParams(const SceneParams &_params);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the finished frames' counters on their way to the gui
+  //----------------------------------------------------------------------------------------------------------------------
+  SnapshotMailbox<FrameReport> m_reports;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draws the scene when threaded, nullptr when it is drawn in paintGL
+  //----------------------------------------------------------------------------------------------------------------------
+  std::unique_ptr<RenderThread> m_renderThread;
+  bool m_threaded;
+  int m_samples;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GL work from the gui (mesh imports, prefetch) waiting for the render side's context,
+  /// guarded by m_glJobsMutex
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<std::function<void()>> m_glJobs;
+  std::mutex m_glJobsMutex;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the steady clock time of the first edit of the open transaction, and of the oldest
+  /// input in the frame being drawn (render side, 0 if none)
+  //----------------------------------------------------------------------------------------------------------------------
+  int64_t m_firstEditNs;
+  int64_t m_frameInputNs;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fixed size ring of the gui's latency samples in ms
+  //----------------------------------------------------------------------------------------------------------------------
+  struct History
+  {
+    std::array<double, 120> samples = {};
+    size_t next = 0;
+    size_t count = 0;
+    void push(double _value);
+    double mean() const;
+    double max() const;
+  };
+  History m_inputLatency;
+  History m_guiStall;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set once paintGL has shown a frame, the prefetch waits for it
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_frameShown;
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief used to store the x rotation mouse value
   //----------------------------------------------------------------------------------------------------------------------
   WinParams m_win;
   //----------------------------------------------------------------------------------------------------------------------
-  ngl::Vec3 m_modelPos;
-  //----------------------------------------------------------------------------------------------------------------------
   /// @brief used to store the global mouse transforms
   //----------------------------------------------------------------------------------------------------------------------
   ngl::Mat4 m_mouseGlobalTX;
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the rotation part of m_mouseGlobalTX, only rebuilt when the mouse spins
+  //----------------------------------------------------------------------------------------------------------------------
+  ngl::Mat4 m_mouseRotation;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the left mouse drag rotation when arcballMode is set, otherwise the integer
+  /// m_win.spinXFace / spinYFace angles are used. Both are copied to m_params
+  //----------------------------------------------------------------------------------------------------------------------
+  Arcball m_arcball;
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief Our Camera
   //----------------------------------------------------------------------------------------------------------------------
   ngl::Mat4 m_view;
   ngl::Mat4 m_project;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief the index into the VBO name array for the drawing
+  /// @brief the VAOPrimitives names that can be drawn, the built in ones then any imported meshes
   //----------------------------------------------------------------------------------------------------------------------
-  size_t m_drawIndex;
+  std::vector<std::string> m_meshNames;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief flag to indicate if we draw the normals
+  /// @brief workers for the cpu heavy jobs such as mesh import
   //----------------------------------------------------------------------------------------------------------------------
-  bool m_drawNormals;
+  ThreadPool m_pool;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief the final transform matrix
+  /// @brief the final transform, composed in closed form from the translate values, the rotation
+  /// for the order and the scale values
+  //----------------------------------------------------------------------------------------------------------------------
+  AffineTransform m_affine;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief m_affine expanded to a full matrix for the ui
   //----------------------------------------------------------------------------------------------------------------------
   ngl::Mat4 m_transform;
   //----------------------------------------------------------------------------------------------------------------------
@@ -69,47 +296,226 @@ private :
   //----------------------------------------------------------------------------------------------------------------------
   ngl::Mat4 m_gimbal;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief the translation matrix
-  //----------------------------------------------------------------------------------------------------------------------
-  ngl::Mat4 m_translate;
+  /// @brief the rotation as a unit quaternion x,y,z,w for MatrixOrder::QUATERNION and its matrix,
+  /// made straight from the quaternion rather than by multiplying axis rotations
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief the scale matrix
-  //----------------------------------------------------------------------------------------------------------------------
-  ngl::Mat4 m_scale;
+  float m_orientation[4];
+  ngl::Mat4 m_quaternionRotate;
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief the Euler rotation matrix
   //----------------------------------------------------------------------------------------------------------------------
   ngl::Mat4 m_euler;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief the colour for the object material
+  /// @brief the axis
   //----------------------------------------------------------------------------------------------------------------------
-  ngl::Vec3 m_colour;
+  std::unique_ptr<Axis> m_axis;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief the size to draw the normals
+  /// @brief which parts of the transform have changed since the last frame
   //----------------------------------------------------------------------------------------------------------------------
-  int m_normalSize;
+  TransformState m_state;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief the axis
+  /// @brief recompute and signal counters, the edit counters are copied from m_frame
   //----------------------------------------------------------------------------------------------------------------------
-  std::unique_ptr<Axis> m_axis;
+  TransformStats m_stats;
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the edits made in the open transaction, the beginEdit nesting depth and whether an
+  /// implicit transaction is waiting for the event loop
   //----------------------------------------------------------------------------------------------------------------------
-  bool m_wireframe;
+  uint64_t m_pendingEdits;
+  int m_editDepth;
+  bool m_commitQueued;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @enum for the Matrix order Rotate Trans Scale, Trans Rotate Scale or Euler
+  /// @brief the last matrix sent with matrixDirty
   //----------------------------------------------------------------------------------------------------------------------
-  enum class MatrixOrder{
-                    RTS, ///<Rotate Translate Scale
-                    TRS, ///<Translate Rotate Scale
-                    GIMBALLOCK,
-                    EULERTS, //< Use Axis Angle Euler Trans Scale
-                    TEULERS //<  Use Translate Euler Scale
-
-                  };
+  ngl::Mat4 m_emittedTransform;
+  bool m_matrixEmitted;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the layout of the TransformUBO uniform block in PBRVertex.glsl
+  //----------------------------------------------------------------------------------------------------------------------
+  struct TransformUBO
+  {
+    ngl::Mat4 MVP;
+    float normalMatrix[3][4]; ///< std140 mat3, each column is padded to a vec4
+    ngl::Mat4 M;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the last values uploaded to the TransformUBO
+  //----------------------------------------------------------------------------------------------------------------------
+  TransformUBO m_transformUBO;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the ring of buffer slices the TransformUBO block is uploaded to
+  //----------------------------------------------------------------------------------------------------------------------
+  UniformRing m_transformRing;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief distance between the copies on the instance grid
+  //----------------------------------------------------------------------------------------------------------------------
+  float m_instanceSpacing;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set when a parameter changes and the instance matrices must be rebuilt
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_instancesDirty;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the per instance parameters, the ui transform plus a grid offset
+  //----------------------------------------------------------------------------------------------------------------------
+  TransformParams m_instanceParams;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief per instance model matrices (16 floats) followed by the normal matrices (9 floats)
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<float> m_instanceData;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the buffer holding m_instanceData on the GPU
+  //----------------------------------------------------------------------------------------------------------------------
+  GLuint m_instanceBuffer;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the box around each instance before the mouse transform, and the BVH over them
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<Aabb> m_instanceBounds;
+  InstanceBVH m_instanceBVH;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the mesh m_instanceBounds were made for, empty when they need remaking
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_boundsName;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the box around each mesh in its own space, empty if the mesh couldn't be read back
+  //----------------------------------------------------------------------------------------------------------------------
+  std::map<std::string, Aabb> m_meshBounds;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the instances in m_instanceBuffer when culling, and the next query's result
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<uint32_t> m_visibleInstances;
+  std::vector<uint32_t> m_cullResult;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the matrices of m_visibleInstances packed in the same layout as m_instanceData
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<float> m_visibleData;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set when m_instanceBuffer no longer holds the instances that should be drawn
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_instanceUploadDirty;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of instances in m_instanceBuffer
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t m_drawnInstances;
+  CullStats m_cullStats;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief picks the coarser levels of detail of the mesh when it is small on screen
+  //----------------------------------------------------------------------------------------------------------------------
+  LodSelector m_lodSelector;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the level last used for the single object and for each instance, kept for the hysteresis
+  //----------------------------------------------------------------------------------------------------------------------
+  uint8_t m_objectLod;
+  std::vector<uint8_t> m_instanceLods;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the drawn instances grouped by level, and the range of m_instanceBuffer each
+  /// level uses. m_lodGrouped is set when the buffer is in this order
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<uint32_t> m_drawOrder;
+  std::array<size_t, LodSelector::MaxLevels> m_lodFirst;
+  std::array<size_t, LodSelector::MaxLevels> m_lodCount;
+  bool m_lodGrouped;
+  LodStats m_lodStats;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief used to time each frame
+  //----------------------------------------------------------------------------------------------------------------------
+  QElapsedTimer m_frameTimer;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief times the stages of renderFrame
+  //----------------------------------------------------------------------------------------------------------------------
+  FrameProfiler m_profiler;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the generated primitives and axis kept between runs
+  //----------------------------------------------------------------------------------------------------------------------
+  GeometryCache m_geometryCache;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the times initializeScene took and the geometry and program cache hits, copied into
+  /// every FrameReport
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_startup;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the linked shader programs kept between runs
+  //----------------------------------------------------------------------------------------------------------------------
+  ProgramCache m_programCache;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief makes the generated primitives when they are first needed
+  //----------------------------------------------------------------------------------------------------------------------
+  PrimitiveLoader m_loader;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief m_loader's summary from when it last finished, copied into every FrameReport
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_loaderSummary;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief polls m_loader while it is busy, the render thread polls it itself
+  //----------------------------------------------------------------------------------------------------------------------
+  QTimer m_loadTimer;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load the rest of the primitives after the first frame
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_prefetch;
+  bool m_prefetchStarted;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the mesh to draw, a placeholder while the selected one is still loading
+  //----------------------------------------------------------------------------------------------------------------------
+  const std::string &drawName() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief hand over finished loads and repaint if the drawn mesh is now ready
+  //----------------------------------------------------------------------------------------------------------------------
+  void pollLoader();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue every primitive not yet loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  void startPrefetch();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue the coarser levels of the selected mesh when the level of detail is on
+  //----------------------------------------------------------------------------------------------------------------------
+  void requestLods();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the mesh to draw for level _level, the next finer level that is ready if it is
+  /// still loading
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string lodDrawName(size_t _level) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the pixels per unit of size at distance one, for LodSelector::screenSize
+  //----------------------------------------------------------------------------------------------------------------------
+  float pixelScale() const;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief the order of multiplication for the transform matrix
+  /// @brief the vertex and face normal lines of each mesh, made the first time its normals are drawn
   //----------------------------------------------------------------------------------------------------------------------
-  MatrixOrder m_matrixOrder;
+  std::map<std::string, std::unique_ptr<ngl::AbstractVAO>> m_normalLines;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the normal lines for _name, building them if needed
+  /// @returns nullptr if the mesh can't be read back, the geometry shader is then used
+  //----------------------------------------------------------------------------------------------------------------------
+  ngl::AbstractVAO *normalLines(const std::string &_name);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draws the single object on the cpu when software is set. It has its own workers so a
+  /// frame never waits behind a mesh load on m_pool
+  //----------------------------------------------------------------------------------------------------------------------
+  std::unique_ptr<ThreadPool> m_softwarePool;
+  std::unique_ptr<SoftwareRasterizer> m_software;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the vertices of a mesh read back from GL the first time it is drawn in software,
+  /// mesh.data is nullptr if it can't be drawn that way
+  //----------------------------------------------------------------------------------------------------------------------
+  struct SoftwareMesh
+  {
+    std::vector<char> data;
+    SoftwareRasterizer::Mesh mesh;
+  };
+  std::map<std::string, SoftwareMesh> m_softwareMeshes;
+  const SoftwareMesh &softwareMesh(const std::string &_name);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the colour and depth textures the software frame is copied to the framebuffer
+  /// through, and the empty VAO the copy is drawn with
+  //----------------------------------------------------------------------------------------------------------------------
+  GLuint m_softwareTextures[2];
+  GLuint m_softwareVAO;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draw the object with m_software and copy it into the framebuffer with its depth, so
+  /// the normals and axis drawn by GL afterwards are hidden by it as usual
+  /// @returns false if the mesh can't be read back, it is then drawn by GL
+  //----------------------------------------------------------------------------------------------------------------------
+  bool drawSoftware();
 
 public slots :
   //----------------------------------------------------------------------------------------------------------------------
@@ -119,17 +525,26 @@ public slots :
   //----------------------------------------------------------------------------------------------------------------------
   void vboChanged(int _index);
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief slot to turn loading the unused primitives in the background on or off
+  //----------------------------------------------------------------------------------------------------------------------
+  void setPrefetch(bool _value);
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief slot to indicate the normal tick box has been activated
   /// called from MainWindow
   /// @param[in] _value the new value of the tick box
   //----------------------------------------------------------------------------------------------------------------------
   void toggleNormals(bool _value );
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief slot to draw the normals with the geometry shader rather than the prebuilt lines
+  /// @param[in] _value the new value of the tick box
+  //----------------------------------------------------------------------------------------------------------------------
+  void toggleGeometryShaderNormals(bool _value );
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief slot to indicate the wireframe tick box has been activated
   /// called from MainWindow
   /// @param[in] _value the new value of the tick box
   //----------------------------------------------------------------------------------------------------------------------
-  void toggleWireframe(bool _value ){m_wireframe=_value; update();}
+  void toggleWireframe(bool _value ){m_profiler.mark("toggleWireframe"); m_params.wireframe=_value; edit();}
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief slot to indicate the normal length slider had changed
   /// called from MainWindow
@@ -138,7 +553,7 @@ public slots :
   void setNormalSize(int _value );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief called when any of the scale elements are modified sets the
-  /// new m_scale matrix value and forces a re-calcuation and re-draw
+  /// new scale values and forces a re-calcuation and re-draw
   /// called from MainWindow
   /// @param[in] _x the value of scale in the x
   /// @param[in] _y the value of scale in the y
@@ -147,7 +562,7 @@ public slots :
   void setScale(float _x,float _y, float _z );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief called when any of the translate elements are modified sets the
-  /// new m_translate matrix value and forces a re-calcuation and re-draw
+  /// new translate values and forces a re-calcuation and re-draw
   /// called from MainWindow
   /// @param[in] _x the value of translate in the x
   /// @param[in] _y the value of translate in the y
@@ -165,6 +580,13 @@ public slots :
   //----------------------------------------------------------------------------------------------------------------------
   void setRotate(float _x,float _y, float _z );
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the translation, rotation and scale as one transaction
+  /// @param[in] _translate the translate values
+  /// @param[in] _rotate the x, y and z rotations in degrees
+  /// @param[in] _scale the scale values
+  //----------------------------------------------------------------------------------------------------------------------
+  void setTRS(ngl::Vec3 _translate, ngl::Vec3 _rotate, ngl::Vec3 _scale);
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief called when the colour button is pressed and a new colour selected
   /// sets a new current material and forces update
   /// called from MainWindow
@@ -175,7 +597,7 @@ public slots :
   void setColour(float _r,float _g,float _b );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief called when the matrix order combobox is changed sets the new
-  /// matrix order for m_matrixOrder and forces re-draw
+  /// matrix order and forces re-draw
   /// called from MainWindow
   /// @param[in] _index the index of the combobox
   //---------------------------------------------------------------------------------------------------------------------
@@ -190,6 +612,36 @@ public slots :
   /// @param[in] _z the value of rotation axis [-1 , 1]
   //----------------------------------------------------------------------------------------------------------------------
   void setEuler(float _angle,float _x,float _y,float _z );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief slot to indicate the instanced tick box has been activated
+  /// called from MainWindow
+  /// @param[in] _value the new value of the tick box
+  //----------------------------------------------------------------------------------------------------------------------
+  void toggleInstanced(bool _value );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief called when the instance count spinbox is changed
+  /// called from MainWindow
+  /// @param[in] _count the number of copies to draw
+  //----------------------------------------------------------------------------------------------------------------------
+  void setInstanceCount(int _count );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief slot to switch the mouse rotation between the arcball and the x / y spin angles
+  /// @param[in] _value true for the arcball
+  //----------------------------------------------------------------------------------------------------------------------
+  void setArcball(bool _value );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief slot to switch the frustum culling of the instances on and off
+  //----------------------------------------------------------------------------------------------------------------------
+  void setFrustumCulling(bool _value );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief slot to switch the level of detail selection on and off
+  //----------------------------------------------------------------------------------------------------------------------
+  void setLod(bool _value );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief slot to draw the single object with the cpu rasterizer rather than GL, the instances
+  /// are always drawn by GL
+  //----------------------------------------------------------------------------------------------------------------------
+  void setSoftwareRendering(bool _value );
 
  signals :
   //----------------------------------------------------------------------------------------------------------------------
@@ -198,6 +650,29 @@ public slots :
   /// @param _m the new transformation values used in the display
   //----------------------------------------------------------------------------------------------------------------------
   void matrixDirty(ngl::Mat4 _m);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief signal emitted at the end of each frame with the time it took
+  /// @param _cpuMs the time in milli seconds to submit the frame, the gpu isn't waited for
+  /// @param _gpuMs the gpu time of a frame FrameProfiler::QueryLatency frames earlier
+  /// @param _instances the number of copies drawn
+  //----------------------------------------------------------------------------------------------------------------------
+  void frameTime(double _cpuMs, double _gpuMs, int _instances);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief signal emitted by paintGL when it shows a frame with new input in it
+  /// @param _ms from the first edit of the oldest transaction in the frame to the end of paintGL
+  //----------------------------------------------------------------------------------------------------------------------
+  void inputLatency(double _ms);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief signal emitted when an imported mesh is ready to draw
+  /// @param _name the name added to the mesh list
+  /// @param _report the size and throughput of the import
+  //----------------------------------------------------------------------------------------------------------------------
+  void meshImported(QString _name, QString _report);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief signal emitted when a mesh can't be imported
+  /// @param _error why
+  //----------------------------------------------------------------------------------------------------------------------
+  void meshImportFailed(QString _error);
 protected:
 
   //----------------------------------------------------------------------------------------------------------------------
@@ -246,6 +721,113 @@ private :
   void wheelEvent(QWheelEvent *_event ) override;
 
   void loadMatricesToShader();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief record a change to m_params in the open transaction, starting an implicit one
+  /// if there is none
+  //----------------------------------------------------------------------------------------------------------------------
+  void edit();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief copy the arcball and spin angles to m_params and edit
+  //----------------------------------------------------------------------------------------------------------------------
+  void editMouseSpin();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief publish the open transaction, unless an explicit one is still open
+  //----------------------------------------------------------------------------------------------------------------------
+  void applyEdits();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief hand a copy of m_params to the render side and ask for a frame
+  /// @param[in] _inputNs steady clock time of the input that caused it, 0 if none
+  //----------------------------------------------------------------------------------------------------------------------
+  void publishParams(int64_t _inputNs);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief wake the render thread, or schedule paintGL when there is none
+  //----------------------------------------------------------------------------------------------------------------------
+  void requestFrame();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief render side, take the latest parameters if there are new ones, rebuild what they
+  /// are derived into and mark the components that changed dirty
+  /// @returns true if there were new parameters
+  //----------------------------------------------------------------------------------------------------------------------
+  bool takeParams();
+  void applyParams(const SceneParams &_next);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief run _job with the render side's context current: straight away on the gui thread
+  /// when it draws, otherwise queued for initializeGL or the render thread's next frame
+  //----------------------------------------------------------------------------------------------------------------------
+  void withContext(std::function<void()> _job);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief render side, run the queued jobs
+  /// @returns true if there were any
+  //----------------------------------------------------------------------------------------------------------------------
+  bool runGLJobs();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief make and delete the scene's GL objects, with the render side's context current.
+  /// _loaderShare is given to PrimitiveLoader::initializeGL, nullptr to load synchronously
+  //----------------------------------------------------------------------------------------------------------------------
+  void initializeScene(QOpenGLContext *_loaderShare);
+  void releaseScene();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draw a frame of the scene into the bound framebuffer from m_frame
+  //----------------------------------------------------------------------------------------------------------------------
+  void renderFrame();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the render thread's frame callback, draws and presents if anything has changed
+  /// @returns true while primitives are still loading
+  //----------------------------------------------------------------------------------------------------------------------
+  bool renderThreadFrame();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start m_loadTimer if the loader is busy and the gui thread draws
+  //----------------------------------------------------------------------------------------------------------------------
+  void startLoadPolling();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rebuild m_rotate, m_gimbal and the quaternion from the rotate values
+  //----------------------------------------------------------------------------------------------------------------------
+  void buildRotation();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rebuild m_transform for the current order if any of its components changed
+  /// and emit matrixDirty if the result is different
+  //----------------------------------------------------------------------------------------------------------------------
+  void composeTransform();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rebuild m_mouseGlobalTX if the mouse rotation or position changed
+  //----------------------------------------------------------------------------------------------------------------------
+  void composeMouseTransform();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief import a mesh with the context already current
+  //----------------------------------------------------------------------------------------------------------------------
+  void loadMesh(const QString &_fileName);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rebuild the per instance matrices with TransformBatch
+  //----------------------------------------------------------------------------------------------------------------------
+  void updateInstances();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the box around _name, read back from its vertex buffer the first time
+  //----------------------------------------------------------------------------------------------------------------------
+  const Aabb &meshBounds(const std::string &_name);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief transform the mesh box by every instance matrix, then build the BVH if the number
+  /// of instances changed or refit it if not
+  //----------------------------------------------------------------------------------------------------------------------
+  void updateInstanceBounds();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief find the instances inside the frustum of m_project * m_view * m_mouseGlobalTX, pick
+  /// their levels and upload their matrices if they aren't the ones already in m_instanceBuffer
+  //----------------------------------------------------------------------------------------------------------------------
+  void cullInstances();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief pick a level for each instance that will be drawn and group them by level
+  /// @param[in] _cull true if only m_visibleInstances are drawn
+  /// @returns true if m_instanceBuffer has to be uploaded in a new order
+  //----------------------------------------------------------------------------------------------------------------------
+  bool selectInstanceLods(bool _cull);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draw the single object at the level for its size on screen
+  //----------------------------------------------------------------------------------------------------------------------
+  void drawObject();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draw instanceCount copies of the current primitive, one instanced draw per level
+  //----------------------------------------------------------------------------------------------------------------------
+  void drawInstanced();
 
 
 
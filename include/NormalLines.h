@@ -0,0 +1,48 @@
+#ifndef NORMALLINES_H_
+#define NORMALLINES_H_
+
+#include "GeometryCache.h"
+#include <ngl/AbstractVAO.h>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file NormalLines.h
+/// @brief line lists showing the vertex and face normals of a mesh, built once instead of by
+/// the normalGeo geometry shader every frame
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class NormalLines
+/// @brief each line is two vertices of x,y,z,ox,oy,oz,face. The offset is 0 for the start of
+/// the line and the unit normal for the end, so normalLineVertex.glsl only has to add
+/// offset * normalSize and the length can change without a rebuild. face is 1 for face
+/// normals (from the centre of each triangle) and 0 for vertex normals.
+/// The vertex normals match the geometry shader, the face normals are found in model space
+/// rather than clip space so they are perpendicular to the face whatever the projection.
+//----------------------------------------------------------------------------------------------------------------------
+class NormalLines
+{
+public :
+  static constexpr size_t FloatsPerVertex = 7;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build the lines from a copy of a mesh's vertex buffer
+  /// @param[in] _data the vertex buffer
+  /// @param[in] _vertices the number of vertices
+  /// @param[in] _position the layout of the position attribute in _data
+  /// @param[in] _normal the layout of the normal attribute in _data
+  /// @param[in] _faces add the face normals, the vertices must be a triangle list
+  /// @param[in] _pool if set large meshes are split over the workers
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::vector<float> build(const char *_data, size_t _vertices, const GeometryCache::Attribute &_position,
+                                  const GeometryCache::Attribute &_normal, bool _faces, ThreadPool *_pool = nullptr);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read _mesh back from GL and make a GL_LINES VAO of its normals
+  /// @returns nullptr if _mesh has no float position (attribute 0) and normal (attribute 1)
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::unique_ptr<ngl::AbstractVAO> create(ngl::AbstractVAO *_mesh, ThreadPool *_pool = nullptr);
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef PARAMLOG_H_
+#define PARAMLOG_H_
+
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ParamLog.h
+/// @brief a compact timestamped binary log of the parameters the ui hands to NGLScene, so an
+/// interactive session can be replayed as a repeatable performance run
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the recorded part of NGLScene's parameters as plain 32 bit words, each field is a run
+/// of consecutive words so it can be compared and copied as one block
+//----------------------------------------------------------------------------------------------------------------------
+struct RecordedParams
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @enum the fields a record can change
+  //----------------------------------------------------------------------------------------------------------------------
+  enum Field : uint16_t
+  {
+    TRANSLATE,
+    ROTATE,
+    SCALE,
+    EULER,
+    ORDER,
+    MESH,
+    NORMALS,   ///< drawNormals, geometryShaderNormals and normalSize
+    WIREFRAME,
+    COLOUR,
+    INSTANCES, ///< instanced, instanceCount, frustumCull and lod
+    SPIN,      ///< arcballMode, arcball and spin
+    PANZOOM,
+    VIEWPORT,
+    FIELDS
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the fields that differ between _a and _b as a bit per Field, compared bit for bit
+  //----------------------------------------------------------------------------------------------------------------------
+  static uint16_t changed(const RecordedParams &_a, const RecordedParams &_b);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the name of a field for reports
+  //----------------------------------------------------------------------------------------------------------------------
+  static const char *fieldName(Field _field);
+
+  float translate[3] = {0.0f, 0.0f, 0.0f};
+  float rotate[3] = {0.0f, 0.0f, 0.0f};
+  float scale[3] = {1.0f, 1.0f, 1.0f};
+  float euler[4] = {0.0f, 1.0f, 0.0f, 0.0f}; ///< angle then axis x,y,z
+  int32_t order = 0;                          ///< the MatrixOrder as setMatrixOrder's index
+  int32_t drawIndex = 6;                      ///< vboChanged
+  int32_t drawNormals = 0;
+  int32_t geometryShaderNormals = 0;
+  int32_t normalSize = 6;
+  int32_t wireframe = 0;
+  float colour[3] = {0.5f, 0.5f, 0.5f};
+  int32_t instanced = 0;
+  int32_t instanceCount = 1000;
+  int32_t frustumCull = 1;
+  int32_t lod = 1;
+  int32_t arcballMode = 1;
+  float arcball[4] = {0.0f, 0.0f, 0.0f, 1.0f}; ///< the left mouse spin as the arcball orientation
+  int32_t spin[2] = {0, 0};                    ///< or as the x and y angles
+  float modelPos[3] = {0.0f, 0.0f, 0.0f};      ///< the right mouse pan and the wheel zoom
+  int32_t viewport[2] = {0, 0};                ///< the widget size
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class ParamLogWriter
+/// @brief writes one record per commit of the parameters. A record is the time since the last
+/// one in microseconds as a variable length integer, a bit mask of the fields that changed and
+/// the words of just those fields, so dragging a spin box costs about 16 bytes a commit. The
+/// first record holds every field. The records are buffered and written in large blocks so
+/// recording doesn't add file writes to the gui thread's commits
+//----------------------------------------------------------------------------------------------------------------------
+class ParamLogWriter
+{
+public :
+  ParamLogWriter() = default;
+  ~ParamLogWriter() { close(); }
+  ParamLogWriter(const ParamLogWriter &) = delete;
+  ParamLogWriter &operator=(const ParamLogWriter &) = delete;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start a new log, any open one is closed first
+  /// @returns false if the file can't be created
+  //----------------------------------------------------------------------------------------------------------------------
+  bool open(const std::string &_fileName);
+  bool isOpen() const { return m_out.is_open(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief append the parameters as they are at _ns, a steady clock time in ns. The first
+  /// record is at time 0, later times never go backwards
+  //----------------------------------------------------------------------------------------------------------------------
+  void record(int64_t _ns, const RecordedParams &_params);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write what is buffered and close the file
+  /// @returns false if any write failed
+  //----------------------------------------------------------------------------------------------------------------------
+  bool close();
+  uint64_t records() const { return m_records; }
+  uint64_t bytes() const { return m_bytes + m_buffer.size(); } ///< including what is still buffered
+
+private :
+  void flush();
+  std::ofstream m_out;
+  std::vector<uint8_t> m_buffer;
+  RecordedParams m_last;
+  int64_t m_startNs = 0;
+  int64_t m_lastUs = 0;
+  uint64_t m_records = 0;
+  uint64_t m_bytes = 0;
+  bool m_failed = false;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class ParamLogReader
+/// @brief maps a log and decodes its records one at a time into the full parameters
+//----------------------------------------------------------------------------------------------------------------------
+class ParamLogReader
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one commit of the recorded session
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Event
+  {
+    int64_t timeNs = 0;      ///< since the start of the recording
+    uint16_t changed = 0;    ///< a bit per RecordedParams::Field
+    RecordedParams params;   ///< every field as it was after this commit
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief map _fileName and check its header
+  /// @returns false if it can't be read or isn't a log this version can replay, see error()
+  //----------------------------------------------------------------------------------------------------------------------
+  bool open(const std::string &_fileName);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief decode the next record
+  /// @returns false at the end of the log, or at a damaged record in which case error() is set
+  //----------------------------------------------------------------------------------------------------------------------
+  bool next(Event &o_event);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief go back to the first record
+  //----------------------------------------------------------------------------------------------------------------------
+  void rewind();
+  const std::string &error() const { return m_error; }
+  size_t size() const { return m_file.size(); }
+
+private :
+  MappedFile m_file;
+  size_t m_offset = 0;
+  int64_t m_us = 0;
+  RecordedParams m_state;
+  std::string m_error;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef PARAMREPLAY_H_
+#define PARAMREPLAY_H_
+
+#include "ParamLog.h"
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <string>
+#include <vector>
+
+class NGLScene;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ParamReplay.h
+/// @brief plays recorded parameter logs back into an NGLScene and times the frames they cause
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class ParamReplay
+/// @brief each log is a session replayed one after the other. At recorded speed each commit is
+/// made when it was made in the recording, measured from the start of the session. Flat out
+/// each commit is made as soon as the frame of the one before has been drawn, so the session
+/// takes as long as the frames do. The frame times and input latencies the scene reports during
+/// a session give its statistics, and the window is resized when the recorded viewport changes.
+//----------------------------------------------------------------------------------------------------------------------
+class ParamReplay : public QObject
+{
+Q_OBJECT
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief what one session did
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Session
+  {
+    std::string fileName;
+    std::string error;          ///< empty if the whole log was replayed
+    uint64_t commits = 0;
+    uint64_t frames = 0;
+    double recordedSeconds = 0.0;
+    double seconds = 0.0;       ///< how long the replay took
+    double meanMs = 0.0;        ///< the cpu frame times as reported by the scene's frameTime
+    double medianMs = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+    double gpuMs = 0.0;         ///< the mean of the gpu frame times
+    double inputMs = 0.0;       ///< the mean of the scene's inputLatency during the session
+    double maxInputMs = 0.0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _scene the scene to replay into, it must outlive the replay
+  /// @param[in] _flatOut make each commit as soon as the last frame is drawn instead of at its time
+  //----------------------------------------------------------------------------------------------------------------------
+  ParamReplay(NGLScene *_scene, bool _flatOut, QObject *_parent = nullptr);
+  void addSession(const std::string &_fileName);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief replay every session, finished is emitted after the last
+  //----------------------------------------------------------------------------------------------------------------------
+  void start();
+  const std::vector<Session> &sessions() const { return m_sessions; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the statistics of every session as json
+  /// @returns false if the file can't be written
+  //----------------------------------------------------------------------------------------------------------------------
+  bool writeJSON(const std::string &_fileName) const;
+
+signals :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief every session has been replayed
+  /// @param[in] _ok no log failed to open or was damaged
+  //----------------------------------------------------------------------------------------------------------------------
+  void finished(bool _ok);
+
+private slots :
+  void step();
+  void frameDrawn(double _cpuMs, double _gpuMs, int _instances);
+  void inputShown(double _ms);
+
+private :
+  void beginSession();
+  void endSession();
+  void apply(const ParamLogReader::Event &_event);
+  NGLScene *m_scene;
+  bool m_flatOut;
+  std::vector<Session> m_sessions;
+  size_t m_current = 0;
+  ParamLogReader m_reader;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the next commit, read but not yet due
+  //----------------------------------------------------------------------------------------------------------------------
+  ParamLogReader::Event m_event;
+  bool m_pending = false;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief flat out only, a commit has been made and its frame not drawn yet
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_waiting = false;
+  bool m_running = false;
+  std::vector<double> m_frameTimes;
+  std::vector<double> m_gpuTimes;
+  std::vector<double> m_inputTimes;
+  QElapsedTimer m_clock;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief wakes step when the next commit is due, or flat out if a frame never comes
+  //----------------------------------------------------------------------------------------------------------------------
+  QTimer m_timer;
+};
+
+#endif
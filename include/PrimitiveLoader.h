@@ -0,0 +1,141 @@
+#ifndef PRIMITIVELOADER_H_
+#define PRIMITIVELOADER_H_
+
+#include "GeometryCache.h"
+#include <ngl/Types.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class QOffscreenSurface;
+class QOpenGLContext;
+class QThread;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PrimitiveLoader.h
+/// @brief creates the generated primitives the first time they are needed instead of at start up
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class PrimitiveLoader
+/// @brief primitives with a GeometryCache entry are read and uploaded on a worker thread
+/// with its own QOpenGLContext shared with the widget's. Buffers and fences are shared
+/// between the contexts but vertex arrays aren't, so the worker fills a buffer and fences
+/// it, and poll (on the gui thread) wraps the buffer in a VAO once the fence has signalled.
+/// Primitives with no cache entry have to be built by ngl on the gui thread, poll does one
+/// of these per call so a prefetch never stalls a frame for long. If the shared context
+/// can't be made everything is built on the gui thread.
+/// Built in and imported meshes are always ready.
+//----------------------------------------------------------------------------------------------------------------------
+class PrimitiveLoader
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief how the primitives were made
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    size_t background = 0;         ///< uploaded by the worker
+    size_t foreground = 0;         ///< built on the gui thread
+    size_t fenceWaits = 0;         ///< polls where an upload was done but its fence hadn't signalled
+    double backgroundSeconds = 0.0; ///< worker time reading and uploading
+    double foregroundSeconds = 0.0; ///< gui thread time building
+  };
+  explicit PrimitiveLoader(GeometryCache &_cache);
+  ~PrimitiveLoader();
+  PrimitiveLoader(const PrimitiveLoader &) = delete;
+  PrimitiveLoader &operator=(const PrimitiveLoader &) = delete;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start the worker, _shareContext must be current on the calling (gui) thread
+  /// @returns false if the worker context can't be created, loading is then synchronous
+  //----------------------------------------------------------------------------------------------------------------------
+  bool initializeGL(QOpenGLContext *_shareContext);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief stop the worker and free anything not yet handed over, the gui context must be current
+  //----------------------------------------------------------------------------------------------------------------------
+  void releaseGL();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true if _name can be drawn now
+  //----------------------------------------------------------------------------------------------------------------------
+  bool isReady(const std::string &_name) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief _name is needed now, start it in the background or build it straight away if
+  /// there is no worker. Does nothing if it is ready or already loading
+  //----------------------------------------------------------------------------------------------------------------------
+  void request(const std::string &_name);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue _names to be loaded when there is nothing more urgent
+  //----------------------------------------------------------------------------------------------------------------------
+  void prefetch(const std::vector<std::string> &_names);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief finish any fenced uploads and build at most one primitive with no cache entry,
+  /// call regularly on the gui thread with its context current
+  /// @returns true if a primitive became ready
+  //----------------------------------------------------------------------------------------------------------------------
+  bool poll();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true while anything is loading or queued
+  //----------------------------------------------------------------------------------------------------------------------
+  bool busy() const;
+  const Stats &stats() const { return m_stats; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one line summary of the stats for the status bar
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string summary() const;
+
+private :
+  enum class State
+  {
+    QUEUED,
+    LOADING,
+    READY
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a buffer filled by the worker, ok is false if there was no cache entry
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Upload
+  {
+    std::string name;
+    bool ok = false;
+    std::shared_ptr<GeometryCache::Entry> entry;
+    GLuint buffer = 0;
+    GLsync fence = nullptr;
+    double seconds = 0.0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief runs on the worker thread
+  //----------------------------------------------------------------------------------------------------------------------
+  void upload(const std::string &_name);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build _name with ngl on the calling thread (via the cache so it is stored)
+  //----------------------------------------------------------------------------------------------------------------------
+  void build(const std::string &_name);
+
+  GeometryCache &m_cache;
+  std::unique_ptr<QThread> m_thread;
+  std::unique_ptr<QOpenGLContext> m_context;
+  std::unique_ptr<QOffscreenSurface> m_surface;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the primitives that have been asked for, only used on the gui thread
+  //----------------------------------------------------------------------------------------------------------------------
+  std::map<std::string, State> m_states;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief names waiting to be built on the gui thread
+  //----------------------------------------------------------------------------------------------------------------------
+  std::deque<std::string> m_buildQueue;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief uploads handed over by poll but whose fence hasn't signalled yet
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<Upload> m_fenced;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief uploads finished by the worker, guarded by m_finishedMutex
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<Upload> m_finished;
+  std::mutex m_finishedMutex;
+  Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef PROGRAMCACHE_H_
+#define PROGRAMCACHE_H_
+
+#include <ngl/ShaderLib.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ProgramCache.h
+/// @brief on disk cache of linked shader programs using glGetProgramBinary / glProgramBinary
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class ProgramCache
+/// @brief builds ngl::ShaderLib programs, loading the linked binary from the cache when the
+/// driver accepts it and compiling from source (then storing the binary) otherwise.
+/// The key is a hash of the program name, every stage's source and the GL vendor, renderer
+/// and version strings, so editing a shader or updating the driver makes a new entry.
+/// Each entry also records how long the source build took so the time saved by a hit can
+/// be reported.
+/// A valid GL context and ngl::NGLInit are needed for build.
+//----------------------------------------------------------------------------------------------------------------------
+class ProgramCache
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the file format version, older files are treated as a miss
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr uint32_t Version = 1;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one shader of a program
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stage
+  {
+    std::string name;
+    ngl::ShaderType type;
+    std::string file;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief hit and miss counts since the last resetStats, rejected binaries are also misses
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t rejected = 0;
+    double loadSeconds = 0.0;    ///< time spent in glProgramBinary for the hits
+    double compileSeconds = 0.0; ///< time spent compiling and linking the misses
+    double savedSeconds = 0.0;   ///< recorded source build time of the hits less loadSeconds
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _directory where the entries are kept, created on the first store. An empty
+  /// directory disables the cache and every program is built from source
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit ProgramCache(std::string _directory);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create the ShaderLib program _program from _stages
+  /// @returns false if the program doesn't compile or link
+  //----------------------------------------------------------------------------------------------------------------------
+  bool build(const std::string &_program, const std::vector<Stage> &_stages);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief delete every entry in the directory
+  //----------------------------------------------------------------------------------------------------------------------
+  void clear();
+  const std::string &directory() const { return m_directory; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief false if there is no directory or the driver has no program binary formats
+  //----------------------------------------------------------------------------------------------------------------------
+  bool enabled() const;
+  const Stats &stats() const { return m_stats; }
+  void resetStats() { m_stats = Stats(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one line summary of the stats for the status bar
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string summary() const;
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief try to link _program from the entry at _path
+  /// @returns false if there is no entry or the driver rejects the binary
+  //----------------------------------------------------------------------------------------------------------------------
+  bool loadBinary(const std::string &_program, const std::string &_path, uint64_t _key);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the usual ShaderLib compile and link, then store the binary at _path
+  //----------------------------------------------------------------------------------------------------------------------
+  bool compile(const std::string &_program, const std::vector<Stage> &_stages, const std::string &_path, uint64_t _key);
+
+  std::string m_directory;
+  Stats m_stats;
+};
+
+#endif
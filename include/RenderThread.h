@@ -0,0 +1,145 @@
+#ifndef RENDERTHREAD_H_
+#define RENDERTHREAD_H_
+
+#include "SnapshotMailbox.h"
+#include <QThread>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+class QOffscreenSurface;
+class QOpenGLContext;
+class QOpenGLFramebufferObject;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RenderThread.h
+/// @brief draws the frames on a thread of its own so a slow frame never holds up the gui
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class RenderThread
+/// @brief the thread owns a GL context shared with the widget's, an offscreen surface and a
+/// framebuffer for each slot of a SnapshotMailbox of finished frames. The frame callback draws
+/// into the back slot's framebuffer and present hands it to the gui, which blits the latest
+/// finished frame into the widget while the next one is drawn into another slot. Only the
+/// colour textures and fences are used by both contexts. Vertex arrays aren't shared, so
+/// everything the frame callback draws has to be made by the initialise callback on this
+/// thread. The GL calls here go through Qt's resolver so the gui side works whatever the
+/// render thread's GL loader is doing.
+/// The thread sleeps until requestFrame is called, or for at most a few ms while the frame
+/// callback says it has more to do (e.g. primitives still loading).
+//----------------------------------------------------------------------------------------------------------------------
+class RenderThread : public QThread
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief what the thread runs, all but presented are called with its context current
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Callbacks
+  {
+    std::function<void()> initialize; ///< make the scene's GL objects
+    std::function<bool()> frame;      ///< draw if anything changed, true to be called again soon
+    std::function<void()> release;    ///< delete the scene's GL objects
+    std::function<void()> presented;  ///< a frame is ready to blit, on the render thread
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief what blit did
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Blit
+  {
+    bool drawn = false;  ///< a frame was copied, otherwise the target was cleared
+    bool fresh = false;  ///< it is a frame that hadn't been blitted before
+    int64_t inputNs = 0; ///< steady clock time of the oldest input drawn in it, 0 if none
+    uint64_t frame = 0;  ///< its number, counting from 1
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, on the gui thread with _shareContext current
+  /// @param[in] _samples the multisampling of the frames, 0 for none
+  //----------------------------------------------------------------------------------------------------------------------
+  RenderThread(QOpenGLContext *_shareContext, int _samples, Callbacks _callbacks);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor stops the thread
+  //----------------------------------------------------------------------------------------------------------------------
+  ~RenderThread() override;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief false if the context couldn't be made, nothing should then be started
+  //----------------------------------------------------------------------------------------------------------------------
+  bool isValid() const { return m_context != nullptr; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief wake the thread to run the frame callback, from any thread
+  //----------------------------------------------------------------------------------------------------------------------
+  void requestFrame();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief run the release callback and join the thread
+  //----------------------------------------------------------------------------------------------------------------------
+  void stop();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief render thread, in the frame callback, bind the framebuffer for the next frame made
+  /// or resized to _width x _height pixels and set the viewport to it
+  //----------------------------------------------------------------------------------------------------------------------
+  void bindTarget(int _width, int _height);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief render thread, the frame drawn since bindTarget is finished
+  /// @param[in] _inputNs steady clock time of the oldest input drawn in it, 0 if none
+  //----------------------------------------------------------------------------------------------------------------------
+  void present(int64_t _inputNs);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief gui thread, copy the latest finished frame into the framebuffer _target
+  /// @param[in] _context the gui context, current
+  //----------------------------------------------------------------------------------------------------------------------
+  Blit blit(QOpenGLContext *_context, unsigned int _target, int _width, int _height);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief gui thread, delete the gui side framebuffer, _context must be current
+  //----------------------------------------------------------------------------------------------------------------------
+  void releaseGL(QOpenGLContext *_context);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief frames presented and frames blitted, the difference were replaced before the gui
+  /// got to them
+  //----------------------------------------------------------------------------------------------------------------------
+  uint64_t framesPresented() const { return m_frames.published(); }
+  uint64_t framesShown() const { return m_frames.taken(); }
+
+protected :
+  void run() override;
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a finished frame, the fences are GLsync kept opaque so this header needs no GL types
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Frame
+  {
+    unsigned int texture = 0;
+    int width = 0;
+    int height = 0;
+    void *rendered = nullptr; ///< signalled when the frame is drawn, waited on by the blit
+    void *read = nullptr;     ///< signalled when the gui has blitted it, waited on before reuse
+    int64_t inputNs = 0;
+    uint64_t number = 0;
+  };
+  Callbacks m_callbacks;
+  int m_samples;
+  std::unique_ptr<QOpenGLContext> m_context;
+  std::unique_ptr<QOffscreenSurface> m_surface;
+  SnapshotMailbox<Frame> m_frames;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the framebuffer of each slot of m_frames, and the multisampled one drawn into
+  /// first when there is multisampling. Only used on the render thread
+  //----------------------------------------------------------------------------------------------------------------------
+  std::unique_ptr<QOpenGLFramebufferObject> m_targets[SnapshotMailbox<Frame>::Slots];
+  std::unique_ptr<QOpenGLFramebufferObject> m_multisampled;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the gui side framebuffer the frame textures are attached to for the blit
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_readFramebuffer = 0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief only used to sleep and wake, the frames and the scene parameters need no lock
+  //----------------------------------------------------------------------------------------------------------------------
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  bool m_requested = true;
+  bool m_exiting = false;
+};
+
+#endif
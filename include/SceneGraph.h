@@ -0,0 +1,157 @@
+#ifndef SCENEGRAPH_H_
+#define SCENEGRAPH_H_
+
+#include "AffineTransform.h"
+#include "MatrixOrder.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SceneGraph.h
+/// @brief parent / child hierarchy of transforms, each node composed in its own MatrixOrder,
+/// for building and timing rigs.
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class SceneGraph
+/// @brief the nodes are kept in flat arrays sorted by depth, so every parent comes before its
+/// children and each level is a contiguous range. update walks the levels in order and splits
+/// each one across the thread pool, a node's world matrix is its parent's world times its own
+/// composeAffine, and the roots are multiplied by the root transform.
+/// Changing a node marks it dirty, and update only recomposes the dirty nodes and anything
+/// under them. Levels with nothing dirty in them or above them are skipped without being
+/// touched, the rest of an unchanged branch costs one flag test per node.
+/// Nodes are named by the NodeId addNode returns, which doesn't change when the arrays are
+/// re-sorted. Adding a node shallower than the last one added means a sort at the next
+/// update, so build breadth first where possible.
+//----------------------------------------------------------------------------------------------------------------------
+class SceneGraph
+{
+public :
+  using NodeId = uint32_t;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the parent of a root node
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr NodeId NoParent = std::numeric_limits<NodeId>::max();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief counters since the last resetStats
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    size_t updates = 0;
+    size_t composed = 0;      ///< nodes whose world matrix was rebuilt
+    size_t skipped = 0;       ///< nodes left as they were
+    size_t levelsSkipped = 0; ///< whole levels skipped as nothing in or above them changed
+    size_t sorts = 0;
+    double seconds = 0.0;     ///< time in update, including any sort
+    double sortSeconds = 0.0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief make room for _nodes nodes
+  //----------------------------------------------------------------------------------------------------------------------
+  void reserve(size_t _nodes);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief remove every node, the root transform and stats are kept
+  //----------------------------------------------------------------------------------------------------------------------
+  void clear();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add a node, it is dirty until the next update
+  /// @param[in] _parent an existing node or NoParent for a root
+  /// @param[in] _order the order _local is composed in
+  /// @param[in] _local the node's transform relative to its parent
+  /// @returns the id of the new node, ids are given out from 0 in the order nodes are added
+  /// @throws std::out_of_range if _parent isn't a node
+  //----------------------------------------------------------------------------------------------------------------------
+  NodeId addNode(NodeId _parent, MatrixOrder _order, const TransformComponents &_local);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief replace a node's transform and mark it, and so everything under it, dirty
+  //----------------------------------------------------------------------------------------------------------------------
+  void setLocal(NodeId _node, const TransformComponents &_local);
+  void setOrder(NodeId _node, MatrixOrder _order);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the transform applied to every root, e.g. the mouse transform, marks them all dirty
+  //----------------------------------------------------------------------------------------------------------------------
+  void setRootTransform(const AffineTransform &_root);
+  const AffineTransform &rootTransform() const { return m_root; }
+  const TransformComponents &local(NodeId _node) const { return m_locals[m_slotOf[_node]]; }
+  MatrixOrder order(NodeId _node) const { return m_orders[m_slotOf[_node]]; }
+  NodeId parent(NodeId _node) const { return m_parentOf[_node]; }
+  size_t depth(NodeId _node) const { return m_depthOf[_node]; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the world matrix of _node as of the last update
+  //----------------------------------------------------------------------------------------------------------------------
+  const AffineTransform &world(NodeId _node) const { return m_world[m_slotOf[_node]]; }
+  size_t size() const { return m_parentOf.size(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of levels, the depth of the deepest node plus one
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t levels() const { return m_levelDirty.size(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true if any node has changed since the last update
+  //----------------------------------------------------------------------------------------------------------------------
+  bool dirty() const { return m_anyDirty; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rebuild the world matrices of the dirty nodes and their descendants
+  /// @param[in] _pool the levels are split across this pool, nullptr does everything on the
+  /// calling thread
+  /// @param[in] _grain the smallest range of a level given to one task, levels smaller than
+  /// this run on the calling thread
+  //----------------------------------------------------------------------------------------------------------------------
+  void update(ThreadPool *_pool = nullptr, size_t _grain = 4096);
+  const Stats &stats() const { return m_stats; }
+  void resetStats() { m_stats = Stats(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one line summary of the stats for the log
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string summary() const;
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief stable counting sort of the node arrays by depth
+  //----------------------------------------------------------------------------------------------------------------------
+  void sort();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief rebuild the dirty nodes in the slots [_begin,_end) of one level
+  /// @returns the number rebuilt
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t updateRange(size_t _begin, size_t _end);
+  void markDirty(size_t _slot);
+
+  // indexed by NodeId
+  std::vector<NodeId> m_parentOf;
+  std::vector<uint32_t> m_depthOf;
+  std::vector<uint32_t> m_slotOf;
+  // indexed by slot, sorted by depth
+  std::vector<uint32_t> m_parentSlot;
+  std::vector<MatrixOrder> m_orders;
+  std::vector<TransformComponents> m_locals;
+  std::vector<AffineTransform> m_world;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set for a node that has been changed, and during update for every node that was
+  /// rebuilt, bytes rather than bits so the threads never write to the same word
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<uint8_t> m_changed;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the first slot of each level, with size() on the end
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<size_t> m_levelStart = {0};
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set for a level holding a node that has been changed
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<uint8_t> m_levelDirty;
+  AffineTransform m_root = AffineTransform::identity();
+  bool m_sorted = true;
+  bool m_anyDirty = false;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the root transform has changed, so every root is rebuilt without marking each one
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_rootChanged = false;
+  Stats m_stats;
+};
+
+#endif
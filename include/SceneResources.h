@@ -0,0 +1,103 @@
+#ifndef SCENERESOURCES_H_
+#define SCENERESOURCES_H_
+
+#include <ngl/Types.h>
+#include <ngl/Vec3.h>
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+
+class GeometryCache;
+class ProgramCache;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SceneResources.h
+/// @brief the shaders and primitives used to draw the scene, shared by the NGLScene widget
+/// and the offscreen benchmark so both always render exactly the same thing
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class SceneResources
+/// @brief static helpers to create the GL resources, a valid context and ngl::NGLInit must
+/// exist before any of these are called
+//----------------------------------------------------------------------------------------------------------------------
+class SceneResources
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the names of the shader programs
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr auto NormalShader = "normalShader";
+  static constexpr auto NormalLineShader = "normalLineShader";
+  static constexpr auto AxisShader = "AxisShader";
+  static constexpr auto PBR = "PBR";
+  static constexpr auto SoftwareImageShader = "SoftwareImageShader";
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the uniform block in PBRVertex.glsl holding the matrices and its binding point
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr auto TransformBlock = "TransformUBO";
+  static constexpr GLuint TransformBinding = 1;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of primitives that can be drawn
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t NumPrimitives = 17;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the VAOPrimitives names in the same order as the ui combo box
+  //----------------------------------------------------------------------------------------------------------------------
+  static const std::array<std::string, NumPrimitives> &primitiveNames();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a primitive generated at run time rather than built in to ngl, the generated
+  /// primitives and their coarser levels of detail
+  //----------------------------------------------------------------------------------------------------------------------
+  struct GeneratedPrimitive
+  {
+    std::string name;
+    std::string params;           ///< every generation parameter, used in the GeometryCache key
+    std::function<void()> create; ///< adds name to ngl::VAOPrimitives
+  };
+  static const std::vector<GeneratedPrimitive> &generatedPrimitives();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of levels of detail of the generated primitives and scanned meshes,
+  /// level 0 is the mesh itself
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t LodLevels = 4;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @returns the VAOPrimitives name of level _level of _name, _name itself for level 0
+  //----------------------------------------------------------------------------------------------------------------------
+  static std::string lodName(const std::string &_name, size_t _level);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @returns true if _name has coarser levels of detail, false for the platonic solids and
+  /// imported meshes
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool hasLods(const std::string &_name);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read _source back from GL and add a MeshSimplifier version of it called _name
+  /// @param[in] _cells the number of clustering cubes along the longest side of the mesh
+  /// @returns false if _source can't be read back, nothing is added
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool createSimplified(const std::string &_source, const std::string &_name, unsigned int _cells);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @returns the generated primitive called _name or nullptr if it is built in or imported
+  //----------------------------------------------------------------------------------------------------------------------
+  static const GeneratedPrimitive *findGenerated(const std::string &_name);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create one generated primitive
+  /// @param[in] _cache if set the primitive is loaded from / stored in it
+  //----------------------------------------------------------------------------------------------------------------------
+  static void createPrimitive(const GeneratedPrimitive &_primitive, GeometryCache *_cache = nullptr);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create all the primitives not built in to ngl::VAOPrimitives
+  /// @param[in] _cache if set the primitives are loaded from / stored in it
+  //----------------------------------------------------------------------------------------------------------------------
+  static void createPrimitives(GeometryCache *_cache = nullptr);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief load the PBR, normal, normal line, axis and software image shaders and set their
+  /// constant uniforms
+  /// @param[in] _camPos the camera position for the PBR lighting
+  /// @param[in] _cache if set the linked programs are loaded from / stored in it
+  //----------------------------------------------------------------------------------------------------------------------
+  static void loadShaders(const ngl::Vec3 &_camPos, ProgramCache *_cache = nullptr);
+};
+
+#endif
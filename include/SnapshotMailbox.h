@@ -0,0 +1,109 @@
+#ifndef SNAPSHOTMAILBOX_H_
+#define SNAPSHOTMAILBOX_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SnapshotMailbox.h
+/// @brief hands the latest value of something from one thread to another without a lock
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class SnapshotMailbox
+/// @brief a triple buffer for one producer thread and one consumer thread. The producer writes
+/// the back slot and publishes it, which swaps it with the middle slot. The consumer takes the
+/// middle slot, if it has been published since the last take, by swapping it with the front
+/// slot. Neither side ever waits for the other. A value that is published again before the
+/// consumer takes it is overwritten, so the consumer always gets the latest whole value and
+/// never a mix of two. The producer owns back() until it publishes and the consumer owns
+/// front() until it takes again, so both can also be used in place (e.g. a framebuffer per slot).
+//----------------------------------------------------------------------------------------------------------------------
+template <typename T>
+class SnapshotMailbox
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of slots, the indices of back() and front() are below this
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t Slots = 3;
+  SnapshotMailbox() = default;
+  SnapshotMailbox(const SnapshotMailbox &) = delete;
+  SnapshotMailbox &operator=(const SnapshotMailbox &) = delete;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief producer, the slot the next publish hands over. It holds whatever was in it when
+  /// the consumer gave it back, not the last value published
+  //----------------------------------------------------------------------------------------------------------------------
+  T &back() { return m_slots[m_back]; }
+  size_t backIndex() const { return m_back; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief producer, make back() the latest value
+  //----------------------------------------------------------------------------------------------------------------------
+  void publish()
+  {
+    const uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_back | Fresh), std::memory_order_acq_rel);
+    m_back = previous & Index;
+    m_published.fetch_add(1, std::memory_order_relaxed);
+  }
+  void publish(const T &_value)
+  {
+    back() = _value;
+    publish();
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief producer, true if the last value published hasn't been taken yet
+  //----------------------------------------------------------------------------------------------------------------------
+  bool unread() const { return (m_middle.load(std::memory_order_acquire) & Fresh) != 0; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief consumer, make the latest value published front()
+  /// @returns false if nothing has been published since the last take, front() is unchanged
+  //----------------------------------------------------------------------------------------------------------------------
+  bool take()
+  {
+    if ((m_middle.load(std::memory_order_relaxed) & Fresh) == 0)
+    {
+      return false;
+    }
+    const uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+    m_front = previous & Index;
+    m_taken.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief consumer, the value last taken, default constructed before the first take
+  //----------------------------------------------------------------------------------------------------------------------
+  T &front() { return m_slots[m_front]; }
+  const T &front() const { return m_slots[m_front]; }
+  size_t frontIndex() const { return m_front; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief counters, safe to read from either thread. published - taken values were
+  /// overwritten before the consumer got to them (give or take the one in the middle)
+  //----------------------------------------------------------------------------------------------------------------------
+  uint64_t published() const { return m_published.load(std::memory_order_relaxed); }
+  uint64_t taken() const { return m_taken.load(std::memory_order_relaxed); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief any slot, only once neither thread uses the mailbox any more (e.g. to free what
+  /// the slots hold)
+  //----------------------------------------------------------------------------------------------------------------------
+  T &slot(size_t _index) { return m_slots[_index]; }
+
+private :
+  static constexpr uint8_t Index = 0x3;
+  static constexpr uint8_t Fresh = 0x4;
+  T m_slots[Slots] = {};
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the producer's and consumer's slots, each only touched by its own thread
+  //----------------------------------------------------------------------------------------------------------------------
+  alignas(64) uint8_t m_back = 0;
+  alignas(64) uint8_t m_front = 1;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the slot between them and whether it was published since the last take. Every
+  /// index and counter has a cache line of its own so the two threads don't fight over them
+  //----------------------------------------------------------------------------------------------------------------------
+  alignas(64) std::atomic<uint8_t> m_middle{2};
+  alignas(64) std::atomic<uint64_t> m_published{0};
+  alignas(64) std::atomic<uint64_t> m_taken{0};
+};
+
+#endif
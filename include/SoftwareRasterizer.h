@@ -0,0 +1,178 @@
+#ifndef SOFTWARERASTERIZER_H_
+#define SOFTWARERASTERIZER_H_
+
+#include "ThreadPool.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SoftwareRasterizer.h
+/// @brief draws a mesh on the cpu with the same matrices and lighting as the PBR shaders, so a
+/// frame can be made without a GPU and checked against the GL one
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class SoftwareRasterizer
+/// @brief the vertices are transformed by the TransformUBO matrices in parallel, then each
+/// triangle is clipped to the view volume, snapped to 1/256 of a pixel and binned into the
+/// square screen tiles it covers. The tiles are drawn by the ThreadPool workers and the calling
+/// thread, each taking the next tile from a shared counter when it finishes one, the tiles with
+/// the most triangles first so a busy tile isn't left until last. A tile keeps its own depth and
+/// the triangle seen at each pixel, and shades each pixel once after all its triangles are
+/// drawn with a port of the Cook-Torrance model in PBRFragment.glsl.
+/// The edge tests are exact integer sums at the pixel centres and a pixel on an edge shared by
+/// two triangles belongs to exactly one, so the image doesn't depend on the tile size or the
+/// number of threads.
+//----------------------------------------------------------------------------------------------------------------------
+class SoftwareRasterizer
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the same layout as the TransformUBO in PBRVertex.glsl, matrices are column major
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Transforms
+  {
+    float MVP[16];
+    float normalMatrix[3][4]; ///< std140 mat3, each column is padded to a vec4
+    float M[16];
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the PBRFragment.glsl uniforms, the defaults are the ones SceneResources::loadShaders sets
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Material
+  {
+    float albedo[3] = {0.5f, 0.5f, 0.5f};
+    float metallic = 1.02f;
+    float roughness = 0.38f;
+    float ao = 0.2f;
+    float lightPosition[3] = {0.0f, 2.0f, 2.0f};
+    float lightColor[3] = {400.0f, 400.0f, 400.0f};
+    float camPos[3] = {0.0f, 0.0f, 8.0f};
+    float exposure = 2.2f;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a non indexed triangle list of interleaved vertices holding a float3 position and
+  /// normal, as GeometryCache::readBack returns them
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Mesh
+  {
+    const char *data = nullptr;
+    size_t vertices = 0;
+    size_t stride = 8 * sizeof(float);
+    size_t position = 0;                 ///< byte offset of the position in a vertex
+    size_t normal = 3 * sizeof(float);   ///< byte offset of the normal in a vertex
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the last frame, rows top first. The depth is the window depth GL would write, 1 where
+  /// nothing was drawn
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Image
+  {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgba;
+    std::vector<float> depth;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief how long one tile took and who drew it
+  //----------------------------------------------------------------------------------------------------------------------
+  struct TileStats
+  {
+    int x = 0;               ///< the pixel of the top left corner
+    int y = 0;
+    uint32_t triangles = 0;  ///< binned to the tile
+    uint32_t pixels = 0;     ///< shaded
+    uint32_t worker = 0;     ///< 0 is the calling thread
+    double ms = 0.0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the timings of the last frame
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    size_t triangles = 0;     ///< in the mesh
+    size_t clipped = 0;       ///< drawn after clipping, a clipped triangle can become several
+    size_t binned = 0;        ///< triangle and tile pairs
+    size_t pixels = 0;        ///< shaded
+    size_t workers = 0;       ///< threads drawing tiles, the pool and the calling thread
+    double vertexMs = 0.0;    ///< transforming the vertices
+    double setupMs = 0.0;     ///< clipping, snapping and binning
+    double rasterMs = 0.0;    ///< drawing and shading the tiles
+    double totalMs = 0.0;
+    std::vector<TileStats> tiles;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the stage times, the slowest tile and the time each worker spent on tiles
+    //----------------------------------------------------------------------------------------------------------------------
+    std::string summary() const;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief how far apart two images are, per colour channel in 0-255
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Difference
+  {
+    size_t pixels = 0;
+    size_t differing = 0;   ///< pixels with a channel more than the threshold apart
+    int maxDifference = 0;
+    double meanDifference = 0.0;
+    double differingPercent() const { return pixels > 0 ? 100.0 * differing / pixels : 0.0; }
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _pool the workers the vertices and tiles are shared between
+  /// @param[in] _tileSize the width and height of a tile in pixels
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit SoftwareRasterizer(ThreadPool &_pool, int _tileSize = 32);
+  ~SoftwareRasterizer();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the colour of the pixels nothing is drawn on, as glClearColor
+  //----------------------------------------------------------------------------------------------------------------------
+  void setClearColour(float _r, float _g, float _b, float _a);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief clear the image to _width x _height and draw _mesh into it with depth testing
+  //----------------------------------------------------------------------------------------------------------------------
+  void render(const Mesh &_mesh, const Transforms &_transforms, const Material &_material, int _width, int _height);
+  const Image &image() const { return m_image; }
+  const Stats &stats() const { return m_stats; }
+  int tileSize() const { return m_tileSize; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the PBRFragment.glsl colour of a point, in 0-1 before it is written to the image
+  //----------------------------------------------------------------------------------------------------------------------
+  static void shade(const Material &_material, const float _worldPos[3], const float _normal[3], float o_colour[3]);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compare the rgb of two rgba images of _pixels pixels in the same row order, a pixel
+  /// differs if any channel is more than _threshold apart
+  //----------------------------------------------------------------------------------------------------------------------
+  static Difference compare(const uint8_t *_a, const uint8_t *_b, size_t _pixels, int _threshold);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the image as a binary ppm, the alpha is dropped
+  /// @returns false if the file can't be written
+  //----------------------------------------------------------------------------------------------------------------------
+  bool writePPM(const std::string &_fileName) const;
+
+private :
+  struct Vertex;
+  struct Triangle;
+  void transformVertices(const Mesh &_mesh, const Transforms &_transforms);
+  void setupTriangles();
+  void binTriangles();
+  void drawTile(size_t _tile, uint32_t _worker, const Material &_material);
+  ThreadPool &m_pool;
+  int m_tileSize;
+  float m_clear[4] = {0.5f, 0.5f, 0.5f, 0.0f};
+  Image m_image;
+  Stats m_stats;
+  int m_tilesX = 0;
+  int m_tilesY = 0;
+  std::vector<Vertex> m_vertices;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the triangles set up from each fixed block of the mesh, joined in mesh order so
+  /// the bins (and so the depth ties) don't depend on the threads
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<std::vector<Triangle>> m_blocks;
+  std::vector<Triangle> m_triangles;
+  std::vector<std::vector<uint32_t>> m_bins;
+  std::vector<uint32_t> m_tileOrder;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef STREAMINGVAO_H_
+#define STREAMINGVAO_H_
+
+#include <ngl/AbstractVAO.h>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file StreamingVAO.h
+/// @brief a single buffer non indexed VAO that can be allocated first and filled in pieces
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class StreamingVAO
+/// @brief works like ngl's simpleVAO but the data doesn't have to exist in one block, so a
+/// mesh can be uploaded while the rest of it is still being loaded
+//----------------------------------------------------------------------------------------------------------------------
+class StreamingVAO : public ngl::AbstractVAO
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, needs a current GL context
+  /// @param[in] _mode the draw mode
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit StreamingVAO(GLenum _mode = GL_TRIANGLES) : ngl::AbstractVAO(_mode) {}
+  ~StreamingVAO() override;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draw numIndices() vertices
+  //----------------------------------------------------------------------------------------------------------------------
+  void draw() const override;
+  void removeVAO() override;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief allocate and fill the buffer in one go
+  //----------------------------------------------------------------------------------------------------------------------
+  void setData(const VertexData &_data) override;
+  GLuint getBufferID(unsigned int = 0) override { return m_buffer; }
+  ngl::Real *mapBuffer(unsigned int _index = 0, GLenum _accessMode = GL_READ_WRITE) override;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief allocate _bytes of uninitialised storage, the VAO must be bound
+  //----------------------------------------------------------------------------------------------------------------------
+  void allocate(size_t _bytes, GLenum _usage = GL_STATIC_DRAW);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief copy _bytes of _data to _offset in the buffer
+  //----------------------------------------------------------------------------------------------------------------------
+  void setSubData(size_t _offset, size_t _bytes, const void *_data);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief use a buffer that was filled elsewhere (e.g. on a shared context), the VAO owns
+  /// it afterwards. The buffer is left bound to GL_ARRAY_BUFFER ready for the attribute pointers
+  //----------------------------------------------------------------------------------------------------------------------
+  void adoptBuffer(GLuint _buffer);
+
+private :
+  GLuint m_buffer = 0;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ThreadPool.h
+/// @brief a fixed set of worker threads for the cpu heavy jobs (mesh import, batch transforms)
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class ThreadPool
+/// @brief tasks are run in the order they are submitted by the first free worker
+//----------------------------------------------------------------------------------------------------------------------
+class ThreadPool
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor starts the workers
+  /// @param[in] _threads the number of workers, 0 uses one per hardware thread
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit ThreadPool(size_t _threads = 0);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor finishes the queued tasks then joins the workers
+  //----------------------------------------------------------------------------------------------------------------------
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of worker threads
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t size() const { return m_workers.size(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue a task
+  /// @returns a future for the result of the task, exceptions are passed on through it
+  //----------------------------------------------------------------------------------------------------------------------
+  template <typename Func>
+  auto submit(Func &&_func) -> std::future<std::invoke_result_t<Func>>
+  {
+    using Result = std::invoke_result_t<Func>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(_func));
+    auto future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_tasks.emplace([task]() { (*task)(); });
+    }
+    m_wake.notify_one();
+    return future;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief split [0,_count) into ranges of at least _grain and run _func(begin,end) on each
+  /// in parallel, returns when they have all finished
+  //----------------------------------------------------------------------------------------------------------------------
+  void parallelFor(size_t _count, size_t _grain, const std::function<void(size_t, size_t)> &_func);
+
+private :
+  void workerLoop();
+
+  std::vector<std::thread> m_workers;
+  std::queue<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_stop = false;
+};
+
+#endif
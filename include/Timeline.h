@@ -0,0 +1,143 @@
+#ifndef TIMELINE_H_
+#define TIMELINE_H_
+
+#include "TransformBatch.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Timeline.h
+/// @brief keyframed transform parameters played back at a fixed tick
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Timeline
+/// @brief each track is one animated object with a curve for each of the parameters the ui
+/// feeds into NGLScene (translate, rotate, scale and the euler angle and axis). A curve is a
+/// list of keys, blended smoothly (Catmull-Rom) or linearly to the next key, and holds its first
+/// and last values outside them. A channel with no keys stays at its identity value.
+/// Evaluating the keys of every curve every tick would mean a search and a cubic per value, so
+/// the curves are baked at a fixed sample rate first. The samples of a channel are stored frame
+/// by frame with every track's value for a frame next to each other, so a tick is a linear
+/// blend of two rows per channel straight into a TransformParams, and the orientations of the
+/// rows are blended by TransformBatch::interpolate. The timeline loops at its duration.
+//----------------------------------------------------------------------------------------------------------------------
+class Timeline
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @enum the animated parameters, in the order of TransformParams::set
+  //----------------------------------------------------------------------------------------------------------------------
+  enum Channel : size_t
+  {
+    TX, TY, TZ,
+    RX, RY, RZ,
+    SX, SY, SZ,
+    EULERANGLE, EULERX, EULERY, EULERZ,
+    CHANNELS
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @enum how a key blends to the next one
+  //----------------------------------------------------------------------------------------------------------------------
+  enum class Ease
+  {
+    LINEAR,
+    SMOOTH ///< Catmull-Rom through the neighbouring keys
+  };
+  struct Key
+  {
+    float time = 0.0f; ///< seconds
+    float value = 0.0f;
+    Ease ease = Ease::SMOOTH;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief how fast evaluate has run so far
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    uint64_t ticks = 0;
+    uint64_t transforms = 0; ///< tracks evaluated over all the ticks
+    double seconds = 0.0;    ///< spent in evaluate
+    double bakeMs = 0.0;     ///< the last bake
+    double transformsPerSecond() const { return seconds > 0.0 ? transforms / seconds : 0.0; }
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _tracks the number of animated objects
+  /// @param[in] _sampleRate samples per second the curves are baked at
+  //----------------------------------------------------------------------------------------------------------------------
+  explicit Timeline(size_t _tracks = 1, float _sampleRate = 120.0f);
+  size_t tracks() const { return m_tracks; }
+  float sampleRate() const { return m_sampleRate; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief change the number of tracks, new ones have no keys
+  //----------------------------------------------------------------------------------------------------------------------
+  void setTracks(size_t _tracks);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add a key, replacing any key of the curve at the same time
+  //----------------------------------------------------------------------------------------------------------------------
+  void setKey(size_t _track, Channel _channel, float _time, float _value, Ease _ease = Ease::SMOOTH);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief key every channel of _track at _time from one transform of _params
+  //----------------------------------------------------------------------------------------------------------------------
+  void setPose(size_t _track, float _time, const TransformParams &_params, size_t _index, Ease _ease = Ease::SMOOTH);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief remove every key
+  //----------------------------------------------------------------------------------------------------------------------
+  void clear();
+  const std::vector<Key> &keys(size_t _track, Channel _channel) const { return m_curves[curve(_track, _channel)]; }
+  size_t keyCount() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the time of the last key, the timeline loops back to 0 after it
+  //----------------------------------------------------------------------------------------------------------------------
+  float duration() const { return m_duration; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief _time wrapped into [0, duration]
+  //----------------------------------------------------------------------------------------------------------------------
+  float wrap(float _time) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the value of a curve straight from its keys, what the baked samples are made from
+  //----------------------------------------------------------------------------------------------------------------------
+  float valueAt(size_t _track, Channel _channel, float _time) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief sample every curve, done by evaluate when the keys have changed since the last bake
+  //----------------------------------------------------------------------------------------------------------------------
+  void bake();
+  size_t frames() const { return m_frames; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the parameters of every track at _time, wrapped into the timeline
+  /// @param[out] o_params resized to tracks(), the orientations are set too
+  /// @param[in] _mode how the orientations of the two nearest samples are blended
+  //----------------------------------------------------------------------------------------------------------------------
+  void evaluate(float _time, TransformParams &o_params,
+                TransformBatch::Interpolation _mode = TransformBatch::Interpolation::NLERP);
+  const Stats &stats() const { return m_stats; }
+  void resetStats();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the value of a channel with no keys
+  //----------------------------------------------------------------------------------------------------------------------
+  static float identity(Channel _channel);
+
+private :
+  size_t curve(size_t _track, Channel _channel) const { return _track * CHANNELS + _channel; }
+  size_t m_tracks;
+  float m_sampleRate;
+  float m_duration = 0.0f;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the keys of every curve sorted by time, CHANNELS curves per track
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<std::vector<Key>> m_curves;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the baked samples of each channel then the orientation x,y,z,w, m_frames rows of
+  /// m_tracks values each
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t Sampled = CHANNELS + 4;
+  std::array<std::vector<float>, Sampled> m_samples;
+  size_t m_frames = 0;
+  bool m_dirty = true;
+  Stats m_stats;
+};
+
+#endif
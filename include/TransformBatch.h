@@ -0,0 +1,209 @@
+#ifndef TRANSFORMBATCH_H_
+#define TRANSFORMBATCH_H_
+
+#include "MatrixOrder.h"
+#include <cstddef>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TransformBatch.h
+/// @brief batch version of the transform composition done in NGLScene::paintGL
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief raw structure of arrays view of the transform parameters, each pointer must
+/// reference at least count floats. Angles are in degrees as in the ui.
+//----------------------------------------------------------------------------------------------------------------------
+struct TransformArrays
+{
+  const float *tx = nullptr;
+  const float *ty = nullptr;
+  const float *tz = nullptr;
+  const float *rx = nullptr;
+  const float *ry = nullptr;
+  const float *rz = nullptr;
+  const float *sx = nullptr;
+  const float *sy = nullptr;
+  const float *sz = nullptr;
+  const float *eulerAngle = nullptr;
+  const float *eulerX = nullptr;
+  const float *eulerY = nullptr;
+  const float *eulerZ = nullptr;
+  const float *qx = nullptr;
+  const float *qy = nullptr;
+  const float *qz = nullptr;
+  const float *qw = nullptr;
+  size_t count = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief writable structure of arrays of unit quaternions, the output of the interpolation
+//----------------------------------------------------------------------------------------------------------------------
+struct QuaternionArrays
+{
+  float *x = nullptr;
+  float *y = nullptr;
+  float *z = nullptr;
+  float *w = nullptr;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief owning structure of arrays of the parameters the ui feeds into NGLScene
+/// (setTranslate, setRotate, setScale and setEuler) one entry per transform.
+/// The orientation used by MatrixOrder::QUATERNION is a unit quaternion (qx,qy,qz,qw), set
+/// from the rotate angles by set or directly by setOrientation.
+//----------------------------------------------------------------------------------------------------------------------
+struct TransformParams
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief resize all the arrays, new entries are set to the identity values
+  /// @param[in] _n the new number of transforms
+  //----------------------------------------------------------------------------------------------------------------------
+  void resize(size_t _n);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set all the parameters for a single transform
+  //----------------------------------------------------------------------------------------------------------------------
+  void set(size_t _i, float _tx, float _ty, float _tz,
+           float _rx, float _ry, float _rz,
+           float _sx, float _sy, float _sz,
+           float _eulerAngle, float _eulerX, float _eulerY, float _eulerZ);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief replace the orientation of a single transform, _x,_y,_z,_w must be a unit quaternion
+  //----------------------------------------------------------------------------------------------------------------------
+  void setOrientation(size_t _i, float _x, float _y, float _z, float _w);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of transforms held
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t size() const { return tx.size(); }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get a raw view of the arrays for the kernels
+  //----------------------------------------------------------------------------------------------------------------------
+  TransformArrays arrays() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a writable view of the orientations for TransformBatch::interpolate
+  //----------------------------------------------------------------------------------------------------------------------
+  QuaternionArrays orientations();
+
+  std::vector<float> tx, ty, tz;
+  std::vector<float> rx, ry, rz;
+  std::vector<float> sx, sy, sz;
+  std::vector<float> eulerAngle, eulerX, eulerY, eulerZ;
+  std::vector<float> qx, qy, qz, qw;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class TransformBatch
+/// @brief composes arrays of transform parameters into arrays of matrices for any MatrixOrder.
+/// The output is 16 floats per matrix in the same column major layout as ngl::Mat4::openGL().
+/// The SSE and AVX2 kernels give exactly the same bits as the scalar reference, to make this
+/// possible sin / cos are evaluated with the same polynomial in every kernel rather than
+/// using the C library, so results may differ from ngl::Mat4::rotateX etc in the last bit.
+//----------------------------------------------------------------------------------------------------------------------
+class TransformBatch
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @enum the instruction set used to do the composition
+  //----------------------------------------------------------------------------------------------------------------------
+  enum class Kernel{
+                    SCALAR, ///< plain C++ reference
+                    SSE,    ///< 4 transforms at a time
+                    AVX2    ///< 8 transforms at a time
+                   };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @enum how interpolate blends two orientations
+  //----------------------------------------------------------------------------------------------------------------------
+  enum class Interpolation{
+                           NLERP, ///< normalised linear blend, cheap but the speed varies over the arc
+                           SLERP  ///< constant angular speed, falls back to NLERP for nearly equal orientations
+                          };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the fastest kernel supported by this cpu
+  //----------------------------------------------------------------------------------------------------------------------
+  static Kernel bestKernel();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief check if a kernel was compiled in and can run on this cpu
+  //----------------------------------------------------------------------------------------------------------------------
+  static bool isSupported(Kernel _kernel);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief name of the kernel for reports
+  //----------------------------------------------------------------------------------------------------------------------
+  static const char *kernelName(Kernel _kernel);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compose every transform in _params
+  /// @param[in] _order the order to multiply the components in
+  /// @param[in] _params the parameters
+  /// @param[out] _out 16 * _params.size() floats to receive the matrices
+  /// @param[in] _kernel the kernel to use, unsupported kernels fall back to the scalar one
+  //----------------------------------------------------------------------------------------------------------------------
+  static void compose(MatrixOrder _order, const TransformParams &_params, float *_out, Kernel _kernel=bestKernel());
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compose the transforms [_begin,_end) so large batches can be split across threads
+  /// @param[out] _out receives the matrix for _begin at _out[0]
+  //----------------------------------------------------------------------------------------------------------------------
+  static void compose(MatrixOrder _order, const TransformArrays &_params, size_t _begin, size_t _end, float *_out, Kernel _kernel=bestKernel());
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief sin and cos of an angle in degrees using the same polynomial as the simd kernels
+  //----------------------------------------------------------------------------------------------------------------------
+  static void sinCosDegrees(float _degrees, float &_sin, float &_cos);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief as sinCosDegrees for an angle in radians
+  //----------------------------------------------------------------------------------------------------------------------
+  static void sinCosRadians(float _radians, float &_sin, float &_cos);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the unit quaternion of the rz * ry * rx rotation used by RTS and TRS
+  /// @param[in] _rx _ry _rz the angles in degrees
+  /// @param[out] o_q x,y,z,w
+  //----------------------------------------------------------------------------------------------------------------------
+  static void quaternionFromEuler(float _rx, float _ry, float _rz, float o_q[4]);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the rotation matrix of a unit quaternion, written straight into the 3x3 block
+  /// without building or multiplying any axis rotations
+  /// @param[in] _q x,y,z,w
+  /// @param[out] o_m 16 floats, column major
+  //----------------------------------------------------------------------------------------------------------------------
+  static void quaternionToMatrix(const float _q[4], float o_m[16]);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief blend the orientations of two sets of transforms, the shorter way round the arc
+  /// @param[in] _mode NLERP or SLERP
+  /// @param[in] _from the orientations at _t = 0
+  /// @param[in] _to the orientations at _t = 1
+  /// @param[in] _t the blend factor, the same for every transform
+  /// @param[in] _begin _end the range of transforms to blend
+  /// @param[out] o_out receives the unit quaternion for _begin at index 0, may alias _from or _to
+  /// @param[in] _kernel the kernel to use, unsupported kernels fall back to the scalar one
+  //----------------------------------------------------------------------------------------------------------------------
+  static void interpolate(Interpolation _mode, const TransformArrays &_from, const TransformArrays &_to, float _t,
+                          size_t _begin, size_t _end, const QuaternionArrays &o_out, Kernel _kernel=bestKernel());
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief blend every orientation of _from and _to (which must be the same size) into o_out
+  //----------------------------------------------------------------------------------------------------------------------
+  static void interpolate(Interpolation _mode, const TransformParams &_from, const TransformParams &_to, float _t,
+                          TransformParams &o_out, Kernel _kernel=bestKernel());
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the inverse transpose of the upper 3x3 of each matrix for transforming normals
+  /// @param[in] _matrices 16 floats per matrix as written by compose
+  /// @param[in] _count the number of matrices
+  /// @param[out] _out 9 floats per matrix, column major
+  //----------------------------------------------------------------------------------------------------------------------
+  static void normalMatrices(const float *_matrices, size_t _count, float *_out);
+
+private :
+  static void composeScalar(MatrixOrder _order, const TransformArrays &_params, size_t _begin, size_t _end, float *_out);
+  static void interpolateScalar(Interpolation _mode, const TransformArrays &_from, const TransformArrays &_to, float _t,
+                                size_t _begin, size_t _end, const QuaternionArrays &o_out);
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the simd kernels, each lives in its own translation unit so it can be built with the
+/// right instruction set flags, they are only called from TransformBatch::compose
+/// @returns the index of the first transform not processed, the tail is done by the scalar kernel
+//----------------------------------------------------------------------------------------------------------------------
+size_t composeTransformsSSE(MatrixOrder _order, const TransformArrays &_params, size_t _begin, size_t _end, float *_out);
+size_t composeTransformsAVX2(MatrixOrder _order, const TransformArrays &_params, size_t _begin, size_t _end, float *_out);
+size_t interpolateSSE(TransformBatch::Interpolation _mode, const TransformArrays &_from, const TransformArrays &_to,
+                      float _t, size_t _begin, size_t _end, const QuaternionArrays &o_out);
+size_t interpolateAVX2(TransformBatch::Interpolation _mode, const TransformArrays &_from, const TransformArrays &_to,
+                       float _t, size_t _begin, size_t _end, const QuaternionArrays &o_out);
+
+#endif
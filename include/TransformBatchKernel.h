@@ -0,0 +1,395 @@
+#ifndef TRANSFORMBATCHKERNEL_H_
+#define TRANSFORMBATCHKERNEL_H_
+
+#include "TransformBatch.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TransformBatchKernel.h
+/// @brief constants and the generic simd kernel used by TransformBatch. This is only included by
+/// the TransformBatch translation units, the kernel is written against a small Ops type so the SSE
+/// and AVX2 versions execute exactly the same sequence of operations as the scalar reference.
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief degrees to radians and the range reduction constants, pi/2 is split in three
+/// so q * kPiOver2A and q * kPiOver2B are exact (Cody-Waite reduction)
+//----------------------------------------------------------------------------------------------------------------------
+constexpr float kDegToRad = 0.017453292519943295f;
+constexpr float kTwoOverPi = 0.63661977236758134f;
+constexpr float kPiOver2A = 1.5703125f;
+constexpr float kPiOver2B = 4.837512969970703125e-4f;
+constexpr float kPiOver2C = 7.54978995489188216e-8f;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief minimax polynomials for sin and cos on [-pi/4,pi/4] (from cephes sinf / cosf)
+//----------------------------------------------------------------------------------------------------------------------
+constexpr float kSin0 = -1.9515295891e-4f;
+constexpr float kSin1 = 8.3321608736e-3f;
+constexpr float kSin2 = -1.6666654611e-1f;
+constexpr float kCos0 = 2.443315711809948e-5f;
+constexpr float kCos1 = -1.388731625493765e-3f;
+constexpr float kCos2 = 4.166664568298827e-2f;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief asin polynomial on [0,0.5] (from cephes asinf), acos of larger values uses the
+/// half angle identity so the polynomial is never evaluated outside its range
+//----------------------------------------------------------------------------------------------------------------------
+constexpr float kHalfPi = 1.57079632679489662f;
+constexpr float kAsin0 = 4.2163199048e-2f;
+constexpr float kAsin1 = 2.4181311049e-2f;
+constexpr float kAsin2 = 4.5470025998e-2f;
+constexpr float kAsin3 = 7.4953002686e-2f;
+constexpr float kAsin4 = 1.6666752422e-1f;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief above this cosine of the angle between two quaternions slerp uses the nlerp weights,
+/// sin of the angle is too small to divide by
+//----------------------------------------------------------------------------------------------------------------------
+constexpr float kSlerpThreshold = 0.9995f;
+
+#if defined(TRANSFORMBATCH_SIMD_KERNEL)
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief sin and cos of a vector of angles in radians, see TransformBatch::sinCosRadians
+/// for the scalar version, any change here must be made there as well
+//----------------------------------------------------------------------------------------------------------------------
+template <class Ops>
+inline void sinCosRadians(typename Ops::V _r, typename Ops::V &_s, typename Ops::V &_c)
+{
+  using V = typename Ops::V;
+  using I = typename Ops::I;
+  I qi = Ops::roundToInt(Ops::mul(_r, Ops::set1(kTwoOverPi)));
+  V q = Ops::toFloat(qi);
+  V x = Ops::sub(_r, Ops::mul(q, Ops::set1(kPiOver2A)));
+  x = Ops::sub(x, Ops::mul(q, Ops::set1(kPiOver2B)));
+  x = Ops::sub(x, Ops::mul(q, Ops::set1(kPiOver2C)));
+  V z = Ops::mul(x, x);
+
+  V ps = Ops::mul(Ops::set1(kSin0), z);
+  ps = Ops::add(ps, Ops::set1(kSin1));
+  ps = Ops::mul(ps, z);
+  ps = Ops::add(ps, Ops::set1(kSin2));
+  ps = Ops::mul(ps, z);
+  ps = Ops::mul(ps, x);
+  ps = Ops::add(ps, x);
+
+  V pc = Ops::mul(Ops::set1(kCos0), z);
+  pc = Ops::add(pc, Ops::set1(kCos1));
+  pc = Ops::mul(pc, z);
+  pc = Ops::add(pc, Ops::set1(kCos2));
+  pc = Ops::mul(pc, z);
+  pc = Ops::mul(pc, z);
+  pc = Ops::sub(pc, Ops::mul(Ops::set1(0.5f), z));
+  pc = Ops::add(pc, Ops::set1(1.0f));
+  // odd quadrants swap sin and cos, then fix up the signs
+  V swap = Ops::bitSet(qi, 1);
+  _s = Ops::negateIf(Ops::select(swap, pc, ps), qi, 2);
+  _c = Ops::negateIf(Ops::select(swap, ps, pc), Ops::addInt(qi, 1), 2);
+}
+
+template <class Ops>
+inline void sinCosDegrees(typename Ops::V _deg, typename Ops::V &_s, typename Ops::V &_c)
+{
+  sinCosRadians<Ops>(Ops::mul(_deg, Ops::set1(kDegToRad)), _s, _c);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief acos of values in [0,1], see acosPositive in TransformBatch.cpp for the scalar version
+//----------------------------------------------------------------------------------------------------------------------
+template <class Ops>
+inline typename Ops::V asinPoly(typename Ops::V _x)
+{
+  using V = typename Ops::V;
+  V z = Ops::mul(_x, _x);
+  V p = Ops::mul(Ops::set1(kAsin0), z);
+  p = Ops::add(p, Ops::set1(kAsin1));
+  p = Ops::mul(p, z);
+  p = Ops::add(p, Ops::set1(kAsin2));
+  p = Ops::mul(p, z);
+  p = Ops::add(p, Ops::set1(kAsin3));
+  p = Ops::mul(p, z);
+  p = Ops::add(p, Ops::set1(kAsin4));
+  p = Ops::mul(p, z);
+  p = Ops::mul(p, _x);
+  return Ops::add(p, _x);
+}
+
+template <class Ops>
+inline typename Ops::V acosPositive(typename Ops::V _d)
+{
+  using V = typename Ops::V;
+  V small = Ops::sub(Ops::set1(kHalfPi), asinPoly<Ops>(_d));
+  V big = asinPoly<Ops>(Ops::sqrt(Ops::mul(Ops::sub(Ops::set1(1.0f), _d), Ops::set1(0.5f))));
+  big = Ops::add(big, big);
+  return Ops::select(Ops::lessThan(Ops::set1(0.5f), _d), big, small);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the 3x3 rotation block (column major) for the different orders
+//----------------------------------------------------------------------------------------------------------------------
+template <class Ops>
+inline void rotateBlock(const TransformArrays &_p, size_t _i, typename Ops::V *_l)
+{
+  using V = typename Ops::V;
+  V sx, cx, sy, cy, sz, cz;
+  sinCosDegrees<Ops>(Ops::load(_p.rx + _i), sx, cx);
+  sinCosDegrees<Ops>(Ops::load(_p.ry + _i), sy, cy);
+  sinCosDegrees<Ops>(Ops::load(_p.rz + _i), sz, cz);
+  // rz * ry * rx
+  V czsy = Ops::mul(cz, sy);
+  V szsy = Ops::mul(sz, sy);
+  _l[0] = Ops::mul(cz, cy);
+  _l[1] = Ops::mul(sz, cy);
+  _l[2] = Ops::neg(sy);
+  _l[3] = Ops::add(Ops::mul(Ops::neg(sz), cx), Ops::mul(czsy, sx));
+  _l[4] = Ops::add(Ops::mul(cz, cx), Ops::mul(szsy, sx));
+  _l[5] = Ops::mul(cy, sx);
+  _l[6] = Ops::add(Ops::mul(sz, sx), Ops::mul(czsy, cx));
+  _l[7] = Ops::add(Ops::mul(Ops::neg(cz), sx), Ops::mul(szsy, cx));
+  _l[8] = Ops::mul(cy, cx);
+}
+
+template <class Ops>
+inline void gimbalBlock(const TransformArrays &_p, size_t _i, typename Ops::V *_l)
+{
+  using V = typename Ops::V;
+  V sx, cx, sy, cy, sz, cz;
+  sinCosDegrees<Ops>(Ops::load(_p.rx + _i), sx, cx);
+  sinCosDegrees<Ops>(Ops::load(_p.ry + _i), sy, cy);
+  sinCosDegrees<Ops>(Ops::load(_p.rz + _i), sz, cz);
+  _l[0] = cz;
+  _l[1] = sz;
+  _l[2] = Ops::neg(sy);
+  _l[3] = Ops::neg(sz);
+  _l[4] = cz;
+  _l[5] = sx;
+  _l[6] = sy;
+  _l[7] = Ops::neg(sx);
+  _l[8] = cy;
+}
+
+template <class Ops>
+inline void eulerBlock(const TransformArrays &_p, size_t _i, typename Ops::V *_l)
+{
+  using V = typename Ops::V;
+  V s, c;
+  sinCosDegrees<Ops>(Ops::neg(Ops::load(_p.eulerAngle + _i)), s, c);
+  V x = Ops::load(_p.eulerX + _i);
+  V y = Ops::load(_p.eulerY + _i);
+  V z = Ops::load(_p.eulerZ + _i);
+  V len = Ops::sqrt(Ops::add(Ops::add(Ops::mul(x, x), Ops::mul(y, y)), Ops::mul(z, z)));
+  // a zero length axis gives the identity
+  V valid = Ops::notZero(len);
+  x = Ops::select(valid, Ops::div(x, len), Ops::zero());
+  y = Ops::select(valid, Ops::div(y, len), Ops::zero());
+  z = Ops::select(valid, Ops::div(z, len), Ops::zero());
+  s = Ops::select(valid, s, Ops::zero());
+  c = Ops::select(valid, c, Ops::set1(1.0f));
+  V o = Ops::sub(Ops::set1(1.0f), c);
+  V ox = Ops::mul(o, x);
+  V oy = Ops::mul(o, y);
+  V oz = Ops::mul(o, z);
+  _l[0] = Ops::add(Ops::mul(ox, x), c);
+  _l[1] = Ops::sub(Ops::mul(ox, y), Ops::mul(s, z));
+  _l[2] = Ops::add(Ops::mul(ox, z), Ops::mul(s, y));
+  _l[3] = Ops::add(Ops::mul(ox, y), Ops::mul(s, z));
+  _l[4] = Ops::add(Ops::mul(oy, y), c);
+  _l[5] = Ops::sub(Ops::mul(oy, z), Ops::mul(s, x));
+  _l[6] = Ops::sub(Ops::mul(ox, z), Ops::mul(s, y));
+  _l[7] = Ops::add(Ops::mul(oy, z), Ops::mul(s, x));
+  _l[8] = Ops::add(Ops::mul(oz, z), c);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the rotation block of a unit quaternion, see quaternionBlock in TransformBatch.cpp
+//----------------------------------------------------------------------------------------------------------------------
+template <class Ops>
+inline void quaternionBlock(const TransformArrays &_p, size_t _i, typename Ops::V *_l)
+{
+  using V = typename Ops::V;
+  V x = Ops::load(_p.qx + _i);
+  V y = Ops::load(_p.qy + _i);
+  V z = Ops::load(_p.qz + _i);
+  V w = Ops::load(_p.qw + _i);
+  V x2 = Ops::add(x, x);
+  V y2 = Ops::add(y, y);
+  V z2 = Ops::add(z, z);
+  V xx = Ops::mul(x, x2);
+  V yy = Ops::mul(y, y2);
+  V zz = Ops::mul(z, z2);
+  V xy = Ops::mul(x, y2);
+  V xz = Ops::mul(x, z2);
+  V yz = Ops::mul(y, z2);
+  V wx = Ops::mul(w, x2);
+  V wy = Ops::mul(w, y2);
+  V wz = Ops::mul(w, z2);
+  V one = Ops::set1(1.0f);
+  _l[0] = Ops::sub(one, Ops::add(yy, zz));
+  _l[1] = Ops::add(xy, wz);
+  _l[2] = Ops::sub(xz, wy);
+  _l[3] = Ops::sub(xy, wz);
+  _l[4] = Ops::sub(one, Ops::add(xx, zz));
+  _l[5] = Ops::add(yz, wx);
+  _l[6] = Ops::add(xz, wy);
+  _l[7] = Ops::sub(yz, wx);
+  _l[8] = Ops::sub(one, Ops::add(xx, yy));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief compose Ops::width transforms at a time for a fixed order
+/// @returns the first index not processed
+//----------------------------------------------------------------------------------------------------------------------
+template <class Ops, MatrixOrder Order>
+size_t composeRange(const TransformArrays &_p, size_t _begin, size_t _end, float *_out)
+{
+  using V = typename Ops::V;
+  size_t i = _begin;
+  for (; i + Ops::width <= _end; i += Ops::width)
+  {
+    V l[9];
+    if constexpr (Order == MatrixOrder::RTS || Order == MatrixOrder::TRS)
+    {
+      rotateBlock<Ops>(_p, i, l);
+    }
+    else if constexpr (Order == MatrixOrder::GIMBALLOCK)
+    {
+      gimbalBlock<Ops>(_p, i, l);
+    }
+    else if constexpr (Order == MatrixOrder::QUATERNION)
+    {
+      quaternionBlock<Ops>(_p, i, l);
+    }
+    else
+    {
+      eulerBlock<Ops>(_p, i, l);
+    }
+    V sx = Ops::load(_p.sx + i);
+    V sy = Ops::load(_p.sy + i);
+    V sz = Ops::load(_p.sz + i);
+    V tx = Ops::load(_p.tx + i);
+    V ty = Ops::load(_p.ty + i);
+    V tz = Ops::load(_p.tz + i);
+    V m[16];
+    m[0] = Ops::mul(l[0], sx);
+    m[1] = Ops::mul(l[1], sx);
+    m[2] = Ops::mul(l[2], sx);
+    m[3] = Ops::zero();
+    m[4] = Ops::mul(l[3], sy);
+    m[5] = Ops::mul(l[4], sy);
+    m[6] = Ops::mul(l[5], sy);
+    m[7] = Ops::zero();
+    m[8] = Ops::mul(l[6], sz);
+    m[9] = Ops::mul(l[7], sz);
+    m[10] = Ops::mul(l[8], sz);
+    m[11] = Ops::zero();
+    if constexpr (Order == MatrixOrder::RTS || Order == MatrixOrder::TEULERS)
+    {
+      // rotation applied after the translation so the translation is rotated
+      m[12] = Ops::add(Ops::add(Ops::mul(l[0], tx), Ops::mul(l[3], ty)), Ops::mul(l[6], tz));
+      m[13] = Ops::add(Ops::add(Ops::mul(l[1], tx), Ops::mul(l[4], ty)), Ops::mul(l[7], tz));
+      m[14] = Ops::add(Ops::add(Ops::mul(l[2], tx), Ops::mul(l[5], ty)), Ops::mul(l[8], tz));
+    }
+    else
+    {
+      m[12] = tx;
+      m[13] = ty;
+      m[14] = tz;
+    }
+    m[15] = Ops::set1(1.0f);
+    Ops::storeMatrices(m, _out + (i - _begin) * 16);
+  }
+  return i;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief dispatch to the compile time specialised kernel for the order
+//----------------------------------------------------------------------------------------------------------------------
+template <class Ops>
+size_t composeOrder(MatrixOrder _order, const TransformArrays &_p, size_t _begin, size_t _end, float *_out)
+{
+  switch (_order)
+  {
+  case MatrixOrder::RTS: return composeRange<Ops, MatrixOrder::RTS>(_p, _begin, _end, _out);
+  case MatrixOrder::TRS: return composeRange<Ops, MatrixOrder::TRS>(_p, _begin, _end, _out);
+  case MatrixOrder::GIMBALLOCK: return composeRange<Ops, MatrixOrder::GIMBALLOCK>(_p, _begin, _end, _out);
+  case MatrixOrder::EULERTS: return composeRange<Ops, MatrixOrder::EULERTS>(_p, _begin, _end, _out);
+  case MatrixOrder::TEULERS: return composeRange<Ops, MatrixOrder::TEULERS>(_p, _begin, _end, _out);
+  case MatrixOrder::QUATERNION: return composeRange<Ops, MatrixOrder::QUATERNION>(_p, _begin, _end, _out);
+  }
+  return _begin;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief blend Ops::width orientations at a time, see TransformBatch::interpolateScalar
+/// @returns the first index not processed
+//----------------------------------------------------------------------------------------------------------------------
+template <class Ops, TransformBatch::Interpolation Mode>
+size_t interpolateRange(const TransformArrays &_from, const TransformArrays &_to, float _t, size_t _begin,
+                        size_t _end, const QuaternionArrays &o_out)
+{
+  using V = typename Ops::V;
+  const V t = Ops::set1(_t);
+  const V oneMinusT = Ops::sub(Ops::set1(1.0f), t);
+  size_t i = _begin;
+  for (; i + Ops::width <= _end; i += Ops::width)
+  {
+    V ax = Ops::load(_from.qx + i);
+    V ay = Ops::load(_from.qy + i);
+    V az = Ops::load(_from.qz + i);
+    V aw = Ops::load(_from.qw + i);
+    V bx = Ops::load(_to.qx + i);
+    V by = Ops::load(_to.qy + i);
+    V bz = Ops::load(_to.qz + i);
+    V bw = Ops::load(_to.qw + i);
+    V d = Ops::add(Ops::mul(ax, bx), Ops::mul(ay, by));
+    d = Ops::add(d, Ops::mul(az, bz));
+    d = Ops::add(d, Ops::mul(aw, bw));
+    // q and -q are the same orientation, take the shorter way round
+    V flip = Ops::lessThan(d, Ops::zero());
+    bx = Ops::select(flip, Ops::neg(bx), bx);
+    by = Ops::select(flip, Ops::neg(by), by);
+    bz = Ops::select(flip, Ops::neg(bz), bz);
+    bw = Ops::select(flip, Ops::neg(bw), bw);
+    d = Ops::select(flip, Ops::neg(d), d);
+    V wa = oneMinusT;
+    V wb = t;
+    if constexpr (Mode == TransformBatch::Interpolation::SLERP)
+    {
+      V theta = acosPositive<Ops>(d);
+      V sinTheta = Ops::sqrt(Ops::sub(Ops::set1(1.0f), Ops::mul(d, d)));
+      V sa, sb, unused;
+      sinCosRadians<Ops>(Ops::mul(oneMinusT, theta), sa, unused);
+      sinCosRadians<Ops>(Ops::mul(t, theta), sb, unused);
+      V linear = Ops::lessThan(Ops::set1(kSlerpThreshold), d);
+      wa = Ops::select(linear, wa, Ops::div(sa, sinTheta));
+      wb = Ops::select(linear, wb, Ops::div(sb, sinTheta));
+    }
+    V x = Ops::add(Ops::mul(wa, ax), Ops::mul(wb, bx));
+    V y = Ops::add(Ops::mul(wa, ay), Ops::mul(wb, by));
+    V z = Ops::add(Ops::mul(wa, az), Ops::mul(wb, bz));
+    V w = Ops::add(Ops::mul(wa, aw), Ops::mul(wb, bw));
+    V len = Ops::add(Ops::mul(x, x), Ops::mul(y, y));
+    len = Ops::add(len, Ops::mul(z, z));
+    len = Ops::sqrt(Ops::add(len, Ops::mul(w, w)));
+    size_t o = i - _begin;
+    Ops::store(o_out.x + o, Ops::div(x, len));
+    Ops::store(o_out.y + o, Ops::div(y, len));
+    Ops::store(o_out.z + o, Ops::div(z, len));
+    Ops::store(o_out.w + o, Ops::div(w, len));
+  }
+  return i;
+}
+
+template <class Ops>
+size_t interpolateMode(TransformBatch::Interpolation _mode, const TransformArrays &_from, const TransformArrays &_to,
+                       float _t, size_t _begin, size_t _end, const QuaternionArrays &o_out)
+{
+  if (_mode == TransformBatch::Interpolation::SLERP)
+  {
+    return interpolateRange<Ops, TransformBatch::Interpolation::SLERP>(_from, _to, _t, _begin, _end, o_out);
+  }
+  return interpolateRange<Ops, TransformBatch::Interpolation::NLERP>(_from, _to, _t, _begin, _end, o_out);
+}
+#endif // TRANSFORMBATCH_SIMD_KERNEL
+
+} // end anon namespace
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef TRANSFORMSTATE_H_
+#define TRANSFORMSTATE_H_
+
+#include "MatrixOrder.h"
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TransformState.h
+/// @brief dirty tracking for the NGLScene transforms so paintGL only recomputes the
+/// products whose inputs have changed since the last frame
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class TransformState
+/// @brief a bit per component of the scene transform, set by the NGLScene slots and
+/// cleared at the end of each paintGL. The version increases on every change so other
+/// code can cheaply check if anything moved since it last looked.
+//----------------------------------------------------------------------------------------------------------------------
+class TransformState
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @enum the components that can be dirty
+  //----------------------------------------------------------------------------------------------------------------------
+  enum Component : uint32_t
+  {
+    SCALE      = 1 << 0, ///< m_scale
+    TRANSLATE  = 1 << 1, ///< m_translate
+    ROTATE     = 1 << 2, ///< m_rotate and m_gimbal
+    EULER      = 1 << 3, ///< m_euler
+    ORDER      = 1 << 4, ///< m_matrixOrder
+    MOUSESPIN  = 1 << 5, ///< the mouse rotation
+    MODELPOS   = 1 << 6, ///< the mouse translation and zoom
+    PROJECTION = 1 << 7, ///< the camera projection (window resize)
+    MODE       = 1 << 8, ///< drawing mode changes that alter what is in the TransformUBO
+    ALL        = 0x1ff
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief flag components as changed
+  //----------------------------------------------------------------------------------------------------------------------
+  void markDirty(uint32_t _components)
+  {
+    m_dirty |= _components;
+    ++m_version;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief check if any of the components have changed
+  //----------------------------------------------------------------------------------------------------------------------
+  bool isDirty(uint32_t _components) const { return (m_dirty & _components) != 0; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief called once everything has been recomputed
+  //----------------------------------------------------------------------------------------------------------------------
+  void clean() { m_dirty = 0; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of changes made so far
+  //----------------------------------------------------------------------------------------------------------------------
+  uint64_t version() const { return m_version; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the components the composed model transform depends on for an order, rotation
+  /// changes don't matter to the euler orders and vice versa
+  //----------------------------------------------------------------------------------------------------------------------
+  static uint32_t transformComponents(MatrixOrder _order)
+  {
+    switch (_order)
+    {
+    case MatrixOrder::EULERTS:
+    case MatrixOrder::TEULERS:
+      return SCALE | TRANSLATE | EULER | ORDER;
+    default:
+      return SCALE | TRANSLATE | ROTATE | ORDER;
+    }
+  }
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief everything is dirty until the first frame
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t m_dirty = ALL;
+  uint64_t m_version = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief counters to show how much work the dirty tracking saves
+//----------------------------------------------------------------------------------------------------------------------
+struct TransformStats
+{
+  uint64_t frames = 0;
+  uint64_t transformRecomputes = 0; ///< m_transform rebuilt
+  uint64_t transformSkipped = 0;    ///< m_transform reused
+  uint64_t mouseRecomputes = 0;     ///< m_mouseGlobalTX rebuilt
+  uint64_t mouseSkipped = 0;        ///< m_mouseGlobalTX reused
+  uint64_t uboRecomputes = 0;       ///< MVP and normal matrix rebuilt and uploaded
+  uint64_t uboSkipped = 0;          ///< MVP and normal matrix reused
+  uint64_t signalsEmitted = 0;      ///< matrixDirty emitted
+  uint64_t signalsSkipped = 0;      ///< frames where matrixDirty was not needed
+  uint64_t edits = 0;               ///< parameter setter calls
+  uint64_t commits = 0;             ///< transactions applied, each one rebuild and one repaint request
+  uint64_t lastCommitEdits = 0;     ///< the setter calls gathered into the last transaction
+};
+
+#endif
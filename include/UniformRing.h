@@ -0,0 +1,125 @@
+#ifndef UNIFORMRING_H_
+#define UNIFORMRING_H_
+
+#include <ngl/Types.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file UniformRing.h
+/// @brief a persistently mapped ring of uniform buffer slices so uploading uniforms never makes
+/// the driver synchronise with the gpu
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class UniformRing
+/// @brief one buffer made with glBufferStorage and mapped once (persistent and coherent), split
+/// into Frames sections of slicesPerFrame slices. Each upload copies into the next free slice
+/// of the current frame's section and binds it with glBindBufferRange. endFrame fences the
+/// section of the bound slice, and the first upload into a section waits for its fence, which
+/// will normally have signalled Frames frames before. A frame that uses more than slicesPerFrame
+/// slices stalls until the gpu has finished with its section and starts again at the beginning.
+/// Without glBufferStorage (GL before 4.4) a single buffer is orphaned and refilled on every
+/// upload instead.
+/// A valid GL context is needed for everything but the stats.
+//----------------------------------------------------------------------------------------------------------------------
+class UniformRing
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of frames the cpu can be ahead of the gpu before an upload waits
+  //----------------------------------------------------------------------------------------------------------------------
+  static constexpr size_t Frames = 3;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief counters since the last resetStats
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Stats
+  {
+    size_t frames = 0;
+    size_t uploads = 0;
+    size_t bytes = 0;
+    size_t fenceWaits = 0;     ///< uploads that found the gpu still reading the section
+    size_t overflows = 0;      ///< frames that ran out of slices and had to stall
+    double waitSeconds = 0.0;  ///< time blocked in glClientWaitSync
+    double copySeconds = 0.0;  ///< time copying into the mapped buffer (or in glBufferData)
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _binding the uniform buffer binding point the slices are bound to
+  /// @param[in] _sliceBytes the size of one upload, each slice is rounded up to
+  /// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  /// @param[in] _slicesPerFrame the uploads a frame can make without stalling
+  //----------------------------------------------------------------------------------------------------------------------
+  UniformRing(GLuint _binding, size_t _sliceBytes, size_t _slicesPerFrame = 16);
+  ~UniformRing();
+  UniformRing(const UniformRing &) = delete;
+  UniformRing &operator=(const UniformRing &) = delete;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create and map the buffer
+  /// @param[in] _persistent false always uses the orphaning fallback, for comparison
+  /// @returns false if glBufferStorage isn't available (or wasn't asked for) and the orphaning
+  /// fallback is used
+  //----------------------------------------------------------------------------------------------------------------------
+  bool initializeGL(bool _persistent = true);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief unmap and delete the buffer and any fences
+  //----------------------------------------------------------------------------------------------------------------------
+  void releaseGL();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief copy sliceBytes from _data into the next slice and bind it to the binding point,
+  /// the draws that use it must be issued before the next upload
+  //----------------------------------------------------------------------------------------------------------------------
+  void upload(const void *_data);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fence the section of the bound slice and, if this frame uploaded anything, move to
+  /// the next section. Call once after the last draw of each frame
+  //----------------------------------------------------------------------------------------------------------------------
+  void endFrame();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true if the buffer is persistently mapped, false for the orphaning fallback
+  //----------------------------------------------------------------------------------------------------------------------
+  bool persistent() const { return m_mapped != nullptr; }
+  size_t sliceBytes() const { return m_sliceBytes; }
+  const Stats &stats() const { return m_stats; }
+  void resetStats();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief uploaded MB per second of wall time since the last resetStats
+  //----------------------------------------------------------------------------------------------------------------------
+  double uploadMBPerSecond() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one line summary of the stats for the status bar and log
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string summary() const;
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief block until the gpu has finished with _fence then delete it
+  //----------------------------------------------------------------------------------------------------------------------
+  void wait(GLsync &_fence);
+
+  GLuint m_binding;
+  size_t m_sliceBytes;
+  size_t m_slicesPerFrame;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief m_sliceBytes rounded up to the offset alignment
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t m_stride = 0;
+  GLuint m_buffer = 0;
+  char *m_mapped = nullptr;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the fence written at the end of the last frame to use each section
+  //----------------------------------------------------------------------------------------------------------------------
+  GLsync m_fences[Frames] = {};
+  size_t m_section = 0;
+  size_t m_slice = 0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the section of the slice currently bound, Frames before the first upload
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t m_boundSection = Frames;
+  Stats m_stats;
+  std::chrono::steady_clock::time_point m_statsStart;
+};
+
+#endif
@@ -0,0 +1,13 @@
+#version 410 core
+/// @brief the vertex passed in
+layout (location = 0) in vec3 inVert;
+/// @brief the per vertex colour
+layout (location = 1) in vec3 inColour;
+uniform mat4 MVP;
+out vec3 vertColour;
+
+void main()
+{
+  vertColour = inColour;
+  gl_Position = MVP*vec4(inVert,1.0);
+}
@@ -6,6 +6,12 @@ layout (location = 0) in vec3 inVert;
 layout (location = 1) in vec3 inNormal;
 /// @brief the in uv
 layout (location = 2) in vec2 inUV;
+/// @brief per instance model matrix (uses locations 3-6)
+layout (location = 3) in mat4 inInstanceModel;
+/// @brief per instance normal matrix (uses locations 7-9)
+layout (location = 7) in mat3 inInstanceNormal;
+/// @brief set when drawing with glDrawArraysInstanced, the UBO then only holds the global transform
+uniform bool instanced=false;
 
 out vec3 worldPos;
 out vec3 normal;
@@ -13,15 +19,22 @@ out vec3 normal;
 layout( std140) uniform TransformUBO
 {
   mat4 MVP;
-  mat4 normalMatrix;
+  mat3 normalMatrix;
   mat4 M;
 }transforms;
 
 void main()
 {
-  worldPos = vec3(transforms.M * vec4(inVert, 1.0f));
-  normal=normalize(mat3(transforms.normalMatrix)*inNormal);
-  gl_Position = transforms.MVP*vec4(inVert,1.0);
+  vec4 position = vec4(inVert, 1.0);
+  vec3 n = inNormal;
+  if(instanced)
+  {
+    position = inInstanceModel * position;
+    n = inInstanceNormal * n;
+  }
+  worldPos = vec3(transforms.M * position);
+  normal=normalize(transforms.normalMatrix*n);
+  gl_Position = transforms.MVP*position;
 
 
 }
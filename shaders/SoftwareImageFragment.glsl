@@ -0,0 +1,13 @@
+#version 410 core
+/// @brief shows a frame drawn by the SoftwareRasterizer, with its depth so anything drawn by GL
+/// afterwards is still hidden by it
+layout (location =0) out vec4 fragColour;
+in vec2 uv;
+uniform sampler2D image;
+uniform sampler2D depth;
+
+void main()
+{
+  fragColour = texture(image, uv);
+  gl_FragDepth = texture(depth, uv).r;
+}
@@ -0,0 +1,11 @@
+#version 410 core
+/// @brief a triangle covering the viewport made from gl_VertexID, no vertex buffer is needed
+out vec2 uv;
+
+void main()
+{
+  vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  // the image's first row is the top of the screen
+  uv = vec2(corner.x, 1.0 - corner.y);
+  gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+precision highp float;
+/// @brief the start of the line
+layout (location = 0) in vec3 inVert;
+/// @brief the unit normal for the end of the line, zero for the start
+layout (location = 1) in vec3 inOffset;
+/// @brief 1 for a face normal, 0 for a vertex normal
+layout (location = 2) in float inFace;
+uniform mat4 MVP;
+
+uniform float normalSize;
+uniform vec4 vertNormalColour;
+uniform vec4 faceNormalColour;
+
+out vec4 perNormalColour;
+
+void main(void)
+{
+  gl_Position = MVP*vec4(inVert+inOffset*normalSize,1);
+  perNormalColour = mix(vertNormalColour,faceNormalColour,inFace);
+}
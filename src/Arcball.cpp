@@ -0,0 +1,71 @@
+/// @file Arcball.cpp
+/// @brief implementation of the arcball mouse rotation
+#include "Arcball.h"
+#include <algorithm>
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------------------------
+void Arcball::begin(float _x, float _y, int _width, int _height)
+{
+  m_width = std::max(_width, 1);
+  m_height = std::max(_height, 1);
+  std::copy(m_orientation, m_orientation + 4, m_start);
+  project(_x, _y, m_from);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Arcball::drag(float _x, float _y)
+{
+  float to[3];
+  project(_x, _y, to);
+  // the drag rotation is (from x to, from . to), twice the angle between the points
+  const float *f = m_from;
+  float d[4] = {f[1] * to[2] - f[2] * to[1], f[2] * to[0] - f[0] * to[2], f[0] * to[1] - f[1] * to[0],
+                f[0] * to[0] + f[1] * to[1] + f[2] * to[2]};
+  // applied after the orientation at the start of the drag, d * start
+  const float *s = m_start;
+  float q[4] = {d[3] * s[0] + d[0] * s[3] + d[1] * s[2] - d[2] * s[1],
+                d[3] * s[1] - d[0] * s[2] + d[1] * s[3] + d[2] * s[0],
+                d[3] * s[2] + d[0] * s[1] - d[1] * s[0] + d[2] * s[3],
+                d[3] * s[3] - d[0] * s[0] - d[1] * s[1] - d[2] * s[2]};
+  // renormalise so rounding doesn't build up over a long session
+  float len = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  if (len > 0.0f)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      m_orientation[i] = q[i] / len;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Arcball::reset()
+{
+  const float identity[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  std::copy(identity, identity + 4, m_orientation);
+  std::copy(identity, identity + 4, m_start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Arcball::project(float _x, float _y, float o_p[3]) const
+{
+  // the sphere fits the smaller side of the window, y is up
+  float radius = 0.5f * static_cast<float>(std::min(m_width, m_height));
+  float x = (_x - 0.5f * m_width) / radius;
+  float y = (0.5f * m_height - _y) / radius;
+  float d2 = x * x + y * y;
+  if (d2 <= 1.0f)
+  {
+    o_p[0] = x;
+    o_p[1] = y;
+    o_p[2] = std::sqrt(1.0f - d2);
+  }
+  else
+  {
+    float len = std::sqrt(d2);
+    o_p[0] = x / len;
+    o_p[1] = y / len;
+    o_p[2] = 0.0f;
+  }
+}
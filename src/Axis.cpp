@@ -1,82 +1,127 @@
 #include "Axis.h"
-#include <QDebug>
+#include "GeometryCache.h"
+#include <ngl/VAOFactory.h>
+#include <ngl/SimpleVAO.h>
+#include <cmath>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief number of segments around the shafts and arrow heads
+//----------------------------------------------------------------------------------------------------------------------
+constexpr int s_slices = 24;
 
 //----------------------------------------------------------------------------------------------------------------------
-Axis::Axis(std::string _shaderName, ngl::Real _scale )
+/// @brief two unit vectors perpendicular to the axis direction to sweep the circles with
+//----------------------------------------------------------------------------------------------------------------------
+void basis(const ngl::Vec3 &_dir, ngl::Vec3 &o_u, ngl::Vec3 &o_v)
+{
+  ngl::Vec3 up = std::abs(_dir.m_y) > 0.9f ? ngl::Vec3(1.0f, 0.0f, 0.0f) : ngl::Vec3(0.0f, 1.0f, 0.0f);
+  o_u = _dir.cross(up);
+  o_u.normalize();
+  o_v = _dir.cross(o_u);
+}
+
+void addVertex(std::vector<float> &_verts, const ngl::Vec3 &_p, const ngl::Vec3 &_colour)
+{
+  _verts.insert(_verts.end(), {_p.m_x, _p.m_y, _p.m_z, _colour.m_x, _colour.m_y, _colour.m_z});
+}
+
+ngl::Vec3 ring(const ngl::Vec3 &_u, const ngl::Vec3 &_v, int _i, ngl::Real _radius)
+{
+  ngl::Real theta = 2.0f * static_cast<ngl::Real>(M_PI) * _i / s_slices;
+  return (_u * std::cos(theta) + _v * std::sin(theta)) * _radius;
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+Axis::Axis(std::string _shaderName, ngl::Real _scale, GeometryCache *_cache )
 {
   m_shaderName=_shaderName;
   m_scale=_scale;
-  ngl::VAOPrimitives::createCylinder("nglAXISCylinder",0.02f,2,60,60);
-  ngl::VAOPrimitives::createCone("nglAXISCone",0.05f,0.2f,30,30);
+  std::string key="axis scale="+std::to_string(m_scale)+" slices="+std::to_string(s_slices);
+  if(_cache!=nullptr)
+  {
+    m_vao=_cache->load(key);
+    if(m_vao)
+    {
+      return;
+    }
+  }
+  // the geometry never changes so build all of it once in model space, each axis is
+  // a shaft from -scale to scale with an arrow head at both ends
+  const ngl::Vec3 axis[3]={{1.0f,0.0f,0.0f},{0.0f,1.0f,0.0f},{0.0f,0.0f,1.0f}};
+  std::vector<float> verts;
+  for(const auto &a : axis)
+  {
+    // the axis direction doubles as its colour
+    addCylinder(verts,a,-m_scale,m_scale,0.02f*m_scale,a);
+    addCone(verts,a,m_scale,0.4f*m_scale,0.05f*m_scale,a);
+    addCone(verts,a,-m_scale,-0.4f*m_scale,0.05f*m_scale,a);
+  }
+  m_vao=ngl::VAOFactory::createVAO(ngl::simpleVAO,GL_TRIANGLES);
+  m_vao->bind();
+  m_vao->setData(ngl::AbstractVAO::VertexData(verts.size()*sizeof(float),verts[0]));
+  m_vao->setVertexAttributePointer(0,3,GL_FLOAT,6*sizeof(float),0);
+  m_vao->setVertexAttributePointer(1,3,GL_FLOAT,6*sizeof(float),3);
+  m_vao->setNumIndices(verts.size()/6);
+  m_vao->unbind();
+  if(_cache!=nullptr)
+  {
+    _cache->store(key,m_vao.get());
+  }
 }
 
-void Axis::loadMatricesToShader(const ngl::Mat4 &_view, const ngl::Mat4 &_project)
+//----------------------------------------------------------------------------------------------------------------------
+void Axis::addCylinder(std::vector<float> &_verts, const ngl::Vec3 &_dir, ngl::Real _start, ngl::Real _end,
+                       ngl::Real _radius, const ngl::Vec3 &_colour)
 {
-  ngl::Mat4 MV;
-  ngl::Mat4 MVP;
-  ngl::Mat4 M;
-  M=m_globalMouseTx*m_transform.getMatrix();
-  MV=  _view*M;
-  MVP= _project*MV;
- // MVP= m_transform.getMatrix() * m_cam->getVPMatrix();
-  ngl::ShaderLib::setUniform("MVP",MVP);
+  ngl::Vec3 u,v;
+  basis(_dir,u,v);
+  ngl::Vec3 start=_dir*_start;
+  ngl::Vec3 end=_dir*_end;
+  for(int i=0; i<s_slices; ++i)
+  {
+    ngl::Vec3 r0=ring(u,v,i,_radius);
+    ngl::Vec3 r1=ring(u,v,i+1,_radius);
+    addVertex(_verts,start+r0,_colour);
+    addVertex(_verts,end+r0,_colour);
+    addVertex(_verts,end+r1,_colour);
+    addVertex(_verts,start+r0,_colour);
+    addVertex(_verts,end+r1,_colour);
+    addVertex(_verts,start+r1,_colour);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Axis::addCone(std::vector<float> &_verts, const ngl::Vec3 &_dir, ngl::Real _base, ngl::Real _height,
+                   ngl::Real _radius, const ngl::Vec3 &_colour)
+{
+  ngl::Vec3 u,v;
+  basis(_dir,u,v);
+  ngl::Vec3 base=_dir*_base;
+  ngl::Vec3 tip=_dir*(_base+_height);
+  for(int i=0; i<s_slices; ++i)
+  {
+    ngl::Vec3 r0=ring(u,v,i,_radius);
+    ngl::Vec3 r1=ring(u,v,i+1,_radius);
+    // side and base cap
+    addVertex(_verts,base+r0,_colour);
+    addVertex(_verts,tip,_colour);
+    addVertex(_verts,base+r1,_colour);
+    addVertex(_verts,base,_colour);
+    addVertex(_verts,base+r1,_colour);
+    addVertex(_verts,base+r0,_colour);
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void Axis::draw(const ngl::Mat4 &_view, const ngl::Mat4 &_project, const ngl::Mat4 &_globalTx )
 {
-  m_globalMouseTx=_globalTx;
   ngl::ShaderLib::use(m_shaderName);
-  // Rotation based on the mouse position for our global
-  // transform
-
-  ngl::ShaderLib::setUniform("Colour",1.0f,0.0f,0.0f,1.0f);
-  m_transform.setScale(m_scale,m_scale,m_scale*2);
-  m_transform.setPosition(ngl::Vec3(m_scale,0,0));
-  m_transform.setRotation(0,90,0);
-  loadMatricesToShader(_view,_project);
-  ngl::VAOPrimitives::draw("nglAXISCylinder");
-
-  m_transform.setPosition(ngl::Vec3(m_scale,0,0));
-  m_transform.setRotation(0,90,0);
-  loadMatricesToShader(_view,_project);
-  ngl::VAOPrimitives::draw("nglAXISCone");
-  m_transform.setPosition(ngl::Vec3(-m_scale,0,0));
-  m_transform.setRotation(0,-90,0);
-  loadMatricesToShader(_view,_project);
-  ngl::VAOPrimitives::draw("nglAXISCone");
-
-  // y axis
-   ngl::ShaderLib::setUniform("Colour",0.0f,1.0f,0.0f,1.0f);
-   m_transform.setScale(m_scale,m_scale,m_scale*2);
-   m_transform.setPosition(ngl::Vec3(0,-m_scale,0));
-   m_transform.setRotation(90,0,0);
-   loadMatricesToShader(_view,_project);
-   ngl::VAOPrimitives::draw("nglAXISCylinder");
-
-   m_transform.setPosition(ngl::Vec3(0,m_scale,0));
-   m_transform.setRotation(-90,0,0);
-   loadMatricesToShader(_view,_project);
-   ngl::VAOPrimitives::draw("nglAXISCone");
-   m_transform.setPosition(ngl::Vec3(0,-m_scale,0));
-   m_transform.setRotation(90,0,0);
-   loadMatricesToShader(_view,_project);
-   ngl::VAOPrimitives::draw("nglAXISCone");
-
-//     // z axis
-   ngl::ShaderLib::setUniform("Colour",0.0f,0.0f,1.0f,1.0f);
-   m_transform.setScale(m_scale,m_scale,m_scale*2);
-   m_transform.setPosition(ngl::Vec3(0,0,m_scale));
-   m_transform.setRotation(0,0,-90);
-   loadMatricesToShader(_view,_project);
-   ngl::VAOPrimitives::draw("nglAXISCylinder");
-
-   m_transform.setPosition(ngl::Vec3(0,0,m_scale));
-   loadMatricesToShader(_view,_project);
-   ngl::VAOPrimitives::draw("nglAXISCone");
-   m_transform.setPosition(ngl::Vec3(0,0,-m_scale));
-   m_transform.setRotation(180,0,0);
-   loadMatricesToShader(_view,_project);
-   ngl::VAOPrimitives::draw("nglAXISCone");
-
+  // only the global mouse transform moves the axis so this is the only upload
+  ngl::ShaderLib::setUniform("MVP",_project*_view*_globalTx);
+  m_vao->bind();
+  m_vao->draw();
+  m_vao->unbind();
 }
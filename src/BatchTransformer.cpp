@@ -0,0 +1,507 @@
+/// @file BatchTransformer.cpp
+/// @brief implementation of the streaming parameter file to matrix file transform
+#include "BatchTransformer.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+
+namespace
+{
+const char s_magic[4] = {'A', 'T', 'B', 'R'};
+constexpr uint32_t s_version = 1;
+constexpr size_t s_orders = sizeof(s_matrixOrders) / sizeof(s_matrixOrders[0]);
+static_assert(sizeof(BatchTransformer::Record) == 56, "records are written packed");
+
+//----------------------------------------------------------------------------------------------------------------------
+inline bool isSpace(char _c)
+{
+  return _c == ' ' || _c == '\t' || _c == '\r';
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+inline void skipSpace(const char *&_p, const char *_end)
+{
+  while (_p < _end && isSpace(*_p))
+  {
+    ++_p;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a value may be separated from the one before by a comma and or spaces
+//----------------------------------------------------------------------------------------------------------------------
+inline void skipSeparator(const char *&_p, const char *_end)
+{
+  skipSpace(_p, _end);
+  if (_p < _end && *_p == ',')
+  {
+    ++_p;
+  }
+  skipSpace(_p, _end);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief from_chars is correctly rounded so a csv value gives the same float as it would in any
+/// other tool, unlike the faster approximate parse the mesh importer uses
+//----------------------------------------------------------------------------------------------------------------------
+bool parseFloat(const char *&_p, const char *_end, float &o_value)
+{
+  skipSeparator(_p, _end);
+  if (_p < _end && *_p == '+')
+  {
+    ++_p;
+  }
+  auto result = std::from_chars(_p, _end, o_value);
+  if (result.ec != std::errc())
+  {
+    return false;
+  }
+  _p = result.ptr;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the order as its index or its matrixOrderName
+//----------------------------------------------------------------------------------------------------------------------
+bool parseOrder(const char *&_p, const char *_end, int32_t &o_order)
+{
+  const char *token = _p;
+  while (_p < _end && *_p != ',' && !isSpace(*_p))
+  {
+    ++_p;
+  }
+  const size_t length = static_cast<size_t>(_p - token);
+  auto result = std::from_chars(token, _p, o_order);
+  if (result.ec == std::errc() && result.ptr == _p)
+  {
+    return true;
+  }
+  for (size_t i = 0; i < s_orders; ++i)
+  {
+    const char *name = matrixOrderName(s_matrixOrders[i]);
+    if (std::strlen(name) == length && std::memcmp(name, token, length) == 0)
+    {
+      o_order = static_cast<int32_t>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the shortest text that reads back as exactly _value
+//----------------------------------------------------------------------------------------------------------------------
+inline void appendFloat(std::string &o_text, float _value)
+{
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), _value);
+  o_text.append(buffer, result.ptr);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+inline double secondsSince(std::chrono::steady_clock::time_point _start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool endsWithCSV(const std::string &_fileName)
+{
+  if (_fileName.size() < 4)
+  {
+    return false;
+  }
+  std::string extension = _fileName.substr(_fileName.size() - 4);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+  return extension == ".csv";
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the input range of a chunk and the buffers it is parsed and composed into, the chunks
+/// are reused so the buffers only grow for the first few
+//----------------------------------------------------------------------------------------------------------------------
+struct BatchTransformer::Chunk
+{
+  const char *begin = nullptr;
+  const char *end = nullptr;
+  uint64_t first = 0;                ///< the number of its first record, or line for csv, from 1
+  std::vector<Record> records;
+  TransformParams grouped;           ///< the records sorted by order
+  std::vector<uint32_t> groupedIndex; ///< where each record went in grouped
+  std::vector<float> composed;       ///< the matrices in grouped order
+  std::vector<float> matrices;       ///< and in record order
+  std::string text;
+  double computeSeconds = 0.0;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+BatchTransformer::BatchTransformer(ThreadPool &_pool, size_t _chunkRecords) : m_pool(_pool),
+  m_chunkRecords(std::max<size_t>(_chunkRecords, 1))
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BatchTransformer::writeHeader(std::ostream &_out)
+{
+  const uint32_t header[3] = {s_version, static_cast<uint32_t>(sizeof(Record)), 0};
+  _out.write(s_magic, sizeof(s_magic));
+  _out.write(reinterpret_cast<const char *>(header), sizeof(header));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BatchTransformer::appendCSV(std::string &o_text, const Record &_record)
+{
+  o_text += matrixOrderName(static_cast<MatrixOrder>(_record.order));
+  for (auto v : {_record.translate[0], _record.translate[1], _record.translate[2],
+                 _record.rotate[0], _record.rotate[1], _record.rotate[2],
+                 _record.scale[0], _record.scale[1], _record.scale[2],
+                 _record.euler[0], _record.euler[1], _record.euler[2], _record.euler[3]})
+  {
+    o_text += ',';
+    appendFloat(o_text, v);
+  }
+  o_text += '\n';
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BatchTransformer::process(Chunk &_chunk, bool _binary, bool _csvOut) const
+{
+  auto start = std::chrono::steady_clock::now();
+  auto &records = _chunk.records;
+  records.clear();
+  if (_binary)
+  {
+    records.resize(static_cast<size_t>(_chunk.end - _chunk.begin) / sizeof(Record));
+    std::memcpy(records.data(), _chunk.begin, records.size() * sizeof(Record));
+  }
+  else
+  {
+    uint64_t line = _chunk.first;
+    for (const char *p = _chunk.begin; p < _chunk.end; ++line)
+    {
+      auto newLine = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(_chunk.end - p)));
+      const char *eol = newLine != nullptr ? newLine : _chunk.end;
+      skipSpace(p, eol);
+      if (p == eol || *p == '#' || (line == 1 && eol - p >= 5 && std::memcmp(p, "order", 5) == 0))
+      {
+        p = eol + 1;
+        continue;
+      }
+      Record r;
+      float values[13];
+      if (!parseOrder(p, eol, r.order) || r.order < 0 || r.order >= static_cast<int32_t>(s_orders))
+      {
+        throw std::runtime_error("line " + std::to_string(line) + ": unknown matrix order");
+      }
+      for (int v = 0; v < 13; ++v)
+      {
+        if (!parseFloat(p, eol, values[v]))
+        {
+          throw std::runtime_error("line " + std::to_string(line) + ": expected 13 values after the order");
+        }
+      }
+      skipSpace(p, eol);
+      if (p != eol)
+      {
+        throw std::runtime_error("line " + std::to_string(line) + ": more than 13 values after the order");
+      }
+      static_assert(offsetof(Record, euler) + sizeof(r.euler) - offsetof(Record, translate) == sizeof(values),
+                    "the csv values are in the same order as the record");
+      std::memcpy(reinterpret_cast<char *>(&r) + offsetof(Record, translate), values, sizeof(values));
+      records.push_back(r);
+      p = eol + 1;
+    }
+  }
+
+  // sort the records by order so each order is one run for the simd kernels
+  const size_t count = records.size();
+  size_t offsets[s_orders + 1] = {};
+  for (size_t i = 0; i < count; ++i)
+  {
+    // csv orders were checked as they were parsed
+    const int32_t order = records[i].order;
+    if (order < 0 || order >= static_cast<int32_t>(s_orders))
+    {
+      throw std::runtime_error("record " + std::to_string(_chunk.first + i) + ": matrix order " + std::to_string(order) +
+                               " out of range");
+    }
+    ++offsets[order + 1];
+  }
+  for (size_t o = 0; o < s_orders; ++o)
+  {
+    offsets[o + 1] += offsets[o];
+  }
+  auto &grouped = _chunk.grouped;
+  grouped.resize(count);
+  _chunk.groupedIndex.resize(count);
+  size_t next[s_orders];
+  std::copy(offsets, offsets + s_orders, next);
+  for (size_t i = 0; i < count; ++i)
+  {
+    const Record &r = records[i];
+    const size_t g = next[r.order]++;
+    _chunk.groupedIndex[i] = static_cast<uint32_t>(g);
+    grouped.tx[g] = r.translate[0];
+    grouped.ty[g] = r.translate[1];
+    grouped.tz[g] = r.translate[2];
+    grouped.rx[g] = r.rotate[0];
+    grouped.ry[g] = r.rotate[1];
+    grouped.rz[g] = r.rotate[2];
+    grouped.sx[g] = r.scale[0];
+    grouped.sy[g] = r.scale[1];
+    grouped.sz[g] = r.scale[2];
+    grouped.eulerAngle[g] = r.euler[0];
+    grouped.eulerX[g] = r.euler[1];
+    grouped.eulerY[g] = r.euler[2];
+    grouped.eulerZ[g] = r.euler[3];
+    // only the quaternion order reads the orientation, so the others skip making it
+    if (r.order == static_cast<int32_t>(MatrixOrder::QUATERNION))
+    {
+      float q[4];
+      TransformBatch::quaternionFromEuler(r.rotate[0], r.rotate[1], r.rotate[2], q);
+      grouped.setOrientation(g, q[0], q[1], q[2], q[3]);
+    }
+  }
+
+  _chunk.composed.resize(count * 16);
+  auto arrays = grouped.arrays();
+  bool oneOrder = false;
+  for (size_t o = 0; o < s_orders; ++o)
+  {
+    if (offsets[o + 1] > offsets[o])
+    {
+      TransformBatch::compose(s_matrixOrders[o], arrays, offsets[o], offsets[o + 1], _chunk.composed.data() + offsets[o] * 16,
+                              m_kernel);
+      oneOrder = offsets[o + 1] - offsets[o] == count;
+    }
+  }
+  // the grouped order is the record order when the chunk has only one order
+  if (oneOrder)
+  {
+    _chunk.matrices.swap(_chunk.composed);
+  }
+  else
+  {
+    _chunk.matrices.resize(count * 16);
+    for (size_t i = 0; i < count; ++i)
+    {
+      std::memcpy(&_chunk.matrices[i * 16], &_chunk.composed[_chunk.groupedIndex[i] * 16], 16 * sizeof(float));
+    }
+  }
+
+  if (_csvOut)
+  {
+    auto &text = _chunk.text;
+    text.clear();
+    text.reserve(count * 16 * 12);
+    for (size_t i = 0; i < count; ++i)
+    {
+      for (size_t e = 0; e < 16; ++e)
+      {
+        appendFloat(text, _chunk.matrices[i * 16 + e]);
+        text += e < 15 ? ',' : '\n';
+      }
+    }
+  }
+  _chunk.computeSeconds = secondsSince(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool BatchTransformer::transform(const std::string &_input, const std::string &_output)
+{
+  m_stats = Stats();
+  m_stats.threads = m_pool.size();
+  m_error.clear();
+  auto start = std::chrono::steady_clock::now();
+  MappedFile file(_input);
+  if (!file.isOpen())
+  {
+    m_error = "unable to open " + _input;
+    return false;
+  }
+  m_stats.inputBytes = file.size();
+  const char *base = file.data();
+  const char *end = base + file.size();
+  const bool binary = file.size() >= HeaderSize && std::memcmp(base, s_magic, sizeof(s_magic)) == 0;
+  if (binary)
+  {
+    uint32_t header[3];
+    std::memcpy(header, base + sizeof(s_magic), sizeof(header));
+    if (header[0] != s_version || header[1] != sizeof(Record))
+    {
+      m_error = _input + " was written by a different version";
+      return false;
+    }
+    if ((file.size() - HeaderSize) % sizeof(Record) != 0)
+    {
+      m_error = _input + " ends in a partial record";
+      return false;
+    }
+  }
+  std::ofstream out(_output, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    m_error = "unable to create " + _output;
+    return false;
+  }
+  const bool csvOut = endsWithCSV(_output);
+  file.adviseSequential();
+
+  // the chunks go round from the reader to the workers to the writer and back to the reader,
+  // so the slowest stage sets the pace and the others wait on it
+  std::vector<Chunk> chunks(std::max<size_t>(m_inFlight != 0 ? m_inFlight : m_pool.size() * 2, 2));
+  std::vector<Chunk *> freeChunks;
+  for (auto &chunk : chunks)
+  {
+    freeChunks.push_back(&chunk);
+  }
+  std::queue<std::pair<Chunk *, std::future<void>>> queued;
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool reading = true;
+  std::exception_ptr error;
+
+  std::thread writer([&]()
+  {
+    for (;;)
+    {
+      auto waitStart = std::chrono::steady_clock::now();
+      std::pair<Chunk *, std::future<void>> next;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return !queued.empty() || !reading; });
+        if (queued.empty())
+        {
+          return;
+        }
+        next = std::move(queued.front());
+        queued.pop();
+      }
+      // after a failure the rest are still waited for as they use the chunks, but not written
+      try
+      {
+        next.second.get();
+        m_stats.writeWaitSeconds += secondsSince(waitStart);
+        if (!error)
+        {
+          auto writeStart = std::chrono::steady_clock::now();
+          const Chunk &chunk = *next.first;
+          if (csvOut)
+          {
+            out.write(chunk.text.data(), static_cast<std::streamsize>(chunk.text.size()));
+            m_stats.outputBytes += chunk.text.size();
+          }
+          else
+          {
+            out.write(reinterpret_cast<const char *>(chunk.matrices.data()),
+                      static_cast<std::streamsize>(chunk.matrices.size() * sizeof(float)));
+            m_stats.outputBytes += chunk.matrices.size() * sizeof(float);
+          }
+          if (!out)
+          {
+            throw std::runtime_error("unable to write " + _output);
+          }
+          m_stats.writeSeconds += secondsSince(writeStart);
+          m_stats.records += chunk.records.size();
+          m_stats.computeSeconds += chunk.computeSeconds;
+          ++m_stats.chunks;
+        }
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeChunks.push_back(next.first);
+      }
+      changed.notify_all();
+    }
+  });
+
+  const char *p = binary ? base + HeaderSize : base;
+  uint64_t first = 1;
+  while (p < end)
+  {
+    auto waitStart = std::chrono::steady_clock::now();
+    Chunk *chunk = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&]() { return !freeChunks.empty(); });
+      if (error)
+      {
+        break;
+      }
+      chunk = freeChunks.back();
+      freeChunks.pop_back();
+    }
+    m_stats.readWaitSeconds += secondsSince(waitStart);
+    const char *chunkEnd = end;
+    uint64_t count = 0;
+    if (binary)
+    {
+      count = std::min<uint64_t>(m_chunkRecords, static_cast<uint64_t>(end - p) / sizeof(Record));
+      chunkEnd = p + count * sizeof(Record);
+    }
+    else
+    {
+      // finding the lines touches every page, this is where a csv is read from disk
+      for (const char *q = p; count < m_chunkRecords && q < end; ++count)
+      {
+        auto newLine = static_cast<const char *>(std::memchr(q, '\n', static_cast<size_t>(end - q)));
+        q = newLine != nullptr ? newLine + 1 : end;
+        chunkEnd = q;
+      }
+    }
+    // start reading the next chunk while the workers compose this one
+    file.prefetch(static_cast<size_t>(chunkEnd - base), static_cast<size_t>(chunkEnd - p));
+    chunk->begin = p;
+    chunk->end = chunkEnd;
+    chunk->first = first;
+    first += count;
+    p = chunkEnd;
+    auto done = m_pool.submit([this, chunk, binary, csvOut]() { process(*chunk, binary, csvOut); });
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queued.emplace(chunk, std::move(done));
+    }
+    changed.notify_all();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    reading = false;
+  }
+  changed.notify_all();
+  writer.join();
+  out.close();
+  if (!error && out.fail())
+  {
+    error = std::make_exception_ptr(std::runtime_error("unable to write " + _output));
+  }
+  m_stats.seconds = secondsSince(start);
+  if (error)
+  {
+    try
+    {
+      std::rethrow_exception(error);
+    }
+    catch (const std::exception &e)
+    {
+      m_error = _input + ": " + e.what();
+    }
+    return false;
+  }
+  return true;
+}
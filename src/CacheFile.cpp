@@ -0,0 +1,72 @@
+/// @file CacheFile.cpp
+/// @brief implementation of the cache file helpers
+#include "CacheFile.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+//----------------------------------------------------------------------------------------------------------------------
+uint64_t hashBytes(const void *_data, size_t _size, uint64_t _seed)
+{
+  auto bytes = static_cast<const unsigned char *>(_data);
+  uint64_t hash = _seed;
+  for (size_t i = 0; i < _size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string hashToHex(uint64_t _hash)
+{
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(_hash));
+  return hex;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool writeCacheFile(const std::string &_path, std::initializer_list<CacheFilePart> _parts)
+{
+  std::error_code error;
+  auto path = std::filesystem::path(_path);
+  if (path.has_parent_path())
+  {
+    std::filesystem::create_directories(path.parent_path(), error);
+  }
+  auto temp = _path + ".tmp";
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    for (auto &part : _parts)
+    {
+      out.write(static_cast<const char *>(part.data), static_cast<std::streamsize>(part.size));
+    }
+    if (!out)
+    {
+      out.close();
+      std::filesystem::remove(temp, error);
+      return false;
+    }
+  }
+  std::filesystem::rename(temp, _path, error);
+  if (error)
+  {
+    std::filesystem::remove(temp, error);
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void clearCacheFiles(const std::string &_directory, const std::string &_extension)
+{
+  std::error_code error;
+  for (auto &entry : std::filesystem::directory_iterator(_directory, error))
+  {
+    if (entry.path().extension() == _extension)
+    {
+      std::filesystem::remove(entry.path(), error);
+    }
+  }
+}
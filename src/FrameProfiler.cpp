@@ -0,0 +1,291 @@
+/// @file FrameProfiler.cpp
+/// @brief implementation of the frame stage timers
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+constexpr int s_cpuThread = 1;
+constexpr int s_gpuThread = 2;
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+FrameProfiler::FrameProfiler(std::initializer_list<const char *> _stages, size_t _historyFrames)
+  : m_epoch(std::chrono::steady_clock::now())
+{
+  for (auto name : _stages)
+  {
+    Stage stage;
+    stage.name = name;
+    stage.cpu.samples.resize(_historyFrames);
+    stage.gpu.samples.resize(_historyFrames);
+    m_stages.push_back(std::move(stage));
+  }
+  for (auto &f : m_queryFrames)
+  {
+    f.queries.resize(m_stages.size(), 0);
+    f.issued.resize(m_stages.size(), false);
+    f.startUs.resize(m_stages.size(), 0.0);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::initializeGL()
+{
+  for (auto &f : m_queryFrames)
+  {
+    glGenQueries(static_cast<GLsizei>(f.queries.size()), f.queries.data());
+  }
+  m_glReady = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::releaseGL()
+{
+  if (!m_glReady)
+  {
+    return;
+  }
+  for (auto &f : m_queryFrames)
+  {
+    glDeleteQueries(static_cast<GLsizei>(f.queries.size()), f.queries.data());
+    f.pending = false;
+  }
+  m_glReady = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+double FrameProfiler::nowUs() const
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::beginFrame()
+{
+  ++m_frame;
+  m_frameStartUs = nowUs();
+  if (!m_glReady)
+  {
+    return;
+  }
+  // the queries for this slot were issued QueryLatency frames ago, read them now if
+  // they are ready rather than wait as re-using them discards the old results
+  auto &slot = m_queryFrames[m_frame % QueryLatency];
+  if (slot.pending)
+  {
+    collect(slot);
+  }
+  slot.frame = m_frame;
+  std::fill(slot.issued.begin(), slot.issued.end(), false);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::endFrame()
+{
+  if (m_glReady)
+  {
+    auto &slot = m_queryFrames[m_frame % QueryLatency];
+    slot.pending = std::find(slot.issued.begin(), slot.issued.end(), true) != slot.issued.end();
+  }
+  if (m_tracing)
+  {
+    record({"frame " + std::to_string(m_frame), 'X', s_cpuThread, m_frameStartUs, nowUs() - m_frameStartUs});
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::beginStage(size_t _stage)
+{
+  m_stages[_stage].startUs = nowUs();
+  if (m_glReady)
+  {
+    auto &slot = m_queryFrames[m_frame % QueryLatency];
+    slot.issued[_stage] = true;
+    slot.startUs[_stage] = m_stages[_stage].startUs;
+    glBeginQuery(GL_TIME_ELAPSED, slot.queries[_stage]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::endStage(size_t _stage)
+{
+  if (m_glReady)
+  {
+    glEndQuery(GL_TIME_ELAPSED);
+  }
+  auto &stage = m_stages[_stage];
+  double durationUs = nowUs() - stage.startUs;
+  stage.cpu.push(durationUs / 1000.0);
+  if (m_tracing)
+  {
+    record({stage.name, 'X', s_cpuThread, stage.startUs, durationUs});
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::collect(QueryFrame &_frame)
+{
+  _frame.pending = false;
+  // the queries finish in order so if the last one is ready they all are
+  for (size_t i = _frame.issued.size(); i-- > 0;)
+  {
+    if (_frame.issued[i])
+    {
+      GLint available = 0;
+      glGetQueryObjectiv(_frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available)
+      {
+        ++m_droppedGPUFrames;
+        return;
+      }
+      break;
+    }
+  }
+  double frameMs = 0.0;
+  for (size_t i = 0; i < _frame.issued.size(); ++i)
+  {
+    if (!_frame.issued[i])
+    {
+      continue;
+    }
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(_frame.queries[i], GL_QUERY_RESULT, &ns);
+    m_stages[i].gpu.push(static_cast<double>(ns) / 1.0e6);
+    frameMs += static_cast<double>(ns) / 1.0e6;
+    if (m_tracing)
+    {
+      // GL_TIME_ELAPSED only gives the duration, so the gpu events are placed at the time the
+      // cpu issued the work which keeps them lined up with the stage that caused them
+      record({m_stages[i].name, 'X', s_gpuThread, _frame.startUs[i], static_cast<double>(ns) / 1000.0});
+    }
+  }
+  m_lastGPUFrameMs = frameMs;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::mark(const char *_name)
+{
+  if (m_tracing)
+  {
+    record({_name, 'i', s_cpuThread, nowUs(), 0.0});
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::History::push(double _value)
+{
+  if (samples.empty())
+  {
+    return;
+  }
+  samples[next] = _value;
+  next = (next + 1) % samples.size();
+  count = std::min(count + 1, samples.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<double> FrameProfiler::History::ordered() const
+{
+  std::vector<double> out;
+  out.reserve(count);
+  size_t first = (next + samples.size() - count) % std::max(samples.size(), size_t(1));
+  for (size_t i = 0; i < count; ++i)
+  {
+    out.push_back(samples[(first + i) % samples.size()]);
+  }
+  return out;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+double FrameProfiler::average(const History &_history)
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < _history.count; ++i)
+  {
+    sum += _history.samples[i];
+  }
+  return _history.count == 0 ? 0.0 : sum / _history.count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+double FrameProfiler::maximum(const History &_history)
+{
+  double worst = 0.0;
+  for (size_t i = 0; i < _history.count; ++i)
+  {
+    worst = std::max(worst, _history.samples[i]);
+  }
+  return worst;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string FrameProfiler::summary() const
+{
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(3);
+  for (size_t i = 0; i < m_stages.size(); ++i)
+  {
+    out << (i == 0 ? "" : "  ") << m_stages[i].name << ' ' << averageCPU(i) << '/' << averageGPU(i);
+  }
+  out << " ms cpu/gpu";
+  return out.str();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::startTrace()
+{
+  std::lock_guard<std::mutex> lock(m_traceMutex);
+  m_trace.clear();
+  m_tracing = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void FrameProfiler::record(TraceEvent _event)
+{
+  std::lock_guard<std::mutex> lock(m_traceMutex);
+  // tracing may have stopped since the caller checked
+  if (m_tracing)
+  {
+    m_trace.push_back(std::move(_event));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool FrameProfiler::stopTrace(const std::string &_fileName)
+{
+  std::vector<TraceEvent> events;
+  {
+    std::lock_guard<std::mutex> lock(m_traceMutex);
+    m_tracing = false;
+    events.swap(m_trace);
+  }
+  std::ofstream out(_fileName);
+  if (!out.is_open())
+  {
+    return false;
+  }
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << s_cpuThread << ", \"args\": {\"name\": \"cpu\"}},\n";
+  out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << s_gpuThread << ", \"args\": {\"name\": \"gpu\"}}";
+  for (auto &e : events)
+  {
+    out << ",\n{\"name\": \"" << e.name << "\", \"ph\": \"" << e.phase << "\", \"pid\": 1, \"tid\": " << e.thread
+        << ", \"ts\": " << e.startUs;
+    if (e.phase == 'X')
+    {
+      out << ", \"dur\": " << e.durationUs;
+    }
+    else
+    {
+      out << ", \"s\": \"g\"";
+    }
+    out << '}';
+  }
+  out << "\n]}\n";
+  return true;
+}
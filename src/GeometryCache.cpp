@@ -0,0 +1,275 @@
+/// @file GeometryCache.cpp
+/// @brief implementation of the on disk vertex buffer cache
+#include "GeometryCache.h"
+#include "CacheFile.h"
+#include "StreamingVAO.h"
+#include <ngl/VAOPrimitives.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+constexpr char s_magic[4] = {'N', 'G', 'L', 'G'};
+constexpr uint32_t s_byteOrder = 0x01020304;
+constexpr uint32_t s_maxAttributes = 16;
+constexpr size_t s_dataAlignment = 16;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the start of every entry, followed by the key then the vertex data at dataOffset
+//----------------------------------------------------------------------------------------------------------------------
+struct Header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t mode;
+  uint32_t keyBytes;
+  uint32_t attributeCount;
+  uint64_t vertices;
+  uint64_t dataOffset;
+  uint64_t dataBytes;
+  GeometryCache::Attribute attributes[s_maxAttributes];
+};
+
+double secondsSince(std::chrono::steady_clock::time_point _start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+GeometryCache::GeometryCache(std::string _directory) : m_directory(std::move(_directory))
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string GeometryCache::fileName(const std::string &_key) const
+{
+  // keep the readable part of the key so the directory can be inspected by hand
+  std::string name;
+  for (char c : _key.substr(0, _key.find(' ')))
+  {
+    name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+  }
+  return (std::filesystem::path(m_directory) / (name + "-" + hashToHex(hashString(_key)) + ".geo")).string();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool GeometryCache::read(const std::string &_key, Entry &o_entry) const
+{
+  if (!enabled() || !o_entry.file.open(fileName(_key)) || o_entry.file.size() < sizeof(Header))
+  {
+    return false;
+  }
+  const auto &file = o_entry.file;
+  Header header;
+  std::memcpy(&header, file.data(), sizeof(Header));
+  bool valid = std::memcmp(header.magic, s_magic, sizeof(s_magic)) == 0 && header.version == Version &&
+               header.byteOrder == s_byteOrder && header.attributeCount <= s_maxAttributes &&
+               header.keyBytes == _key.size() && sizeof(Header) + header.keyBytes <= file.size() &&
+               std::memcmp(file.data() + sizeof(Header), _key.data(), _key.size()) == 0 &&
+               header.dataOffset <= file.size() && header.dataBytes <= file.size() - header.dataOffset;
+  if (!valid)
+  {
+    o_entry.file.close();
+    return false;
+  }
+  o_entry.mode = static_cast<GLenum>(header.mode);
+  o_entry.vertices = header.vertices;
+  o_entry.attributes.assign(header.attributes, header.attributes + header.attributeCount);
+  o_entry.data = file.data() + header.dataOffset;
+  o_entry.bytes = header.dataBytes;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GeometryCache::setLayout(ngl::AbstractVAO *_vao, const Entry &_entry)
+{
+  for (const auto &a : _entry.attributes)
+  {
+    _vao->setVertexAttributePointer(a.location, static_cast<GLint>(a.size), a.type, static_cast<GLsizei>(a.stride),
+                                    a.offset / sizeof(GLfloat), a.normalised != 0);
+  }
+  _vao->setNumIndices(_entry.vertices);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::unique_ptr<ngl::AbstractVAO> GeometryCache::createVAO(const Entry &_entry, GLuint _buffer)
+{
+  auto vao = std::make_unique<StreamingVAO>(_entry.mode);
+  vao->bind();
+  vao->adoptBuffer(_buffer);
+  setLayout(vao.get(), _entry);
+  vao->unbind();
+  return vao;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::unique_ptr<ngl::AbstractVAO> GeometryCache::load(const std::string &_key)
+{
+  if (!enabled())
+  {
+    return nullptr;
+  }
+  auto start = std::chrono::steady_clock::now();
+  Entry entry;
+  if (!read(_key, entry))
+  {
+    ++m_stats.misses;
+    return nullptr;
+  }
+  auto vao = std::make_unique<StreamingVAO>(entry.mode);
+  vao->bind();
+  vao->allocate(entry.bytes);
+  vao->setSubData(0, entry.bytes, entry.data);
+  setLayout(vao.get(), entry);
+  vao->unbind();
+  ++m_stats.hits;
+  m_stats.bytesRead += entry.file.size();
+  m_stats.hitSeconds += secondsSince(start);
+  return vao;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool GeometryCache::readBack(ngl::AbstractVAO *_vao, std::vector<Attribute> &o_attributes, std::vector<char> &o_data)
+{
+  // the layout is read back from the VAO itself rather than assumed so anything drawn with
+  // glDrawArrays from a single buffer can be used
+  o_attributes.clear();
+  _vao->bind();
+  GLint elements = 0;
+  glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elements);
+  GLint maxAttributes = 0;
+  glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttributes);
+  GLint buffer = 0;
+  bool usable = elements == 0;
+  for (GLuint i = 0; usable && i < std::min(static_cast<GLuint>(maxAttributes), s_maxAttributes); ++i)
+  {
+    GLint active = 0;
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &active);
+    if (!active)
+    {
+      continue;
+    }
+    GLint attributeBuffer = 0;
+    GLint size = 0;
+    GLint type = 0;
+    GLint stride = 0;
+    GLint normalised = 0;
+    GLint integer = 0;
+    GLint divisor = 0;
+    void *pointer = nullptr;
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &attributeBuffer);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &normalised);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+    glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_DIVISOR, &divisor);
+    glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+    auto offset = reinterpret_cast<uintptr_t>(pointer);
+    // per instance data, integer attributes and a second buffer can't be rebuilt by load
+    if (attributeBuffer == 0 || (buffer != 0 && attributeBuffer != buffer) || integer || divisor != 0 ||
+        offset % sizeof(GLfloat) != 0)
+    {
+      usable = false;
+      break;
+    }
+    buffer = attributeBuffer;
+    o_attributes.push_back({i, static_cast<uint32_t>(size), static_cast<uint32_t>(type), static_cast<uint32_t>(stride),
+                            static_cast<uint32_t>(offset), static_cast<uint32_t>(normalised)});
+  }
+  _vao->unbind();
+  if (!usable || buffer == 0)
+  {
+    return false;
+  }
+  GLint bytes = 0;
+  glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(buffer));
+  glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &bytes);
+  o_data.resize(static_cast<size_t>(bytes));
+  glGetBufferSubData(GL_ARRAY_BUFFER, 0, bytes, o_data.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool GeometryCache::store(const std::string &_key, ngl::AbstractVAO *_vao)
+{
+  if (!enabled() || _vao == nullptr)
+  {
+    return false;
+  }
+  auto start = std::chrono::steady_clock::now();
+  Header header = {};
+  std::memcpy(header.magic, s_magic, sizeof(s_magic));
+  header.version = Version;
+  header.byteOrder = s_byteOrder;
+  header.mode = _vao->getMode();
+  header.vertices = _vao->numIndices();
+  header.keyBytes = static_cast<uint32_t>(_key.size());
+
+  std::vector<Attribute> attributes;
+  std::vector<char> data;
+  if (!readBack(_vao, attributes, data))
+  {
+    return false;
+  }
+  header.attributeCount = static_cast<uint32_t>(attributes.size());
+  std::copy(attributes.begin(), attributes.end(), header.attributes);
+  header.dataBytes = data.size();
+  header.dataOffset = (sizeof(Header) + _key.size() + s_dataAlignment - 1) / s_dataAlignment * s_dataAlignment;
+  const char padding[s_dataAlignment] = {};
+  if (!writeCacheFile(fileName(_key), {{&header, sizeof(Header)},
+                                       {_key.data(), _key.size()},
+                                       {padding, header.dataOffset - sizeof(Header) - _key.size()},
+                                       {data.data(), data.size()}}))
+  {
+    return false;
+  }
+  m_stats.bytesWritten += header.dataOffset + header.dataBytes;
+  m_stats.missSeconds += secondsSince(start);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool GeometryCache::createPrimitive(const std::string &_name, const std::string &_params,
+                                    const std::function<void()> &_create)
+{
+  auto key = primitiveKey(_name, _params);
+  if (auto vao = load(key))
+  {
+    ngl::VAOPrimitives::addToPrimitives(_name, std::move(vao));
+    return true;
+  }
+  auto start = std::chrono::steady_clock::now();
+  _create();
+  m_stats.missSeconds += secondsSince(start);
+  store(key, ngl::VAOPrimitives::getVAOFromName(_name));
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GeometryCache::clear()
+{
+  if (!enabled())
+  {
+    return;
+  }
+  clearCacheFiles(m_directory, ".geo");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string GeometryCache::summary() const
+{
+  std::ostringstream out;
+  out << "geometry cache " << m_stats.hits << " hits (" << m_stats.hitSeconds * 1000.0 << " ms, "
+      << m_stats.bytesRead / 1024 << " KiB) " << m_stats.misses << " misses (" << m_stats.missSeconds * 1000.0
+      << " ms)";
+  return out.str();
+}
@@ -0,0 +1,215 @@
+/// @file InstanceBVH.cpp
+/// @brief implementation of the instance bounding volume hierarchy
+#include "InstanceBVH.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+namespace
+{
+double secondsSince(std::chrono::steady_clock::time_point _start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+constexpr uint32_t s_noParent = ~0u;
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+void InstanceBVH::build(const Aabb *_boxes, size_t _count)
+{
+  auto start = std::chrono::steady_clock::now();
+  m_nodes.clear();
+  m_parent.clear();
+  m_indices.resize(_count);
+  std::iota(m_indices.begin(), m_indices.end(), 0u);
+  m_leafOf.resize(_count);
+  m_slotOf.resize(_count);
+  m_boxes.resize(_count);
+  if (_count != 0)
+  {
+    std::vector<float> centres(_count * 3);
+    for (size_t i = 0; i < _count; ++i)
+    {
+      for (int a = 0; a < 3; ++a)
+      {
+        centres[i * 3 + a] = _boxes[i].centre(a);
+      }
+    }
+    m_nodes.reserve(2 * (_count / LeafSize + 1));
+    m_parent.reserve(m_nodes.capacity());
+    buildNode(0, static_cast<uint32_t>(_count), s_noParent, centres);
+    for (size_t slot = 0; slot < _count; ++slot)
+    {
+      m_slotOf[m_indices[slot]] = static_cast<uint32_t>(slot);
+      m_boxes[slot] = _boxes[m_indices[slot]];
+    }
+    for (size_t n = m_nodes.size(); n-- > 0;)
+    {
+      refitNode(static_cast<uint32_t>(n));
+    }
+  }
+  ++m_stats.builds;
+  m_stats.buildSeconds += secondsSince(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+uint32_t InstanceBVH::buildNode(uint32_t _first, uint32_t _count, uint32_t _parent, const std::vector<float> &_centres)
+{
+  const auto index = static_cast<uint32_t>(m_nodes.size());
+  m_nodes.push_back({Aabb::empty(), _first, _count, 0});
+  m_parent.push_back(_parent);
+  if (_count <= LeafSize)
+  {
+    for (uint32_t i = _first; i < _first + _count; ++i)
+    {
+      m_leafOf[m_indices[i]] = index;
+    }
+    return index;
+  }
+  // split at the median centre along the axis the centres are most spread over
+  float lo[3] = {_centres[m_indices[_first] * 3], _centres[m_indices[_first] * 3 + 1], _centres[m_indices[_first] * 3 + 2]};
+  float hi[3] = {lo[0], lo[1], lo[2]};
+  for (uint32_t i = _first + 1; i < _first + _count; ++i)
+  {
+    for (int a = 0; a < 3; ++a)
+    {
+      lo[a] = std::min(lo[a], _centres[m_indices[i] * 3 + a]);
+      hi[a] = std::max(hi[a], _centres[m_indices[i] * 3 + a]);
+    }
+  }
+  int axis = 0;
+  for (int a = 1; a < 3; ++a)
+  {
+    if (hi[a] - lo[a] > hi[axis] - lo[axis])
+    {
+      axis = a;
+    }
+  }
+  const uint32_t half = _count / 2;
+  std::nth_element(m_indices.begin() + _first, m_indices.begin() + _first + half, m_indices.begin() + _first + _count,
+                   [&](uint32_t _a, uint32_t _b) { return _centres[_a * 3 + axis] < _centres[_b * 3 + axis]; });
+  // the left child is always index + 1
+  buildNode(_first, half, index, _centres);
+  m_nodes[index].right = buildNode(_first + half, _count - half, index, _centres);
+  return index;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void InstanceBVH::refitNode(uint32_t _node)
+{
+  auto &node = m_nodes[_node];
+  if (node.right == 0)
+  {
+    node.box = Aabb::empty();
+    for (uint32_t i = node.first; i < node.first + node.count; ++i)
+    {
+      node.box.expand(m_boxes[i]);
+    }
+  }
+  else
+  {
+    node.box = m_nodes[_node + 1].box;
+    node.box.expand(m_nodes[node.right].box);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void InstanceBVH::refit(const Aabb *_boxes)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (size_t slot = 0; slot < m_indices.size(); ++slot)
+  {
+    m_boxes[slot] = _boxes[m_indices[slot]];
+  }
+  // children always come after their parent
+  for (size_t n = m_nodes.size(); n-- > 0;)
+  {
+    refitNode(static_cast<uint32_t>(n));
+  }
+  ++m_stats.refits;
+  m_stats.nodesRefit += m_nodes.size();
+  m_stats.refitSeconds += secondsSince(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void InstanceBVH::refit(const Aabb *_boxes, const uint32_t *_changed, size_t _count)
+{
+  // each walk is up to the depth of the tree, past about one change per eight nodes it is
+  // cheaper to visit every node once
+  if (_count > m_nodes.size() / 8)
+  {
+    refit(_boxes);
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  size_t visited = 0;
+  for (size_t c = 0; c < _count; ++c)
+  {
+    const uint32_t instance = _changed[c];
+    m_boxes[m_slotOf[instance]] = _boxes[instance];
+    // every node stays the union of its children as they are now, so a walk can stop at the
+    // first node it doesn't change, any later change below it walks through it again
+    for (uint32_t n = m_leafOf[instance]; n != s_noParent; n = m_parent[n])
+    {
+      const Aabb old = m_nodes[n].box;
+      refitNode(n);
+      ++visited;
+      if (m_nodes[n].box == old)
+      {
+        break;
+      }
+    }
+  }
+  ++m_stats.refits;
+  m_stats.nodesRefit += visited;
+  m_stats.refitSeconds += secondsSince(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void InstanceBVH::query(const Frustum &_frustum, std::vector<uint32_t> &o_visible)
+{
+  auto start = std::chrono::steady_clock::now();
+  o_visible.clear();
+  m_stack.clear();
+  if (!m_nodes.empty())
+  {
+    m_stack.push_back(0);
+  }
+  size_t visited = 0;
+  while (!m_stack.empty())
+  {
+    const uint32_t n = m_stack.back();
+    m_stack.pop_back();
+    ++visited;
+    const auto &node = m_nodes[n];
+    auto result = _frustum.classify(node.box);
+    if (result == Frustum::Result::OUTSIDE)
+    {
+      continue;
+    }
+    if (result == Frustum::Result::INSIDE)
+    {
+      // so is everything under it
+      o_visible.insert(o_visible.end(), m_indices.begin() + node.first, m_indices.begin() + node.first + node.count);
+    }
+    else if (node.right == 0)
+    {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i)
+      {
+        if (_frustum.visible(m_boxes[i]))
+        {
+          o_visible.push_back(m_indices[i]);
+        }
+      }
+    }
+    else
+    {
+      m_stack.push_back(node.right);
+      m_stack.push_back(n + 1);
+    }
+  }
+  ++m_stats.queries;
+  m_stats.nodesVisited += visited;
+  m_stats.querySeconds += secondsSince(start);
+}
@@ -0,0 +1,112 @@
+/// @file LodSelector.cpp
+/// @brief implementation of the screen size level of detail selection
+#include "LodSelector.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief instance counts smaller than this aren't worth splitting over the pool
+//----------------------------------------------------------------------------------------------------------------------
+constexpr size_t s_grain = 16384;
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+LodSelector::LodSelector(std::vector<float> _thresholds, float _hysteresis)
+  : m_thresholds(std::move(_thresholds)), m_hysteresis(_hysteresis)
+{
+  if (m_thresholds.size() >= MaxLevels)
+  {
+    m_thresholds.resize(MaxLevels - 1);
+  }
+  std::sort(m_thresholds.begin(), m_thresholds.end(), std::greater<float>());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+float LodSelector::screenSize(const Aabb &_mesh, const float *_model, const float *_clip, float _pixelScale)
+{
+  float centre[3];
+  float radiusSq = 0.0f;
+  for (int a = 0; a < 3; ++a)
+  {
+    centre[a] = _mesh.centre(a);
+    const float half = 0.5f * (_mesh.m_max[a] - _mesh.m_min[a]);
+    radiusSq += half * half;
+  }
+  // the sphere's radius grows by the longest column of the model matrix, which covers any
+  // non uniform scale whichever order it was applied in
+  float scaleSq = 0.0f;
+  float world[3];
+  for (int r = 0; r < 3; ++r)
+  {
+    const float *column = _model + r * 4;
+    scaleSq = std::max(scaleSq, column[0] * column[0] + column[1] * column[1] + column[2] * column[2]);
+    world[r] = _model[12 + r] + _model[r] * centre[0] + _model[4 + r] * centre[1] + _model[8 + r] * centre[2];
+  }
+  const float radius = std::sqrt(radiusSq * scaleSq);
+  const float w = _clip[3] * world[0] + _clip[7] * world[1] + _clip[11] * world[2] + _clip[15];
+  if (w <= radius)
+  {
+    return std::numeric_limits<float>::max();
+  }
+  return 2.0f * radius * _pixelScale / w;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+uint8_t LodSelector::select(float _pixels, uint8_t _current) const
+{
+  const size_t last = m_thresholds.size();
+  if (_current == NoLevel)
+  {
+    size_t level = 0;
+    while (level < last && _pixels < m_thresholds[level])
+    {
+      ++level;
+    }
+    return static_cast<uint8_t>(level);
+  }
+  size_t level = std::min<size_t>(_current, last);
+  while (level > 0 && _pixels >= m_thresholds[level - 1] * (1.0f + m_hysteresis))
+  {
+    --level;
+  }
+  while (level < last && _pixels < m_thresholds[level] * (1.0f - m_hysteresis))
+  {
+    ++level;
+  }
+  return static_cast<uint8_t>(level);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t LodSelector::select(const Aabb &_mesh, const float *_models, const uint32_t *_instances, size_t _count,
+                           const float *_clip, float _pixelScale, uint8_t *io_levels, ThreadPool *_pool) const
+{
+  std::atomic<size_t> changed{0};
+  auto range = [&](size_t _begin, size_t _end)
+  {
+    size_t local = 0;
+    for (size_t i = _begin; i < _end; ++i)
+    {
+      const size_t instance = _instances != nullptr ? _instances[i] : i;
+      const float pixels = screenSize(_mesh, _models + instance * 16, _clip, _pixelScale);
+      const uint8_t level = select(pixels, io_levels[instance]);
+      local += level != io_levels[instance];
+      io_levels[instance] = level;
+    }
+    changed += local;
+  };
+  if (_pool != nullptr && _count > s_grain)
+  {
+    _pool->parallelFor(_count, s_grain, range);
+  }
+  else
+  {
+    range(0, _count);
+  }
+  return changed;
+}
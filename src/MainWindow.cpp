@@ -4,12 +4,24 @@
 #include "ui_MainWindow.h"
 #include <QKeyEvent>
 #include <QColorDialog>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QSignalBlocker>
+#include <QStringList>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the timeline tick, about 60Hz, the playhead moves on exactly this much each tick
+//----------------------------------------------------------------------------------------------------------------------
+constexpr int s_timelineTickMs = 16;
+} // end anon namespace
 //----------------------------------------------------------------------------------------------------------------------
-MainWindow::MainWindow( QWidget *parent ) : QMainWindow(parent), m_ui(new Ui::MainWindow)
+MainWindow::MainWindow( QWidget *parent, bool _threaded ) : QMainWindow(parent), m_ui(new Ui::MainWindow)
 {
   // setup the user interface
   m_ui->setupUi(this);
-  m_gl = new NGLScene(this);
+  m_gl = new NGLScene(this, _threaded);
   m_ui->s_mainGridLayout->addWidget(m_gl, 0, 0, 6, 6);
 
   // the following code connects the ui components to the GL class
@@ -17,6 +29,7 @@ MainWindow::MainWindow( QWidget *parent ) : QMainWindow(parent), m_ui(new Ui::Ma
   connect(m_ui->m_vboSelection,SIGNAL(currentIndexChanged(int)),m_gl,SLOT(vboChanged(int )));
   /// connect the normal and vertexx tick boxes
   connect(m_ui->m_normals,SIGNAL(toggled(bool)),m_gl,SLOT(toggleNormals(bool)));
+  connect(m_ui->m_geometryShaderNormals,SIGNAL(toggled(bool)),m_gl,SLOT(toggleGeometryShaderNormals(bool)));
   /// connect the wireframe tick box
   connect(m_ui->m_wireframe,SIGNAL(toggled(bool)),m_gl,SLOT(toggleWireframe(bool)));
   connect(m_ui->m_sx,SIGNAL(valueChanged(double)),this,SLOT(setScale()));
@@ -61,6 +74,35 @@ MainWindow::MainWindow( QWidget *parent ) : QMainWindow(parent), m_ui(new Ui::Ma
   connect(m_ui->m_eulerXAxis,SIGNAL(valueChanged(double)),this,SLOT(setEuler()));
   connect(m_ui->m_eulerYAxis,SIGNAL(valueChanged(double)),this,SLOT(setEuler()));
   connect(m_ui->m_eulerZAxis,SIGNAL(valueChanged(double)),this,SLOT(setEuler()));
+  /// connect the instancing controls
+  connect(m_ui->m_instanced,SIGNAL(toggled(bool)),m_gl,SLOT(toggleInstanced(bool)));
+  connect(m_ui->m_instanceCount,SIGNAL(valueChanged(int)),m_gl,SLOT(setInstanceCount(int)));
+  // show the frame time in the status bar
+  connect(m_gl,SIGNAL(frameTime(double,double,int)),this,SLOT(showFrameTime(double,double,int)));
+  connect(m_ui->m_recordTrace,SIGNAL(toggled(bool)),this,SLOT(recordTrace(bool)));
+  m_gl->setPrefetch(m_ui->m_prefetch->isChecked());
+  connect(m_ui->m_prefetch,SIGNAL(toggled(bool)),m_gl,SLOT(setPrefetch(bool)));
+  m_gl->setArcball(m_ui->m_arcball->isChecked());
+  connect(m_ui->m_arcball,SIGNAL(toggled(bool)),m_gl,SLOT(setArcball(bool)));
+  m_gl->setFrustumCulling(m_ui->m_frustumCull->isChecked());
+  connect(m_ui->m_frustumCull,SIGNAL(toggled(bool)),m_gl,SLOT(setFrustumCulling(bool)));
+  m_gl->setLod(m_ui->m_lod->isChecked());
+  connect(m_ui->m_lod,SIGNAL(toggled(bool)),m_gl,SLOT(setLod(bool)));
+  connect(m_ui->m_software,SIGNAL(toggled(bool)),m_gl,SLOT(setSoftwareRendering(bool)));
+  // mesh import, the latest import report stays on the right of the status bar
+  m_importReport = new QLabel(this);
+  m_ui->statusbar->addPermanentWidget(m_importReport);
+  connect(m_ui->m_importMesh,SIGNAL(clicked()),this,SLOT(openMesh()));
+  connect(m_gl,SIGNAL(meshImported(QString,QString)),this,SLOT(meshImported(QString,QString)));
+  connect(m_gl,SIGNAL(meshImportFailed(QString)),this,SLOT(meshImportFailed(QString)));
+  // keyframe playback of the transform spin boxes
+  m_timelineTimer = new QTimer(this);
+  m_timelineTimer->setTimerType(Qt::PreciseTimer);
+  m_timelineTimer->setInterval(s_timelineTickMs);
+  connect(m_timelineTimer,SIGNAL(timeout()),this,SLOT(timelineTick()));
+  connect(m_ui->m_setKey,SIGNAL(clicked()),this,SLOT(setKey()));
+  connect(m_ui->m_clearKeys,SIGNAL(clicked()),this,SLOT(clearKeys()));
+  connect(m_ui->m_playTimeline,SIGNAL(toggled(bool)),this,SLOT(playTimeline(bool)));
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -90,6 +132,8 @@ void MainWindow::setRotate()
 //----------------------------------------------------------------------------------------------------------------------
 void MainWindow::reset()
 {
+  // the nine spin boxes and the mouse are one edit, the scene is rebuilt once at the commit
+  m_gl->beginEdit();
   m_ui->m_rx->setValue(0.0);
   m_ui->m_ry->setValue(0.0);
   m_ui->m_rz->setValue(0.0);
@@ -102,32 +146,24 @@ void MainWindow::reset()
   m_ui->m_normals->setChecked(false);
   m_ui->m_wireframe->setChecked(false);
   m_gl->resetMouse();
+  m_gl->commit();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void MainWindow::updateMatrix(ngl::Mat4 _m )
 {
   ngl::Real *data=_m.openGL();
-  m_ui->m_m00->setValue(data[0]);
-  m_ui->m_m10->setValue(data[1]);
-  m_ui->m_m20->setValue(data[2]);
-  m_ui->m_m30->setValue(data[3]);
-
-  m_ui->m_m01->setValue(data[4]);
-  m_ui->m_m11->setValue(data[5]);
-  m_ui->m_m21->setValue(data[6]);
-  m_ui->m_m31->setValue(data[7]);
-
-  m_ui->m_m02->setValue(data[8]);
-  m_ui->m_m12->setValue(data[9]);
-  m_ui->m_m22->setValue(data[10]);
-  m_ui->m_m32->setValue(data[11]);
-
-  m_ui->m_m03->setValue(data[12]);
-  m_ui->m_m13->setValue(data[13]);
-  m_ui->m_m23->setValue(data[14]);
-  m_ui->m_m33->setValue(data[15]);
-
+  // column major, as openGL() returns them
+  QDoubleSpinBox *boxes[16]={m_ui->m_m00,m_ui->m_m10,m_ui->m_m20,m_ui->m_m30,
+                             m_ui->m_m01,m_ui->m_m11,m_ui->m_m21,m_ui->m_m31,
+                             m_ui->m_m02,m_ui->m_m12,m_ui->m_m22,m_ui->m_m32,
+                             m_ui->m_m03,m_ui->m_m13,m_ui->m_m23,m_ui->m_m33};
+  for(int i=0; i<16; ++i)
+  {
+    // showing the matrix is not an edit of it, so no valueChanged goes back to the scene
+    QSignalBlocker block(boxes[i]);
+    boxes[i]->setValue(data[i]);
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -148,6 +184,8 @@ void MainWindow::keyPressEvent(QKeyEvent *_event  )
 
   // this method is called every time the main window recives a key event.
   // we then switch on the key value and set the camera in the GLWindow
+  // every spin box a key changes is part of one edit
+  m_gl->beginEdit();
   switch (_event->key())
   {
   case Qt::Key_Escape :{ QApplication::exit(EXIT_SUCCESS); break;}
@@ -177,8 +215,8 @@ void MainWindow::keyPressEvent(QKeyEvent *_event  )
 
   default : break;
   }
-  // finally update the GLWindow and re-draw
-  m_gl->update();
+  // finally commit the edit, which re-draws the GLWindow if anything changed
+  m_gl->commit();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -213,7 +251,8 @@ void MainWindow::setEuler()
 //----------------------------------------------------------------------------------------------------------------------
 void MainWindow::setTab(int _value )
 {
-  if(_value >2)
+  // the euler orders use the axis angle tab, the quaternion is made from the rotation angles
+  if(_value == 3 || _value == 4)
   {
     m_ui->s_rotateTabWidget->setCurrentIndex(1);
   }
@@ -222,4 +261,219 @@ void MainWindow::setTab(int _value )
     m_ui->s_rotateTabWidget->setCurrentIndex(0);
   }
 }
+
 //----------------------------------------------------------------------------------------------------------------------
+void MainWindow::showFrameTime(double _cpuMs, double _gpuMs, int _instances)
+{
+  // when threaded this can be a frame or two newer than _cpuMs
+  auto &report = m_gl->frameReport();
+  auto &stats = report.stats;
+  QString detail;
+  if (m_ui->m_instanced->isChecked())
+  {
+    auto &cull = report.cull;
+    detail = QString(" (%1 visible %2 culled, bvh refit %3 ms query %4 ms)")
+              .arg(cull.visible).arg(cull.culled).arg(cull.refitMs,0,'f',3).arg(cull.queryMs,0,'f',3);
+  }
+  // the triangles actually submitted and how many objects were drawn at each level
+  auto &lod = report.lod;
+  detail += QString("  %1 triangles").arg(lod.triangles);
+  if (!lod.objects.empty())
+  {
+    QStringList levels;
+    for (auto count : lod.objects)
+    {
+      levels << QString::number(count);
+    }
+    detail += QString(" (lod %1)").arg(levels.join('/'));
+  }
+  if (!report.loader.empty())
+  {
+    detail += "  " + QString::fromStdString(report.loader);
+  }
+  // how many setter calls were folded into each rebuild of the scene
+  detail += QString("  edits %1 in %2 commits, last %3").arg(stats.edits).arg(stats.commits).arg(stats.lastCommitEdits);
+  // from an edit to the frame showing it, and how long painting held up the gui
+  auto latency = m_gl->latencyStats();
+  detail += QString("  input %1 ms (max %2) gui %3 ms (max %4)")
+              .arg(latency.inputMs,0,'f',1).arg(latency.maxInputMs,0,'f',1)
+              .arg(latency.stallMs,0,'f',2).arg(latency.maxStallMs,0,'f',2);
+  if (m_gl->threaded())
+  {
+    detail += QString(" threaded, %1 frames dropped").arg(latency.framesDropped);
+  }
+  if (m_gl->recorder().isOpen())
+  {
+    detail += QString("  recording %1 commits %2 KB")
+                .arg(m_gl->recorder().records()).arg(m_gl->recorder().bytes() / 1024);
+  }
+  // the cpu rasterizer's stages and how the tiles were shared out
+  if (!report.software.empty())
+  {
+    detail += "  " + QString::fromStdString(report.software);
+  }
+  if (m_timelineTimer->isActive())
+  {
+    detail += QString("  timeline %1 s %2 transforms/s")
+                .arg(m_playhead,0,'f',2).arg(m_timeline.stats().transformsPerSecond(),0,'f',0);
+  }
+  QString frame = QString("%1 ms gpu %2").arg(_cpuMs,0,'f',3).arg(_gpuMs,0,'f',3);
+  // how long the geometry and shaders took to make when the scene was set up, it doesn't change after
+  if (!report.startup.empty())
+  {
+    frame += " (" + QString::fromStdString(report.startup) + ")";
+  }
+  m_ui->statusbar->showMessage(QString("frame %1 ms  instances %2%3  transform %4/%5  ubo %6/%7 rebuilt/reused  %8  %9")
+                               .arg(frame).arg(_instances).arg(detail)
+                               .arg(stats.transformRecomputes).arg(stats.transformSkipped)
+                               .arg(stats.uboRecomputes).arg(stats.uboSkipped)
+                               .arg(QString::fromStdString(report.ring))
+                               .arg(QString::fromStdString(report.profile)));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::recordTrace(bool _value)
+{
+  if (_value)
+  {
+    m_gl->profiler().startTrace();
+    return;
+  }
+  QString fileName = QFileDialog::getSaveFileName(this, "Save Chrome trace", "trace.json", "Trace files (*.json)");
+  if (fileName.isEmpty())
+  {
+    // throw the recording away
+    m_gl->profiler().stopTrace(std::string());
+  }
+  else if (!m_gl->profiler().stopTrace(fileName.toStdString()))
+  {
+    m_ui->statusbar->showMessage(QString("unable to write %1").arg(fileName));
+  }
+}
+//----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::importMesh(const QString &_fileName)
+{
+  m_gl->importMesh(_fileName);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::setSoftwareRendering(bool _value)
+{
+  m_ui->m_software->setChecked(_value);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MainWindow::startRecording(const QString &_fileName)
+{
+  return m_gl->startRecording(_fileName.toStdString());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::replay(const QStringList &_fileNames, bool _flatOut, const QString &_json)
+{
+  m_replay = new ParamReplay(m_gl, _flatOut, this);
+  for (auto &fileName : _fileNames)
+  {
+    m_replay->addSession(fileName.toStdString());
+  }
+  connect(m_replay, &ParamReplay::finished, this, [this, _json](bool _ok)
+          {
+            if (!_json.isEmpty() && !m_replay->writeJSON(_json.toStdString()))
+            {
+              _ok = false;
+            }
+            QApplication::exit(_ok ? EXIT_SUCCESS : EXIT_FAILURE);
+          });
+  // started from the event loop, once the window has been shown
+  QTimer::singleShot(0, m_replay, &ParamReplay::start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::openMesh()
+{
+  QString fileName = QFileDialog::getOpenFileName(this, "Import mesh", QString(), "Meshes (*.obj *.ply)");
+  if (!fileName.isEmpty())
+  {
+    importMesh(fileName);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::meshImported(QString _name, QString _report)
+{
+  m_ui->m_vboSelection->addItem(_name);
+  m_ui->m_vboSelection->setCurrentIndex(m_ui->m_vboSelection->count() - 1);
+  m_importReport->setText(_report);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::meshImportFailed(QString _error)
+{
+  QMessageBox::warning(this, "Import mesh", _error);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::setKey()
+{
+  m_pose.resize(1);
+  m_pose.set(0, m_ui->m_tx->value(), m_ui->m_ty->value(), m_ui->m_tz->value(),
+             m_ui->m_rx->value(), m_ui->m_ry->value(), m_ui->m_rz->value(),
+             m_ui->m_sx->value(), m_ui->m_sy->value(), m_ui->m_sz->value(),
+             m_ui->m_eulerAngle->value(), m_ui->m_eulerXAxis->value(),
+             m_ui->m_eulerYAxis->value(), m_ui->m_eulerZAxis->value());
+  m_timeline.setPose(0, m_ui->m_timelineTime->value(), m_pose, 0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::clearKeys()
+{
+  m_timeline.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::playTimeline(bool _value)
+{
+  if (_value)
+  {
+    m_playhead = m_ui->m_timelineTime->value();
+    m_timeline.resetStats();
+    m_timelineTimer->start();
+  }
+  else
+  {
+    m_timelineTimer->stop();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MainWindow::timelineTick()
+{
+  if (m_timeline.keyCount() == 0)
+  {
+    return;
+  }
+  m_playhead = m_timeline.wrap(m_playhead + s_timelineTickMs / 1000.0f);
+  m_timeline.evaluate(m_playhead, m_pose);
+  {
+    QSignalBlocker block(m_ui->m_timelineTime);
+    m_ui->m_timelineTime->setValue(m_playhead);
+  }
+  // the thirteen spin boxes are one edit, the scene is rebuilt once per tick
+  m_gl->beginEdit();
+  m_ui->m_tx->setValue(m_pose.tx[0]);
+  m_ui->m_ty->setValue(m_pose.ty[0]);
+  m_ui->m_tz->setValue(m_pose.tz[0]);
+  m_ui->m_rx->setValue(m_pose.rx[0]);
+  m_ui->m_ry->setValue(m_pose.ry[0]);
+  m_ui->m_rz->setValue(m_pose.rz[0]);
+  m_ui->m_sx->setValue(m_pose.sx[0]);
+  m_ui->m_sy->setValue(m_pose.sy[0]);
+  m_ui->m_sz->setValue(m_pose.sz[0]);
+  m_ui->m_eulerAngle->setValue(m_pose.eulerAngle[0]);
+  m_ui->m_eulerXAxis->setValue(m_pose.eulerX[0]);
+  m_ui->m_eulerYAxis->setValue(m_pose.eulerY[0]);
+  m_ui->m_eulerZAxis->setValue(m_pose.eulerZ[0]);
+  m_gl->commit();
+}
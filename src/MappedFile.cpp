@@ -0,0 +1,178 @@
+/// @file MappedFile.cpp
+/// @brief posix and windows implementations of MappedFile
+#include "MappedFile.h"
+#include <algorithm>
+#include <utility>
+#if defined(_WIN32)
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+MappedFile::MappedFile(MappedFile &&_other) noexcept
+{
+  *this = std::move(_other);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MappedFile &MappedFile::operator=(MappedFile &&_other) noexcept
+{
+  if (this != &_other)
+  {
+    close();
+    std::swap(m_data, _other.m_data);
+    std::swap(m_size, _other.m_size);
+    std::swap(m_open, _other.m_open);
+#if defined(_WIN32)
+    std::swap(m_file, _other.m_file);
+    std::swap(m_mapping, _other.m_mapping);
+#endif
+  }
+  return *this;
+}
+
+#if defined(_WIN32)
+//----------------------------------------------------------------------------------------------------------------------
+bool MappedFile::open(const std::string &_fileName)
+{
+  close();
+  HANDLE file = CreateFileA(_fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size))
+  {
+    CloseHandle(file);
+    return false;
+  }
+  m_file = file;
+  m_open = true;
+  m_size = static_cast<size_t>(size.QuadPart);
+  if (m_size == 0)
+  {
+    return true;
+  }
+  m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping != nullptr)
+  {
+    m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (m_data == nullptr)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MappedFile::close()
+{
+  if (m_data != nullptr)
+  {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping != nullptr)
+  {
+    CloseHandle(m_mapping);
+  }
+  if (m_file != nullptr)
+  {
+    CloseHandle(m_file);
+  }
+  m_data = nullptr;
+  m_mapping = nullptr;
+  m_file = nullptr;
+  m_size = 0;
+  m_open = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MappedFile::adviseSequential() const
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MappedFile::prefetch(size_t, size_t) const
+{
+}
+
+#else
+//----------------------------------------------------------------------------------------------------------------------
+bool MappedFile::open(const std::string &_fileName)
+{
+  close();
+  int fd = ::open(_fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+  {
+    ::close(fd);
+    return false;
+  }
+  m_size = static_cast<size_t>(info.st_size);
+  m_open = true;
+  if (m_size != 0)
+  {
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      m_size = 0;
+      m_open = false;
+    }
+    else
+    {
+      m_data = static_cast<const char *>(data);
+    }
+  }
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  return m_open;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MappedFile::close()
+{
+  if (m_data != nullptr)
+  {
+    munmap(const_cast<char *>(m_data), m_size);
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_open = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MappedFile::adviseSequential() const
+{
+  if (m_data != nullptr)
+  {
+    madvise(const_cast<char *>(m_data), m_size, MADV_SEQUENTIAL);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MappedFile::prefetch(size_t _offset, size_t _size) const
+{
+  if (m_data == nullptr || _offset >= m_size)
+  {
+    return;
+  }
+  // madvise needs a page aligned start
+  static const size_t s_pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t begin = _offset / s_pageSize * s_pageSize;
+  const size_t end = std::min(m_size, _offset + _size);
+  madvise(const_cast<char *>(m_data) + begin, end - begin, MADV_WILLNEED);
+}
+#endif
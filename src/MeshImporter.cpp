@@ -0,0 +1,1229 @@
+/// @file MeshImporter.cpp
+/// @brief parallel OBJ and PLY parsing
+#include "MeshImporter.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief chunks smaller than this aren't worth a task
+//----------------------------------------------------------------------------------------------------------------------
+constexpr size_t s_minChunkBytes = 1 << 20;
+constexpr size_t s_minChunkFaces = 1 << 16;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a piece of the file starting at the beginning of a line
+//----------------------------------------------------------------------------------------------------------------------
+struct TextChunk
+{
+  const char *begin;
+  const char *end;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<TextChunk> splitLines(const char *_begin, const char *_end, size_t _pieces)
+{
+  std::vector<TextChunk> chunks;
+  size_t bytes = static_cast<size_t>(_end - _begin);
+  size_t pieces = std::max(size_t(1), std::min(_pieces, bytes / s_minChunkBytes));
+  size_t step = bytes / pieces;
+  const char *start = _begin;
+  for (size_t i = 1; i < pieces; ++i)
+  {
+    const char *split = _begin + i * step;
+    if (split <= start)
+    {
+      continue;
+    }
+    auto newLine = static_cast<const char *>(std::memchr(split, '\n', static_cast<size_t>(_end - split)));
+    const char *next = newLine != nullptr ? newLine + 1 : _end;
+    chunks.push_back({start, next});
+    start = next;
+  }
+  if (start < _end)
+  {
+    chunks.push_back({start, _end});
+  }
+  return chunks;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+inline const char *findLineEnd(const char *_p, const char *_end)
+{
+  auto newLine = static_cast<const char *>(std::memchr(_p, '\n', static_cast<size_t>(_end - _p)));
+  return newLine != nullptr ? newLine : _end;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+inline bool isSpace(char _c)
+{
+  return _c == ' ' || _c == '\t' || _c == '\r';
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+inline void skipSpace(const char *&_p, const char *_end)
+{
+  while (_p < _end && isSpace(*_p))
+  {
+    ++_p;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+inline bool isDigit(char _c)
+{
+  return _c >= '0' && _c <= '9';
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief locale independent float parse, much faster than strtof and accurate to well within
+/// a float for the up to 19 significant digits it keeps
+//----------------------------------------------------------------------------------------------------------------------
+bool parseFloat(const char *&_p, const char *_end, float &_value)
+{
+  static const double s_powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  skipSpace(_p, _end);
+  const char *p = _p;
+  bool negative = false;
+  if (p < _end && (*p == '-' || *p == '+'))
+  {
+    negative = *p == '-';
+    ++p;
+  }
+  uint64_t mantissa = 0;
+  int exponent = 0;
+  int digits = 0;
+  bool any = false;
+  for (; p < _end && isDigit(*p); ++p, any = true)
+  {
+    if (digits < 19)
+    {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+      digits += mantissa != 0;
+    }
+    else
+    {
+      ++exponent;
+    }
+  }
+  if (p < _end && *p == '.')
+  {
+    for (++p; p < _end && isDigit(*p); ++p, any = true)
+    {
+      if (digits < 19)
+      {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        digits += mantissa != 0;
+        --exponent;
+      }
+    }
+  }
+  if (!any)
+  {
+    return false;
+  }
+  if (p < _end && (*p == 'e' || *p == 'E'))
+  {
+    const char *e = p + 1;
+    bool negativeExponent = false;
+    if (e < _end && (*e == '-' || *e == '+'))
+    {
+      negativeExponent = *e == '-';
+      ++e;
+    }
+    if (e < _end && isDigit(*e))
+    {
+      int value = 0;
+      for (; e < _end && isDigit(*e); ++e)
+      {
+        value = std::min(value * 10 + (*e - '0'), 1000);
+      }
+      exponent += negativeExponent ? -value : value;
+      p = e;
+    }
+  }
+  double v = static_cast<double>(mantissa);
+  if (exponent < 0)
+  {
+    v = -exponent <= 22 ? v / s_powers[-exponent] : v * std::pow(10.0, exponent);
+  }
+  else if (exponent > 0)
+  {
+    v = exponent <= 22 ? v * s_powers[exponent] : v * std::pow(10.0, exponent);
+  }
+  _value = static_cast<float>(negative ? -v : v);
+  _p = p;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool parseInt(const char *&_p, const char *_end, long &_value)
+{
+  skipSpace(_p, _end);
+  const char *p = _p;
+  bool negative = false;
+  if (p < _end && (*p == '-' || *p == '+'))
+  {
+    negative = *p == '-';
+    ++p;
+  }
+  if (p == _end || !isDigit(*p))
+  {
+    return false;
+  }
+  long value = 0;
+  for (; p < _end && isDigit(*p); ++p)
+  {
+    value = value * 10 + (*p - '0');
+  }
+  _value = negative ? -value : value;
+  _p = p;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief byte offset of _p in the file for error messages
+//----------------------------------------------------------------------------------------------------------------------
+std::string offsetText(const char *_base, const char *_p)
+{
+  return "byte " + std::to_string(_p - _base);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief write the three corners of a triangle, any missing normal (nullptr) is replaced
+/// by the face normal and a missing uv by 0,0
+//----------------------------------------------------------------------------------------------------------------------
+void emitTriangle(float *&_out, const float *const _p[3], const float *const _n[3], const float *const _uv[3])
+{
+  float face[3] = {0.0f, 0.0f, 0.0f};
+  if (_n[0] == nullptr || _n[1] == nullptr || _n[2] == nullptr)
+  {
+    float e1[3] = {_p[1][0] - _p[0][0], _p[1][1] - _p[0][1], _p[1][2] - _p[0][2]};
+    float e2[3] = {_p[2][0] - _p[0][0], _p[2][1] - _p[0][1], _p[2][2] - _p[0][2]};
+    face[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    face[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    face[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    float length = std::sqrt(face[0] * face[0] + face[1] * face[1] + face[2] * face[2]);
+    if (length > 0.0f)
+    {
+      face[0] /= length;
+      face[1] /= length;
+      face[2] /= length;
+    }
+  }
+  for (int c = 0; c < 3; ++c)
+  {
+    const float *n = _n[c] != nullptr ? _n[c] : face;
+    _out[0] = _p[c][0];
+    _out[1] = _p[c][1];
+    _out[2] = _p[c][2];
+    _out[3] = n[0];
+    _out[4] = n[1];
+    _out[5] = n[2];
+    _out[6] = _uv[c] != nullptr ? _uv[c][0] : 0.0f;
+    _out[7] = _uv[c] != nullptr ? _uv[c][1] : 0.0f;
+    _out += MeshImporter::FloatsPerVertex;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the vertex data found in one chunk of an obj file
+//----------------------------------------------------------------------------------------------------------------------
+struct ObjChunk
+{
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> uvs;
+  size_t triangles = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the kind of obj line starting at _p, 'v' position, 'n' normal, 't' uv, 'f' face or 0
+//----------------------------------------------------------------------------------------------------------------------
+inline char objLineType(const char *&_p, const char *_end)
+{
+  skipSpace(_p, _end);
+  if (_end - _p < 2)
+  {
+    return 0;
+  }
+  if (_p[0] == 'v')
+  {
+    if (isSpace(_p[1]))
+    {
+      _p += 2;
+      return 'v';
+    }
+    if (_end - _p > 2 && (_p[1] == 'n' || _p[1] == 't') && isSpace(_p[2]))
+    {
+      char type = _p[1];
+      _p += 3;
+      return type;
+    }
+  }
+  else if (_p[0] == 'f' && isSpace(_p[1]))
+  {
+    _p += 2;
+    return 'f';
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the end of the face data on a line, before any trailing comment
+//----------------------------------------------------------------------------------------------------------------------
+inline const char *faceEnd(const char *_p, const char *_eol)
+{
+  auto hash = static_cast<const char *>(std::memchr(_p, '#', static_cast<size_t>(_eol - _p)));
+  return hash != nullptr ? hash : _eol;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief turn an obj index (1 based or negative relative to _seen) into a 0 based one
+//----------------------------------------------------------------------------------------------------------------------
+inline size_t objIndex(long _index, size_t _seen, size_t _total)
+{
+  long resolved = _index > 0 ? _index - 1 : static_cast<long>(_seen) + _index;
+  if (_index == 0 || resolved < 0 || static_cast<size_t>(resolved) >= _total)
+  {
+    throw std::runtime_error("face index " + std::to_string(_index) + " out of range");
+  }
+  return static_cast<size_t>(resolved);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the ply scalar types
+//----------------------------------------------------------------------------------------------------------------------
+enum class PlyType
+{
+  INT8,
+  UINT8,
+  INT16,
+  UINT16,
+  INT32,
+  UINT32,
+  FLOAT32,
+  FLOAT64,
+  INVALID
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+PlyType plyType(const std::string &_name)
+{
+  if (_name == "char" || _name == "int8") return PlyType::INT8;
+  if (_name == "uchar" || _name == "uint8") return PlyType::UINT8;
+  if (_name == "short" || _name == "int16") return PlyType::INT16;
+  if (_name == "ushort" || _name == "uint16") return PlyType::UINT16;
+  if (_name == "int" || _name == "int32") return PlyType::INT32;
+  if (_name == "uint" || _name == "uint32") return PlyType::UINT32;
+  if (_name == "float" || _name == "float32") return PlyType::FLOAT32;
+  if (_name == "double" || _name == "float64") return PlyType::FLOAT64;
+  return PlyType::INVALID;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t plySize(PlyType _type)
+{
+  switch (_type)
+  {
+  case PlyType::INT8:
+  case PlyType::UINT8: return 1;
+  case PlyType::INT16:
+  case PlyType::UINT16: return 2;
+  case PlyType::INT32:
+  case PlyType::UINT32:
+  case PlyType::FLOAT32: return 4;
+  case PlyType::FLOAT64: return 8;
+  default: return 0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool hostIsLittleEndian()
+{
+  const uint16_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief read one binary value, swapping the bytes if the file endian differs from ours
+//----------------------------------------------------------------------------------------------------------------------
+double readBinary(const char *_p, PlyType _type, bool _swap)
+{
+  unsigned char bytes[8];
+  size_t size = plySize(_type);
+  for (size_t i = 0; i < size; ++i)
+  {
+    bytes[i] = static_cast<unsigned char>(_p[_swap ? size - 1 - i : i]);
+  }
+  switch (_type)
+  {
+  case PlyType::INT8: { int8_t v; std::memcpy(&v, bytes, 1); return v; }
+  case PlyType::UINT8: { uint8_t v; std::memcpy(&v, bytes, 1); return v; }
+  case PlyType::INT16: { int16_t v; std::memcpy(&v, bytes, 2); return v; }
+  case PlyType::UINT16: { uint16_t v; std::memcpy(&v, bytes, 2); return v; }
+  case PlyType::INT32: { int32_t v; std::memcpy(&v, bytes, 4); return v; }
+  case PlyType::UINT32: { uint32_t v; std::memcpy(&v, bytes, 4); return v; }
+  case PlyType::FLOAT32: { float v; std::memcpy(&v, bytes, 4); return v; }
+  case PlyType::FLOAT64: { double v; std::memcpy(&v, bytes, 8); return v; }
+  default: return 0.0;
+  }
+}
+
+struct PlyProperty
+{
+  std::string name;
+  PlyType type = PlyType::INVALID;
+  PlyType countType = PlyType::INVALID;
+  bool list = false;
+};
+
+struct PlyElement
+{
+  std::string name;
+  size_t count = 0;
+  std::vector<PlyProperty> properties;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the index of the first property with one of the names or -1
+  //----------------------------------------------------------------------------------------------------------------------
+  int find(std::initializer_list<const char *> _names) const
+  {
+    for (size_t i = 0; i < properties.size(); ++i)
+    {
+      for (auto n : _names)
+      {
+        if (properties[i].name == n)
+        {
+          return static_cast<int>(i);
+        }
+      }
+    }
+    return -1;
+  }
+};
+
+struct PlyHeader
+{
+  enum class Format
+  {
+    ASCII,
+    BINARY_LE,
+    BINARY_BE
+  };
+  Format format = Format::ASCII;
+  std::vector<PlyElement> elements;
+  const char *body = nullptr;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+PlyHeader parsePlyHeader(const char *_begin, const char *_end)
+{
+  PlyHeader header;
+  const char *p = _begin;
+  bool first = true;
+  while (p < _end)
+  {
+    const char *eol = findLineEnd(p, _end);
+    std::istringstream line(std::string(p, eol));
+    p = eol + 1;
+    std::string keyword;
+    line >> keyword;
+    if (first)
+    {
+      if (keyword != "ply")
+      {
+        throw std::runtime_error("not a ply file");
+      }
+      first = false;
+    }
+    else if (keyword == "format")
+    {
+      std::string format;
+      line >> format;
+      if (format == "ascii")
+      {
+        header.format = PlyHeader::Format::ASCII;
+      }
+      else if (format == "binary_little_endian")
+      {
+        header.format = PlyHeader::Format::BINARY_LE;
+      }
+      else if (format == "binary_big_endian")
+      {
+        header.format = PlyHeader::Format::BINARY_BE;
+      }
+      else
+      {
+        throw std::runtime_error("unknown ply format " + format);
+      }
+    }
+    else if (keyword == "element")
+    {
+      PlyElement element;
+      line >> element.name >> element.count;
+      header.elements.push_back(element);
+    }
+    else if (keyword == "property")
+    {
+      if (header.elements.empty())
+      {
+        throw std::runtime_error("ply property before any element");
+      }
+      PlyProperty property;
+      std::string type;
+      line >> type;
+      if (type == "list")
+      {
+        std::string countType;
+        line >> countType >> type;
+        property.list = true;
+        property.countType = plyType(countType);
+        if (property.countType == PlyType::INVALID)
+        {
+          throw std::runtime_error("unknown ply type " + countType);
+        }
+      }
+      property.type = plyType(type);
+      if (property.type == PlyType::INVALID)
+      {
+        throw std::runtime_error("unknown ply type " + type);
+      }
+      line >> property.name;
+      header.elements.back().properties.push_back(property);
+    }
+    else if (keyword == "end_header")
+    {
+      header.body = std::min(p, _end);
+      return header;
+    }
+  }
+  throw std::runtime_error("ply header has no end_header");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the vertex properties we use and where they go
+//----------------------------------------------------------------------------------------------------------------------
+struct PlyVertexLayout
+{
+  int position[3];
+  int normal[3];
+  int uv[2];
+  bool hasNormals;
+  bool hasUVs;
+
+  explicit PlyVertexLayout(const PlyElement &_vertex)
+  {
+    position[0] = _vertex.find({"x"});
+    position[1] = _vertex.find({"y"});
+    position[2] = _vertex.find({"z"});
+    normal[0] = _vertex.find({"nx"});
+    normal[1] = _vertex.find({"ny"});
+    normal[2] = _vertex.find({"nz"});
+    uv[0] = _vertex.find({"u", "s", "texture_u", "texture_s"});
+    uv[1] = _vertex.find({"v", "t", "texture_v", "texture_t"});
+    if (position[0] < 0 || position[1] < 0 || position[2] < 0)
+    {
+      throw std::runtime_error("ply vertex has no x y z");
+    }
+    hasNormals = normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0;
+    hasUVs = uv[0] >= 0 && uv[1] >= 0;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief copy the values of vertex _i from the per property _values
+  //----------------------------------------------------------------------------------------------------------------------
+  void store(const double *_values, size_t _i, std::vector<float> &_positions, std::vector<float> &_normals,
+             std::vector<float> &_uvs) const
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      _positions[_i * 3 + k] = static_cast<float>(_values[position[k]]);
+    }
+    if (hasNormals)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        _normals[_i * 3 + k] = static_cast<float>(_values[normal[k]]);
+      }
+    }
+    if (hasUVs)
+    {
+      _uvs[_i * 2] = static_cast<float>(_values[uv[0]]);
+      _uvs[_i * 2 + 1] = static_cast<float>(_values[uv[1]]);
+    }
+  }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the vertex arrays every ply triangle indexes
+//----------------------------------------------------------------------------------------------------------------------
+struct PlyVertices
+{
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> uvs;
+  size_t count = 0;
+
+  void emitPolygon(float *&_out, const std::vector<size_t> &_indices) const
+  {
+    for (auto i : _indices)
+    {
+      if (i >= count)
+      {
+        throw std::runtime_error("face index " + std::to_string(i) + " out of range");
+      }
+    }
+    for (size_t i = 1; i + 1 < _indices.size(); ++i)
+    {
+      const size_t corner[3] = {_indices[0], _indices[i], _indices[i + 1]};
+      const float *p[3];
+      const float *n[3];
+      const float *uv[3];
+      for (int c = 0; c < 3; ++c)
+      {
+        p[c] = &positions[corner[c] * 3];
+        n[c] = normals.empty() ? nullptr : &normals[corner[c] * 3];
+        uv[c] = uvs.empty() ? nullptr : &uvs[corner[c] * 2];
+      }
+      emitTriangle(_out, p, n, uv);
+    }
+  }
+};
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MeshImporter::isSupported(const std::string &_fileName)
+{
+  auto dot = _fileName.find_last_of('.');
+  if (dot == std::string::npos)
+  {
+    return false;
+  }
+  std::string extension = _fileName.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+  return extension == "obj" || extension == "ply";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MeshImporter::load(const std::string &_fileName, const AllocateFunc &_allocate, const UploadFunc &_upload)
+{
+  m_stats = Stats();
+  m_stats.threads = m_pool.size();
+  m_error.clear();
+  if (!isSupported(_fileName))
+  {
+    m_error = "unsupported file type " + _fileName;
+    return false;
+  }
+  auto start = std::chrono::steady_clock::now();
+  MappedFile file(_fileName);
+  if (!file.isOpen())
+  {
+    m_error = "unable to open " + _fileName;
+    return false;
+  }
+  m_stats.fileBytes = file.size();
+  bool ok = false;
+  try
+  {
+    bool ply = std::tolower(static_cast<unsigned char>(_fileName.back())) == 'y';
+    ok = ply ? loadPLY(file, _allocate, _upload) : loadOBJ(file, _allocate, _upload);
+  }
+  catch (const std::exception &e)
+  {
+    m_error = _fileName + ": " + e.what();
+    ok = false;
+  }
+  double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  m_stats.parseSeconds = total - m_stats.uploadSeconds;
+  return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MeshImporter::streamChunks(std::vector<std::future<std::vector<float>>> &_chunks, const UploadFunc &_upload)
+{
+  size_t first = 0;
+  try
+  {
+    for (auto &chunk : _chunks)
+    {
+      auto vertices = chunk.get();
+      size_t count = vertices.size() / FloatsPerVertex;
+      auto start = std::chrono::steady_clock::now();
+      _upload(first, vertices.data(), count);
+      m_stats.uploadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      m_stats.vertexBytes += vertices.size() * sizeof(float);
+      first += count;
+    }
+  }
+  catch (...)
+  {
+    // the other chunks still reference the caller's data so they must finish first
+    for (auto &chunk : _chunks)
+    {
+      if (chunk.valid())
+      {
+        chunk.wait();
+      }
+    }
+    throw;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MeshImporter::loadOBJ(const MappedFile &_file, const AllocateFunc &_allocate, const UploadFunc &_upload)
+{
+  const char *base = _file.data();
+  auto pieces = splitLines(base, base + _file.size(), m_pool.size() * 4);
+
+  // pass 1 each chunk parses its own vertex data and counts the triangles its faces make
+  std::vector<ObjChunk> chunks(pieces.size());
+  m_pool.parallelFor(pieces.size(), 1, [&](size_t _begin, size_t _end)
+  {
+    for (size_t c = _begin; c < _end; ++c)
+    {
+      auto &chunk = chunks[c];
+      for (const char *p = pieces[c].begin; p < pieces[c].end;)
+      {
+        const char *eol = findLineEnd(p, pieces[c].end);
+        const char *q = p;
+        char type = objLineType(q, eol);
+        if (type == 'v' || type == 'n')
+        {
+          float xyz[3];
+          if (!parseFloat(q, eol, xyz[0]) || !parseFloat(q, eol, xyz[1]) || !parseFloat(q, eol, xyz[2]))
+          {
+            throw std::runtime_error("bad vertex at " + offsetText(base, p));
+          }
+          auto &out = type == 'v' ? chunk.positions : chunk.normals;
+          out.insert(out.end(), xyz, xyz + 3);
+        }
+        else if (type == 't')
+        {
+          float uv[2] = {0.0f, 0.0f};
+          if (!parseFloat(q, eol, uv[0]))
+          {
+            throw std::runtime_error("bad uv at " + offsetText(base, p));
+          }
+          parseFloat(q, eol, uv[1]);
+          chunk.uvs.insert(chunk.uvs.end(), uv, uv + 2);
+        }
+        else if (type == 'f')
+        {
+          const char *stop = faceEnd(q, eol);
+          size_t corners = 0;
+          for (skipSpace(q, stop); q < stop; skipSpace(q, stop))
+          {
+            ++corners;
+            while (q < stop && !isSpace(*q))
+            {
+              ++q;
+            }
+          }
+          chunk.triangles += corners >= 3 ? corners - 2 : 0;
+        }
+        p = eol + 1;
+      }
+    }
+  });
+
+  // where each chunk's data goes in the whole file
+  const size_t n = chunks.size();
+  std::vector<size_t> positionStart(n + 1, 0), normalStart(n + 1, 0), uvStart(n + 1, 0), triangleStart(n + 1, 0);
+  for (size_t c = 0; c < n; ++c)
+  {
+    positionStart[c + 1] = positionStart[c] + chunks[c].positions.size() / 3;
+    normalStart[c + 1] = normalStart[c] + chunks[c].normals.size() / 3;
+    uvStart[c + 1] = uvStart[c] + chunks[c].uvs.size() / 2;
+    triangleStart[c + 1] = triangleStart[c] + chunks[c].triangles;
+  }
+  m_stats.triangles = triangleStart[n];
+  if (m_stats.triangles == 0)
+  {
+    throw std::runtime_error("no faces");
+  }
+  std::vector<float> positions(positionStart[n] * 3), normals(normalStart[n] * 3), uvs(uvStart[n] * 2);
+  m_pool.parallelFor(n, 1, [&](size_t _begin, size_t _end)
+  {
+    for (size_t c = _begin; c < _end; ++c)
+    {
+      std::copy(chunks[c].positions.begin(), chunks[c].positions.end(), positions.begin() + positionStart[c] * 3);
+      std::copy(chunks[c].normals.begin(), chunks[c].normals.end(), normals.begin() + normalStart[c] * 3);
+      std::copy(chunks[c].uvs.begin(), chunks[c].uvs.end(), uvs.begin() + uvStart[c] * 2);
+      chunks[c] = ObjChunk();
+    }
+  });
+
+  // pass 2 the faces of each chunk are expanded to triangles and uploaded in file order as
+  // soon as they are ready
+  _allocate(m_stats.triangles * 3);
+  std::vector<std::future<std::vector<float>>> results;
+  for (size_t c = 0; c < n; ++c)
+  {
+    results.push_back(m_pool.submit([&, c]()
+    {
+      std::vector<float> out((triangleStart[c + 1] - triangleStart[c]) * 3 * FloatsPerVertex);
+      float *write = out.data();
+      size_t positionSeen = positionStart[c];
+      size_t normalSeen = normalStart[c];
+      size_t uvSeen = uvStart[c];
+      std::vector<size_t> p, t, nrm;
+      for (const char *line = pieces[c].begin; line < pieces[c].end;)
+      {
+        const char *eol = findLineEnd(line, pieces[c].end);
+        const char *q = line;
+        switch (objLineType(q, eol))
+        {
+        case 'v': ++positionSeen; break;
+        case 'n': ++normalSeen; break;
+        case 't': ++uvSeen; break;
+        case 'f':
+        {
+          const char *stop = faceEnd(q, eol);
+          p.clear();
+          t.clear();
+          nrm.clear();
+          for (skipSpace(q, stop); q < stop; skipSpace(q, stop))
+          {
+            long index = 0;
+            if (!parseInt(q, stop, index))
+            {
+              throw std::runtime_error("bad face at " + offsetText(base, line));
+            }
+            p.push_back(objIndex(index, positionSeen, positions.size() / 3));
+            size_t uv = SIZE_MAX;
+            size_t normal = SIZE_MAX;
+            if (q < stop && *q == '/')
+            {
+              ++q;
+              if (parseInt(q, stop, index))
+              {
+                uv = objIndex(index, uvSeen, uvs.size() / 2);
+              }
+              if (q < stop && *q == '/')
+              {
+                ++q;
+                if (parseInt(q, stop, index))
+                {
+                  normal = objIndex(index, normalSeen, normals.size() / 3);
+                }
+              }
+            }
+            t.push_back(uv);
+            nrm.push_back(normal);
+            while (q < stop && !isSpace(*q))
+            {
+              ++q;
+            }
+          }
+          for (size_t i = 1; i + 1 < p.size(); ++i)
+          {
+            const size_t corner[3] = {0, i, i + 1};
+            const float *cp[3];
+            const float *cn[3];
+            const float *cuv[3];
+            for (int k = 0; k < 3; ++k)
+            {
+              cp[k] = &positions[p[corner[k]] * 3];
+              cn[k] = nrm[corner[k]] == SIZE_MAX ? nullptr : &normals[nrm[corner[k]] * 3];
+              cuv[k] = t[corner[k]] == SIZE_MAX ? nullptr : &uvs[t[corner[k]] * 2];
+            }
+            emitTriangle(write, cp, cn, cuv);
+          }
+          break;
+        }
+        default: break;
+        }
+        line = eol + 1;
+      }
+      return out;
+    }));
+  }
+  streamChunks(results, _upload);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MeshImporter::loadPLY(const MappedFile &_file, const AllocateFunc &_allocate, const UploadFunc &_upload)
+{
+  const char *base = _file.data();
+  const char *end = base + _file.size();
+  PlyHeader header = parsePlyHeader(base, end);
+  int vertexElement = -1;
+  int faceElement = -1;
+  for (size_t e = 0; e < header.elements.size(); ++e)
+  {
+    if (header.elements[e].name == "vertex")
+    {
+      vertexElement = static_cast<int>(e);
+    }
+    else if (header.elements[e].name == "face")
+    {
+      faceElement = static_cast<int>(e);
+    }
+  }
+  if (vertexElement < 0 || faceElement < 0)
+  {
+    throw std::runtime_error("ply file needs vertex and face elements");
+  }
+  const PlyElement &vertex = header.elements[vertexElement];
+  const PlyElement &face = header.elements[faceElement];
+  const int indexProperty = face.find({"vertex_indices", "vertex_index"});
+  if (indexProperty < 0 || !face.properties[indexProperty].list)
+  {
+    throw std::runtime_error("ply face has no vertex_indices list");
+  }
+  PlyVertexLayout layout(vertex);
+  PlyVertices vertices;
+  vertices.count = vertex.count;
+  vertices.positions.resize(vertex.count * 3);
+  vertices.normals.resize(layout.hasNormals ? vertex.count * 3 : 0);
+  vertices.uvs.resize(layout.hasUVs ? vertex.count * 2 : 0);
+
+  // each face chunk knows where it starts and how many triangles come before it
+  struct FaceChunk
+  {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    size_t firstFace = 0;
+    size_t faces = 0;
+    size_t firstTriangle = 0;
+    size_t triangles = 0;
+  };
+  std::vector<FaceChunk> faceChunks;
+  std::vector<std::future<std::vector<float>>> results;
+
+  if (header.format == PlyHeader::Format::ASCII)
+  {
+    // count the lines in each chunk so every line knows which element it belongs to
+    auto pieces = splitLines(header.body, end, m_pool.size() * 4);
+    std::vector<size_t> firstLine(pieces.size() + 1, 0);
+    m_pool.parallelFor(pieces.size(), 1, [&](size_t _begin, size_t _end)
+    {
+      for (size_t c = _begin; c < _end; ++c)
+      {
+        size_t lines = static_cast<size_t>(std::count(pieces[c].begin, pieces[c].end, '\n'));
+        if (pieces[c].end > pieces[c].begin && pieces[c].end[-1] != '\n')
+        {
+          ++lines;
+        }
+        firstLine[c + 1] = lines;
+      }
+    });
+    for (size_t c = 0; c < pieces.size(); ++c)
+    {
+      firstLine[c + 1] += firstLine[c];
+    }
+    std::vector<size_t> elementStart(header.elements.size() + 1, 0);
+    for (size_t e = 0; e < header.elements.size(); ++e)
+    {
+      elementStart[e + 1] = elementStart[e] + header.elements[e].count;
+    }
+    const size_t vertexBegin = elementStart[vertexElement];
+    const size_t faceBegin = elementStart[faceElement];
+
+    // read the values of one ascii record, list properties give their count then the items
+    auto readRecord = [&](const char *&_q, const char *_eol, const PlyElement &_element, std::vector<double> &_values,
+                          std::vector<size_t> *_indices)
+    {
+      _values.resize(_element.properties.size());
+      for (size_t i = 0; i < _element.properties.size(); ++i)
+      {
+        float value = 0.0f;
+        if (!_element.properties[i].list)
+        {
+          if (!parseFloat(_q, _eol, value))
+          {
+            throw std::runtime_error("bad " + _element.name + " at " + offsetText(base, _q));
+          }
+          _values[i] = value;
+          continue;
+        }
+        long count = 0;
+        if (!parseInt(_q, _eol, count) || count < 0)
+        {
+          throw std::runtime_error("bad list at " + offsetText(base, _q));
+        }
+        _values[i] = static_cast<double>(count);
+        for (long k = 0; k < count; ++k)
+        {
+          long index = 0;
+          if (!parseInt(_q, _eol, index) || index < 0)
+          {
+            throw std::runtime_error("bad list at " + offsetText(base, _q));
+          }
+          if (_indices != nullptr && static_cast<int>(i) == indexProperty)
+          {
+            _indices->push_back(static_cast<size_t>(index));
+          }
+        }
+      }
+    };
+
+    // vertices and the face triangle counts
+    faceChunks.resize(pieces.size());
+    m_pool.parallelFor(pieces.size(), 1, [&](size_t _begin, size_t _end)
+    {
+      std::vector<double> values;
+      for (size_t c = _begin; c < _end; ++c)
+      {
+        size_t line = firstLine[c];
+        auto &chunk = faceChunks[c];
+        chunk.begin = pieces[c].begin;
+        chunk.end = pieces[c].end;
+        for (const char *p = pieces[c].begin; p < pieces[c].end; ++line)
+        {
+          const char *eol = findLineEnd(p, pieces[c].end);
+          const char *q = p;
+          if (line >= vertexBegin && line < vertexBegin + vertex.count)
+          {
+            readRecord(q, eol, vertex, values, nullptr);
+            layout.store(values.data(), line - vertexBegin, vertices.positions, vertices.normals, vertices.uvs);
+          }
+          else if (line >= faceBegin && line < faceBegin + face.count)
+          {
+            if (chunk.faces == 0)
+            {
+              chunk.firstFace = line - faceBegin;
+            }
+            ++chunk.faces;
+            readRecord(q, eol, face, values, nullptr);
+            size_t corners = static_cast<size_t>(values[indexProperty]);
+            chunk.triangles += corners >= 3 ? corners - 2 : 0;
+          }
+          p = eol + 1;
+        }
+      }
+    });
+    for (size_t c = 1; c < faceChunks.size(); ++c)
+    {
+      faceChunks[c].firstTriangle = faceChunks[c - 1].firstTriangle + faceChunks[c - 1].triangles;
+    }
+    m_stats.triangles = faceChunks.empty() ? 0 : faceChunks.back().firstTriangle + faceChunks.back().triangles;
+    if (m_stats.triangles == 0)
+    {
+      throw std::runtime_error("no faces");
+    }
+    _allocate(m_stats.triangles * 3);
+    for (size_t c = 0; c < faceChunks.size(); ++c)
+    {
+      results.push_back(m_pool.submit([&, c]()
+      {
+        const auto &chunk = faceChunks[c];
+        std::vector<float> out(chunk.triangles * 3 * FloatsPerVertex);
+        float *write = out.data();
+        std::vector<double> values;
+        std::vector<size_t> indices;
+        size_t line = firstLine[c];
+        for (const char *p = chunk.begin; p < chunk.end; ++line)
+        {
+          const char *eol = findLineEnd(p, chunk.end);
+          const char *q = p;
+          if (line >= faceBegin && line < faceBegin + face.count)
+          {
+            indices.clear();
+            readRecord(q, eol, face, values, &indices);
+            vertices.emitPolygon(write, indices);
+          }
+          p = eol + 1;
+        }
+        return out;
+      }));
+    }
+    streamChunks(results, _upload);
+    return true;
+  }
+
+  // binary, every element before the face element has to be walked to find where the faces start
+  const bool swap = (header.format == PlyHeader::Format::BINARY_LE) != hostIsLittleEndian();
+  auto recordSize = [&](const char *_p, const PlyElement &_element) -> size_t
+  {
+    size_t size = 0;
+    for (auto &property : _element.properties)
+    {
+      if (property.list)
+      {
+        if (_p + size + plySize(property.countType) > end)
+        {
+          throw std::runtime_error("ply file is truncated");
+        }
+        auto count = static_cast<size_t>(readBinary(_p + size, property.countType, swap));
+        size += plySize(property.countType) + count * plySize(property.type);
+      }
+      else
+      {
+        size += plySize(property.type);
+      }
+    }
+    return size;
+  };
+  const char *p = header.body;
+  const char *vertexData = nullptr;
+  for (int e = 0; e <= faceElement; ++e)
+  {
+    const auto &element = header.elements[e];
+    if (e == vertexElement)
+    {
+      vertexData = p;
+    }
+    if (e == faceElement)
+    {
+      break;
+    }
+    bool fixed = std::none_of(element.properties.begin(), element.properties.end(),
+                              [](const PlyProperty &_property) { return _property.list; });
+    if (fixed)
+    {
+      p += element.count * recordSize(p, element);
+    }
+    else
+    {
+      for (size_t i = 0; i < element.count; ++i)
+      {
+        p += recordSize(p, element);
+      }
+    }
+    if (p > end)
+    {
+      throw std::runtime_error("ply file is truncated");
+    }
+  }
+  if (std::any_of(vertex.properties.begin(), vertex.properties.end(), [](const PlyProperty &_property) { return _property.list; }))
+  {
+    throw std::runtime_error("ply vertex list properties are not supported");
+  }
+  // the vertices have a fixed size so are split evenly across the pool
+  std::vector<size_t> propertyOffset;
+  size_t stride = 0;
+  for (auto &property : vertex.properties)
+  {
+    propertyOffset.push_back(stride);
+    stride += plySize(property.type);
+  }
+  if (vertexData + vertex.count * stride > end)
+  {
+    throw std::runtime_error("ply file is truncated");
+  }
+  m_pool.parallelFor(vertex.count, 1 << 16, [&](size_t _begin, size_t _end)
+  {
+    std::vector<double> values(vertex.properties.size());
+    for (size_t i = _begin; i < _end; ++i)
+    {
+      const char *record = vertexData + i * stride;
+      for (size_t k = 0; k < values.size(); ++k)
+      {
+        values[k] = readBinary(record + propertyOffset[k], vertex.properties[k].type, swap);
+      }
+      layout.store(values.data(), i, vertices.positions, vertices.normals, vertices.uvs);
+    }
+  });
+
+  // faces have a variable size so one quick walk over their counts finds the chunk starts
+  size_t facesPerChunk = std::max(s_minChunkFaces, face.count / (m_pool.size() * 4) + 1);
+  size_t triangles = 0;
+  for (size_t f = 0; f < face.count; ++f)
+  {
+    if (f % facesPerChunk == 0)
+    {
+      if (!faceChunks.empty())
+      {
+        faceChunks.back().end = p;
+      }
+      FaceChunk chunk;
+      chunk.begin = p;
+      chunk.firstFace = f;
+      chunk.firstTriangle = triangles;
+      faceChunks.push_back(chunk);
+    }
+    size_t size = 0;
+    for (int k = 0; k < static_cast<int>(face.properties.size()); ++k)
+    {
+      const auto &property = face.properties[k];
+      if (property.list)
+      {
+        if (p + size + plySize(property.countType) > end)
+        {
+          throw std::runtime_error("ply file is truncated");
+        }
+        auto count = static_cast<size_t>(readBinary(p + size, property.countType, swap));
+        if (k == indexProperty && count >= 3)
+        {
+          triangles += count - 2;
+          faceChunks.back().triangles += count - 2;
+        }
+        size += plySize(property.countType) + count * plySize(property.type);
+      }
+      else
+      {
+        size += plySize(property.type);
+      }
+    }
+    p += size;
+    ++faceChunks.back().faces;
+  }
+  if (p > end)
+  {
+    throw std::runtime_error("ply file is truncated");
+  }
+  if (!faceChunks.empty())
+  {
+    faceChunks.back().end = p;
+  }
+  m_stats.triangles = triangles;
+  if (triangles == 0)
+  {
+    throw std::runtime_error("no faces");
+  }
+  _allocate(triangles * 3);
+  for (size_t c = 0; c < faceChunks.size(); ++c)
+  {
+    results.push_back(m_pool.submit([&, c]()
+    {
+      const auto &chunk = faceChunks[c];
+      std::vector<float> out(chunk.triangles * 3 * FloatsPerVertex);
+      float *write = out.data();
+      std::vector<size_t> indices;
+      const char *record = chunk.begin;
+      for (size_t f = 0; f < chunk.faces; ++f)
+      {
+        indices.clear();
+        for (int k = 0; k < static_cast<int>(face.properties.size()); ++k)
+        {
+          const auto &property = face.properties[k];
+          if (!property.list)
+          {
+            record += plySize(property.type);
+            continue;
+          }
+          auto count = static_cast<size_t>(readBinary(record, property.countType, swap));
+          record += plySize(property.countType);
+          for (size_t i = 0; i < count; ++i, record += plySize(property.type))
+          {
+            if (k == indexProperty)
+            {
+              double index = readBinary(record, property.type, swap);
+              if (index < 0.0)
+              {
+                throw std::runtime_error("negative face index at " + offsetText(base, record));
+              }
+              indices.push_back(static_cast<size_t>(index));
+            }
+          }
+        }
+        vertices.emitPolygon(write, indices);
+      }
+      return out;
+    }));
+  }
+  streamChunks(results, _upload);
+  return true;
+}
@@ -0,0 +1,128 @@
+/// @file MeshSimplifier.cpp
+/// @brief implementation of the vertex clustering simplifier
+#include "MeshSimplifier.h"
+#include "Bounds.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the clusters of a kept triangle rotated so the smallest comes first, which keeps the
+/// winding so a triangle and its back face are both kept
+//----------------------------------------------------------------------------------------------------------------------
+struct TriangleKey
+{
+  std::array<uint32_t, 3> c;
+  bool operator==(const TriangleKey &_k) const { return c == _k.c; }
+};
+
+struct TriangleKeyHash
+{
+  size_t operator()(const TriangleKey &_k) const
+  {
+    uint64_t h = _k.c[0];
+    h = h * 0x9E3779B97F4A7C15ull ^ _k.c[1];
+    h = h * 0x9E3779B97F4A7C15ull ^ _k.c[2];
+    return static_cast<size_t>(h ^ (h >> 32));
+  }
+};
+
+TriangleKey makeKey(uint32_t _a, uint32_t _b, uint32_t _c)
+{
+  if (_b < _a && _b < _c)
+  {
+    return {{_b, _c, _a}};
+  }
+  if (_c < _a && _c < _b)
+  {
+    return {{_c, _a, _b}};
+  }
+  return {{_a, _b, _c}};
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<char> MeshSimplifier::cluster(const char *_data, size_t _vertices, size_t _stride, size_t _position,
+                                          unsigned int _cells)
+{
+  const size_t triangles = _vertices / 3;
+  const size_t used = triangles * 3;
+  const auto box = Aabb::fromPositions(_data + _position, used, _stride);
+  float extent = 0.0f;
+  for (int a = 0; a < 3; ++a)
+  {
+    extent = std::max(extent, box.m_max[a] - box.m_min[a]);
+  }
+  if (used == 0 || _cells == 0 || !(extent > 0.0f))
+  {
+    return std::vector<char>(_data, _data + used * _stride);
+  }
+  const float cellSize = extent / _cells;
+  uint64_t count[3];
+  for (int a = 0; a < 3; ++a)
+  {
+    count[a] = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil((box.m_max[a] - box.m_min[a]) / cellSize)));
+  }
+  // give every occupied cube a dense id and sum the positions in it
+  std::unordered_map<uint64_t, uint32_t> ids;
+  std::vector<uint32_t> clusterOf(used);
+  std::vector<double> sums;
+  std::vector<uint32_t> members;
+  for (size_t v = 0; v < used; ++v)
+  {
+    float p[3];
+    std::memcpy(p, _data + v * _stride + _position, sizeof(p));
+    uint64_t cell[3];
+    for (int a = 0; a < 3; ++a)
+    {
+      auto i = static_cast<uint64_t>((p[a] - box.m_min[a]) / cellSize);
+      cell[a] = std::min(i, count[a] - 1);
+    }
+    const uint64_t key = cell[0] + count[0] * (cell[1] + count[1] * cell[2]);
+    auto id = ids.emplace(key, static_cast<uint32_t>(members.size()));
+    if (id.second)
+    {
+      sums.insert(sums.end(), {0.0, 0.0, 0.0});
+      members.push_back(0);
+    }
+    const uint32_t c = id.first->second;
+    for (int a = 0; a < 3; ++a)
+    {
+      sums[c * 3 + a] += p[a];
+    }
+    ++members[c];
+    clusterOf[v] = c;
+  }
+  std::vector<float> centres(sums.size());
+  for (size_t c = 0; c < members.size(); ++c)
+  {
+    for (int a = 0; a < 3; ++a)
+    {
+      centres[c * 3 + a] = static_cast<float>(sums[c * 3 + a] / members[c]);
+    }
+  }
+
+  std::vector<char> out;
+  std::unordered_set<TriangleKey, TriangleKeyHash> kept;
+  for (size_t t = 0; t < triangles; ++t)
+  {
+    const uint32_t *c = &clusterOf[t * 3];
+    if (c[0] == c[1] || c[1] == c[2] || c[0] == c[2] || !kept.insert(makeKey(c[0], c[1], c[2])).second)
+    {
+      continue;
+    }
+    const size_t first = out.size();
+    out.insert(out.end(), _data + t * 3 * _stride, _data + (t + 1) * 3 * _stride);
+    for (size_t corner = 0; corner < 3; ++corner)
+    {
+      std::memcpy(out.data() + first + corner * _stride + _position, &centres[c[corner] * 3], 3 * sizeof(float));
+    }
+  }
+  return out;
+}
@@ -1,58 +1,169 @@
 /// @file NGLScene.cpp
 /// @brief basic implementation file for the NGLScene class
 #include "NGLScene.h"
+#include "SceneResources.h"
+#include "MeshImporter.h"
+#include "NormalLines.h"
+#include "RenderThread.h"
+#include "StreamingVAO.h"
 #include <iostream>
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
 #include <ngl/ShaderLib.h>
-#include <array>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <QDebug>
+#include <QFileInfo>
 #include <QMouseEvent>
+#include <QStandardPaths>
 
-const std::array<std::string, 17> s_vboNames = {
-    {"sphere",
-     "cylinder",
-     "cone",
-     "disk",
-     "plane",
-     "torus",
-     "teapot",
-     "octahedron",
-     "dodecahedron",
-     "icosahedron",
-     "tetrahedron",
-     "football",
-     "cube",
-     "troll",
-     "buddah",
-     "dragon",
-     "bunny"}};
-
-constexpr auto NormalShader = "normalShader";
-constexpr auto ColourShader = "nglColourShader";
-constexpr auto PBR = "PBR";
-
-//----------------------------------------------------------------------------------------------------------------------
-NGLScene::NGLScene(QWidget *_parent)
+namespace
+{
+constexpr auto NormalShader = SceneResources::NormalShader;
+constexpr auto NormalLineShader = SceneResources::NormalLineShader;
+constexpr auto AxisShader = SceneResources::AxisShader;
+constexpr auto SoftwareImageShader = SceneResources::SoftwareImageShader;
+/// the stages of paintGL timed by m_profiler, in the order given to its ctor
+enum ProfileStage : size_t
+{
+  TRANSFORM,
+  MATRICES,
+  DRAW,
+  NORMALS,
+  AXIS
+};
+
+/// drawn while the selected primitive is loading, it is built in so always ready
+const std::string s_placeholder = "cube";
+
+/// the triangles drawn by one instance of _vao
+size_t triangleCount(ngl::AbstractVAO *_vao)
+{
+  return _vao != nullptr && _vao->getMode() == GL_TRIANGLES ? _vao->numIndices() / 3 : 0;
+}
+
+std::string cacheDirectory(const char *_name)
+{
+  auto dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  return dir.isEmpty() ? std::string() : (dir + "/" + _name).toStdString();
+}
+
+/// the steady clock in ns, the time base of the input latency on both threads
+int64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/// exact so setting a value again is no change but any real change is seen
+bool differs(const ngl::Vec3 &_a, const ngl::Vec3 &_b)
+{
+  return _a.m_x != _b.m_x || _a.m_y != _b.m_y || _a.m_z != _b.m_z;
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+NGLScene::NGLScene(QWidget *_parent, bool _threaded) : m_threaded(_threaded), m_samples(0),
+  m_transformRing(SceneResources::TransformBinding, sizeof(TransformUBO)),
+  m_profiler({"transform", "matrices", "draw", "normals", "axis"}),
+  m_geometryCache(cacheDirectory("geometry")), m_programCache(cacheDirectory("programs")), m_loader(m_geometryCache)
 {
 
   // set this widget to have the initial keyboard focus
   setFocus();
   // re-size the widget to that of the parent (in this case the GLFrame passed in on construction)
   this->resize(_parent->size());
-  m_drawIndex = 6;
-  m_drawNormals = false;
+  m_meshNames.assign(SceneResources::primitiveNames().begin(), SceneResources::primitiveNames().end());
   /// set all our matrices to the identity
+  m_affine = AffineTransform::identity();
   m_transform = 1.0f;
   m_rotate = 1.0f;
-  m_translate = 1.0f;
-  m_scale = 1.0f;
-  m_normalSize = 6.0f;
-  m_colour.set(0.5f, 0.5f, 0.5f);
 
-  m_matrixOrder = NGLScene::MatrixOrder::RTS;
   m_euler = 1.0f;
-  m_modelPos.set(0.0f, 0.0f, 0.0f);
+  TransformBatch::quaternionFromEuler(0.0f, 0.0f, 0.0f, m_orientation);
+  m_quaternionRotate = 1.0f;
+  m_instanceSpacing = 2.0f;
+  m_instancesDirty = true;
+  m_instanceBuffer = 0;
+  m_instanceUploadDirty = true;
+  m_drawnInstances = 0;
+  m_objectLod = LodSelector::NoLevel;
+  m_lodFirst.fill(0);
+  m_lodCount.fill(0);
+  m_lodGrouped = false;
+  m_matrixEmitted = false;
+  m_pendingEdits = 0;
+  m_editDepth = 0;
+  m_commitQueued = false;
+  m_firstEditNs = 0;
+  m_frameInputNs = 0;
+  m_frameShown = false;
+  m_prefetch = true;
+  m_prefetchStarted = false;
+  m_softwareTextures[0] = 0;
+  m_softwareTextures[1] = 0;
+  m_softwareVAO = 0;
+  // the render thread's signals are queued so their arguments have to be copyable by Qt
+  qRegisterMetaType<ngl::Mat4>("ngl::Mat4");
+  if (m_threaded)
+  {
+    // the frames are blitted into the widget and a blit into a multisampled framebuffer isn't
+    // allowed, so the multisampling moves to the render thread's framebuffers
+    auto format = QSurfaceFormat::defaultFormat();
+    m_samples = format.samples() > 0 ? format.samples() : 0;
+    format.setSamples(0);
+    setFormat(format);
+  }
+  m_loadTimer.setInterval(10);
+  connect(&m_loadTimer, &QTimer::timeout, this, &NGLScene::pollLoader);
+  // the rest of the primitives are only loaded once the first frame is on screen
+  connect(this, &QOpenGLWidget::frameSwapped, this, [this]()
+          {
+            if (m_prefetch && !m_prefetchStarted && m_frameShown)
+            {
+              startPrefetch();
+            }
+          });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+NGLScene::~NGLScene()
+{
+  if (m_renderThread)
+  {
+    // the scene is released on the render thread before it exits
+    m_renderThread->stop();
+    makeCurrent();
+    m_renderThread->releaseGL(context());
+    doneCurrent();
+    m_renderThread.reset();
+  }
+  else if (m_instanceBuffer != 0)
+  {
+    makeCurrent();
+    releaseScene();
+    doneCurrent();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::releaseScene()
+{
+  glDeleteBuffers(1, &m_instanceBuffer);
+  m_instanceBuffer = 0;
+  m_transformRing.releaseGL();
+  m_normalLines.clear();
+  m_loader.releaseGL();
+  m_profiler.releaseGL();
+  if (m_software)
+  {
+    // made again in the next context if software rendering is still on
+    glDeleteTextures(2, m_softwareTextures);
+    glDeleteVertexArrays(1, &m_softwareVAO);
+    m_software.reset();
+  }
 }
 
 // This virtual function is called once before the first call to paintGL() or resizeGL(),
@@ -61,6 +172,36 @@ NGLScene::NGLScene(QWidget *_parent)
 
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::initializeGL()
+{
+  if (m_threaded)
+  {
+    RenderThread::Callbacks callbacks;
+    // the loader's worker would need a surface made on the gui thread, the render thread
+    // builds the primitives itself between frames instead
+    callbacks.initialize = [this]() { initializeScene(nullptr); };
+    callbacks.frame = [this]() { return renderThreadFrame(); };
+    callbacks.release = [this]() { releaseScene(); };
+    callbacks.presented = [this]() { QMetaObject::invokeMethod(this, [this]() { update(); }, Qt::QueuedConnection); };
+    m_renderThread = std::make_unique<RenderThread>(context(), m_samples, std::move(callbacks));
+    if (m_renderThread->isValid())
+    {
+      m_renderThread->start();
+      return;
+    }
+    m_renderThread.reset();
+  }
+  initializeScene(context());
+  if (m_threaded)
+  {
+    // only reached when the render thread couldn't start, the status bar says so after the startup times
+    m_startup += ", the render thread's context couldn't be made so the gui thread draws";
+  }
+  // meshes given on the command line before the context existed
+  runGLJobs();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::initializeScene(QOpenGLContext *_loaderShare)
 {
   ngl::NGLInit::initialize();
 
@@ -79,59 +220,30 @@ void NGLScene::initializeGL()
   // The final two are near and far clipping planes of 0.5 and 10
   m_project = ngl::perspective(45.0f, 720.0f / 576.0f, 0.5f, 10.0f);
 
-  ngl::VAOPrimitives::createSphere("sphere", 1.0f, 40.0f);
-  ngl::VAOPrimitives::createCylinder("cylinder", 0.5f, 1.4f, 40.0f, 40.0f);
-  ngl::VAOPrimitives::createCone("cone", 0.5f, 1.4f, 20.0f, 20.0f);
-  ngl::VAOPrimitives::createDisk("disk", 0.5f, 40.0f);
-  ngl::VAOPrimitives::createTrianglePlane("plane", 1.0f, 1.0f, 10.0f, 10.0f, ngl::Vec3(0.0f, 1.0f, 0.0f));
-  ngl::VAOPrimitives::createTorus("torus", 0.15f, 0.4f, 40.0f, 40.0f);
+  QElapsedTimer geometryTimer;
+  geometryTimer.start();
+  // the generated primitives are made when first selected, only the axis is needed now
+  m_loader.initializeGL(_loaderShare);
+  m_loader.request(m_meshNames[m_frame.drawIndex]);
+  requestLods();
+  m_axis.reset(new Axis(AxisShader, 1.5f, &m_geometryCache));
+  m_startup = QString("startup geometry %1 ms %2")
+                  .arg(geometryTimer.nsecsElapsed() / 1.0e6, 0, 'f', 1)
+                  .arg(QString::fromStdString(m_geometryCache.summary()))
+                  .toStdString();
   // set the bg colour
   glClearColor(0.5, 0.5, 0.5, 0.0);
-  m_axis.reset(new Axis(ColourShader, 1.5f));
-  // load the normal shader
-
-  ngl::ShaderLib::loadShader(PBR, "shaders/PBRVertex.glsl", "shaders/PBRFragment.glsl");
-  ngl::ShaderLib::use(PBR);
-  ngl::ShaderLib::setUniform("camPos", from);
-  // these are "uniform" so will retain their values
-  ngl::ShaderLib::setUniform("lightPosition", 0.0f, 2.0f, 2.0f);
-  ngl::ShaderLib::setUniform("lightColor", 400.0f, 400.0f, 400.0f);
-  ngl::ShaderLib::setUniform("exposure", 2.2f);
-  ngl::ShaderLib::setUniform("albedo", 0.950f, 0.71f, 0.29f);
-
-  ngl::ShaderLib::setUniform("metallic", 1.02f);
-  ngl::ShaderLib::setUniform("roughness", 0.38f);
-  ngl::ShaderLib::setUniform("ao", 0.2f);
-
-  ngl::ShaderLib::createShaderProgram(NormalShader);
-  constexpr auto normalVert = "normalVertex";
-  constexpr auto normalGeo = "normalGeo";
-  constexpr auto normalFrag = "normalFrag";
-
-  ngl::ShaderLib::attachShader(normalVert, ngl::ShaderType::VERTEX);
-  ngl::ShaderLib::attachShader(normalFrag, ngl::ShaderType::FRAGMENT);
-  ngl::ShaderLib::loadShaderSource(normalVert, "shaders/normalVertex.glsl");
-  ngl::ShaderLib::loadShaderSource(normalFrag, "shaders/normalFragment.glsl");
-
-  ngl::ShaderLib::compileShader(normalVert);
-  ngl::ShaderLib::compileShader(normalFrag);
-  ngl::ShaderLib::attachShaderToProgram(NormalShader, normalVert);
-  ngl::ShaderLib::attachShaderToProgram(NormalShader, normalFrag);
-
-  ngl::ShaderLib::attachShader(normalGeo, ngl::ShaderType::GEOMETRY);
-  ngl::ShaderLib::loadShaderSource(normalGeo, "shaders/normalGeo.glsl");
-  ngl::ShaderLib::compileShader(normalGeo);
-  ngl::ShaderLib::attachShaderToProgram(NormalShader, normalGeo);
-
-  ngl::ShaderLib::linkProgramObject(NormalShader);
-  ngl::ShaderLib::use(NormalShader);
-  // now pass the modelView and projection values to the shader
-  ngl::ShaderLib::setUniform("normalSize", 0.1f);
-  ngl::ShaderLib::setUniform("vertNormalColour", 1.0f, 1.0f, 0.0f, 1.0f);
-  ngl::ShaderLib::setUniform("faceNormalColour", 1.0f, 0.0f, 0.0f, 1.0f);
-
-  ngl::ShaderLib::setUniform("drawFaceNormals", true);
-  ngl::ShaderLib::setUniform("drawVertexNormals", true);
+  QElapsedTimer shaderTimer;
+  shaderTimer.start();
+  SceneResources::loadShaders(from, &m_programCache);
+  m_startup += QString(", shaders %1 ms %2")
+                   .arg(shaderTimer.nsecsElapsed() / 1.0e6, 0, 'f', 1)
+                   .arg(QString::fromStdString(m_programCache.summary()))
+                   .toStdString();
+  // the status bar shows "ubo orphan" instead of "ubo ring" if glBufferStorage isn't available
+  m_transformRing.initializeGL();
+  glGenBuffers(1, &m_instanceBuffer);
+  m_profiler.initializeGL();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -139,103 +251,738 @@ void NGLScene::initializeGL()
 // The new size is passed in width and height.
 void NGLScene::resizeGL(int _w, int _h)
 {
-  glViewport(0, 0, _w, _h);
-  m_project = ngl::perspective(45.0f, static_cast<float>(_w) / _h, 0.05f, 450.0f);
+  if (!m_renderThread)
+  {
+    glViewport(0, 0, _w, _h);
+  }
+  // the projection is made from the size when the render side takes it
+  m_params.width = _w;
+  m_params.height = _h;
+  m_params.pixelRatio = static_cast<float>(devicePixelRatioF());
+  publishParams(0);
 }
 
 void NGLScene::loadMatricesToShader()
 {
   ngl::ShaderLib::use("PBR");
-  struct transform
+  // the UBO keeps its contents so it only needs re-building and uploading when
+  // one of the matrices it is made from has changed
+  if (m_state.isDirty(TransformState::ALL))
   {
-    ngl::Mat4 MVP;
-    ngl::Mat4 normalMatrix;
-    ngl::Mat4 M;
-  };
+    // when instancing the per instance matrices already contain m_transform, the model
+    // matrix is only expanded to 4x4 here for the upload
+    auto model = AffineTransform::fromMat4(&m_mouseGlobalTX.m_openGL[0]);
+    if (!m_frame.instanced)
+    {
+      model = model * m_affine;
+    }
+    model.toMat4(&m_transformUBO.M.m_openGL[0]);
+
+    m_transformUBO.MVP = m_project * m_view * m_transformUBO.M;
+    // the mouse transform is a rotation and every order but GIMBALLOCK is a rotation times the
+    // scale, so the shape of the model matrix is known and the normal matrix needs no inverse
+    const float scale[3] = {m_frame.scale.m_x, m_frame.scale.m_y, m_frame.scale.m_z};
+    auto linear = m_frame.instanced ? AffineTransform::Linear::ROTATION
+                                    : AffineTransform::classify(scale, m_frame.order != MatrixOrder::GIMBALLOCK);
+    model.normalMatrix(linear, scale, &m_transformUBO.normalMatrix[0][0], 4);
+    m_transformRing.upload(&m_transformUBO);
+    ++m_stats.uboRecomputes;
+  }
+  else
+  {
+    ++m_stats.uboSkipped;
+  }
+  ngl::ShaderLib::setUniform("albedo", m_frame.colour);
+}
 
-  transform t;
-  t.M = m_mouseGlobalTX * m_transform;
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::composeTransform()
+{
+  if (!m_state.isDirty(TransformState::transformComponents(m_frame.order)))
+  {
+    ++m_stats.transformSkipped;
+    ++m_stats.signalsSkipped;
+    return;
+  }
+  ++m_stats.transformRecomputes;
+  // every order is a translation, a rotation and a scale so only the rotation differs, the
+  // closed form composition never does a 4x4 multiply
+  const ngl::Mat4 *rotation = &m_rotate;
+  switch (m_frame.order)
+  {
+  case MatrixOrder::EULERTS:
+  case MatrixOrder::TEULERS:
+    rotation = &m_euler;
+    break;
+  case MatrixOrder::GIMBALLOCK:
+    rotation = &m_gimbal;
+    break;
+  case MatrixOrder::QUATERNION:
+    rotation = &m_quaternionRotate;
+    break;
+  default:
+    break;
+  }
+  TransformComponents components;
+  components.translate[0] = m_frame.translate.m_x;
+  components.translate[1] = m_frame.translate.m_y;
+  components.translate[2] = m_frame.translate.m_z;
+  components.scale[0] = m_frame.scale.m_x;
+  components.scale[1] = m_frame.scale.m_y;
+  components.scale[2] = m_frame.scale.m_z;
+  for (int c = 0; c < 3; ++c)
+  {
+    for (int r = 0; r < 3; ++r)
+    {
+      components.rotate[c * 3 + r] = rotation->m_m[c][r];
+    }
+  }
+  m_affine = composeAffine(m_frame.order, components);
+  m_affine.toMat4(&m_transform.m_openGL[0]);
+  // a change of input doesn't always change the result (e.g. setting the same value again)
+  // so only tell the ui when the matrix really is different
+  if (!m_matrixEmitted || std::memcmp(m_transform.openGL(), m_emittedTransform.openGL(), 16 * sizeof(ngl::Real)) != 0)
+  {
+    m_emittedTransform = m_transform;
+    m_matrixEmitted = true;
+    ++m_stats.signalsEmitted;
+    emit matrixDirty(m_transform);
+  }
+  else
+  {
+    ++m_stats.signalsSkipped;
+  }
+}
 
-  t.MVP = m_project * m_view * t.M;
-  t.normalMatrix = t.M;
-  t.normalMatrix.inverse().transpose();
-  ngl::ShaderLib::setUniformBuffer("TransformUBO", sizeof(transform), &t.MVP.m_00);
-  ngl::ShaderLib::setUniform("albedo", m_colour);
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::composeMouseTransform()
+{
+  if (!m_state.isDirty(TransformState::MOUSESPIN | TransformState::MODELPOS))
+  {
+    ++m_stats.mouseSkipped;
+    return;
+  }
+  ++m_stats.mouseRecomputes;
+  if (m_state.isDirty(TransformState::MOUSESPIN))
+  {
+    if (m_frame.arcballMode)
+    {
+      TransformBatch::quaternionToMatrix(m_frame.arcball, &m_mouseRotation.m_openGL[0]);
+    }
+    else
+    {
+      // Rotation based on the mouse position for our global transform
+      auto rotX = ngl::Mat4::rotateX(m_frame.spinX);
+      auto rotY = ngl::Mat4::rotateY(m_frame.spinY);
+      // multiply the rotations
+      m_mouseRotation = rotY * rotX;
+    }
+  }
+  m_mouseGlobalTX = m_mouseRotation;
+  // add the translations
+  m_mouseGlobalTX.m_m[3][0] = m_frame.modelPos.m_x;
+  m_mouseGlobalTX.m_m[3][1] = m_frame.modelPos.m_y;
+  m_mouseGlobalTX.m_m[3][2] = m_frame.modelPos.m_z;
 }
+
 //----------------------------------------------------------------------------------------------------------------------
 // This virtual function is called whenever the widget needs to be painted.
-// this is our main drawing routine
+// this is our main drawing routine, when threaded it only shows the latest finished frame
 void NGLScene::paintGL()
 {
+  const int64_t start = nowNs();
+  int64_t inputNs = 0;
+  if (m_renderThread)
+  {
+    const qreal ratio = devicePixelRatioF();
+    auto blit = m_renderThread->blit(context(), defaultFramebufferObject(), static_cast<int>(width() * ratio),
+                                     static_cast<int>(height() * ratio));
+    m_frameShown = m_frameShown || blit.drawn;
+    // a frame shown again (e.g. after an expose) has had its latency counted already
+    inputNs = blit.fresh ? blit.inputNs : 0;
+  }
+  else
+  {
+    takeParams();
+    renderFrame();
+    inputNs = m_frameInputNs;
+    m_frameInputNs = 0;
+    m_frameShown = true;
+  }
+  const int64_t end = nowNs();
+  m_guiStall.push((end - start) / 1.0e6);
+  if (inputNs != 0)
+  {
+    const double latency = (end - inputNs) / 1.0e6;
+    m_inputLatency.push(latency);
+    emit inputLatency(latency);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NGLScene::renderThreadFrame()
+{
+  bool changed = runGLJobs();
+  const bool loading = m_loader.busy();
+  if (loading && m_loader.poll())
+  {
+    changed = true;
+  }
+  if (takeParams())
+  {
+    changed = true;
+  }
+  // the first frame is drawn whatever happened, once the size is known
+  if ((changed || m_stats.frames == 0) && m_frame.width > 0 && m_frame.height > 0)
+  {
+    m_renderThread->bindTarget(static_cast<int>(m_frame.width * m_frame.pixelRatio),
+                               static_cast<int>(m_frame.height * m_frame.pixelRatio));
+    renderFrame();
+    m_renderThread->present(m_frameInputNs);
+    m_frameInputNs = 0;
+  }
+  if (loading && !m_loader.busy())
+  {
+    m_loaderSummary = m_loader.summary();
+  }
+  return m_loader.busy();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::renderFrame()
+{
+  m_frameTimer.start();
+  m_profiler.beginFrame();
+  ++m_stats.frames;
   // clear the screen and depth buffer
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  // Rotation based on the mouse position for our global
-  // transform
-
-  m_transform.identity();
+  {
+    FrameProfiler::Scope scope(m_profiler, TRANSFORM);
+    // only the parts of the transform whose inputs changed since the last frame are
+    // rebuilt, a repaint from a resize or expose reuses everything
+    composeTransform();
+    composeMouseTransform();
+  }
+  {
+    FrameProfiler::Scope scope(m_profiler, MATRICES);
+    // now set this value in the shader for the current ModelMatrix
+    loadMatricesToShader();
+  }
 
-  if (m_matrixOrder == NGLScene::MatrixOrder::RTS)
+  if (m_frame.wireframe)
   {
-    m_transform = m_rotate * m_translate * m_scale;
+    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+  }
+  else
+  {
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
   }
 
-  else if (m_matrixOrder == NGLScene::MatrixOrder::TRS)
+  bool software = false;
   {
-    m_transform = m_translate * m_rotate * m_scale;
+    FrameProfiler::Scope scope(m_profiler, DRAW);
+    if (m_frame.instanced)
+    {
+      drawInstanced();
+    }
+    else if (m_frame.software && drawSoftware())
+    {
+      software = true;
+    }
+    else
+    {
+      drawObject();
+    }
   }
-  else if (m_matrixOrder == NGLScene::MatrixOrder::EULERTS)
+  // the normals are only drawn for the single object
+  if (m_frame.drawNormals && !m_frame.instanced)
   {
-    m_transform = m_translate * m_euler * m_scale;
+    FrameProfiler::Scope scope(m_profiler, NORMALS);
+    auto lines = m_frame.geometryShaderNormals ? nullptr : normalLines(drawName());
+    ngl::ShaderLib::use(lines != nullptr ? NormalLineShader : NormalShader);
+    // not instanced so this is the MVP of the object
+    ngl::ShaderLib::setUniform("MVP", m_transformUBO.MVP);
+    ngl::ShaderLib::setUniform("normalSize", m_frame.normalSize / 10.0f);
+    if (lines != nullptr)
+    {
+      lines->bind();
+      lines->draw();
+      lines->unbind();
+    }
+    else
+    {
+      ngl::VAOPrimitives::draw(drawName());
+    }
   }
-  else if (m_matrixOrder == NGLScene::MatrixOrder::TEULERS)
   {
-    m_transform = m_euler * m_translate * m_scale;
+    FrameProfiler::Scope scope(m_profiler, AXIS);
+    m_axis->draw(m_view, m_project, m_mouseGlobalTX);
   }
+  m_state.clean();
+  m_transformRing.endFrame();
+  m_profiler.endFrame();
+  // copied for the gui, which may be reading the last report while this one is made
+  auto &report = m_reports.back();
+  report.stats = m_stats;
+  report.cull = m_cullStats;
+  report.lod = m_lodStats;
+  report.ring = m_transformRing.summary();
+  report.profile = m_profiler.summary();
+  report.software = software ? m_software->stats().summary() : std::string();
+  report.startup = m_startup;
+  report.loader = m_loaderSummary;
+  m_reports.publish();
+  // the gpu time comes from the profiler's queries so neither mode has to wait for the gpu
+  emit frameTime(m_frameTimer.nsecsElapsed() / 1.0e6, m_profiler.lastGPUFrameMs(),
+                 m_frame.instanced ? m_frame.instanceCount : 1);
+}
 
-  else if (m_matrixOrder == NGLScene::MatrixOrder::GIMBALLOCK)
+//----------------------------------------------------------------------------------------------------------------------
+const NGLScene::FrameReport &NGLScene::frameReport()
+{
+  m_reports.take();
+  return m_reports.front();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::History::push(double _value)
+{
+  samples[next] = _value;
+  next = (next + 1) % samples.size();
+  count = std::min(count + 1, samples.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+double NGLScene::History::mean() const
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < count; ++i)
   {
-    m_transform = m_translate * m_gimbal * m_scale;
+    sum += samples[i];
   }
-  emit matrixDirty(m_transform);
-  // now set this value in the shader for the current ModelMatrix
-  ngl::ShaderLib::use(PBR);
+  return count > 0 ? sum / count : 0.0;
+}
 
-  // Rotation based on the mouse position for our global transform
-  auto rotX = ngl::Mat4::rotateX(m_win.spinXFace);
-  auto rotY = ngl::Mat4::rotateY(m_win.spinYFace);
-  // multiply the rotations
-  m_mouseGlobalTX = rotY * rotX;
-  // add the translations
-  m_mouseGlobalTX.m_m[3][0] = m_modelPos.m_x;
-  m_mouseGlobalTX.m_m[3][1] = m_modelPos.m_y;
-  m_mouseGlobalTX.m_m[3][2] = m_modelPos.m_z;
+//----------------------------------------------------------------------------------------------------------------------
+double NGLScene::History::max() const
+{
+  return count > 0 ? *std::max_element(samples.begin(), samples.begin() + count) : 0.0;
+}
 
-  loadMatricesToShader();
+//----------------------------------------------------------------------------------------------------------------------
+NGLScene::LatencyStats NGLScene::latencyStats() const
+{
+  LatencyStats stats;
+  stats.inputMs = m_inputLatency.mean();
+  stats.maxInputMs = m_inputLatency.max();
+  stats.stallMs = m_guiStall.mean();
+  stats.maxStallMs = m_guiStall.max();
+  if (m_renderThread)
+  {
+    stats.framesDropped = m_renderThread->framesPresented() - m_renderThread->framesShown();
+  }
+  return stats;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::updateInstances()
+{
+  // lay the copies out on a grid centred on the origin, the offset is added to the ui
+  // translation so each copy is composed in the current matrix order
+  size_t count = static_cast<size_t>(m_frame.instanceCount);
+  int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(count))));
+  float origin = -0.5f * m_instanceSpacing * (side - 1);
+  m_instanceParams.resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    float ox = origin + m_instanceSpacing * (i % side);
+    float oy = origin + m_instanceSpacing * ((i / side) % side);
+    float oz = origin + m_instanceSpacing * (i / (side * side));
+    const auto &p = m_frame;
+    m_instanceParams.set(i, p.translate.m_x + ox, p.translate.m_y + oy, p.translate.m_z + oz,
+                         p.rotate.m_x, p.rotate.m_y, p.rotate.m_z,
+                         p.scale.m_x, p.scale.m_y, p.scale.m_z,
+                         p.eulerAngle, p.eulerAxis.m_x, p.eulerAxis.m_y, p.eulerAxis.m_z);
+  }
+  m_instanceData.resize(count * (16 + 9));
+  TransformBatch::compose(m_frame.order, m_instanceParams, m_instanceData.data());
+  TransformBatch::normalMatrices(m_instanceData.data(), count, m_instanceData.data() + count * 16);
+  m_instancesDirty = false;
+  m_boundsName.clear();
+  m_instanceUploadDirty = true;
+}
 
-  if (m_wireframe)
+//----------------------------------------------------------------------------------------------------------------------
+const Aabb &NGLScene::meshBounds(const std::string &_name)
+{
+  auto bounds = m_meshBounds.find(_name);
+  if (bounds == m_meshBounds.end())
   {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    // a mesh that can't be read back gets an empty box, and its instances are never culled
+    auto box = Aabb::empty();
+    auto *vao = ngl::VAOPrimitives::getVAOFromName(_name);
+    std::vector<GeometryCache::Attribute> attributes;
+    std::vector<char> data;
+    if (vao != nullptr && GeometryCache::readBack(vao, attributes, data))
+    {
+      for (auto &a : attributes)
+      {
+        size_t stride = a.stride != 0 ? a.stride : 3 * sizeof(float);
+        if (a.location == 0 && a.type == GL_FLOAT && a.size == 3 && data.size() >= a.offset + 3 * sizeof(float))
+        {
+          size_t vertices = std::min(vao->numIndices(), (data.size() - a.offset - 3 * sizeof(float)) / stride + 1);
+          box = Aabb::fromPositions(data.data() + a.offset, vertices, stride);
+        }
+      }
+    }
+    bounds = m_meshBounds.emplace(_name, box).first;
+  }
+  return bounds->second;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::updateInstanceBounds()
+{
+  auto start = std::chrono::steady_clock::now();
+  const auto &mesh = meshBounds(drawName());
+  const size_t count = static_cast<size_t>(m_frame.instanceCount);
+  m_instanceBounds.resize(count);
+  if (!mesh.isEmpty())
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      m_instanceBounds[i] = mesh.transformed(&m_instanceData[i * 16]);
+    }
+  }
+  // every instance is made from the same ui values so they have all moved, but only a change
+  // in their number needs a new tree
+  if (m_instanceBVH.size() != count)
+  {
+    m_instanceBVH.build(m_instanceBounds.data(), count);
   }
   else
   {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    m_instanceBVH.refit(m_instanceBounds.data());
   }
+  m_boundsName = drawName();
+  m_cullStats.refitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
-  ngl::VAOPrimitives::draw(s_vboNames[m_drawIndex]);
-  if (m_drawNormals)
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::cullInstances()
+{
+  const size_t count = static_cast<size_t>(m_frame.instanceCount);
+  const bool cull = m_frame.frustumCull && !meshBounds(drawName()).isEmpty();
+  m_cullStats.queryMs = 0.0;
+  if (cull)
+  {
+    auto start = std::chrono::steady_clock::now();
+    // the boxes are in the space before the mouse transform, so that goes into the frustum
+    // instead and spinning the view doesn't need a refit
+    auto clip = m_project * m_view * m_mouseGlobalTX;
+    m_instanceBVH.query(Frustum(&clip.m_openGL[0]), m_cullResult);
+    if (m_cullResult != m_visibleInstances)
+    {
+      m_visibleInstances.swap(m_cullResult);
+      m_instanceUploadDirty = true;
+    }
+    m_cullStats.queryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+  m_cullStats.visible = cull ? m_visibleInstances.size() : count;
+  m_cullStats.culled = count - m_cullStats.visible;
+  if (selectInstanceLods(cull))
   {
-    ngl::ShaderLib::use(NormalShader);
-    ngl::Mat4 MV;
-    ngl::Mat4 MVP;
+    m_instanceUploadDirty = true;
+  }
+  if (!m_instanceUploadDirty)
+  {
+    return;
+  }
+  const float *data = m_instanceData.data();
+  if (cull || m_lodGrouped)
+  {
+    const auto &order = m_lodGrouped ? m_drawOrder : m_visibleInstances;
+    const size_t drawn = order.size();
+    m_visibleData.resize(drawn * (16 + 9));
+    for (size_t v = 0; v < drawn; ++v)
+    {
+      const size_t i = order[v];
+      std::memcpy(&m_visibleData[v * 16], &m_instanceData[i * 16], 16 * sizeof(float));
+      std::memcpy(&m_visibleData[drawn * 16 + v * 9], &m_instanceData[count * 16 + i * 9], 9 * sizeof(float));
+    }
+    data = m_visibleData.data();
+  }
+  m_drawnInstances = m_cullStats.visible;
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+  glBufferData(GL_ARRAY_BUFFER, m_drawnInstances * (16 + 9) * sizeof(float), data, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  m_instanceUploadDirty = false;
+}
 
-    MV = m_view * m_mouseGlobalTX * m_transform;
-    MVP = m_project * MV;
-    ngl::ShaderLib::setUniform("MVP", MVP);
-    ngl::ShaderLib::setUniform("normalSize", m_normalSize / 10.0f);
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::drawInstanced()
+{
+  if (m_instancesDirty)
+  {
+    updateInstances();
+  }
+  m_cullStats.refitMs = 0.0;
+  if (m_boundsName != drawName())
+  {
+    updateInstanceBounds();
+  }
+  cullInstances();
+  m_lodStats.triangles = 0;
+  m_lodStats.objects.clear();
+  if (m_lodGrouped)
+  {
+    m_lodStats.objects.assign(m_lodCount.begin(), m_lodCount.begin() + m_lodSelector.levels());
+  }
+  if (m_drawnInstances == 0)
+  {
+    return;
+  }
+  ngl::ShaderLib::setUniform("instanced", true);
+  const size_t normalOffset = m_drawnInstances * 16 * sizeof(float);
+  // each level is a run of the buffer, without level of detail it is all level 0
+  for (size_t level = 0; level < m_lodSelector.levels(); ++level)
+  {
+    const size_t first = m_lodFirst[level];
+    const size_t instances = m_lodCount[level];
+    if (instances == 0)
+    {
+      continue;
+    }
+    auto *vao = ngl::VAOPrimitives::getVAOFromName(lodDrawName(level));
+    vao->bind();
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    // the model matrix uses attributes 3-6 and the normal matrix 7-9, one of each per instance
+    for (GLuint c = 0; c < 4; ++c)
+    {
+      glEnableVertexAttribArray(3 + c);
+      glVertexAttribPointer(3 + c, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float),
+                            reinterpret_cast<void *>((first * 16 + c * 4) * sizeof(float)));
+      glVertexAttribDivisor(3 + c, 1);
+    }
+    for (GLuint c = 0; c < 3; ++c)
+    {
+      glEnableVertexAttribArray(7 + c);
+      glVertexAttribPointer(7 + c, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float),
+                            reinterpret_cast<void *>(normalOffset + (first * 9 + c * 3) * sizeof(float)));
+      glVertexAttribDivisor(7 + c, 1);
+    }
+    glDrawArraysInstanced(vao->getMode(), 0, static_cast<GLsizei>(vao->numIndices()), static_cast<GLsizei>(instances));
+    m_lodStats.triangles += instances * triangleCount(vao);
+    // leave the primitive's vao as we found it for the normal draws
+    for (GLuint a = 3; a < 10; ++a)
+    {
+      glVertexAttribDivisor(a, 0);
+      glDisableVertexAttribArray(a);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vao->unbind();
+  }
+  ngl::ShaderLib::setUniform("instanced", false);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NGLScene::selectInstanceLods(bool _cull)
+{
+  const size_t count = static_cast<size_t>(m_frame.instanceCount);
+  const size_t drawn = _cull ? m_visibleInstances.size() : count;
+  const auto &name = drawName();
+  m_lodStats.changes = 0;
+  if (!m_frame.lod || !SceneResources::hasLods(name) || meshBounds(name).isEmpty())
+  {
+    m_lodFirst.fill(0);
+    m_lodCount.fill(0);
+    m_lodCount[0] = drawn;
+    // a buffer grouped by level has to go back to the plain order
+    const bool wasGrouped = m_lodGrouped;
+    m_lodGrouped = false;
+    return wasGrouped;
+  }
+  m_instanceLods.resize(count, LodSelector::NoLevel);
+  // the same clip matrix as the culling, so spinning the view needs no new instance data
+  auto clip = m_project * m_view * m_mouseGlobalTX;
+  const uint32_t *instances = _cull ? m_visibleInstances.data() : nullptr;
+  m_lodStats.changes = m_lodSelector.select(meshBounds(name), m_instanceData.data(), instances, drawn,
+                                            &clip.m_openGL[0], pixelScale(), m_instanceLods.data(), &m_pool);
+  if (m_lodStats.changes == 0 && m_lodGrouped && !m_instanceUploadDirty)
+  {
+    return false;
+  }
+  // counting sort of the drawn instances by level, keeping their order within each level
+  m_lodCount.fill(0);
+  for (size_t i = 0; i < drawn; ++i)
+  {
+    ++m_lodCount[m_instanceLods[instances != nullptr ? instances[i] : i]];
+  }
+  size_t first = 0;
+  for (size_t level = 0; level < m_lodCount.size(); ++level)
+  {
+    m_lodFirst[level] = first;
+    first += m_lodCount[level];
+  }
+  auto next = m_lodFirst;
+  m_drawOrder.resize(drawn);
+  for (size_t i = 0; i < drawn; ++i)
+  {
+    const uint32_t instance = instances != nullptr ? instances[i] : static_cast<uint32_t>(i);
+    m_drawOrder[next[m_instanceLods[instance]]++] = instance;
+  }
+  m_lodGrouped = true;
+  return true;
+}
 
-    ngl::VAOPrimitives::draw(s_vboNames[m_drawIndex]);
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::drawObject()
+{
+  const auto &name = drawName();
+  std::string drawn = name;
+  m_lodStats.changes = 0;
+  m_lodStats.objects.clear();
+  if (m_frame.lod && SceneResources::hasLods(name) && !meshBounds(name).isEmpty())
+  {
+    // m_transform is the composition for the current order, so its translation and scale
+    // decide how big the object is
+    auto clip = m_project * m_view * m_mouseGlobalTX;
+    float pixels = LodSelector::screenSize(meshBounds(name), &m_transform.m_openGL[0], &clip.m_openGL[0], pixelScale());
+    uint8_t level = m_lodSelector.select(pixels, m_objectLod);
+    m_lodStats.changes = level != m_objectLod ? 1 : 0;
+    m_objectLod = level;
+    m_lodStats.objects.assign(m_lodSelector.levels(), 0);
+    m_lodStats.objects[level] = 1;
+    drawn = lodDrawName(level);
   }
-  m_axis->draw(m_view, m_project, m_mouseGlobalTX);
+  m_lodStats.triangles = triangleCount(ngl::VAOPrimitives::getVAOFromName(drawn));
+  ngl::VAOPrimitives::draw(drawn);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const NGLScene::SoftwareMesh &NGLScene::softwareMesh(const std::string &_name)
+{
+  auto found = m_softwareMeshes.find(_name);
+  if (found != m_softwareMeshes.end())
+  {
+    return found->second;
+  }
+  SoftwareMesh mesh;
+  auto *vao = ngl::VAOPrimitives::getVAOFromName(_name);
+  std::vector<GeometryCache::Attribute> attributes;
+  if (vao == nullptr || vao->getMode() != GL_TRIANGLES || !GeometryCache::readBack(vao, attributes, mesh.data))
+  {
+    // not kept, a mesh with no VAO yet may still get one
+    static const SoftwareMesh none;
+    return none;
+  }
+  const GeometryCache::Attribute *position = nullptr;
+  const GeometryCache::Attribute *normal = nullptr;
+  for (auto &a : attributes)
+  {
+    if (a.type != GL_FLOAT || a.size != 3)
+    {
+      continue;
+    }
+    if (a.location == 0)
+    {
+      position = &a;
+    }
+    else if (a.location == 1)
+    {
+      normal = &a;
+    }
+  }
+  // the rasterizer reads both from one interleaved vertex
+  auto &entry = m_softwareMeshes[_name];
+  if (position != nullptr && normal != nullptr && position->stride == normal->stride && position->stride != 0)
+  {
+    entry.data = std::move(mesh.data);
+    const size_t end = std::max(position->offset, normal->offset) + 3 * sizeof(float);
+    entry.mesh.data = entry.data.data();
+    entry.mesh.stride = position->stride;
+    entry.mesh.position = position->offset;
+    entry.mesh.normal = normal->offset;
+    entry.mesh.vertices = entry.data.size() < end ? 0 : std::min(vao->numIndices(), (entry.data.size() - end) / position->stride + 1);
+  }
+  return entry;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NGLScene::drawSoftware()
+{
+  const auto &mesh = softwareMesh(drawName());
+  if (mesh.mesh.data == nullptr)
+  {
+    return false;
+  }
+  if (!m_software)
+  {
+    if (!m_softwarePool)
+    {
+      m_softwarePool = std::make_unique<ThreadPool>();
+    }
+    m_software = std::make_unique<SoftwareRasterizer>(*m_softwarePool);
+    glGenTextures(2, m_softwareTextures);
+    glGenVertexArrays(1, &m_softwareVAO);
+  }
+  // the matrices are the ones loadMatricesToShader gave GL
+  SoftwareRasterizer::Transforms transforms;
+  static_assert(sizeof(transforms) == sizeof(m_transformUBO), "the software transforms must have the TransformUBO layout");
+  std::memcpy(&transforms, &m_transformUBO, sizeof(transforms));
+  SoftwareRasterizer::Material material;
+  material.albedo[0] = m_frame.colour.m_x;
+  material.albedo[1] = m_frame.colour.m_y;
+  material.albedo[2] = m_frame.colour.m_z;
+  const int width = static_cast<int>(m_frame.width * m_frame.pixelRatio);
+  const int height = static_cast<int>(m_frame.height * m_frame.pixelRatio);
+  m_software->render(mesh.mesh, transforms, material, width, height);
+  // there is no level of detail, the whole mesh is drawn
+  m_lodStats.changes = 0;
+  m_lodStats.objects.clear();
+  m_lodStats.triangles = m_software->stats().triangles;
+
+  const auto &image = m_software->image();
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, m_softwareTextures[1]);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, image.width, image.height, 0, GL_RED, GL_FLOAT, image.depth.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, m_softwareTextures[0]);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.rgba.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  // a draw rather than a blit as the widget's framebuffer may be multisampled, the pixels
+  // nothing was drawn on have depth 1 so they fail the depth test and keep the clear colour
+  ngl::ShaderLib::use(SoftwareImageShader);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glBindVertexArray(m_softwareVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string NGLScene::lodDrawName(size_t _level) const
+{
+  const auto &name = drawName();
+  for (size_t level = _level; level > 0; --level)
+  {
+    auto lod = SceneResources::lodName(name, level);
+    // a scanned mesh that couldn't be simplified is ready but never added
+    if (m_loader.isReady(lod) && ngl::VAOPrimitives::getVAOFromName(lod) != nullptr)
+    {
+      return lod;
+    }
+  }
+  return name;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+float NGLScene::pixelScale() const
+{
+  return 0.5f * m_project.m_m[1][1] * static_cast<float>(m_frame.height) * m_frame.pixelRatio;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -249,7 +996,12 @@ void NGLScene::mouseMoveEvent(QMouseEvent *_event)
 #else
   auto position = _event->pos();
 #endif
-  if (m_win.rotate && _event->buttons() == Qt::LeftButton)
+  if (m_win.rotate && _event->buttons() == Qt::LeftButton && m_params.arcballMode)
+  {
+    m_arcball.drag(position.x(), position.y());
+    editMouseSpin();
+  }
+  else if (m_win.rotate && _event->buttons() == Qt::LeftButton)
   {
     int diffx = position.x() - m_win.origX;
     int diffy = position.y() - m_win.origY;
@@ -257,7 +1009,7 @@ void NGLScene::mouseMoveEvent(QMouseEvent *_event)
     m_win.spinYFace += static_cast<int>(0.5f * diffx);
     m_win.origX = position.x();
     m_win.origY = position.y();
-    update();
+    editMouseSpin();
   }
   // right mouse translate code
   else if (m_win.translate && _event->buttons() == Qt::RightButton)
@@ -266,9 +1018,9 @@ void NGLScene::mouseMoveEvent(QMouseEvent *_event)
     int diffY = static_cast<int>(position.y() - m_win.origYPos);
     m_win.origXPos = position.x();
     m_win.origYPos = position.y();
-    m_modelPos.m_x += INCREMENT * diffX;
-    m_modelPos.m_y -= INCREMENT * diffY;
-    update();
+    m_params.modelPos.m_x += INCREMENT * diffX;
+    m_params.modelPos.m_y -= INCREMENT * diffY;
+    edit();
   }
 }
 
@@ -288,6 +1040,7 @@ void NGLScene::mousePressEvent(QMouseEvent *_event)
     m_win.origX = position.x();
     m_win.origY = position.y();
     m_win.rotate = true;
+    m_arcball.begin(position.x(), position.y(), width(), height());
   }
   // right mouse translate mode
   else if (_event->button() == Qt::RightButton)
@@ -321,52 +1074,164 @@ void NGLScene::wheelEvent(QWheelEvent *_event)
   // check the diff of the wheel position (0 means no change)
   if (_event->angleDelta().x() > 0)
   {
-    m_modelPos.m_z += ZOOM;
+    m_params.modelPos.m_z += ZOOM;
   }
   else if (_event->angleDelta().x() < 0)
   {
-    m_modelPos.m_z -= ZOOM;
+    m_params.modelPos.m_z -= ZOOM;
   }
-  update();
+  edit();
 }
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::vboChanged(int _index)
 {
-  m_drawIndex = _index;
-  update();
+  m_profiler.mark("vboChanged");
+  // the mesh list belongs to the render side, which clamps the index and loads the mesh
+  m_params.drawIndex = static_cast<size_t>(std::max(_index, 0));
+  edit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::setPrefetch(bool _value)
+{
+  m_prefetch = _value;
+  // turned on after the first frame has been shown
+  if (m_prefetch && !m_prefetchStarted && m_frameShown)
+  {
+    startPrefetch();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::startPrefetch()
+{
+  m_prefetchStarted = true;
+  withContext([this]()
+              {
+                m_loader.prefetch(m_meshNames);
+                startLoadPolling();
+              });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::startLoadPolling()
+{
+  // the render thread polls between its frames
+  if (!m_renderThread && m_loader.busy())
+  {
+    m_loadTimer.start();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::requestLods()
+{
+  const auto &name = m_meshNames[m_frame.drawIndex];
+  if (!m_frame.lod || !SceneResources::hasLods(name))
+  {
+    return;
+  }
+  // loaded like a prefetch so the selected mesh comes first, the finer levels are drawn until
+  // the coarse ones are ready
+  std::vector<std::string> names;
+  for (size_t level = 1; level < SceneResources::LodLevels; ++level)
+  {
+    names.push_back(SceneResources::lodName(name, level));
+  }
+  m_loader.prefetch(names);
+  startLoadPolling();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const std::string &NGLScene::drawName() const
+{
+  const auto &name = m_meshNames[m_frame.drawIndex];
+  return m_loader.isReady(name) ? name : s_placeholder;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::pollLoader()
+{
+  makeCurrent();
+  bool changed = m_loader.poll();
+  doneCurrent();
+  if (changed)
+  {
+    update();
+  }
+  if (!m_loader.busy())
+  {
+    m_loadTimer.stop();
+    m_loaderSummary = m_loader.summary();
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::toggleNormals(bool _value)
 {
-  m_drawNormals = _value;
-  update();
+  m_profiler.mark("toggleNormals");
+  m_params.drawNormals = _value;
+  edit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::toggleGeometryShaderNormals(bool _value)
+{
+  m_profiler.mark("toggleGeometryShaderNormals");
+  m_params.geometryShaderNormals = _value;
+  edit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+ngl::AbstractVAO *NGLScene::normalLines(const std::string &_name)
+{
+  auto lines = m_normalLines.find(_name);
+  if (lines == m_normalLines.end())
+  {
+    // a mesh that can't be read back is remembered as nullptr so it isn't tried every frame
+    lines = m_normalLines.emplace(_name, NormalLines::create(ngl::VAOPrimitives::getVAOFromName(_name), &m_pool)).first;
+  }
+  return lines->second.get();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::setNormalSize(int _value)
 {
-  m_normalSize = _value;
-  update();
+  m_params.normalSize = _value;
+  edit();
 }
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::setScale(float _x, float _y, float _z)
 {
-  m_scale = ngl::Mat4::scale(_x, _y, _z);
-  update();
+  m_profiler.mark("setScale");
+  m_params.scale.set(_x, _y, _z);
+  edit();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::setTranslate(float _x, float _y, float _z)
 {
+  m_profiler.mark("setTranslate");
 
-  m_translate = ngl::Mat4::translate(_x, _y, _z);
-  update();
+  m_params.translate.set(_x, _y, _z);
+  edit();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::setRotate(float _x, float _y, float _z)
 {
+  m_profiler.mark("setRotate");
+  // the matrices are built once when the render side takes the transaction
+  m_params.rotate.set(_x, _y, _z);
+  edit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::buildRotation()
+{
+  const float _x = m_frame.rotate.m_x;
+  const float _y = m_frame.rotate.m_y;
+  const float _z = m_frame.rotate.m_z;
   auto rx = ngl::Mat4::rotateX(_x);
   auto ry = ngl::Mat4::rotateY(_y);
   auto rz = ngl::Mat4::rotateZ(_z);
@@ -397,61 +1262,281 @@ void NGLScene::setRotate(float _x, float _y, float _z)
   m_gimbal.m_01 = sr;
   m_gimbal.m_10 = -sr;
   m_gimbal.m_11 = cr;
-  update();
+  // the quaternion goes straight to the rotation block, no axis matrices are multiplied
+  TransformBatch::quaternionFromEuler(_x, _y, _z, m_orientation);
+  TransformBatch::quaternionToMatrix(m_orientation, &m_quaternionRotate.m_openGL[0]);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::setTRS(ngl::Vec3 _translate, ngl::Vec3 _rotate, ngl::Vec3 _scale)
+{
+  beginEdit();
+  setTranslate(_translate.m_x, _translate.m_y, _translate.m_z);
+  setRotate(_rotate.m_x, _rotate.m_y, _rotate.m_z);
+  setScale(_scale.m_x, _scale.m_y, _scale.m_z);
+  commit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::beginEdit()
+{
+  ++m_editDepth;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::commit()
+{
+  if (m_editDepth > 0 && --m_editDepth == 0)
+  {
+    applyEdits();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::edit()
+{
+  if (m_pendingEdits == 0)
+  {
+    m_firstEditNs = nowNs();
+  }
+  ++m_params.edits;
+  ++m_pendingEdits;
+  if (m_editDepth == 0 && !m_commitQueued)
+  {
+    // queued behind the rest of the events already posted, so every signal from the same ui
+    // action is in by the time it runs
+    m_commitQueued = true;
+    QMetaObject::invokeMethod(this, [this]()
+                              {
+                                m_commitQueued = false;
+                                applyEdits();
+                              },
+                              Qt::QueuedConnection);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::editMouseSpin()
+{
+  std::copy(m_arcball.orientation(), m_arcball.orientation() + 4, m_params.arcball);
+  m_params.spinX = m_win.spinXFace;
+  m_params.spinY = m_win.spinYFace;
+  edit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::applyEdits()
+{
+  // a queued commit that runs inside an explicit transaction (a nested event loop) leaves its
+  // edits to the explicit commit
+  if (m_pendingEdits == 0 || m_editDepth > 0)
+  {
+    return;
+  }
+  m_profiler.mark("commit");
+  ++m_params.commits;
+  m_params.lastCommitEdits = m_pendingEdits;
+  m_pendingEdits = 0;
+  publishParams(m_firstEditNs);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::publishParams(int64_t _inputNs)
+{
+  // while the last snapshot is waiting to be taken its input is still the oldest one not drawn
+  if (!m_paramsMailbox.unread() || m_params.inputNs == 0)
+  {
+    m_params.inputNs = _inputNs;
+  }
+  m_paramsMailbox.publish(m_params);
+  if (m_recorder.isOpen())
+  {
+    m_recorder.record(nowNs(), recordedParams(m_params));
+  }
+  requestFrame();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::requestFrame()
+{
+  if (m_renderThread)
+  {
+    m_renderThread->requestFrame();
+  }
+  else
+  {
+    update();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NGLScene::takeParams()
+{
+  if (!m_paramsMailbox.take())
+  {
+    return false;
+  }
+  applyParams(m_paramsMailbox.front());
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::applyParams(const SceneParams &_next)
+{
+  const SceneParams previous = m_frame;
+  m_frame = _next;
+  m_frame.drawIndex = std::min(_next.drawIndex, m_meshNames.size() - 1);
+  // the setters only stored values, what they change is found by comparing the snapshots so
+  // several edits of one value or setting it again cost nothing
+  uint32_t dirty = 0;
+  if (differs(m_frame.scale, previous.scale))
+  {
+    dirty |= TransformState::SCALE;
+  }
+  if (differs(m_frame.translate, previous.translate))
+  {
+    dirty |= TransformState::TRANSLATE;
+  }
+  if (differs(m_frame.rotate, previous.rotate))
+  {
+    dirty |= TransformState::ROTATE;
+    buildRotation();
+  }
+  if (m_frame.eulerAngle != previous.eulerAngle || differs(m_frame.eulerAxis, previous.eulerAxis))
+  {
+    dirty |= TransformState::EULER;
+    m_euler = ngl::Mat4::euler(m_frame.eulerAngle, m_frame.eulerAxis.m_x, m_frame.eulerAxis.m_y, m_frame.eulerAxis.m_z);
+  }
+  if (m_frame.order != previous.order)
+  {
+    dirty |= TransformState::ORDER;
+  }
+  if (dirty != 0 || m_frame.instanceCount != previous.instanceCount)
+  {
+    m_instancesDirty = true;
+  }
+  if (m_frame.arcballMode != previous.arcballMode || m_frame.spinX != previous.spinX ||
+      m_frame.spinY != previous.spinY || !std::equal(m_frame.arcball, m_frame.arcball + 4, previous.arcball))
+  {
+    dirty |= TransformState::MOUSESPIN;
+  }
+  if (differs(m_frame.modelPos, previous.modelPos))
+  {
+    dirty |= TransformState::MODELPOS;
+  }
+  if (m_frame.width != previous.width || m_frame.height != previous.height)
+  {
+    dirty |= TransformState::PROJECTION;
+    m_project = ngl::perspective(45.0f, static_cast<float>(m_frame.width) / std::max(m_frame.height, 1), 0.05f, 450.0f);
+  }
+  if (m_frame.instanced != previous.instanced)
+  {
+    dirty |= TransformState::MODE;
+  }
+  m_state.markDirty(dirty);
+  if (m_frame.frustumCull != previous.frustumCull)
+  {
+    // the buffer holds either every instance or just the visible ones
+    m_instanceUploadDirty = true;
+  }
+  if (m_frame.lod != previous.lod)
+  {
+    std::fill(m_instanceLods.begin(), m_instanceLods.end(), LodSelector::NoLevel);
+  }
+  if (m_frame.drawIndex != previous.drawIndex || m_frame.lod != previous.lod)
+  {
+    // a different mesh has a different size, pick its level without the hysteresis
+    m_objectLod = LodSelector::NoLevel;
+    m_loader.request(m_meshNames[m_frame.drawIndex]);
+    requestLods();
+    startLoadPolling();
+  }
+  m_stats.edits = m_frame.edits;
+  m_stats.commits = m_frame.commits;
+  m_stats.lastCommitEdits = m_frame.lastCommitEdits;
+  // a snapshot published again before it was taken carries the same input time
+  if (m_frame.inputNs != 0 && m_frame.inputNs != previous.inputNs && m_frameInputNs == 0)
+  {
+    m_frameInputNs = m_frame.inputNs;
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::setColour(float _r, float _g, float _b)
 {
-  m_colour.set(_r, _g, _b);
+  m_params.colour.set(_r, _g, _b);
 
   // m_material.setDiffuse(m_colour);
   // m_material.loadToShader("material");
-  update();
+  edit();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::setMatrixOrder(int _index)
 {
+  m_profiler.mark("setMatrixOrder");
   switch (_index)
   {
   case 0:
   {
-    m_matrixOrder = NGLScene::MatrixOrder::RTS;
+    m_params.order = MatrixOrder::RTS;
     break;
   }
   case 1:
   {
-    m_matrixOrder = NGLScene::MatrixOrder::TRS;
+    m_params.order = MatrixOrder::TRS;
     break;
   }
   case 2:
   {
-    m_matrixOrder = NGLScene::MatrixOrder::GIMBALLOCK;
+    m_params.order = MatrixOrder::GIMBALLOCK;
     break;
   }
   case 3:
   {
-    m_matrixOrder = NGLScene::MatrixOrder::EULERTS;
+    m_params.order = MatrixOrder::EULERTS;
     break;
   }
   case 4:
   {
-    m_matrixOrder = NGLScene::MatrixOrder::TEULERS;
+    m_params.order = MatrixOrder::TEULERS;
+    break;
+  }
+  case 5:
+  {
+    m_params.order = MatrixOrder::QUATERNION;
     break;
   }
   default:
     break;
   }
-  update();
+  edit();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void NGLScene::setEuler(float _angle, float _x, float _y, float _z)
 {
+  m_profiler.mark("setEuler");
+
+  m_params.eulerAngle = _angle;
+  m_params.eulerAxis.set(_x, _y, _z);
+  edit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::toggleInstanced(bool _value)
+{
+  m_profiler.mark("toggleInstanced");
+  m_params.instanced = _value;
+  edit();
+}
 
-  m_euler = ngl::Mat4::euler(_angle, _x, _y, _z);
-  update();
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::setInstanceCount(int _count)
+{
+  m_profiler.mark("setInstanceCount");
+  m_params.instanceCount = std::max(_count, 1);
+  edit();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -461,6 +1546,224 @@ void NGLScene::resetMouse()
   m_win.spinYFace = 0;
   m_win.origX = 0;
   m_win.origY = 0;
-  update();
+  m_arcball.reset();
+  editMouseSpin();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::setArcball(bool _value)
+{
+  m_profiler.mark("setArcball");
+  m_params.arcballMode = _value;
+  edit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::setFrustumCulling(bool _value)
+{
+  m_profiler.mark("setFrustumCulling");
+  m_params.frustumCull = _value;
+  edit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::setLod(bool _value)
+{
+  m_profiler.mark("setLod");
+  // the levels are reset and requested when the render side takes the change
+  m_params.lod = _value;
+  edit();
 }
 //----------------------------------------------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::setSoftwareRendering(bool _value)
+{
+  m_profiler.mark("setSoftwareRendering");
+  m_params.software = _value;
+  edit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NGLScene::startRecording(const std::string &_fileName)
+{
+  if (!m_recorder.open(_fileName))
+  {
+    return false;
+  }
+  // the first record holds everything as it is now
+  m_recorder.record(nowNs(), recordedParams(m_params));
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NGLScene::stopRecording()
+{
+  return m_recorder.close();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+RecordedParams NGLScene::recordedParams(const SceneParams &_params)
+{
+  RecordedParams recorded;
+  auto copy = [](const ngl::Vec3 &_v, float *o_out)
+  {
+    o_out[0] = _v.m_x;
+    o_out[1] = _v.m_y;
+    o_out[2] = _v.m_z;
+  };
+  copy(_params.translate, recorded.translate);
+  copy(_params.rotate, recorded.rotate);
+  copy(_params.scale, recorded.scale);
+  recorded.euler[0] = _params.eulerAngle;
+  copy(_params.eulerAxis, recorded.euler + 1);
+  recorded.order = static_cast<int32_t>(_params.order);
+  recorded.drawIndex = static_cast<int32_t>(_params.drawIndex);
+  recorded.drawNormals = _params.drawNormals;
+  recorded.geometryShaderNormals = _params.geometryShaderNormals;
+  recorded.normalSize = _params.normalSize;
+  recorded.wireframe = _params.wireframe;
+  copy(_params.colour, recorded.colour);
+  recorded.instanced = _params.instanced;
+  recorded.instanceCount = _params.instanceCount;
+  recorded.frustumCull = _params.frustumCull;
+  recorded.lod = _params.lod;
+  recorded.arcballMode = _params.arcballMode;
+  std::copy(_params.arcball, _params.arcball + 4, recorded.arcball);
+  recorded.spin[0] = _params.spinX;
+  recorded.spin[1] = _params.spinY;
+  copy(_params.modelPos, recorded.modelPos);
+  recorded.viewport[0] = _params.width;
+  recorded.viewport[1] = _params.height;
+  return recorded;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::replayParams(const RecordedParams &_params)
+{
+  m_profiler.mark("replay");
+  // one edit, as if the commit it was recorded from had set every value at once
+  m_params.translate.set(_params.translate[0], _params.translate[1], _params.translate[2]);
+  m_params.rotate.set(_params.rotate[0], _params.rotate[1], _params.rotate[2]);
+  m_params.scale.set(_params.scale[0], _params.scale[1], _params.scale[2]);
+  m_params.eulerAngle = _params.euler[0];
+  m_params.eulerAxis.set(_params.euler[1], _params.euler[2], _params.euler[3]);
+  if (_params.order >= 0 && _params.order <= static_cast<int32_t>(MatrixOrder::QUATERNION))
+  {
+    m_params.order = static_cast<MatrixOrder>(_params.order);
+  }
+  m_params.drawIndex = static_cast<size_t>(std::max(_params.drawIndex, 0));
+  m_params.drawNormals = _params.drawNormals != 0;
+  m_params.geometryShaderNormals = _params.geometryShaderNormals != 0;
+  m_params.normalSize = _params.normalSize;
+  m_params.wireframe = _params.wireframe != 0;
+  m_params.colour.set(_params.colour[0], _params.colour[1], _params.colour[2]);
+  m_params.instanced = _params.instanced != 0;
+  m_params.instanceCount = std::max(_params.instanceCount, 1);
+  m_params.frustumCull = _params.frustumCull != 0;
+  m_params.lod = _params.lod != 0;
+  m_params.arcballMode = _params.arcballMode != 0;
+  // the mouse's own state is left alone, a live drag after the replay carries on from it
+  std::copy(_params.arcball, _params.arcball + 4, m_params.arcball);
+  m_params.spinX = _params.spin[0];
+  m_params.spinY = _params.spin[1];
+  m_params.modelPos.set(_params.modelPos[0], _params.modelPos[1], _params.modelPos[2]);
+  beginEdit();
+  edit();
+  commit();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::importMesh(const QString &_fileName)
+{
+  withContext([this, _fileName]() { loadMesh(_fileName); });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::withContext(std::function<void()> _job)
+{
+  if (!m_renderThread && isValid())
+  {
+    makeCurrent();
+    _job();
+    doneCurrent();
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_glJobsMutex);
+    m_glJobs.push_back(std::move(_job));
+  }
+  if (m_renderThread)
+  {
+    m_renderThread->requestFrame();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NGLScene::runGLJobs()
+{
+  std::vector<std::function<void()>> jobs;
+  {
+    std::lock_guard<std::mutex> lock(m_glJobsMutex);
+    jobs.swap(m_glJobs);
+  }
+  for (auto &job : jobs)
+  {
+    job();
+  }
+  return !jobs.empty();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NGLScene::loadMesh(const QString &_fileName)
+{
+  constexpr GLsizei stride = MeshImporter::FloatsPerVertex * sizeof(float);
+  std::unique_ptr<StreamingVAO> vao(new StreamingVAO(GL_TRIANGLES));
+  vao->bind();
+  MeshImporter importer(m_pool);
+  // each chunk goes straight into the buffer while the importer parses the next ones
+  bool loaded = importer.load(_fileName.toStdString(),
+                              [&vao](size_t _vertices)
+                              {
+                                vao->allocate(_vertices * stride);
+                                vao->setNumIndices(_vertices);
+                              },
+                              [&vao](size_t _first, const float *_data, size_t _vertices)
+                              {
+                                vao->setSubData(_first * stride, _vertices * stride, _data);
+                              });
+  if (!loaded)
+  {
+    vao->unbind();
+    emit meshImportFailed(QString::fromStdString(importer.error()));
+    return;
+  }
+  // x,y,z nx,ny,nz u,v to match the PBR and normal shader attributes
+  glBindBuffer(GL_ARRAY_BUFFER, vao->getBufferID());
+  vao->setVertexAttributePointer(0, 3, GL_FLOAT, stride, 0);
+  vao->setVertexAttributePointer(1, 3, GL_FLOAT, stride, 3);
+  vao->setVertexAttributePointer(2, 2, GL_FLOAT, stride, 6);
+  vao->unbind();
+
+  // the file name is used for the combo box, made unique if it clashes
+  QString base = QFileInfo(_fileName).completeBaseName();
+  QString name = base;
+  for (int i = 2; std::find(m_meshNames.begin(), m_meshNames.end(), name.toStdString()) != m_meshNames.end(); ++i)
+  {
+    name = QString("%1 %2").arg(base).arg(i);
+  }
+  ngl::VAOPrimitives::addToPrimitives(name.toStdString(), std::move(vao));
+  m_meshNames.push_back(name.toStdString());
+
+  auto &stats = importer.stats();
+  QString report = QString("%1: %2 triangles, %3 MB parsed at %4 MB/s, %5 MB uploaded at %6 MB/s, %7 threads")
+                       .arg(name)
+                       .arg(stats.triangles)
+                       .arg(stats.fileBytes / 1.0e6, 0, 'f', 1)
+                       .arg(stats.parseMBPerSecond(), 0, 'f', 1)
+                       .arg(stats.vertexBytes / 1.0e6, 0, 'f', 1)
+                       .arg(stats.uploadMBPerSecond(), 0, 'f', 1)
+                       .arg(stats.threads);
+  qDebug() << report;
+  emit meshImported(name, report);
+}
@@ -0,0 +1,149 @@
+/// @file NormalLines.cpp
+/// @brief implementation of the normal line builder
+#include "NormalLines.h"
+#include "StreamingVAO.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief meshes smaller than this aren't worth splitting over the pool
+//----------------------------------------------------------------------------------------------------------------------
+constexpr size_t s_grain = 4096;
+
+struct Vec
+{
+  float x, y, z;
+};
+
+Vec fetch(const char *_data, const GeometryCache::Attribute &_attribute, size_t _index)
+{
+  size_t stride = _attribute.stride != 0 ? _attribute.stride : 3 * sizeof(float);
+  Vec v;
+  std::memcpy(&v, _data + _index * stride + _attribute.offset, sizeof(Vec));
+  return v;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief write the two vertices of a line from _start along _direction
+//----------------------------------------------------------------------------------------------------------------------
+void writeLine(float *_out, const Vec &_start, const Vec &_direction, float _face)
+{
+  const float line[2 * NormalLines::FloatsPerVertex] = {_start.x, _start.y, _start.z, 0.0f, 0.0f, 0.0f, _face,
+                                                        _start.x, _start.y, _start.z, _direction.x, _direction.y,
+                                                        _direction.z, _face};
+  std::memcpy(_out, line, sizeof(line));
+}
+
+bool isFloat3(const GeometryCache::Attribute *_attribute)
+{
+  return _attribute != nullptr && _attribute->type == GL_FLOAT && _attribute->size == 3;
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+std::vector<float> NormalLines::build(const char *_data, size_t _vertices, const GeometryCache::Attribute &_position,
+                                      const GeometryCache::Attribute &_normal, bool _faces, ThreadPool *_pool)
+{
+  size_t triangles = _faces ? _vertices / 3 : 0;
+  std::vector<float> lines((_vertices + triangles) * 2 * FloatsPerVertex);
+  float *faceLines = lines.data() + _vertices * 2 * FloatsPerVertex;
+  // work in whole triangles so each range writes its own vertex and face lines
+  size_t items = _faces ? triangles : _vertices;
+  size_t perItem = _faces ? 3 : 1;
+  auto range = [&](size_t _begin, size_t _end)
+  {
+    for (size_t i = _begin; i < _end; ++i)
+    {
+      Vec p[3];
+      for (size_t v = 0; v < perItem; ++v)
+      {
+        size_t index = i * perItem + v;
+        p[v] = fetch(_data, _position, index);
+        writeLine(lines.data() + index * 2 * FloatsPerVertex, p[v], fetch(_data, _normal, index), 0.0f);
+      }
+      if (!_faces)
+      {
+        continue;
+      }
+      Vec a{p[1].x - p[0].x, p[1].y - p[0].y, p[1].z - p[0].z};
+      Vec b{p[2].x - p[0].x, p[2].y - p[0].y, p[2].z - p[0].z};
+      Vec n{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+      float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+      // degenerate triangles get a zero length line rather than a NaN
+      float scale = length > 0.0f ? 1.0f / length : 0.0f;
+      Vec centre{(p[0].x + p[1].x + p[2].x) / 3.0f, (p[0].y + p[1].y + p[2].y) / 3.0f,
+                 (p[0].z + p[1].z + p[2].z) / 3.0f};
+      writeLine(faceLines + i * 2 * FloatsPerVertex, centre, {n.x * scale, n.y * scale, n.z * scale}, 1.0f);
+    }
+  };
+  if (_pool != nullptr && items > s_grain)
+  {
+    _pool->parallelFor(items, s_grain, range);
+  }
+  else
+  {
+    range(0, items);
+  }
+  // a triangle list whose count isn't a multiple of 3 still shows every vertex normal
+  for (size_t index = items * perItem; index < _vertices; ++index)
+  {
+    writeLine(lines.data() + index * 2 * FloatsPerVertex, fetch(_data, _position, index),
+              fetch(_data, _normal, index), 0.0f);
+  }
+  return lines;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::unique_ptr<ngl::AbstractVAO> NormalLines::create(ngl::AbstractVAO *_mesh, ThreadPool *_pool)
+{
+  std::vector<GeometryCache::Attribute> attributes;
+  std::vector<char> data;
+  if (_mesh == nullptr || !GeometryCache::readBack(_mesh, attributes, data))
+  {
+    return nullptr;
+  }
+  const GeometryCache::Attribute *position = nullptr;
+  const GeometryCache::Attribute *normal = nullptr;
+  for (auto &a : attributes)
+  {
+    if (a.location == 0)
+    {
+      position = &a;
+    }
+    else if (a.location == 1)
+    {
+      normal = &a;
+    }
+  }
+  if (!isFloat3(position) || !isFloat3(normal))
+  {
+    return nullptr;
+  }
+  size_t vertices = _mesh->numIndices();
+  // don't trust the count beyond what was actually read back
+  for (auto *a : {position, normal})
+  {
+    size_t stride = a->stride != 0 ? a->stride : 3 * sizeof(float);
+    if (data.size() < a->offset + 3 * sizeof(float))
+    {
+      return nullptr;
+    }
+    vertices = std::min(vertices, (data.size() - a->offset - 3 * sizeof(float)) / stride + 1);
+  }
+  auto lines = build(data.data(), vertices, *position, *normal, _mesh->getMode() == GL_TRIANGLES, _pool);
+  auto vao = std::make_unique<StreamingVAO>(GL_LINES);
+  vao->bind();
+  vao->allocate(lines.size() * sizeof(float));
+  vao->setSubData(0, lines.size() * sizeof(float), lines.data());
+  GLsizei stride = FloatsPerVertex * sizeof(float);
+  vao->setVertexAttributePointer(0, 3, GL_FLOAT, stride, 0);
+  vao->setVertexAttributePointer(1, 3, GL_FLOAT, stride, 3);
+  vao->setVertexAttributePointer(2, 1, GL_FLOAT, stride, 6);
+  vao->setNumIndices(lines.size() / FloatsPerVertex);
+  vao->unbind();
+  return vao;
+}
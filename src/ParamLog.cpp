@@ -0,0 +1,270 @@
+/// @file ParamLog.cpp
+/// @brief implementation of the parameter log writer and reader
+#include "ParamLog.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the words of RecordedParams each field covers, in Field order
+//----------------------------------------------------------------------------------------------------------------------
+struct FieldWords
+{
+  size_t first;
+  size_t count;
+  const char *name;
+};
+
+#define PARAMLOG_FIELD(_first, _last, _name) \
+  FieldWords{offsetof(RecordedParams, _first) / 4, (offsetof(RecordedParams, _last) - offsetof(RecordedParams, _first)) / 4, _name}
+
+constexpr size_t s_words = sizeof(RecordedParams) / 4;
+const FieldWords s_fields[RecordedParams::FIELDS] = {
+    PARAMLOG_FIELD(translate, rotate, "translate"),
+    PARAMLOG_FIELD(rotate, scale, "rotate"),
+    PARAMLOG_FIELD(scale, euler, "scale"),
+    PARAMLOG_FIELD(euler, order, "euler"),
+    PARAMLOG_FIELD(order, drawIndex, "order"),
+    PARAMLOG_FIELD(drawIndex, drawNormals, "mesh"),
+    PARAMLOG_FIELD(drawNormals, wireframe, "normals"),
+    PARAMLOG_FIELD(wireframe, colour, "wireframe"),
+    PARAMLOG_FIELD(colour, instanced, "colour"),
+    PARAMLOG_FIELD(instanced, arcballMode, "instances"),
+    PARAMLOG_FIELD(arcballMode, modelPos, "spin"),
+    PARAMLOG_FIELD(modelPos, viewport, "panzoom"),
+    FieldWords{offsetof(RecordedParams, viewport) / 4, 2, "viewport"}};
+#undef PARAMLOG_FIELD
+static_assert(offsetof(RecordedParams, viewport) / 4 + 2 == s_words, "the fields must cover every word of RecordedParams");
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the file starts with the magic, the format version, the words in RecordedParams and
+/// the number of fields, so a log from a build with different parameters is refused
+//----------------------------------------------------------------------------------------------------------------------
+const char s_magic[4] = {'A', 'T', 'P', 'L'};
+constexpr uint32_t s_version = 1;
+constexpr size_t s_headerSize = 16;
+constexpr uint16_t s_allFields = (1u << RecordedParams::FIELDS) - 1;
+
+const uint32_t *words(const RecordedParams &_params)
+{
+  return reinterpret_cast<const uint32_t *>(&_params);
+}
+
+uint32_t *words(RecordedParams &_params)
+{
+  return reinterpret_cast<uint32_t *>(&_params);
+}
+
+void appendVarint(std::vector<uint8_t> &o_buffer, uint64_t _value)
+{
+  while (_value >= 0x80)
+  {
+    o_buffer.push_back(static_cast<uint8_t>(_value | 0x80));
+    _value >>= 7;
+  }
+  o_buffer.push_back(static_cast<uint8_t>(_value));
+}
+
+void appendBytes(std::vector<uint8_t> &o_buffer, const void *_data, size_t _size)
+{
+  auto bytes = static_cast<const uint8_t *>(_data);
+  o_buffer.insert(o_buffer.end(), bytes, bytes + _size);
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+uint16_t RecordedParams::changed(const RecordedParams &_a, const RecordedParams &_b)
+{
+  uint16_t mask = 0;
+  for (size_t f = 0; f < FIELDS; ++f)
+  {
+    auto &field = s_fields[f];
+    if (std::memcmp(words(_a) + field.first, words(_b) + field.first, field.count * 4) != 0)
+    {
+      mask |= static_cast<uint16_t>(1u << f);
+    }
+  }
+  return mask;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const char *RecordedParams::fieldName(Field _field)
+{
+  return _field < FIELDS ? s_fields[_field].name : "unknown";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ParamLogWriter::open(const std::string &_fileName)
+{
+  close();
+  m_out.open(_fileName, std::ios::binary | std::ios::trunc);
+  if (!m_out)
+  {
+    return false;
+  }
+  m_failed = false;
+  m_records = 0;
+  m_bytes = 0;
+  m_lastUs = 0;
+  m_buffer.clear();
+  const uint32_t header[3] = {s_version, static_cast<uint32_t>(s_words), RecordedParams::FIELDS};
+  appendBytes(m_buffer, s_magic, sizeof(s_magic));
+  appendBytes(m_buffer, header, sizeof(header));
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamLogWriter::record(int64_t _ns, const RecordedParams &_params)
+{
+  if (!isOpen())
+  {
+    return;
+  }
+  uint16_t mask = s_allFields;
+  if (m_records == 0)
+  {
+    m_startNs = _ns;
+  }
+  else
+  {
+    mask = RecordedParams::changed(m_last, _params);
+  }
+  // the absolute time is rounded rather than each gap, so rounding never adds up over a session
+  const int64_t us = std::max<int64_t>((_ns - m_startNs) / 1000, m_lastUs);
+  appendVarint(m_buffer, static_cast<uint64_t>(us - m_lastUs));
+  appendBytes(m_buffer, &mask, sizeof(mask));
+  for (size_t f = 0; f < RecordedParams::FIELDS; ++f)
+  {
+    if (mask & (1u << f))
+    {
+      appendBytes(m_buffer, words(_params) + s_fields[f].first, s_fields[f].count * 4);
+    }
+  }
+  m_lastUs = us;
+  m_last = _params;
+  ++m_records;
+  if (m_buffer.size() >= 64 * 1024)
+  {
+    flush();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamLogWriter::flush()
+{
+  m_out.write(reinterpret_cast<const char *>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+  m_failed = m_failed || !m_out;
+  m_bytes += m_buffer.size();
+  m_buffer.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ParamLogWriter::close()
+{
+  if (!isOpen())
+  {
+    return !m_failed;
+  }
+  flush();
+  m_out.close();
+  m_failed = m_failed || m_out.fail();
+  return !m_failed;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ParamLogReader::open(const std::string &_fileName)
+{
+  m_error.clear();
+  if (!m_file.open(_fileName))
+  {
+    m_error = "unable to read " + _fileName;
+    return false;
+  }
+  uint32_t header[3] = {};
+  if (m_file.size() < s_headerSize || std::memcmp(m_file.data(), s_magic, sizeof(s_magic)) != 0)
+  {
+    m_error = _fileName + " is not a parameter log";
+    m_file.close();
+    return false;
+  }
+  std::memcpy(header, m_file.data() + sizeof(s_magic), sizeof(header));
+  if (header[0] != s_version || header[1] != s_words || header[2] != RecordedParams::FIELDS)
+  {
+    m_error = _fileName + " was recorded by a different version";
+    m_file.close();
+    return false;
+  }
+  m_file.adviseSequential();
+  rewind();
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamLogReader::rewind()
+{
+  m_offset = s_headerSize;
+  m_us = 0;
+  m_state = RecordedParams();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ParamLogReader::next(Event &o_event)
+{
+  if (!m_file.isOpen() || m_offset >= m_file.size())
+  {
+    return false;
+  }
+  auto data = reinterpret_cast<const uint8_t *>(m_file.data());
+  const size_t size = m_file.size();
+  size_t offset = m_offset;
+  uint64_t delta = 0;
+  for (int shift = 0;; shift += 7)
+  {
+    if (offset >= size || shift > 63)
+    {
+      m_error = "truncated record";
+      return false;
+    }
+    const uint8_t byte = data[offset++];
+    delta |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      break;
+    }
+  }
+  uint16_t mask = 0;
+  if (offset + sizeof(mask) > size)
+  {
+    m_error = "truncated record";
+    return false;
+  }
+  std::memcpy(&mask, data + offset, sizeof(mask));
+  offset += sizeof(mask);
+  if ((mask & ~s_allFields) != 0)
+  {
+    m_error = "damaged record";
+    return false;
+  }
+  for (size_t f = 0; f < RecordedParams::FIELDS; ++f)
+  {
+    if (mask & (1u << f))
+    {
+      const size_t bytes = s_fields[f].count * 4;
+      if (offset + bytes > size)
+      {
+        m_error = "truncated record";
+        return false;
+      }
+      std::memcpy(words(m_state) + s_fields[f].first, data + offset, bytes);
+      offset += bytes;
+    }
+  }
+  m_offset = offset;
+  m_us += static_cast<int64_t>(delta);
+  o_event.timeNs = m_us * 1000;
+  o_event.changed = mask;
+  o_event.params = m_state;
+  return true;
+}
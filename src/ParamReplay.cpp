@@ -0,0 +1,217 @@
+/// @file ParamReplay.cpp
+/// @brief implementation of the parameter log replay
+#include "ParamReplay.h"
+#include "NGLScene.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+//----------------------------------------------------------------------------------------------------------------------
+ParamReplay::ParamReplay(NGLScene *_scene, bool _flatOut, QObject *_parent) : QObject(_parent), m_scene(_scene),
+  m_flatOut(_flatOut)
+{
+  m_timer.setSingleShot(true);
+  m_timer.setTimerType(Qt::PreciseTimer);
+  connect(&m_timer, &QTimer::timeout, this, &ParamReplay::step);
+  connect(m_scene, &NGLScene::frameTime, this, &ParamReplay::frameDrawn);
+  connect(m_scene, &NGLScene::inputLatency, this, &ParamReplay::inputShown);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamReplay::addSession(const std::string &_fileName)
+{
+  Session session;
+  session.fileName = _fileName;
+  m_sessions.push_back(session);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamReplay::start()
+{
+  m_current = 0;
+  beginSession();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamReplay::beginSession()
+{
+  for (; m_current < m_sessions.size(); ++m_current)
+  {
+    auto &session = m_sessions[m_current];
+    if (!m_reader.open(session.fileName))
+    {
+      session.error = m_reader.error();
+      std::cout << "replay " << session.fileName << ": " << session.error << '\n';
+      continue;
+    }
+    m_frameTimes.clear();
+    m_gpuTimes.clear();
+    m_inputTimes.clear();
+    m_pending = false;
+    m_waiting = false;
+    m_running = true;
+    m_clock.start();
+    step();
+    return;
+  }
+  m_running = false;
+  bool ok = std::all_of(m_sessions.begin(), m_sessions.end(), [](const Session &_s) { return _s.error.empty(); });
+  emit finished(ok);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamReplay::step()
+{
+  if (!m_running)
+  {
+    return;
+  }
+  if (m_flatOut)
+  {
+    // also reached by the timer if the last commit never made a frame, so the replay can't stall
+    m_waiting = false;
+    if (!m_reader.next(m_event))
+    {
+      endSession();
+      return;
+    }
+    apply(m_event);
+    m_waiting = true;
+    m_timer.start(1000);
+    return;
+  }
+  // every commit that is due is made now, several overdue ones are folded into one frame
+  // just as the events of a busy gui would be
+  for (;;)
+  {
+    if (!m_pending)
+    {
+      if (!m_reader.next(m_event))
+      {
+        endSession();
+        return;
+      }
+      m_pending = true;
+    }
+    const int64_t dueNs = m_event.timeNs - m_clock.nsecsElapsed();
+    if (dueNs > 0)
+    {
+      m_timer.start(static_cast<int>((dueNs + 999999) / 1000000));
+      return;
+    }
+    m_pending = false;
+    apply(m_event);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamReplay::apply(const ParamLogReader::Event &_event)
+{
+  auto &session = m_sessions[m_current];
+  const int width = _event.params.viewport[0];
+  const int height = _event.params.viewport[1];
+  if ((_event.changed & (1u << RecordedParams::VIEWPORT)) && width > 0 && height > 0)
+  {
+    // the scene's size is set by the layout, so the window is grown or shrunk by the difference
+    QWidget *window = m_scene->window();
+    window->resize(window->width() + width - m_scene->width(), window->height() + height - m_scene->height());
+  }
+  m_scene->replayParams(_event.params);
+  ++session.commits;
+  session.recordedSeconds = _event.timeNs / 1.0e9;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamReplay::frameDrawn(double _cpuMs, double _gpuMs, int)
+{
+  if (!m_running)
+  {
+    return;
+  }
+  m_frameTimes.push_back(_cpuMs);
+  // 0 until the profiler has read its first queries
+  if (_gpuMs > 0.0)
+  {
+    m_gpuTimes.push_back(_gpuMs);
+  }
+  if (m_flatOut && m_waiting)
+  {
+    m_waiting = false;
+    m_timer.stop();
+    // queued so the next commit isn't made from inside the frame that was just drawn
+    QMetaObject::invokeMethod(this, [this]() { step(); }, Qt::QueuedConnection);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamReplay::inputShown(double _ms)
+{
+  if (m_running)
+  {
+    m_inputTimes.push_back(_ms);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ParamReplay::endSession()
+{
+  m_timer.stop();
+  m_running = false;
+  auto &session = m_sessions[m_current];
+  session.error = m_reader.error();
+  session.seconds = m_clock.nsecsElapsed() / 1.0e9;
+  session.frames = m_frameTimes.size();
+  if (!m_frameTimes.empty())
+  {
+    std::sort(m_frameTimes.begin(), m_frameTimes.end());
+    const size_t count = m_frameTimes.size();
+    session.meanMs = std::accumulate(m_frameTimes.begin(), m_frameTimes.end(), 0.0) / count;
+    session.medianMs = m_frameTimes[count / 2];
+    session.p99Ms = m_frameTimes[std::min(count - 1, static_cast<size_t>(0.99 * count))];
+    session.maxMs = m_frameTimes.back();
+  }
+  if (!m_gpuTimes.empty())
+  {
+    session.gpuMs = std::accumulate(m_gpuTimes.begin(), m_gpuTimes.end(), 0.0) / m_gpuTimes.size();
+  }
+  if (!m_inputTimes.empty())
+  {
+    session.inputMs = std::accumulate(m_inputTimes.begin(), m_inputTimes.end(), 0.0) / m_inputTimes.size();
+    session.maxInputMs = *std::max_element(m_inputTimes.begin(), m_inputTimes.end());
+  }
+  std::cout << "replay " << session.fileName << ": " << session.commits << " commits in " << session.seconds
+            << " s (recorded " << session.recordedSeconds << " s) " << session.frames << " frames, frame ms mean "
+            << session.meanMs << " median " << session.medianMs << " p99 " << session.p99Ms << " max "
+            << session.maxMs << ", gpu ms mean " << session.gpuMs << ", input ms " << session.inputMs << " max " << session.maxInputMs
+            << (session.error.empty() ? "" : ", stopped at a " + session.error) << '\n';
+  ++m_current;
+  beginSession();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ParamReplay::writeJSON(const std::string &_fileName) const
+{
+  std::ofstream out(_fileName);
+  out << "{\n  \"mode\": \"" << (m_flatOut ? "flatout" : "recorded") << "\",\n  \"sessions\": [\n";
+  for (size_t i = 0; i < m_sessions.size(); ++i)
+  {
+    auto &s = m_sessions[i];
+    out << "    {\"file\": \"" << s.fileName << "\""
+        << ", \"error\": \"" << s.error << "\""
+        << ", \"commits\": " << s.commits
+        << ", \"frames\": " << s.frames
+        << ", \"recordedSeconds\": " << s.recordedSeconds
+        << ", \"seconds\": " << s.seconds
+        << ", \"meanMs\": " << s.meanMs
+        << ", \"medianMs\": " << s.medianMs
+        << ", \"p99Ms\": " << s.p99Ms
+        << ", \"maxMs\": " << s.maxMs
+        << ", \"gpuMs\": " << s.gpuMs
+        << ", \"inputMs\": " << s.inputMs
+        << ", \"maxInputMs\": " << s.maxInputMs << "}"
+        << (i + 1 < m_sessions.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}\n";
+  return static_cast<bool>(out);
+}
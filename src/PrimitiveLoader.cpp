@@ -0,0 +1,260 @@
+/// @file PrimitiveLoader.cpp
+/// @brief implementation of the on demand primitive creation
+#include "PrimitiveLoader.h"
+#include "SceneResources.h"
+#include <ngl/VAOPrimitives.h>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace
+{
+double secondsSince(std::chrono::steady_clock::time_point _start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+PrimitiveLoader::PrimitiveLoader(GeometryCache &_cache) : m_cache(_cache)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+PrimitiveLoader::~PrimitiveLoader()
+{
+  // releaseGL should already have done this, the GL objects can't be freed without a context
+  if (m_thread)
+  {
+    m_thread->quit();
+    m_thread->wait();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool PrimitiveLoader::initializeGL(QOpenGLContext *_shareContext)
+{
+  // the worker only ever reads from the cache so there is no point without one
+  if (_shareContext == nullptr || !m_cache.enabled())
+  {
+    return false;
+  }
+  m_context = std::make_unique<QOpenGLContext>();
+  m_context->setFormat(_shareContext->format());
+  m_context->setShareContext(_shareContext);
+  m_surface = std::make_unique<QOffscreenSurface>();
+  m_surface->setFormat(_shareContext->format());
+  // the surface has to be created on the gui thread, the context is then moved to the worker
+  m_surface->create();
+  if (!m_context->create() || !m_surface->isValid())
+  {
+    m_context.reset();
+    m_surface.reset();
+    return false;
+  }
+  m_thread = std::make_unique<QThread>();
+  m_context->moveToThread(m_thread.get());
+  m_thread->start();
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimitiveLoader::releaseGL()
+{
+  if (m_thread)
+  {
+    // anything already queued runs first, then the context is handed back so it can be deleted here
+    QThread *gui = QThread::currentThread();
+    QMetaObject::invokeMethod(m_context.get(), [this, gui]()
+                              {
+                                m_context->doneCurrent();
+                                m_context->moveToThread(gui);
+                              }, Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+    m_thread.reset();
+    m_context.reset();
+    m_surface.reset();
+  }
+  std::vector<Upload> uploads;
+  {
+    std::lock_guard<std::mutex> lock(m_finishedMutex);
+    uploads.swap(m_finished);
+  }
+  uploads.insert(uploads.end(), std::make_move_iterator(m_fenced.begin()), std::make_move_iterator(m_fenced.end()));
+  m_fenced.clear();
+  for (auto &u : uploads)
+  {
+    if (u.fence != nullptr)
+    {
+      glDeleteSync(u.fence);
+    }
+    glDeleteBuffers(1, &u.buffer);
+  }
+  m_buildQueue.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool PrimitiveLoader::isReady(const std::string &_name) const
+{
+  if (SceneResources::findGenerated(_name) == nullptr)
+  {
+    return true;
+  }
+  auto state = m_states.find(_name);
+  return state != m_states.end() && state->second == State::READY;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimitiveLoader::request(const std::string &_name)
+{
+  if (SceneResources::findGenerated(_name) == nullptr)
+  {
+    return;
+  }
+  auto state = m_states.find(_name);
+  if (state != m_states.end() && state->second != State::QUEUED)
+  {
+    return;
+  }
+  if (state == m_states.end() && m_thread)
+  {
+    m_states[_name] = State::LOADING;
+    QMetaObject::invokeMethod(m_context.get(), [this, _name]() { upload(_name); }, Qt::QueuedConnection);
+    return;
+  }
+  // no worker, or it is queued because it isn't in the cache, so it has to be built here
+  m_buildQueue.erase(std::remove(m_buildQueue.begin(), m_buildQueue.end(), _name), m_buildQueue.end());
+  build(_name);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimitiveLoader::prefetch(const std::vector<std::string> &_names)
+{
+  for (auto &name : _names)
+  {
+    if (SceneResources::findGenerated(name) == nullptr || m_states.count(name) != 0)
+    {
+      continue;
+    }
+    if (m_thread)
+    {
+      request(name);
+    }
+    else
+    {
+      m_states[name] = State::QUEUED;
+      m_buildQueue.push_back(name);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool PrimitiveLoader::poll()
+{
+  std::vector<Upload> finished;
+  {
+    std::lock_guard<std::mutex> lock(m_finishedMutex);
+    finished.swap(m_finished);
+  }
+  for (auto &u : finished)
+  {
+    if (u.ok)
+    {
+      m_fenced.push_back(std::move(u));
+    }
+    else
+    {
+      // not in the cache so ngl has to make it
+      m_states[u.name] = State::QUEUED;
+      m_buildQueue.push_back(u.name);
+    }
+  }
+  bool changed = false;
+  for (auto u = m_fenced.begin(); u != m_fenced.end();)
+  {
+    GLenum status = glClientWaitSync(u->fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    {
+      ++m_stats.fenceWaits;
+      ++u;
+      continue;
+    }
+    glDeleteSync(u->fence);
+    ngl::VAOPrimitives::addToPrimitives(u->name, GeometryCache::createVAO(*u->entry, u->buffer));
+    m_states[u->name] = State::READY;
+    ++m_stats.background;
+    m_stats.backgroundSeconds += u->seconds;
+    changed = true;
+    u = m_fenced.erase(u);
+  }
+  if (!m_buildQueue.empty())
+  {
+    auto name = m_buildQueue.front();
+    m_buildQueue.pop_front();
+    build(name);
+    changed = true;
+  }
+  return changed;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool PrimitiveLoader::busy() const
+{
+  for (auto &state : m_states)
+  {
+    if (state.second != State::READY)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimitiveLoader::build(const std::string &_name)
+{
+  auto start = std::chrono::steady_clock::now();
+  SceneResources::createPrimitive(*SceneResources::findGenerated(_name), &m_cache);
+  m_states[_name] = State::READY;
+  ++m_stats.foreground;
+  m_stats.foregroundSeconds += secondsSince(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimitiveLoader::upload(const std::string &_name)
+{
+  auto start = std::chrono::steady_clock::now();
+  auto primitive = SceneResources::findGenerated(_name);
+  Upload result;
+  result.name = _name;
+  result.entry = std::make_shared<GeometryCache::Entry>();
+  if (m_context->makeCurrent(m_surface.get()) &&
+      m_cache.read(GeometryCache::primitiveKey(primitive->name, primitive->params), *result.entry))
+  {
+    glGenBuffers(1, &result.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, result.buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(result.entry->bytes), result.entry->data, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // the flush makes the fence visible to the gui context
+    result.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    result.ok = true;
+  }
+  result.seconds = secondsSince(start);
+  std::lock_guard<std::mutex> lock(m_finishedMutex);
+  m_finished.push_back(std::move(result));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string PrimitiveLoader::summary() const
+{
+  std::ostringstream out;
+  out << "primitives " << m_stats.background << " uploaded in the background (" << m_stats.backgroundSeconds * 1000.0
+      << " ms, " << m_stats.fenceWaits << " fence waits) " << m_stats.foreground << " built on the gui thread ("
+      << m_stats.foregroundSeconds * 1000.0 << " ms)";
+  return out.str();
+}
@@ -0,0 +1,198 @@
+/// @file ProgramCache.cpp
+/// @brief implementation of the program binary cache
+#include "ProgramCache.h"
+#include "CacheFile.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+constexpr char s_magic[4] = {'N', 'G', 'L', 'P'};
+constexpr uint32_t s_byteOrder = 0x01020304;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the start of every entry, followed by the program binary
+//----------------------------------------------------------------------------------------------------------------------
+struct Header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t binaryFormat;
+  uint64_t key;
+  uint64_t binaryBytes;
+  double compileSeconds;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point _start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+std::string glString(GLenum _name)
+{
+  auto value = reinterpret_cast<const char *>(glGetString(_name));
+  return value != nullptr ? value : "";
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+ProgramCache::ProgramCache(std::string _directory) : m_directory(std::move(_directory))
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ProgramCache::enabled() const
+{
+  if (m_directory.empty())
+  {
+    return false;
+  }
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ProgramCache::build(const std::string &_program, const std::vector<Stage> &_stages)
+{
+  ngl::ShaderLib::createShaderProgram(_program);
+  if (!enabled())
+  {
+    return compile(_program, _stages, std::string(), 0);
+  }
+  uint64_t key = hashString(_program);
+  key = hashBytes(&Version, sizeof(Version), key);
+  for (auto &stage : _stages)
+  {
+    std::ifstream in(stage.file, std::ios::binary);
+    std::stringstream source;
+    source << in.rdbuf();
+    auto type = static_cast<int>(stage.type);
+    key = hashBytes(&type, sizeof(type), key);
+    key = hashString(source.str(), key);
+  }
+  // a binary is only valid for the driver that made it
+  key = hashString(glString(GL_VENDOR), key);
+  key = hashString(glString(GL_RENDERER), key);
+  key = hashString(glString(GL_VERSION), key);
+  auto path = (std::filesystem::path(m_directory) / (_program + "-" + hashToHex(key) + ".bin")).string();
+  if (loadBinary(_program, path, key))
+  {
+    return true;
+  }
+  return compile(_program, _stages, path, key);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ProgramCache::loadBinary(const std::string &_program, const std::string &_path, uint64_t _key)
+{
+  auto start = std::chrono::steady_clock::now();
+  MappedFile file(_path);
+  Header header;
+  if (!file.isOpen() || file.size() < sizeof(Header))
+  {
+    return false;
+  }
+  std::memcpy(&header, file.data(), sizeof(Header));
+  if (std::memcmp(header.magic, s_magic, sizeof(s_magic)) != 0 || header.version != Version ||
+      header.byteOrder != s_byteOrder || header.key != _key || header.binaryBytes > file.size() - sizeof(Header))
+  {
+    return false;
+  }
+  GLuint id = ngl::ShaderLib::getProgramID(_program);
+  glProgramBinary(id, header.binaryFormat, file.data() + sizeof(Header), static_cast<GLsizei>(header.binaryBytes));
+  GLint linked = GL_FALSE;
+  glGetProgramiv(id, GL_LINK_STATUS, &linked);
+  if (linked != GL_TRUE)
+  {
+    // drivers may refuse binaries from an older build of themselves, rebuild from source
+    ++m_stats.rejected;
+    file.close();
+    std::error_code error;
+    std::filesystem::remove(_path, error);
+    return false;
+  }
+  // ngl normally finds the uniforms when it links the program
+  ngl::ShaderLib::autoRegisterUniforms(_program);
+  double seconds = secondsSince(start);
+  ++m_stats.hits;
+  m_stats.loadSeconds += seconds;
+  m_stats.savedSeconds += std::max(header.compileSeconds - seconds, 0.0);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ProgramCache::compile(const std::string &_program, const std::vector<Stage> &_stages, const std::string &_path,
+                           uint64_t _key)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (auto &stage : _stages)
+  {
+    ngl::ShaderLib::attachShader(stage.name, stage.type);
+    ngl::ShaderLib::loadShaderSource(stage.name, stage.file);
+    ngl::ShaderLib::compileShader(stage.name);
+    ngl::ShaderLib::attachShaderToProgram(_program, stage.name);
+  }
+  GLuint id = ngl::ShaderLib::getProgramID(_program);
+  if (!_path.empty())
+  {
+    glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+  bool linked = ngl::ShaderLib::linkProgramObject(_program);
+  double seconds = secondsSince(start);
+  ++m_stats.misses;
+  m_stats.compileSeconds += seconds;
+  if (!linked || _path.empty())
+  {
+    return linked;
+  }
+  GLint bytes = 0;
+  glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &bytes);
+  if (bytes <= 0)
+  {
+    return true;
+  }
+  std::vector<char> binary(static_cast<size_t>(bytes));
+  GLenum format = 0;
+  glGetProgramBinary(id, bytes, &bytes, &format, binary.data());
+  Header header = {};
+  std::memcpy(header.magic, s_magic, sizeof(s_magic));
+  header.version = Version;
+  header.byteOrder = s_byteOrder;
+  header.binaryFormat = format;
+  header.key = _key;
+  header.binaryBytes = static_cast<uint64_t>(bytes);
+  header.compileSeconds = seconds;
+  writeCacheFile(_path, {{&header, sizeof(Header)}, {binary.data(), static_cast<size_t>(bytes)}});
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProgramCache::clear()
+{
+  if (!m_directory.empty())
+  {
+    clearCacheFiles(m_directory, ".bin");
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string ProgramCache::summary() const
+{
+  std::ostringstream out;
+  out << "program cache " << m_stats.hits << " hits (" << m_stats.loadSeconds * 1000.0 << " ms, saved "
+      << m_stats.savedSeconds * 1000.0 << " ms) " << m_stats.misses << " misses (" << m_stats.compileSeconds * 1000.0
+      << " ms)";
+  if (m_stats.rejected != 0)
+  {
+    out << " " << m_stats.rejected << " rejected";
+  }
+  return out.str();
+}
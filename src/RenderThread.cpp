@@ -0,0 +1,233 @@
+/// @file RenderThread.cpp
+/// @brief implementation of the render thread and the hand over of its frames
+#include "RenderThread.h"
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief how long the thread sleeps while the frame callback has more to do
+//----------------------------------------------------------------------------------------------------------------------
+constexpr std::chrono::milliseconds s_busyInterval(10);
+
+GLsync toSync(void *_sync)
+{
+  return static_cast<GLsync>(_sync);
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+RenderThread::RenderThread(QOpenGLContext *_shareContext, int _samples, Callbacks _callbacks)
+  : m_callbacks(std::move(_callbacks)), m_samples(_samples)
+{
+  auto context = std::make_unique<QOpenGLContext>();
+  context->setFormat(_shareContext->format());
+  context->setShareContext(_shareContext);
+  m_surface = std::make_unique<QOffscreenSurface>();
+  m_surface->setFormat(_shareContext->format());
+  // the surface has to be created on the gui thread, the context is then moved to this thread
+  m_surface->create();
+  if (context->create() && m_surface->isValid())
+  {
+    context->moveToThread(this);
+    m_context = std::move(context);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+RenderThread::~RenderThread()
+{
+  stop();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void RenderThread::requestFrame()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_requested = true;
+  }
+  m_wake.notify_one();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void RenderThread::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_exiting = true;
+  }
+  m_wake.notify_one();
+  wait();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void RenderThread::run()
+{
+  m_context->makeCurrent(m_surface.get());
+  m_callbacks.initialize();
+  std::unique_lock<std::mutex> lock(m_wakeMutex);
+  auto woken = [this]() { return m_requested || m_exiting; };
+  while (!m_exiting)
+  {
+    // requests made while the frame is drawn wake the next wait straight away
+    m_requested = false;
+    lock.unlock();
+    const bool again = m_callbacks.frame();
+    lock.lock();
+    if (again)
+    {
+      m_wake.wait_for(lock, s_busyInterval, woken);
+    }
+    else
+    {
+      m_wake.wait(lock, woken);
+    }
+  }
+  lock.unlock();
+  m_callbacks.release();
+  // the gui has stopped blitting so every slot's fences can go
+  auto *f = m_context->extraFunctions();
+  for (size_t i = 0; i < SnapshotMailbox<Frame>::Slots; ++i)
+  {
+    auto &frame = m_frames.slot(i);
+    for (void **sync : {&frame.rendered, &frame.read})
+    {
+      if (*sync != nullptr)
+      {
+        f->glDeleteSync(toSync(*sync));
+        *sync = nullptr;
+      }
+    }
+    m_targets[i].reset();
+  }
+  m_multisampled.reset();
+  m_context->doneCurrent();
+  // handed back so it is deleted with this object on the gui thread
+  m_context->moveToThread(thread());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void RenderThread::bindTarget(int _width, int _height)
+{
+  auto *f = m_context->extraFunctions();
+  auto &frame = m_frames.back();
+  if (frame.read != nullptr)
+  {
+    // the gui may not have finished copying this slot, the gpu waits rather than this thread
+    f->glWaitSync(toSync(frame.read), 0, GL_TIMEOUT_IGNORED);
+    f->glDeleteSync(toSync(frame.read));
+    frame.read = nullptr;
+  }
+  if (frame.rendered != nullptr)
+  {
+    f->glDeleteSync(toSync(frame.rendered));
+    frame.rendered = nullptr;
+  }
+  const QSize size(std::max(_width, 1), std::max(_height, 1));
+  auto &target = m_targets[m_frames.backIndex()];
+  if (!target || target->size() != size)
+  {
+    // with multisampling the depth is in the multisampled framebuffer, the slots only hold colour
+    target = std::make_unique<QOpenGLFramebufferObject>(size, m_samples > 0 ? QOpenGLFramebufferObject::NoAttachment
+                                                                            : QOpenGLFramebufferObject::Depth);
+  }
+  QOpenGLFramebufferObject *draw = target.get();
+  if (m_samples > 0)
+  {
+    if (!m_multisampled || m_multisampled->size() != size)
+    {
+      QOpenGLFramebufferObjectFormat format;
+      format.setSamples(m_samples);
+      format.setAttachment(QOpenGLFramebufferObject::Depth);
+      m_multisampled = std::make_unique<QOpenGLFramebufferObject>(size, format);
+    }
+    draw = m_multisampled.get();
+  }
+  draw->bind();
+  f->glViewport(0, 0, size.width(), size.height());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void RenderThread::present(int64_t _inputNs)
+{
+  auto *f = m_context->extraFunctions();
+  auto &target = m_targets[m_frames.backIndex()];
+  if (m_samples > 0)
+  {
+    QOpenGLFramebufferObject::blitFramebuffer(target.get(), m_multisampled.get());
+  }
+  auto &frame = m_frames.back();
+  frame.texture = target->texture();
+  frame.width = target->width();
+  frame.height = target->height();
+  frame.rendered = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  // the fence has to reach the gpu before another context can wait on it
+  f->glFlush();
+  frame.inputNs = _inputNs;
+  frame.number = m_frames.published() + 1;
+  m_frames.publish();
+  QOpenGLFramebufferObject::bindDefault();
+  if (m_callbacks.presented)
+  {
+    m_callbacks.presented();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+RenderThread::Blit RenderThread::blit(QOpenGLContext *_context, unsigned int _target, int _width, int _height)
+{
+  auto *f = _context->extraFunctions();
+  Blit result;
+  result.fresh = m_frames.take();
+  auto &frame = m_frames.front();
+  f->glBindFramebuffer(GL_FRAMEBUFFER, _target);
+  if (frame.texture == 0)
+  {
+    // nothing has been drawn yet
+    f->glClear(GL_COLOR_BUFFER_BIT);
+    return result;
+  }
+  if (frame.rendered != nullptr)
+  {
+    f->glWaitSync(toSync(frame.rendered), 0, GL_TIMEOUT_IGNORED);
+  }
+  if (m_readFramebuffer == 0)
+  {
+    f->glGenFramebuffers(1, &m_readFramebuffer);
+  }
+  f->glBindFramebuffer(GL_READ_FRAMEBUFFER, m_readFramebuffer);
+  f->glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame.texture, 0);
+  // while the widget is being resized the frame can be the old size, it is stretched until
+  // one of the new size is ready
+  const bool sameSize = frame.width == _width && frame.height == _height;
+  f->glBlitFramebuffer(0, 0, frame.width, frame.height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT,
+                       sameSize ? GL_NEAREST : GL_LINEAR);
+  f->glBindFramebuffer(GL_FRAMEBUFFER, _target);
+  // the render thread waits for this before drawing into the slot again
+  if (frame.read != nullptr)
+  {
+    f->glDeleteSync(toSync(frame.read));
+  }
+  frame.read = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  f->glFlush();
+  result.drawn = true;
+  result.inputNs = frame.inputNs;
+  result.frame = frame.number;
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void RenderThread::releaseGL(QOpenGLContext *_context)
+{
+  if (m_readFramebuffer != 0)
+  {
+    _context->extraFunctions()->glDeleteFramebuffers(1, &m_readFramebuffer);
+    m_readFramebuffer = 0;
+  }
+}
@@ -0,0 +1,273 @@
+/// @file SceneGraph.cpp
+/// @brief implementation of the level by level world matrix propagation
+#include "SceneGraph.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+double secondsSince(std::chrono::steady_clock::time_point _start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneGraph::reserve(size_t _nodes)
+{
+  m_parentOf.reserve(_nodes);
+  m_depthOf.reserve(_nodes);
+  m_slotOf.reserve(_nodes);
+  m_parentSlot.reserve(_nodes);
+  m_orders.reserve(_nodes);
+  m_locals.reserve(_nodes);
+  m_world.reserve(_nodes);
+  m_changed.reserve(_nodes);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneGraph::clear()
+{
+  m_parentOf.clear();
+  m_depthOf.clear();
+  m_slotOf.clear();
+  m_parentSlot.clear();
+  m_orders.clear();
+  m_locals.clear();
+  m_world.clear();
+  m_changed.clear();
+  m_levelStart.assign(1, 0);
+  m_levelDirty.clear();
+  m_sorted = true;
+  m_anyDirty = false;
+  m_rootChanged = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+SceneGraph::NodeId SceneGraph::addNode(NodeId _parent, MatrixOrder _order, const TransformComponents &_local)
+{
+  if (_parent != NoParent && _parent >= size())
+  {
+    throw std::out_of_range("scene graph parent " + std::to_string(_parent) + " doesn't exist");
+  }
+  const auto id = static_cast<NodeId>(size());
+  const uint32_t depth = _parent == NoParent ? 0 : m_depthOf[_parent] + 1;
+  const size_t slot = m_parentSlot.size();
+  const size_t oldLevels = levels();
+  m_parentOf.push_back(_parent);
+  m_depthOf.push_back(depth);
+  m_slotOf.push_back(static_cast<uint32_t>(slot));
+  m_parentSlot.push_back(_parent == NoParent ? NoParent : m_slotOf[_parent]);
+  m_orders.push_back(_order);
+  m_locals.push_back(_local);
+  m_world.push_back(AffineTransform::identity());
+  m_changed.push_back(1);
+  if (depth >= oldLevels)
+  {
+    m_levelDirty.resize(depth + 1, 0);
+  }
+  // while sorted the last slot is in the deepest level, so a new node at that depth or one
+  // below can go on the end, anything shallower has to wait for a sort
+  if (m_sorted && depth + 1 < oldLevels)
+  {
+    m_sorted = false;
+  }
+  if (m_sorted)
+  {
+    if (depth == oldLevels)
+    {
+      m_levelStart.push_back(slot + 1);
+    }
+    else
+    {
+      m_levelStart.back() = slot + 1;
+    }
+  }
+  m_levelDirty[depth] = 1;
+  m_anyDirty = true;
+  return id;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneGraph::markDirty(size_t _slot)
+{
+  m_changed[_slot] = 1;
+  m_anyDirty = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneGraph::setLocal(NodeId _node, const TransformComponents &_local)
+{
+  const size_t slot = m_slotOf[_node];
+  m_locals[slot] = _local;
+  markDirty(slot);
+  m_levelDirty[m_depthOf[_node]] = 1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneGraph::setOrder(NodeId _node, MatrixOrder _order)
+{
+  const size_t slot = m_slotOf[_node];
+  m_orders[slot] = _order;
+  markDirty(slot);
+  m_levelDirty[m_depthOf[_node]] = 1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneGraph::setRootTransform(const AffineTransform &_root)
+{
+  m_root = _root;
+  if (size() != 0)
+  {
+    m_rootChanged = true;
+    m_anyDirty = true;
+    m_levelDirty[0] = 1;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneGraph::sort()
+{
+  auto start = std::chrono::steady_clock::now();
+  const size_t n = size();
+  m_levelStart.assign(levels() + 1, 0);
+  for (auto depth : m_depthOf)
+  {
+    ++m_levelStart[depth + 1];
+  }
+  for (size_t l = 1; l < m_levelStart.size(); ++l)
+  {
+    m_levelStart[l] += m_levelStart[l - 1];
+  }
+  // ids are visited in order so the nodes of a level stay in the order they were added
+  std::vector<size_t> next(m_levelStart.begin(), m_levelStart.end() - 1);
+  std::vector<uint32_t> slotOf(n);
+  for (size_t id = 0; id < n; ++id)
+  {
+    slotOf[id] = static_cast<uint32_t>(next[m_depthOf[id]]++);
+  }
+  std::vector<uint32_t> parentSlot(n);
+  std::vector<MatrixOrder> orders(n);
+  std::vector<TransformComponents> locals(n);
+  std::vector<AffineTransform> world(n);
+  std::vector<uint8_t> changed(n);
+  for (size_t id = 0; id < n; ++id)
+  {
+    const size_t from = m_slotOf[id];
+    const size_t to = slotOf[id];
+    parentSlot[to] = m_parentOf[id] == NoParent ? NoParent : slotOf[m_parentOf[id]];
+    orders[to] = m_orders[from];
+    locals[to] = m_locals[from];
+    world[to] = m_world[from];
+    changed[to] = m_changed[from];
+  }
+  m_slotOf.swap(slotOf);
+  m_parentSlot.swap(parentSlot);
+  m_orders.swap(orders);
+  m_locals.swap(locals);
+  m_world.swap(world);
+  m_changed.swap(changed);
+  m_sorted = true;
+  ++m_stats.sorts;
+  m_stats.sortSeconds += secondsSince(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t SceneGraph::updateRange(size_t _begin, size_t _end)
+{
+  size_t rebuilt = 0;
+  for (size_t i = _begin; i < _end; ++i)
+  {
+    const uint32_t p = m_parentSlot[i];
+    const bool parentChanged = p == NoParent ? m_rootChanged : m_changed[p] != 0;
+    if (!parentChanged && m_changed[i] == 0)
+    {
+      continue;
+    }
+    auto local = composeAffine(m_orders[i], m_locals[i]);
+    m_world[i] = (p == NoParent ? m_root : m_world[p]) * local;
+    m_changed[i] = 1;
+    ++rebuilt;
+  }
+  return rebuilt;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneGraph::update(ThreadPool *_pool, size_t _grain)
+{
+  ++m_stats.updates;
+  if (!m_anyDirty)
+  {
+    m_stats.skipped += size();
+    m_stats.levelsSkipped += levels();
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (!m_sorted)
+  {
+    sort();
+  }
+  // each level only reads the flags of the one above, so those can be cleared once the
+  // level is done, and a level with nothing changed above it or in it is skipped outright
+  bool above = false;
+  for (size_t level = 0; level < levels(); ++level)
+  {
+    const size_t begin = m_levelStart[level];
+    const size_t end = m_levelStart[level + 1];
+    if (!above && m_levelDirty[level] == 0)
+    {
+      m_stats.skipped += end - begin;
+      ++m_stats.levelsSkipped;
+      continue;
+    }
+    size_t rebuilt = 0;
+    if (_pool == nullptr || end - begin <= _grain)
+    {
+      rebuilt = updateRange(begin, end);
+    }
+    else
+    {
+      std::atomic<size_t> count(0);
+      _pool->parallelFor(end - begin, _grain, [&](size_t _b, size_t _e)
+                         {
+                           count.fetch_add(updateRange(begin + _b, begin + _e), std::memory_order_relaxed);
+                         });
+      rebuilt = count.load();
+    }
+    m_stats.composed += rebuilt;
+    m_stats.skipped += end - begin - rebuilt;
+    if (above)
+    {
+      std::memset(&m_changed[m_levelStart[level - 1]], 0, begin - m_levelStart[level - 1]);
+    }
+    m_levelDirty[level] = 0;
+    above = rebuilt != 0;
+  }
+  if (above)
+  {
+    const size_t last = m_levelStart[levels() - 1];
+    std::memset(&m_changed[last], 0, size() - last);
+  }
+  m_anyDirty = false;
+  m_rootChanged = false;
+  m_stats.seconds += secondsSince(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string SceneGraph::summary() const
+{
+  std::ostringstream out;
+  out << "scene graph " << size() << " nodes in " << levels() << " levels, " << m_stats.composed << " composed "
+      << m_stats.skipped << " skipped (" << m_stats.levelsSkipped << " levels) over " << m_stats.updates
+      << " updates in " << m_stats.seconds * 1000.0 << " ms";
+  if (m_stats.sorts != 0)
+  {
+    out << ", " << m_stats.sorts << " sorts (" << m_stats.sortSeconds * 1000.0 << " ms)";
+  }
+  return out.str();
+}
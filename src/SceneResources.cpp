@@ -0,0 +1,260 @@
+/// @file SceneResources.cpp
+/// @brief the shader and primitive set up moved out of NGLScene::initializeGL
+#include "SceneResources.h"
+#include "GeometryCache.h"
+#include "MeshSimplifier.h"
+#include "ProgramCache.h"
+#include "StreamingVAO.h"
+#include <ngl/ShaderLib.h>
+#include <ngl/VAOPrimitives.h>
+#include <algorithm>
+#include <cstdio>
+
+//----------------------------------------------------------------------------------------------------------------------
+const std::array<std::string, SceneResources::NumPrimitives> &SceneResources::primitiveNames()
+{
+  static const std::array<std::string, NumPrimitives> s_vboNames = {
+      {"sphere",
+       "cylinder",
+       "cone",
+       "disk",
+       "plane",
+       "torus",
+       "teapot",
+       "octahedron",
+       "dodecahedron",
+       "icosahedron",
+       "tetrahedron",
+       "football",
+       "cube",
+       "troll",
+       "buddah",
+       "dragon",
+       "bunny"}};
+  return s_vboNames;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const std::vector<SceneResources::GeneratedPrimitive> &SceneResources::generatedPrimitives()
+{
+  // the parameters are part of the cache key so they must change with the create call
+  static const std::vector<GeneratedPrimitive> s_generated = []()
+  {
+    std::vector<GeneratedPrimitive> generated = {
+        {"sphere", "radius=1 precision=40", []
+         { ngl::VAOPrimitives::createSphere("sphere", 1.0f, 40.0f); }},
+        {"cylinder", "radius=0.5 height=1.4 slices=40 stacks=40", []
+         { ngl::VAOPrimitives::createCylinder("cylinder", 0.5f, 1.4f, 40.0f, 40.0f); }},
+        {"cone", "base=0.5 height=1.4 slices=20 stacks=20", []
+         { ngl::VAOPrimitives::createCone("cone", 0.5f, 1.4f, 20.0f, 20.0f); }},
+        {"disk", "radius=0.5 slices=40", []
+         { ngl::VAOPrimitives::createDisk("disk", 0.5f, 40.0f); }},
+        {"plane", "width=1 depth=1 wp=10 dp=10 normal=0,1,0", []
+         { ngl::VAOPrimitives::createTrianglePlane("plane", 1.0f, 1.0f, 10.0f, 10.0f, ngl::Vec3(0.0f, 1.0f, 0.0f)); }},
+        {"torus", "minor=0.15 major=0.4 sides=40 rings=40", []
+         { ngl::VAOPrimitives::createTorus("torus", 0.15f, 0.4f, 40.0f, 40.0f); }}};
+    // the coarser levels of detail roughly halve the resolution each time, down to the fewest
+    // segments that still look like the shape. Stacks only add triangles along the straight
+    // sides of the cylinder and cone so they drop faster than the slices
+    const int sphere[] = {20, 10, 6};
+    const int cylinder[][2] = {{20, 10}, {10, 3}, {6, 1}};
+    const int cone[][2] = {{12, 6}, {8, 2}, {5, 1}};
+    const int disk[] = {20, 10, 6};
+    const int plane[] = {4, 2, 1};
+    const int torus[][2] = {{20, 20}, {12, 12}, {6, 6}};
+    auto text = [](const char *_format, auto... _values)
+    {
+      char buffer[128];
+      std::snprintf(buffer, sizeof(buffer), _format, _values...);
+      return std::string(buffer);
+    };
+    for (size_t level = 1; level < LodLevels; ++level)
+    {
+      const size_t i = level - 1;
+      auto name = lodName("sphere", level);
+      generated.push_back({name, text("radius=1 precision=%d", sphere[i]), [name, p = sphere[i]]()
+                           { ngl::VAOPrimitives::createSphere(name, 1.0f, p); }});
+      name = lodName("cylinder", level);
+      generated.push_back({name, text("radius=0.5 height=1.4 slices=%d stacks=%d", cylinder[i][0], cylinder[i][1]),
+                           [name, s = cylinder[i][0], t = cylinder[i][1]]()
+                           { ngl::VAOPrimitives::createCylinder(name, 0.5f, 1.4f, s, t); }});
+      name = lodName("cone", level);
+      generated.push_back({name, text("base=0.5 height=1.4 slices=%d stacks=%d", cone[i][0], cone[i][1]),
+                           [name, s = cone[i][0], t = cone[i][1]]()
+                           { ngl::VAOPrimitives::createCone(name, 0.5f, 1.4f, s, t); }});
+      name = lodName("disk", level);
+      generated.push_back({name, text("radius=0.5 slices=%d", disk[i]), [name, s = disk[i]]()
+                           { ngl::VAOPrimitives::createDisk(name, 0.5f, s); }});
+      name = lodName("plane", level);
+      generated.push_back({name, text("width=1 depth=1 wp=%d dp=%d normal=0,1,0", plane[i], plane[i]),
+                           [name, s = plane[i]]()
+                           { ngl::VAOPrimitives::createTrianglePlane(name, 1.0f, 1.0f, s, s, ngl::Vec3(0.0f, 1.0f, 0.0f)); }});
+      name = lodName("torus", level);
+      generated.push_back({name, text("minor=0.15 major=0.4 sides=%d rings=%d", torus[i][0], torus[i][1]),
+                           [name, s = torus[i][0], r = torus[i][1]]()
+                           { ngl::VAOPrimitives::createTorus(name, 0.15f, 0.4f, s, r); }});
+      // the scanned meshes come from NGLInit so they are always there to be simplified, the
+      // cube count is along the longest side of the model
+      for (const char *scanned : {"troll", "buddah", "dragon", "bunny"})
+      {
+        const unsigned int cells = 128u >> level;
+        name = lodName(scanned, level);
+        generated.push_back({name, text("source=%s cells=%u clustering=1", scanned, cells),
+                             [source = std::string(scanned), name, cells]()
+                             { createSimplified(source, name, cells); }});
+      }
+    }
+    return generated;
+  }();
+  return s_generated;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string SceneResources::lodName(const std::string &_name, size_t _level)
+{
+  return _level == 0 ? _name : _name + " lod" + std::to_string(_level);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool SceneResources::hasLods(const std::string &_name)
+{
+  return findGenerated(lodName(_name, 1)) != nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool SceneResources::createSimplified(const std::string &_source, const std::string &_name, unsigned int _cells)
+{
+  auto *source = ngl::VAOPrimitives::getVAOFromName(_source);
+  std::vector<GeometryCache::Attribute> attributes;
+  std::vector<char> data;
+  if (source == nullptr || source->getMode() != GL_TRIANGLES || !GeometryCache::readBack(source, attributes, data))
+  {
+    return false;
+  }
+  // the simplifier moves whole vertices so the attributes must be interleaved with one stride
+  const GeometryCache::Attribute *position = nullptr;
+  size_t stride = 0;
+  for (auto &a : attributes)
+  {
+    if (a.location == 0 && a.type == GL_FLOAT && a.size == 3)
+    {
+      position = &a;
+    }
+    if (a.stride == 0 || (stride != 0 && a.stride != stride) || a.offset >= a.stride)
+    {
+      return false;
+    }
+    stride = a.stride;
+  }
+  if (position == nullptr)
+  {
+    return false;
+  }
+  const size_t vertices = std::min<size_t>(source->numIndices(), data.size() / stride);
+  auto simplified = MeshSimplifier::cluster(data.data(), vertices, stride, position->offset, _cells);
+  auto vao = std::make_unique<StreamingVAO>(GL_TRIANGLES);
+  vao->bind();
+  vao->allocate(simplified.size());
+  vao->setSubData(0, simplified.size(), simplified.data());
+  for (auto &a : attributes)
+  {
+    vao->setVertexAttributePointer(a.location, static_cast<GLint>(a.size), a.type, static_cast<GLsizei>(a.stride),
+                                   a.offset / sizeof(GLfloat), a.normalised != 0);
+  }
+  vao->setNumIndices(simplified.size() / stride);
+  vao->unbind();
+  ngl::VAOPrimitives::addToPrimitives(_name, std::move(vao));
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const SceneResources::GeneratedPrimitive *SceneResources::findGenerated(const std::string &_name)
+{
+  for (auto &primitive : generatedPrimitives())
+  {
+    if (_name == primitive.name)
+    {
+      return &primitive;
+    }
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneResources::createPrimitive(const GeneratedPrimitive &_primitive, GeometryCache *_cache)
+{
+  if (_cache != nullptr)
+  {
+    _cache->createPrimitive(_primitive.name, _primitive.params, _primitive.create);
+  }
+  else
+  {
+    _primitive.create();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneResources::createPrimitives(GeometryCache *_cache)
+{
+  for (auto &primitive : generatedPrimitives())
+  {
+    createPrimitive(primitive, _cache);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SceneResources::loadShaders(const ngl::Vec3 &_camPos, ProgramCache *_cache)
+{
+  // without a cache every program is compiled from source as before
+  ProgramCache noCache{std::string()};
+  auto &cache = _cache != nullptr ? *_cache : noCache;
+  cache.build(AxisShader, {{"AxisVertex", ngl::ShaderType::VERTEX, "shaders/AxisVertex.glsl"},
+                           {"AxisFragment", ngl::ShaderType::FRAGMENT, "shaders/AxisFragment.glsl"}});
+
+  cache.build(PBR, {{"PBRVertex", ngl::ShaderType::VERTEX, "shaders/PBRVertex.glsl"},
+                    {"PBRFragment", ngl::ShaderType::FRAGMENT, "shaders/PBRFragment.glsl"}});
+  // the transforms come from our own buffer rather than ngl's so they don't depend on ngl
+  // having linked the program itself
+  GLuint pbr = ngl::ShaderLib::getProgramID(PBR);
+  glUniformBlockBinding(pbr, glGetUniformBlockIndex(pbr, TransformBlock), TransformBinding);
+  ngl::ShaderLib::use(PBR);
+  ngl::ShaderLib::setUniform("camPos", _camPos);
+  // these are "uniform" so will retain their values
+  ngl::ShaderLib::setUniform("lightPosition", 0.0f, 2.0f, 2.0f);
+  ngl::ShaderLib::setUniform("lightColor", 400.0f, 400.0f, 400.0f);
+  ngl::ShaderLib::setUniform("exposure", 2.2f);
+  ngl::ShaderLib::setUniform("albedo", 0.950f, 0.71f, 0.29f);
+
+  ngl::ShaderLib::setUniform("metallic", 1.02f);
+  ngl::ShaderLib::setUniform("roughness", 0.38f);
+  ngl::ShaderLib::setUniform("ao", 0.2f);
+  ngl::ShaderLib::setUniform("instanced", false);
+
+  // load the normal shader
+  cache.build(NormalShader, {{"normalVertex", ngl::ShaderType::VERTEX, "shaders/normalVertex.glsl"},
+                             {"normalFrag", ngl::ShaderType::FRAGMENT, "shaders/normalFragment.glsl"},
+                             {"normalGeo", ngl::ShaderType::GEOMETRY, "shaders/normalGeo.glsl"}});
+  ngl::ShaderLib::use(NormalShader);
+  // now pass the modelView and projection values to the shader
+  ngl::ShaderLib::setUniform("normalSize", 0.1f);
+  ngl::ShaderLib::setUniform("vertNormalColour", 1.0f, 1.0f, 0.0f, 1.0f);
+  ngl::ShaderLib::setUniform("faceNormalColour", 1.0f, 0.0f, 0.0f, 1.0f);
+
+  ngl::ShaderLib::setUniform("drawFaceNormals", true);
+  ngl::ShaderLib::setUniform("drawVertexNormals", true);
+
+  // the same lines from the buffers made by NormalLines, no geometry shader needed
+  cache.build(NormalLineShader, {{"normalLineVertex", ngl::ShaderType::VERTEX, "shaders/normalLineVertex.glsl"},
+                                 {"normalLineFrag", ngl::ShaderType::FRAGMENT, "shaders/normalFragment.glsl"}});
+  ngl::ShaderLib::use(NormalLineShader);
+  ngl::ShaderLib::setUniform("normalSize", 0.1f);
+  ngl::ShaderLib::setUniform("vertNormalColour", 1.0f, 1.0f, 0.0f, 1.0f);
+  ngl::ShaderLib::setUniform("faceNormalColour", 1.0f, 0.0f, 0.0f, 1.0f);
+
+  // copies the SoftwareRasterizer's colour and depth into the framebuffer
+  cache.build(SoftwareImageShader, {{"SoftwareImageVertex", ngl::ShaderType::VERTEX, "shaders/SoftwareImageVertex.glsl"},
+                                    {"SoftwareImageFragment", ngl::ShaderType::FRAGMENT, "shaders/SoftwareImageFragment.glsl"}});
+  ngl::ShaderLib::use(SoftwareImageShader);
+  ngl::ShaderLib::setUniform("image", 0);
+  ngl::ShaderLib::setUniform("depth", 1);
+}
@@ -0,0 +1,623 @@
+/// @file SoftwareRasterizer.cpp
+/// @brief implementation of the tiled cpu rasterizer
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a transformed vertex, everything the clipping interpolates
+//----------------------------------------------------------------------------------------------------------------------
+struct SoftwareRasterizer::Vertex
+{
+  float clip[4];
+  float world[3];
+  float normal[3];
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a clipped triangle ready to draw, wound so its area is positive
+//----------------------------------------------------------------------------------------------------------------------
+struct SoftwareRasterizer::Triangle
+{
+  int64_t x[3];           ///< window position in 1/256 pixel, y down
+  int64_t y[3];
+  int64_t area;           ///< twice the area in the same units
+  float z[3];             ///< normalised device depth
+  float invW[3];
+  float world[3][3];
+  float normal[3][3];
+  int minX;               ///< the pixels whose centres may be covered
+  int minY;
+  int maxX;
+  int maxY;
+};
+
+namespace
+{
+/// the bits of sub pixel precision the window positions are snapped to
+constexpr int SubPixelBits = 8;
+constexpr int64_t SubPixel = int64_t(1) << SubPixelBits;
+/// mesh triangles set up together, the result is joined in this order whatever the threads
+constexpr size_t BlockTriangles = 4096;
+constexpr uint32_t NoTriangle = std::numeric_limits<uint32_t>::max();
+constexpr float PI = 3.14159265359f;
+
+double msSince(std::chrono::steady_clock::time_point _start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+}
+
+float dot(const float _a[3], const float _b[3])
+{
+  return _a[0] * _b[0] + _a[1] * _b[1] + _a[2] * _b[2];
+}
+
+void normalize(float io_v[3])
+{
+  float length = std::sqrt(dot(io_v, io_v));
+  if (length > 0.0f)
+  {
+    io_v[0] /= length;
+    io_v[1] /= length;
+    io_v[2] /= length;
+  }
+}
+
+/// the column major 4x4 _m times (_v,1)
+void transformPoint(const float _m[16], const float _v[3], float *o_result, int _rows)
+{
+  for (int r = 0; r < _rows; ++r)
+  {
+    o_result[r] = _m[r] * _v[0] + _m[4 + r] * _v[1] + _m[8 + r] * _v[2] + _m[12 + r];
+  }
+}
+
+/// twice the signed area of _a,_b,_p, positive when _p is to the right of _a to _b with y down
+int64_t edge(int64_t _ax, int64_t _ay, int64_t _bx, int64_t _by, int64_t _px, int64_t _py)
+{
+  return (_bx - _ax) * (_py - _ay) - (_by - _ay) * (_px - _ax);
+}
+
+/// 1 if a pixel centre exactly on the edge _a to _b belongs to the triangle. The test is reversed
+/// for the same edge walked the other way, so a pixel on an edge shared by two triangles is
+/// drawn by exactly one of them
+int64_t edgeBias(int64_t _ax, int64_t _ay, int64_t _bx, int64_t _by)
+{
+  int64_t dx = _bx - _ax;
+  int64_t dy = _by - _ay;
+  return (dy > 0 || (dy == 0 && dx < 0)) ? 1 : 0;
+}
+
+/// distance of _clip inside clip plane _plane, the planes are -x,+x,-y,+y and near
+float planeDistance(const float _clip[4], int _plane)
+{
+  switch (_plane)
+  {
+  case 0:
+    return _clip[3] + _clip[0];
+  case 1:
+    return _clip[3] - _clip[0];
+  case 2:
+    return _clip[3] + _clip[1];
+  case 3:
+    return _clip[3] - _clip[1];
+  default:
+    return _clip[3] + _clip[2];
+  }
+}
+constexpr int ClipPlanes = 5;
+/// a triangle clipped by every plane has at most this many corners
+constexpr int MaxClipVertices = 3 + ClipPlanes;
+
+uint8_t toUnorm(float _value)
+{
+  return static_cast<uint8_t>(std::clamp(_value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+SoftwareRasterizer::SoftwareRasterizer(ThreadPool &_pool, int _tileSize)
+  : m_pool(_pool), m_tileSize(std::max(_tileSize, 8))
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// defined here where Vertex and Triangle are complete
+SoftwareRasterizer::~SoftwareRasterizer() = default;
+
+//----------------------------------------------------------------------------------------------------------------------
+void SoftwareRasterizer::setClearColour(float _r, float _g, float _b, float _a)
+{
+  m_clear[0] = _r;
+  m_clear[1] = _g;
+  m_clear[2] = _b;
+  m_clear[3] = _a;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SoftwareRasterizer::render(const Mesh &_mesh, const Transforms &_transforms, const Material &_material,
+                                int _width, int _height)
+{
+  auto start = std::chrono::steady_clock::now();
+  m_stats = Stats();
+  m_image.width = std::max(_width, 0);
+  m_image.height = std::max(_height, 0);
+  m_image.rgba.resize(size_t(m_image.width) * m_image.height * 4);
+  m_image.depth.resize(size_t(m_image.width) * m_image.height);
+  m_tilesX = (m_image.width + m_tileSize - 1) / m_tileSize;
+  m_tilesY = (m_image.height + m_tileSize - 1) / m_tileSize;
+
+  auto stage = std::chrono::steady_clock::now();
+  transformVertices(_mesh, _transforms);
+  m_stats.vertexMs = msSince(stage);
+
+  stage = std::chrono::steady_clock::now();
+  setupTriangles();
+  binTriangles();
+  m_stats.setupMs = msSince(stage);
+
+  // every tile is drawn, an empty one is just cleared
+  stage = std::chrono::steady_clock::now();
+  const size_t tiles = m_bins.size();
+  m_stats.tiles.resize(tiles);
+  m_tileOrder.resize(tiles);
+  std::iota(m_tileOrder.begin(), m_tileOrder.end(), 0u);
+  std::stable_sort(m_tileOrder.begin(), m_tileOrder.end(),
+                   [this](uint32_t _a, uint32_t _b) { return m_bins[_a].size() > m_bins[_b].size(); });
+  m_stats.workers = m_pool.size() + 1;
+  std::atomic<size_t> next{0};
+  m_pool.parallelFor(m_stats.workers, 1, [&](size_t _begin, size_t _end)
+                     {
+                       for (size_t worker = _begin; worker < _end; ++worker)
+                       {
+                         for (size_t i = next++; i < tiles; i = next++)
+                         {
+                           drawTile(m_tileOrder[i], static_cast<uint32_t>(worker), _material);
+                         }
+                       }
+                     });
+  for (auto &t : m_stats.tiles)
+  {
+    m_stats.pixels += t.pixels;
+  }
+  m_stats.rasterMs = msSince(stage);
+  m_stats.totalMs = msSince(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SoftwareRasterizer::transformVertices(const Mesh &_mesh, const Transforms &_transforms)
+{
+  // only whole triangles are drawn
+  const size_t count = _mesh.data != nullptr ? _mesh.vertices / 3 * 3 : 0;
+  m_vertices.resize(count);
+  m_pool.parallelFor(count, 4096, [&](size_t _begin, size_t _end)
+                     {
+                       for (size_t i = _begin; i < _end; ++i)
+                       {
+                         const char *vertex = _mesh.data + i * _mesh.stride;
+                         float position[3];
+                         float normal[3];
+                         std::memcpy(position, vertex + _mesh.position, sizeof(position));
+                         std::memcpy(normal, vertex + _mesh.normal, sizeof(normal));
+                         auto &v = m_vertices[i];
+                         transformPoint(_transforms.MVP, position, v.clip, 4);
+                         transformPoint(_transforms.M, position, v.world, 3);
+                         for (int r = 0; r < 3; ++r)
+                         {
+                           v.normal[r] = _transforms.normalMatrix[0][r] * normal[0] +
+                                         _transforms.normalMatrix[1][r] * normal[1] +
+                                         _transforms.normalMatrix[2][r] * normal[2];
+                         }
+                         normalize(v.normal);
+                       }
+                     });
+  m_stats.triangles = count / 3;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SoftwareRasterizer::setupTriangles()
+{
+  const size_t triangles = m_vertices.size() / 3;
+  const size_t blocks = (triangles + BlockTriangles - 1) / BlockTriangles;
+  m_blocks.resize(blocks);
+  const float width = static_cast<float>(m_image.width);
+  const float height = static_cast<float>(m_image.height);
+  m_pool.parallelFor(blocks, 1, [&](size_t _begin, size_t _end)
+                     {
+                       Vertex polygon[MaxClipVertices];
+                       Vertex clipped[MaxClipVertices];
+                       for (size_t b = _begin; b < _end; ++b)
+                       {
+                         auto &block = m_blocks[b];
+                         block.clear();
+                         const size_t last = std::min((b + 1) * BlockTriangles, triangles);
+                         for (size_t t = b * BlockTriangles; t < last; ++t)
+                         {
+                           // Sutherland-Hodgman against the sides and near plane, the far plane is
+                           // left to the depth test
+                           int corners = 3;
+                           std::copy_n(&m_vertices[t * 3], 3, polygon);
+                           for (int plane = 0; plane < ClipPlanes && corners >= 3; ++plane)
+                           {
+                             int kept = 0;
+                             for (int c = 0; c < corners; ++c)
+                             {
+                               const Vertex &a = polygon[c];
+                               const Vertex &b = polygon[(c + 1) % corners];
+                               float da = planeDistance(a.clip, plane);
+                               float db = planeDistance(b.clip, plane);
+                               if (da >= 0.0f)
+                               {
+                                 clipped[kept++] = a;
+                               }
+                               if ((da >= 0.0f) != (db >= 0.0f))
+                               {
+                                 float s = da / (da - db);
+                                 Vertex &v = clipped[kept++];
+                                 for (int i = 0; i < 4; ++i)
+                                 {
+                                   v.clip[i] = a.clip[i] + s * (b.clip[i] - a.clip[i]);
+                                 }
+                                 for (int i = 0; i < 3; ++i)
+                                 {
+                                   v.world[i] = a.world[i] + s * (b.world[i] - a.world[i]);
+                                   v.normal[i] = a.normal[i] + s * (b.normal[i] - a.normal[i]);
+                                 }
+                               }
+                             }
+                             corners = kept;
+                             std::copy_n(clipped, corners, polygon);
+                           }
+                           // the clipped polygon is convex so it is drawn as a fan
+                           for (int c = 1; c + 1 < corners; ++c)
+                           {
+                             const Vertex *corner[3] = {&polygon[0], &polygon[c], &polygon[c + 1]};
+                             Triangle tri;
+                             for (int i = 0; i < 3; ++i)
+                             {
+                               const Vertex &v = *corner[i];
+                               tri.invW[i] = 1.0f / v.clip[3];
+                               float sx = (v.clip[0] * tri.invW[i] * 0.5f + 0.5f) * width;
+                               float sy = (0.5f - v.clip[1] * tri.invW[i] * 0.5f) * height;
+                               tri.x[i] = std::llround(sx * SubPixel);
+                               tri.y[i] = std::llround(sy * SubPixel);
+                               tri.z[i] = v.clip[2] * tri.invW[i];
+                               std::copy_n(v.world, 3, tri.world[i]);
+                               std::copy_n(v.normal, 3, tri.normal[i]);
+                             }
+                             tri.area = edge(tri.x[0], tri.y[0], tri.x[1], tri.y[1], tri.x[2], tri.y[2]);
+                             if (tri.area == 0)
+                             {
+                               continue;
+                             }
+                             // there is no face culling so either winding is drawn
+                             if (tri.area < 0)
+                             {
+                               std::swap(tri.x[1], tri.x[2]);
+                               std::swap(tri.y[1], tri.y[2]);
+                               std::swap(tri.z[1], tri.z[2]);
+                               std::swap(tri.invW[1], tri.invW[2]);
+                               std::swap(tri.world[1], tri.world[2]);
+                               std::swap(tri.normal[1], tri.normal[2]);
+                               tri.area = -tri.area;
+                             }
+                             // the pixel centres are at (n + 0.5) pixels
+                             const int64_t half = SubPixel / 2;
+                             int64_t minX = std::min({tri.x[0], tri.x[1], tri.x[2]});
+                             int64_t minY = std::min({tri.y[0], tri.y[1], tri.y[2]});
+                             int64_t maxX = std::max({tri.x[0], tri.x[1], tri.x[2]});
+                             int64_t maxY = std::max({tri.y[0], tri.y[1], tri.y[2]});
+                             tri.minX = static_cast<int>(std::max<int64_t>((minX - half + SubPixel - 1) >> SubPixelBits, 0));
+                             tri.minY = static_cast<int>(std::max<int64_t>((minY - half + SubPixel - 1) >> SubPixelBits, 0));
+                             tri.maxX = static_cast<int>(std::min<int64_t>((maxX - half) >> SubPixelBits, m_image.width - 1));
+                             tri.maxY = static_cast<int>(std::min<int64_t>((maxY - half) >> SubPixelBits, m_image.height - 1));
+                             if (tri.minX <= tri.maxX && tri.minY <= tri.maxY)
+                             {
+                               block.push_back(tri);
+                             }
+                           }
+                         }
+                       }
+                     });
+  m_triangles.clear();
+  for (auto &block : m_blocks)
+  {
+    m_triangles.insert(m_triangles.end(), block.begin(), block.end());
+  }
+  m_stats.clipped = m_triangles.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SoftwareRasterizer::binTriangles()
+{
+  // the bins keep their capacity from frame to frame
+  m_bins.resize(size_t(m_tilesX) * m_tilesY);
+  for (auto &bin : m_bins)
+  {
+    bin.clear();
+  }
+  for (size_t t = 0; t < m_triangles.size(); ++t)
+  {
+    const auto &tri = m_triangles[t];
+    for (int ty = tri.minY / m_tileSize; ty <= tri.maxY / m_tileSize; ++ty)
+    {
+      for (int tx = tri.minX / m_tileSize; tx <= tri.maxX / m_tileSize; ++tx)
+      {
+        m_bins[size_t(ty) * m_tilesX + tx].push_back(static_cast<uint32_t>(t));
+        ++m_stats.binned;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SoftwareRasterizer::drawTile(size_t _tile, uint32_t _worker, const Material &_material)
+{
+  auto start = std::chrono::steady_clock::now();
+  const int x0 = static_cast<int>(_tile % m_tilesX) * m_tileSize;
+  const int y0 = static_cast<int>(_tile / m_tilesX) * m_tileSize;
+  const int x1 = std::min(x0 + m_tileSize, m_image.width);
+  const int y1 = std::min(y0 + m_tileSize, m_image.height);
+  const int tileWidth = x1 - x0;
+  // the visibility buffer, each pixel's nearest triangle is only shaded once they are all drawn
+  thread_local std::vector<float> depth;
+  thread_local std::vector<uint32_t> visible;
+  depth.assign(size_t(m_tileSize) * m_tileSize, 1.0f);
+  visible.assign(size_t(m_tileSize) * m_tileSize, NoTriangle);
+
+  const auto &bin = m_bins[_tile];
+  for (uint32_t t : bin)
+  {
+    const auto &tri = m_triangles[t];
+    const int minX = std::max(tri.minX, x0);
+    const int minY = std::max(tri.minY, y0);
+    const int maxX = std::min(tri.maxX, x1 - 1);
+    const int maxY = std::min(tri.maxY, y1 - 1);
+    const int64_t px = int64_t(minX) * SubPixel + SubPixel / 2;
+    const int64_t py = int64_t(minY) * SubPixel + SubPixel / 2;
+    // the edge opposite each corner, stepped exactly in integers across the tile
+    int64_t row[3];
+    int64_t bias[3];
+    int64_t stepX[3];
+    int64_t stepY[3];
+    for (int e = 0; e < 3; ++e)
+    {
+      const int a = (e + 1) % 3;
+      const int b = (e + 2) % 3;
+      // the bias turns the tie rule into a single > 0 test
+      bias[e] = edgeBias(tri.x[a], tri.y[a], tri.x[b], tri.y[b]);
+      row[e] = edge(tri.x[a], tri.y[a], tri.x[b], tri.y[b], px, py) + bias[e];
+      stepX[e] = -(tri.y[b] - tri.y[a]) * SubPixel;
+      stepY[e] = (tri.x[b] - tri.x[a]) * SubPixel;
+    }
+    const float invArea = 1.0f / static_cast<float>(tri.area);
+    for (int y = minY; y <= maxY; ++y)
+    {
+      int64_t w[3] = {row[0], row[1], row[2]};
+      for (int x = minX; x <= maxX; ++x)
+      {
+        if (w[0] > 0 && w[1] > 0 && w[2] > 0)
+        {
+          float l1 = static_cast<float>(w[1] - bias[1]) * invArea;
+          float l2 = static_cast<float>(w[2] - bias[2]) * invArea;
+          float l0 = 1.0f - l1 - l2;
+          // depth is linear in window space, as GL interpolates it
+          float d = (l0 * tri.z[0] + l1 * tri.z[1] + l2 * tri.z[2]) * 0.5f + 0.5f;
+          size_t i = size_t(y - y0) * m_tileSize + (x - x0);
+          if (d < depth[i])
+          {
+            depth[i] = d;
+            visible[i] = t;
+          }
+        }
+        for (int e = 0; e < 3; ++e)
+        {
+          w[e] += stepX[e];
+        }
+      }
+      for (int e = 0; e < 3; ++e)
+      {
+        row[e] += stepY[e];
+      }
+    }
+  }
+
+  uint32_t pixels = 0;
+  const uint8_t clear[4] = {toUnorm(m_clear[0]), toUnorm(m_clear[1]), toUnorm(m_clear[2]), toUnorm(m_clear[3])};
+  for (int y = y0; y < y1; ++y)
+  {
+    uint8_t *out = &m_image.rgba[(size_t(y) * m_image.width + x0) * 4];
+    float *outDepth = &m_image.depth[size_t(y) * m_image.width + x0];
+    for (int x = 0; x < tileWidth; ++x, out += 4)
+    {
+      size_t i = size_t(y - y0) * m_tileSize + x;
+      outDepth[x] = depth[i];
+      if (visible[i] == NoTriangle)
+      {
+        std::memcpy(out, clear, 4);
+        continue;
+      }
+      // perspective correct attributes from the barycentrics at the pixel centre
+      const auto &tri = m_triangles[visible[i]];
+      const int64_t px = int64_t(x0 + x) * SubPixel + SubPixel / 2;
+      const int64_t py = int64_t(y) * SubPixel + SubPixel / 2;
+      const float invArea = 1.0f / static_cast<float>(tri.area);
+      float q[3];
+      for (int e = 0; e < 3; ++e)
+      {
+        const int a = (e + 1) % 3;
+        const int b = (e + 2) % 3;
+        q[e] = static_cast<float>(edge(tri.x[a], tri.y[a], tri.x[b], tri.y[b], px, py)) * invArea * tri.invW[e];
+      }
+      const float sum = q[0] + q[1] + q[2];
+      float world[3];
+      float normal[3];
+      for (int c = 0; c < 3; ++c)
+      {
+        world[c] = (q[0] * tri.world[0][c] + q[1] * tri.world[1][c] + q[2] * tri.world[2][c]) / sum;
+        normal[c] = (q[0] * tri.normal[0][c] + q[1] * tri.normal[1][c] + q[2] * tri.normal[2][c]) / sum;
+      }
+      float colour[3];
+      shade(_material, world, normal, colour);
+      out[0] = toUnorm(colour[0]);
+      out[1] = toUnorm(colour[1]);
+      out[2] = toUnorm(colour[2]);
+      out[3] = 255;
+      ++pixels;
+    }
+  }
+
+  auto &stats = m_stats.tiles[_tile];
+  stats.x = x0;
+  stats.y = y0;
+  stats.triangles = static_cast<uint32_t>(bin.size());
+  stats.pixels = pixels;
+  stats.worker = _worker;
+  stats.ms = msSince(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SoftwareRasterizer::shade(const Material &_material, const float _worldPos[3], const float _normal[3],
+                               float o_colour[3])
+{
+  float N[3] = {_normal[0], _normal[1], _normal[2]};
+  normalize(N);
+  float V[3];
+  float L[3];
+  float H[3];
+  for (int c = 0; c < 3; ++c)
+  {
+    V[c] = _material.camPos[c] - _worldPos[c];
+    L[c] = _material.lightPosition[c] - _worldPos[c];
+  }
+  normalize(V);
+  const float distance = std::sqrt(dot(L, L));
+  normalize(L);
+  for (int c = 0; c < 3; ++c)
+  {
+    H[c] = V[c] + L[c];
+  }
+  normalize(H);
+  const float attenuation = 1.0f / (distance * distance);
+
+  // Cook-Torrance BRDF, GGX distribution with Smith's Schlick-GGX geometry term
+  const float roughness = _material.roughness;
+  const float a = roughness * roughness;
+  const float a2 = a * a;
+  const float NdotH = std::max(dot(N, H), 0.0f);
+  float denom = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+  denom = PI * denom * denom;
+  const float NDF = a2 / denom;
+
+  const float r = roughness + 1.0f;
+  const float k = (r * r) / 8.0f;
+  const float NdotV = std::max(dot(N, V), 0.0f);
+  const float NdotL = std::max(dot(N, L), 0.0f);
+  const float G = (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+
+  const float cosTheta = std::max(dot(H, V), 0.0f);
+  const float oneMinusCos = 1.0f - cosTheta;
+  const float oneMinusCos2 = oneMinusCos * oneMinusCos;
+  const float fresnel = oneMinusCos2 * oneMinusCos2 * oneMinusCos;
+  const float denominator = 4.0f * NdotV * NdotL + 0.001f;
+  const float metallic = _material.metallic;
+  for (int c = 0; c < 3; ++c)
+  {
+    const float albedo = _material.albedo[c];
+    // reflectance at normal incidence, 0.04 for a dielectric and the albedo for a metal
+    const float F0 = 0.04f * (1.0f - metallic) + albedo * metallic;
+    const float F = F0 + (1.0f - F0) * fresnel;
+    const float brdf = NDF * G * F / denominator;
+    const float kD = (1.0f - F) * (1.0f - metallic);
+    const float radiance = _material.lightColor[c] * attenuation;
+    const float Lo = (kD * albedo / PI + brdf) * radiance * NdotL;
+    float colour = 0.03f * albedo * _material.ao + Lo;
+    // HDR tonemapping then gamma
+    colour = colour / (colour + 1.0f);
+    o_colour[c] = std::pow(colour, 1.0f / _material.exposure);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+SoftwareRasterizer::Difference SoftwareRasterizer::compare(const uint8_t *_a, const uint8_t *_b, size_t _pixels,
+                                                           int _threshold)
+{
+  Difference result;
+  result.pixels = _pixels;
+  uint64_t sum = 0;
+  for (size_t p = 0; p < _pixels; ++p)
+  {
+    int largest = 0;
+    for (int c = 0; c < 3; ++c)
+    {
+      int d = std::abs(int(_a[p * 4 + c]) - int(_b[p * 4 + c]));
+      largest = std::max(largest, d);
+      sum += static_cast<uint64_t>(d);
+    }
+    result.maxDifference = std::max(result.maxDifference, largest);
+    result.differing += largest > _threshold ? 1 : 0;
+  }
+  result.meanDifference = _pixels > 0 ? static_cast<double>(sum) / (_pixels * 3) : 0.0;
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool SoftwareRasterizer::writePPM(const std::string &_fileName) const
+{
+  std::ofstream out(_fileName, std::ios::binary | std::ios::trunc);
+  out << "P6\n" << m_image.width << ' ' << m_image.height << "\n255\n";
+  std::vector<uint8_t> row(size_t(m_image.width) * 3);
+  for (int y = 0; y < m_image.height; ++y)
+  {
+    const uint8_t *in = &m_image.rgba[size_t(y) * m_image.width * 4];
+    for (int x = 0; x < m_image.width; ++x)
+    {
+      std::memcpy(&row[size_t(x) * 3], in + x * 4, 3);
+    }
+    out.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size()));
+  }
+  out.close();
+  return !out.fail();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string SoftwareRasterizer::Stats::summary() const
+{
+  std::ostringstream out;
+  out.setf(std::ios::fixed);
+  out.precision(3);
+  out << "software " << totalMs << " ms (vertex " << vertexMs << " setup " << setupMs << " raster " << rasterMs
+      << "), " << triangles << " triangles " << clipped << " drawn " << binned << " binned " << pixels
+      << " pixels shaded";
+  if (tiles.empty())
+  {
+    return out.str();
+  }
+  // the busiest tile bounds the raster time however many workers there are
+  auto slowest = std::max_element(tiles.begin(), tiles.end(),
+                                  [](const TileStats &_a, const TileStats &_b) { return _a.ms < _b.ms; });
+  std::vector<double> busy(workers, 0.0);
+  std::vector<size_t> drawn(workers, 0);
+  for (auto &t : tiles)
+  {
+    if (t.worker < workers)
+    {
+      busy[t.worker] += t.ms;
+      ++drawn[t.worker];
+    }
+  }
+  out << ", " << tiles.size() << " tiles slowest " << slowest->ms << " ms at " << slowest->x << "," << slowest->y
+      << " (" << slowest->triangles << " triangles), workers ms/tiles";
+  for (size_t w = 0; w < workers; ++w)
+  {
+    out << " " << busy[w] << "/" << drawn[w];
+  }
+  return out.str();
+}
@@ -0,0 +1,84 @@
+/// @file StreamingVAO.cpp
+/// @brief implementation of the streamed vertex buffer
+#include "StreamingVAO.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+StreamingVAO::~StreamingVAO()
+{
+  removeVAO();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void StreamingVAO::draw() const
+{
+  if (m_allocated)
+  {
+    glDrawArrays(m_mode, 0, static_cast<GLsizei>(m_indicesCount));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void StreamingVAO::removeVAO()
+{
+  if (m_bound)
+  {
+    unbind();
+  }
+  if (m_allocated)
+  {
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+  }
+  if (m_id != 0)
+  {
+    glDeleteVertexArrays(1, &m_id);
+    m_id = 0;
+  }
+  m_allocated = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void StreamingVAO::allocate(size_t _bytes, GLenum _usage)
+{
+  if (m_buffer == 0)
+  {
+    glGenBuffers(1, &m_buffer);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_bytes), nullptr, _usage);
+  m_allocated = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void StreamingVAO::setSubData(size_t _offset, size_t _bytes, const void *_data)
+{
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(_offset), static_cast<GLsizeiptr>(_bytes), _data);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void StreamingVAO::adoptBuffer(GLuint _buffer)
+{
+  if (m_buffer != 0 && m_buffer != _buffer)
+  {
+    glDeleteBuffers(1, &m_buffer);
+  }
+  m_buffer = _buffer;
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  m_allocated = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void StreamingVAO::setData(const VertexData &_data)
+{
+  allocate(_data.m_size, _data.m_mode);
+  setSubData(0, _data.m_size, &_data.m_data);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+ngl::Real *StreamingVAO::mapBuffer(unsigned int, GLenum _accessMode)
+{
+  bind();
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  return static_cast<ngl::Real *>(glMapBuffer(GL_ARRAY_BUFFER, _accessMode));
+}
@@ -0,0 +1,99 @@
+/// @file ThreadPool.cpp
+/// @brief implementation of the worker pool
+#include "ThreadPool.h"
+#include <algorithm>
+#include <exception>
+
+//----------------------------------------------------------------------------------------------------------------------
+ThreadPool::ThreadPool(size_t _threads)
+{
+  if (_threads == 0)
+  {
+    _threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < _threads; ++i)
+  {
+    m_workers.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (auto &w : m_workers)
+  {
+    w.join();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ThreadPool::workerLoop()
+{
+  for (;;)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+      if (m_tasks.empty())
+      {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop();
+    }
+    task();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ThreadPool::parallelFor(size_t _count, size_t _grain, const std::function<void(size_t, size_t)> &_func)
+{
+  if (_count == 0)
+  {
+    return;
+  }
+  // a few ranges per worker so an uneven range doesn't leave the others idle
+  size_t ranges = std::min(std::max(_count / std::max(_grain, size_t(1)), size_t(1)), size() * 4);
+  size_t step = (_count + ranges - 1) / ranges;
+  std::vector<std::future<void>> done;
+  for (size_t begin = step; begin < _count; begin += step)
+  {
+    size_t end = std::min(begin + step, _count);
+    done.push_back(submit([&_func, begin, end]() { _func(begin, end); }));
+  }
+  // the calling thread does the first range rather than sit idle, every range must finish
+  // before an exception is passed on as they all reference _func
+  std::exception_ptr error;
+  try
+  {
+    _func(0, std::min(step, _count));
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+  for (auto &d : done)
+  {
+    try
+    {
+      d.get();
+    }
+    catch (...)
+    {
+      if (!error)
+      {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,277 @@
+/// @file Timeline.cpp
+/// @brief implementation of the keyframe timeline and its baked curves
+#include "Timeline.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+using Key = Timeline::Key;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the value between keys _k and _k + 1 of _keys at _time, which must be between them
+//----------------------------------------------------------------------------------------------------------------------
+float segmentValue(const std::vector<Key> &_keys, size_t _k, float _time)
+{
+  const Key &k0 = _keys[_k];
+  const Key &k1 = _keys[_k + 1];
+  const float span = k1.time - k0.time;
+  const float t = span > 0.0f ? (_time - k0.time) / span : 1.0f;
+  if (k0.ease == Timeline::Ease::LINEAR)
+  {
+    return k0.value + (k1.value - k0.value) * t;
+  }
+  // Catmull-Rom tangents for uneven key spacing, one sided at the ends of the curve
+  const Key &before = _k > 0 ? _keys[_k - 1] : k0;
+  const Key &after = _k + 2 < _keys.size() ? _keys[_k + 2] : k1;
+  const float m0 = before.time < k1.time ? (k1.value - before.value) / (k1.time - before.time) * span : 0.0f;
+  const float m1 = k0.time < after.time ? (after.value - k0.value) / (after.time - k0.time) * span : 0.0f;
+  const float t2 = t * t;
+  const float t3 = t2 * t;
+  return (2.0f * t3 - 3.0f * t2 + 1.0f) * k0.value + (t3 - 2.0f * t2 + t) * m0 + (-2.0f * t3 + 3.0f * t2) * k1.value +
+         (t3 - t2) * m1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a row of the output is the blend of two rows of samples, kept simple so it vectorises
+//----------------------------------------------------------------------------------------------------------------------
+void blendRows(const float *_a, const float *_b, float _t, float *o_out, size_t _count)
+{
+  for (size_t i = 0; i < _count; ++i)
+  {
+    o_out[i] = _a[i] + (_b[i] - _a[i]) * _t;
+  }
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+Timeline::Timeline(size_t _tracks, float _sampleRate) : m_tracks(_tracks), m_sampleRate(std::max(_sampleRate, 1.0f))
+{
+  m_curves.resize(m_tracks * CHANNELS);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Timeline::setTracks(size_t _tracks)
+{
+  m_tracks = _tracks;
+  m_curves.resize(m_tracks * CHANNELS);
+  m_duration = 0.0f;
+  for (auto &keys : m_curves)
+  {
+    if (!keys.empty())
+    {
+      m_duration = std::max(m_duration, keys.back().time);
+    }
+  }
+  m_dirty = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+float Timeline::identity(Channel _channel)
+{
+  switch (_channel)
+  {
+  case SX:
+  case SY:
+  case SZ:
+  case EULERX:
+    return 1.0f;
+  default:
+    return 0.0f;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Timeline::setKey(size_t _track, Channel _channel, float _time, float _value, Ease _ease)
+{
+  auto &keys = m_curves[curve(_track, _channel)];
+  _time = std::max(_time, 0.0f);
+  auto at = std::lower_bound(keys.begin(), keys.end(), _time, [](const Key &_k, float _t) { return _k.time < _t; });
+  if (at != keys.end() && at->time == _time)
+  {
+    at->value = _value;
+    at->ease = _ease;
+  }
+  else
+  {
+    keys.insert(at, Key{_time, _value, _ease});
+  }
+  m_duration = std::max(m_duration, _time);
+  m_dirty = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Timeline::setPose(size_t _track, float _time, const TransformParams &_params, size_t _index, Ease _ease)
+{
+  const std::vector<float> *channels[CHANNELS] = {&_params.tx, &_params.ty, &_params.tz,
+                                                  &_params.rx, &_params.ry, &_params.rz,
+                                                  &_params.sx, &_params.sy, &_params.sz,
+                                                  &_params.eulerAngle, &_params.eulerX, &_params.eulerY, &_params.eulerZ};
+  for (size_t c = 0; c < CHANNELS; ++c)
+  {
+    setKey(_track, static_cast<Channel>(c), _time, (*channels[c])[_index], _ease);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Timeline::clear()
+{
+  for (auto &keys : m_curves)
+  {
+    keys.clear();
+  }
+  m_duration = 0.0f;
+  m_dirty = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t Timeline::keyCount() const
+{
+  size_t count = 0;
+  for (auto &keys : m_curves)
+  {
+    count += keys.size();
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+float Timeline::wrap(float _time) const
+{
+  if (!(m_duration > 0.0f))
+  {
+    return 0.0f;
+  }
+  float time = std::fmod(_time, m_duration);
+  return time < 0.0f ? time + m_duration : time;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+float Timeline::valueAt(size_t _track, Channel _channel, float _time) const
+{
+  const auto &keys = m_curves[curve(_track, _channel)];
+  if (keys.empty())
+  {
+    return identity(_channel);
+  }
+  if (_time <= keys.front().time)
+  {
+    return keys.front().value;
+  }
+  if (_time >= keys.back().time)
+  {
+    return keys.back().value;
+  }
+  auto next = std::upper_bound(keys.begin(), keys.end(), _time, [](float _t, const Key &_k) { return _t < _k.time; });
+  return segmentValue(keys, static_cast<size_t>(next - keys.begin()) - 1, _time);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Timeline::bake()
+{
+  auto start = std::chrono::steady_clock::now();
+  m_frames = m_duration > 0.0f ? static_cast<size_t>(std::ceil(m_duration * m_sampleRate)) + 1 : 1;
+  for (auto &samples : m_samples)
+  {
+    samples.resize(m_frames * m_tracks);
+  }
+  for (size_t track = 0; track < m_tracks; ++track)
+  {
+    for (size_t c = 0; c < CHANNELS; ++c)
+    {
+      const auto &keys = m_curves[curve(track, static_cast<Channel>(c))];
+      float *out = m_samples[c].data() + track;
+      // the frames only go forward so the segment is found by walking rather than searching
+      size_t k = 0;
+      for (size_t f = 0; f < m_frames; ++f)
+      {
+        const float time = std::min(f / m_sampleRate, m_duration);
+        float value;
+        if (keys.empty())
+        {
+          value = identity(static_cast<Channel>(c));
+        }
+        else if (time <= keys.front().time)
+        {
+          value = keys.front().value;
+        }
+        else if (time >= keys.back().time)
+        {
+          value = keys.back().value;
+        }
+        else
+        {
+          while (keys[k + 1].time <= time)
+          {
+            ++k;
+          }
+          value = segmentValue(keys, k, time);
+        }
+        out[f * m_tracks] = value;
+      }
+    }
+  }
+  // the orientation of each sample, blended by interpolate rather than rebuilt from the blended angles
+  float q[4];
+  for (size_t i = 0; i < m_frames * m_tracks; ++i)
+  {
+    TransformBatch::quaternionFromEuler(m_samples[RX][i], m_samples[RY][i], m_samples[RZ][i], q);
+    for (size_t a = 0; a < 4; ++a)
+    {
+      m_samples[CHANNELS + a][i] = q[a];
+    }
+  }
+  m_dirty = false;
+  m_stats.bakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Timeline::evaluate(float _time, TransformParams &o_params, TransformBatch::Interpolation _mode)
+{
+  if (m_dirty)
+  {
+    bake();
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (o_params.size() != m_tracks)
+  {
+    o_params.resize(m_tracks);
+  }
+  const float time = wrap(_time);
+  const size_t frame = std::min(static_cast<size_t>(time * m_sampleRate), m_frames - 1);
+  const size_t next = std::min(frame + 1, m_frames - 1);
+  // the last sample is baked at the duration, so the last interval can be shorter than the rest
+  const float frameTime = frame / m_sampleRate;
+  const float interval = std::min(next / m_sampleRate, m_duration) - frameTime;
+  const float t = interval > 0.0f ? std::min(std::max((time - frameTime) / interval, 0.0f), 1.0f) : 0.0f;
+  std::vector<float> *out[CHANNELS] = {&o_params.tx, &o_params.ty, &o_params.tz,
+                                       &o_params.rx, &o_params.ry, &o_params.rz,
+                                       &o_params.sx, &o_params.sy, &o_params.sz,
+                                       &o_params.eulerAngle, &o_params.eulerX, &o_params.eulerY, &o_params.eulerZ};
+  for (size_t c = 0; c < CHANNELS; ++c)
+  {
+    blendRows(&m_samples[c][frame * m_tracks], &m_samples[c][next * m_tracks], t, out[c]->data(), m_tracks);
+  }
+  TransformArrays from;
+  TransformArrays to;
+  const float **rows[2][4] = {{&from.qx, &from.qy, &from.qz, &from.qw}, {&to.qx, &to.qy, &to.qz, &to.qw}};
+  for (size_t a = 0; a < 4; ++a)
+  {
+    *rows[0][a] = &m_samples[CHANNELS + a][frame * m_tracks];
+    *rows[1][a] = &m_samples[CHANNELS + a][next * m_tracks];
+  }
+  from.count = to.count = m_tracks;
+  TransformBatch::interpolate(_mode, from, to, t, 0, m_tracks, o_params.orientations());
+  ++m_stats.ticks;
+  m_stats.transforms += m_tracks;
+  m_stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Timeline::resetStats()
+{
+  const double bakeMs = m_stats.bakeMs;
+  m_stats = Stats();
+  m_stats.bakeMs = bakeMs;
+}
@@ -0,0 +1,519 @@
+/// @file TransformBatch.cpp
+/// @brief the scalar reference and kernel dispatch for TransformBatch
+#include "TransformBatch.h"
+#include "TransformBatchKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the rotation block of a unit quaternion, the simd version is quaternionBlock in
+/// TransformBatchKernel.h, any change here must be made there as well
+//----------------------------------------------------------------------------------------------------------------------
+void quaternionBlock(float _x, float _y, float _z, float _w, float *_l)
+{
+  float x2 = _x + _x;
+  float y2 = _y + _y;
+  float z2 = _z + _z;
+  float xx = _x * x2;
+  float yy = _y * y2;
+  float zz = _z * z2;
+  float xy = _x * y2;
+  float xz = _x * z2;
+  float yz = _y * z2;
+  float wx = _w * x2;
+  float wy = _w * y2;
+  float wz = _w * z2;
+  _l[0] = 1.0f - (yy + zz);
+  _l[1] = xy + wz;
+  _l[2] = xz - wy;
+  _l[3] = xy - wz;
+  _l[4] = 1.0f - (xx + zz);
+  _l[5] = yz + wx;
+  _l[6] = xz + wy;
+  _l[7] = yz - wx;
+  _l[8] = 1.0f - (xx + yy);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief acos of a value in [0,1] matching acosPositive in TransformBatchKernel.h
+//----------------------------------------------------------------------------------------------------------------------
+float asinPoly(float _x)
+{
+  float z = _x * _x;
+  float p = kAsin0 * z;
+  p = p + kAsin1;
+  p = p * z;
+  p = p + kAsin2;
+  p = p * z;
+  p = p + kAsin3;
+  p = p * z;
+  p = p + kAsin4;
+  p = p * z;
+  p = p * _x;
+  return p + _x;
+}
+
+float acosPositive(float _d)
+{
+  if (0.5f < _d)
+  {
+    float big = asinPoly(std::sqrt((1.0f - _d) * 0.5f));
+    return big + big;
+  }
+  return kHalfPi - asinPoly(_d);
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformParams::resize(size_t _n)
+{
+  for (auto *a : {&tx, &ty, &tz, &rx, &ry, &rz, &eulerAngle, &eulerY, &eulerZ, &qx, &qy, &qz})
+  {
+    a->resize(_n, 0.0f);
+  }
+  for (auto *a : {&sx, &sy, &sz, &eulerX, &qw})
+  {
+    a->resize(_n, 1.0f);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformParams::set(size_t _i, float _tx, float _ty, float _tz,
+                          float _rx, float _ry, float _rz,
+                          float _sx, float _sy, float _sz,
+                          float _eulerAngle, float _eulerX, float _eulerY, float _eulerZ)
+{
+  tx[_i] = _tx;
+  ty[_i] = _ty;
+  tz[_i] = _tz;
+  rx[_i] = _rx;
+  ry[_i] = _ry;
+  rz[_i] = _rz;
+  sx[_i] = _sx;
+  sy[_i] = _sy;
+  sz[_i] = _sz;
+  eulerAngle[_i] = _eulerAngle;
+  eulerX[_i] = _eulerX;
+  eulerY[_i] = _eulerY;
+  eulerZ[_i] = _eulerZ;
+  float q[4];
+  TransformBatch::quaternionFromEuler(_rx, _ry, _rz, q);
+  setOrientation(_i, q[0], q[1], q[2], q[3]);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformParams::setOrientation(size_t _i, float _x, float _y, float _z, float _w)
+{
+  qx[_i] = _x;
+  qy[_i] = _y;
+  qz[_i] = _z;
+  qw[_i] = _w;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+TransformArrays TransformParams::arrays() const
+{
+  TransformArrays a;
+  a.tx = tx.data();
+  a.ty = ty.data();
+  a.tz = tz.data();
+  a.rx = rx.data();
+  a.ry = ry.data();
+  a.rz = rz.data();
+  a.sx = sx.data();
+  a.sy = sy.data();
+  a.sz = sz.data();
+  a.eulerAngle = eulerAngle.data();
+  a.eulerX = eulerX.data();
+  a.eulerY = eulerY.data();
+  a.eulerZ = eulerZ.data();
+  a.qx = qx.data();
+  a.qy = qy.data();
+  a.qz = qz.data();
+  a.qw = qw.data();
+  a.count = size();
+  return a;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+QuaternionArrays TransformParams::orientations()
+{
+  QuaternionArrays q;
+  q.x = qx.data();
+  q.y = qy.data();
+  q.z = qz.data();
+  q.w = qw.data();
+  return q;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+TransformBatch::Kernel TransformBatch::bestKernel()
+{
+  if (isSupported(Kernel::AVX2))
+  {
+    return Kernel::AVX2;
+  }
+  if (isSupported(Kernel::SSE))
+  {
+    return Kernel::SSE;
+  }
+  return Kernel::SCALAR;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool TransformBatch::isSupported(Kernel _kernel)
+{
+  switch (_kernel)
+  {
+  case Kernel::SCALAR:
+    return true;
+#if defined(TRANSFORMBATCH_HAS_SSE)
+  case Kernel::SSE:
+    return true;
+#endif
+#if defined(TRANSFORMBATCH_HAS_AVX2) && (defined(__GNUC__) || defined(__clang__))
+  case Kernel::AVX2:
+  {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+  }
+#endif
+  default:
+    return false;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const char *TransformBatch::kernelName(Kernel _kernel)
+{
+  switch (_kernel)
+  {
+  case Kernel::SCALAR: return "scalar";
+  case Kernel::SSE: return "sse";
+  case Kernel::AVX2: return "avx2";
+  }
+  return "unknown";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::compose(MatrixOrder _order, const TransformParams &_params, float *_out, Kernel _kernel)
+{
+  compose(_order, _params.arrays(), 0, _params.size(), _out, _kernel);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::compose(MatrixOrder _order, const TransformArrays &_params, size_t _begin, size_t _end, float *_out, Kernel _kernel)
+{
+  size_t done = _begin;
+  if (isSupported(_kernel))
+  {
+    if (_kernel == Kernel::AVX2)
+    {
+      done = composeTransformsAVX2(_order, _params, _begin, _end, _out);
+    }
+    else if (_kernel == Kernel::SSE)
+    {
+      done = composeTransformsSSE(_order, _params, _begin, _end, _out);
+    }
+  }
+  // whatever is left over (or everything for the scalar kernel)
+  composeScalar(_order, _params, done, _end, _out + (done - _begin) * 16);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::sinCosDegrees(float _degrees, float &_sin, float &_cos)
+{
+  sinCosRadians(_degrees * kDegToRad, _sin, _cos);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::sinCosRadians(float _radians, float &_sin, float &_cos)
+{
+  // reduce into [-pi/4,pi/4] and remember the quadrant
+  int qi = static_cast<int>(std::nearbyint(_radians * kTwoOverPi));
+  float q = static_cast<float>(qi);
+  float x = _radians - q * kPiOver2A;
+  x = x - q * kPiOver2B;
+  x = x - q * kPiOver2C;
+  float z = x * x;
+
+  float s = kSin0 * z;
+  s = s + kSin1;
+  s = s * z;
+  s = s + kSin2;
+  s = s * z;
+  s = s * x;
+  s = s + x;
+
+  float c = kCos0 * z;
+  c = c + kCos1;
+  c = c * z;
+  c = c + kCos2;
+  c = c * z;
+  c = c * z;
+  c = c - 0.5f * z;
+  c = c + 1.0f;
+
+  if (qi & 1)
+  {
+    std::swap(s, c);
+  }
+  _sin = (qi & 2) ? -s : s;
+  _cos = ((qi + 1) & 2) ? -c : c;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::composeScalar(MatrixOrder _order, const TransformArrays &_p, size_t _begin, size_t _end, float *_out)
+{
+  for (size_t i = _begin; i < _end; ++i)
+  {
+    // the 3x3 rotation part in column major order
+    float l[9];
+    if (_order == MatrixOrder::QUATERNION)
+    {
+      quaternionBlock(_p.qx[i], _p.qy[i], _p.qz[i], _p.qw[i], l);
+    }
+    else if (_order == MatrixOrder::EULERTS || _order == MatrixOrder::TEULERS)
+    {
+      // axis angle rotation as ngl::Mat4::euler
+      float s, c;
+      sinCosDegrees(-_p.eulerAngle[i], s, c);
+      float x = _p.eulerX[i];
+      float y = _p.eulerY[i];
+      float z = _p.eulerZ[i];
+      float len = std::sqrt(x * x + y * y + z * z);
+      if (len != 0.0f)
+      {
+        x = x / len;
+        y = y / len;
+        z = z / len;
+      }
+      else
+      {
+        x = y = z = 0.0f;
+        s = 0.0f;
+        c = 1.0f;
+      }
+      float o = 1.0f - c;
+      float ox = o * x;
+      float oy = o * y;
+      float oz = o * z;
+      l[0] = ox * x + c;
+      l[1] = ox * y - s * z;
+      l[2] = ox * z + s * y;
+      l[3] = ox * y + s * z;
+      l[4] = oy * y + c;
+      l[5] = oy * z - s * x;
+      l[6] = ox * z - s * y;
+      l[7] = oy * z + s * x;
+      l[8] = oz * z + c;
+    }
+    else
+    {
+      float sx, cx, sy, cy, sz, cz;
+      sinCosDegrees(_p.rx[i], sx, cx);
+      sinCosDegrees(_p.ry[i], sy, cy);
+      sinCosDegrees(_p.rz[i], sz, cz);
+      if (_order == MatrixOrder::GIMBALLOCK)
+      {
+        // the deliberately wrong matrix built by hand in NGLScene::setRotate
+        l[0] = cz;
+        l[1] = sz;
+        l[2] = -sy;
+        l[3] = -sz;
+        l[4] = cz;
+        l[5] = sx;
+        l[6] = sy;
+        l[7] = -sx;
+        l[8] = cy;
+      }
+      else
+      {
+        // rz * ry * rx
+        float czsy = cz * sy;
+        float szsy = sz * sy;
+        l[0] = cz * cy;
+        l[1] = sz * cy;
+        l[2] = -sy;
+        l[3] = -sz * cx + czsy * sx;
+        l[4] = cz * cx + szsy * sx;
+        l[5] = cy * sx;
+        l[6] = sz * sx + czsy * cx;
+        l[7] = -cz * sx + szsy * cx;
+        l[8] = cy * cx;
+      }
+    }
+
+    float *m = _out + (i - _begin) * 16;
+    const float s[3] = {_p.sx[i], _p.sy[i], _p.sz[i]};
+    for (int c = 0; c < 3; ++c)
+    {
+      m[c * 4 + 0] = l[c * 3 + 0] * s[c];
+      m[c * 4 + 1] = l[c * 3 + 1] * s[c];
+      m[c * 4 + 2] = l[c * 3 + 2] * s[c];
+      m[c * 4 + 3] = 0.0f;
+    }
+    const float tx = _p.tx[i];
+    const float ty = _p.ty[i];
+    const float tz = _p.tz[i];
+    if (_order == MatrixOrder::RTS || _order == MatrixOrder::TEULERS)
+    {
+      // rotation applied after the translation so the translation is rotated
+      m[12] = l[0] * tx + l[3] * ty + l[6] * tz;
+      m[13] = l[1] * tx + l[4] * ty + l[7] * tz;
+      m[14] = l[2] * tx + l[5] * ty + l[8] * tz;
+    }
+    else
+    {
+      m[12] = tx;
+      m[13] = ty;
+      m[14] = tz;
+    }
+    m[15] = 1.0f;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::quaternionFromEuler(float _rx, float _ry, float _rz, float o_q[4])
+{
+  // qz * qy * qx from the half angles
+  float sx, cx, sy, cy, sz, cz;
+  sinCosDegrees(0.5f * _rx, sx, cx);
+  sinCosDegrees(0.5f * _ry, sy, cy);
+  sinCosDegrees(0.5f * _rz, sz, cz);
+  o_q[0] = sx * cy * cz - cx * sy * sz;
+  o_q[1] = cx * sy * cz + sx * cy * sz;
+  o_q[2] = cx * cy * sz - sx * sy * cz;
+  o_q[3] = cx * cy * cz + sx * sy * sz;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::quaternionToMatrix(const float _q[4], float o_m[16])
+{
+  float l[9];
+  quaternionBlock(_q[0], _q[1], _q[2], _q[3], l);
+  for (int c = 0; c < 3; ++c)
+  {
+    o_m[c * 4 + 0] = l[c * 3 + 0];
+    o_m[c * 4 + 1] = l[c * 3 + 1];
+    o_m[c * 4 + 2] = l[c * 3 + 2];
+    o_m[c * 4 + 3] = 0.0f;
+  }
+  o_m[12] = 0.0f;
+  o_m[13] = 0.0f;
+  o_m[14] = 0.0f;
+  o_m[15] = 1.0f;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::interpolate(Interpolation _mode, const TransformParams &_from, const TransformParams &_to,
+                                 float _t, TransformParams &o_out, Kernel _kernel)
+{
+  if (o_out.size() != _from.size())
+  {
+    o_out.resize(_from.size());
+  }
+  interpolate(_mode, _from.arrays(), _to.arrays(), _t, 0, std::min(_from.size(), _to.size()), o_out.orientations(),
+              _kernel);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::interpolate(Interpolation _mode, const TransformArrays &_from, const TransformArrays &_to,
+                                 float _t, size_t _begin, size_t _end, const QuaternionArrays &o_out, Kernel _kernel)
+{
+  size_t done = _begin;
+  if (isSupported(_kernel))
+  {
+    if (_kernel == Kernel::AVX2)
+    {
+      done = interpolateAVX2(_mode, _from, _to, _t, _begin, _end, o_out);
+    }
+    else if (_kernel == Kernel::SSE)
+    {
+      done = interpolateSSE(_mode, _from, _to, _t, _begin, _end, o_out);
+    }
+  }
+  size_t offset = done - _begin;
+  interpolateScalar(_mode, _from, _to, _t, done, _end,
+                    {o_out.x + offset, o_out.y + offset, o_out.z + offset, o_out.w + offset});
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::interpolateScalar(Interpolation _mode, const TransformArrays &_from, const TransformArrays &_to,
+                                       float _t, size_t _begin, size_t _end, const QuaternionArrays &o_out)
+{
+  const float oneMinusT = 1.0f - _t;
+  for (size_t i = _begin; i < _end; ++i)
+  {
+    float ax = _from.qx[i];
+    float ay = _from.qy[i];
+    float az = _from.qz[i];
+    float aw = _from.qw[i];
+    float bx = _to.qx[i];
+    float by = _to.qy[i];
+    float bz = _to.qz[i];
+    float bw = _to.qw[i];
+    float d = ax * bx + ay * by;
+    d = d + az * bz;
+    d = d + aw * bw;
+    // q and -q are the same orientation, take the shorter way round
+    if (d < 0.0f)
+    {
+      bx = -bx;
+      by = -by;
+      bz = -bz;
+      bw = -bw;
+      d = -d;
+    }
+    float wa = oneMinusT;
+    float wb = _t;
+    if (_mode == Interpolation::SLERP && !(kSlerpThreshold < d))
+    {
+      float theta = acosPositive(d);
+      float sinTheta = std::sqrt(1.0f - d * d);
+      float sa, sb, unused;
+      sinCosRadians(oneMinusT * theta, sa, unused);
+      sinCosRadians(_t * theta, sb, unused);
+      wa = sa / sinTheta;
+      wb = sb / sinTheta;
+    }
+    float x = wa * ax + wb * bx;
+    float y = wa * ay + wb * by;
+    float z = wa * az + wb * bz;
+    float w = wa * aw + wb * bw;
+    float len = x * x + y * y;
+    len = len + z * z;
+    len = std::sqrt(len + w * w);
+    size_t o = i - _begin;
+    o_out.x[o] = x / len;
+    o_out.y[o] = y / len;
+    o_out.z[o] = z / len;
+    o_out.w[o] = w / len;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformBatch::normalMatrices(const float *_matrices, size_t _count, float *_out)
+{
+  for (size_t i = 0; i < _count; ++i)
+  {
+    const float *m = _matrices + i * 16;
+    const float *c0 = m;
+    const float *c1 = m + 4;
+    const float *c2 = m + 8;
+    // the columns of the inverse transpose are the cross products of the other two columns
+    float n[9] = {c1[1] * c2[2] - c1[2] * c2[1], c1[2] * c2[0] - c1[0] * c2[2], c1[0] * c2[1] - c1[1] * c2[0],
+                  c2[1] * c0[2] - c2[2] * c0[1], c2[2] * c0[0] - c2[0] * c0[2], c2[0] * c0[1] - c2[1] * c0[0],
+                  c0[1] * c1[2] - c0[2] * c1[1], c0[2] * c1[0] - c0[0] * c1[2], c0[0] * c1[1] - c0[1] * c1[0]};
+    float det = c0[0] * n[0] + c0[1] * n[1] + c0[2] * n[2];
+    float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+    float *out = _out + i * 9;
+    for (int k = 0; k < 9; ++k)
+    {
+      out[k] = n[k] * invDet;
+    }
+  }
+}
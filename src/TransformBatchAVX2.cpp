@@ -0,0 +1,94 @@
+/// @file TransformBatchAVX2.cpp
+/// @brief AVX2 kernel for TransformBatch, 8 transforms per iteration. This file is built with
+/// -mavx2 so it must only be entered after TransformBatch::isSupported has checked the cpu
+#define TRANSFORMBATCH_SIMD_KERNEL
+#include "TransformBatchKernel.h"
+
+#if defined(TRANSFORMBATCH_HAS_AVX2) && defined(__AVX2__)
+#include <immintrin.h>
+
+namespace
+{
+struct AVX2Ops
+{
+  using V = __m256;
+  using I = __m256i;
+  static constexpr size_t width = 8;
+
+  static V load(const float *_p) { return _mm256_loadu_ps(_p); }
+  static void store(float *_p, V _a) { _mm256_storeu_ps(_p, _a); }
+  static V set1(float _v) { return _mm256_set1_ps(_v); }
+  static V zero() { return _mm256_setzero_ps(); }
+  static V add(V _a, V _b) { return _mm256_add_ps(_a, _b); }
+  static V sub(V _a, V _b) { return _mm256_sub_ps(_a, _b); }
+  static V mul(V _a, V _b) { return _mm256_mul_ps(_a, _b); }
+  static V div(V _a, V _b) { return _mm256_div_ps(_a, _b); }
+  static V sqrt(V _a) { return _mm256_sqrt_ps(_a); }
+  static V neg(V _a) { return _mm256_xor_ps(_a, _mm256_set1_ps(-0.0f)); }
+  static V notZero(V _a) { return _mm256_cmp_ps(_a, _mm256_setzero_ps(), _CMP_NEQ_UQ); }
+  static V select(V _mask, V _a, V _b) { return _mm256_blendv_ps(_b, _a, _mask); }
+  static V lessThan(V _a, V _b) { return _mm256_cmp_ps(_a, _b, _CMP_LT_OQ); }
+  static I roundToInt(V _a) { return _mm256_cvtps_epi32(_a); }
+  static V toFloat(I _a) { return _mm256_cvtepi32_ps(_a); }
+  static I addInt(I _a, int _b) { return _mm256_add_epi32(_a, _mm256_set1_epi32(_b)); }
+  static V bitSet(I _a, int _bit)
+  {
+    I b = _mm256_set1_epi32(_bit);
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_a, b), b));
+  }
+  static V negateIf(V _v, I _a, int _bit)
+  {
+    return _mm256_xor_ps(_v, _mm256_and_ps(bitSet(_a, _bit), _mm256_set1_ps(-0.0f)));
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief _m holds element k of 8 matrices, do the low and high 4 lanes as 4x4 transposes
+  //----------------------------------------------------------------------------------------------------------------------
+  static void storeMatrices(const V *_m, float *_out)
+  {
+    for (int half = 0; half < 2; ++half)
+    {
+      float *out = _out + half * 64;
+      for (int k = 0; k < 16; k += 4)
+      {
+        __m128 a = half ? _mm256_extractf128_ps(_m[k], 1) : _mm256_castps256_ps128(_m[k]);
+        __m128 b = half ? _mm256_extractf128_ps(_m[k + 1], 1) : _mm256_castps256_ps128(_m[k + 1]);
+        __m128 c = half ? _mm256_extractf128_ps(_m[k + 2], 1) : _mm256_castps256_ps128(_m[k + 2]);
+        __m128 d = half ? _mm256_extractf128_ps(_m[k + 3], 1) : _mm256_castps256_ps128(_m[k + 3]);
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+        _mm_storeu_ps(out + k, a);
+        _mm_storeu_ps(out + 16 + k, b);
+        _mm_storeu_ps(out + 32 + k, c);
+        _mm_storeu_ps(out + 48 + k, d);
+      }
+    }
+  }
+};
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t composeTransformsAVX2(MatrixOrder _order, const TransformArrays &_params, size_t _begin, size_t _end, float *_out)
+{
+  return composeOrder<AVX2Ops>(_order, _params, _begin, _end, _out);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t interpolateAVX2(TransformBatch::Interpolation _mode, const TransformArrays &_from, const TransformArrays &_to,
+                       float _t, size_t _begin, size_t _end, const QuaternionArrays &o_out)
+{
+  return interpolateMode<AVX2Ops>(_mode, _from, _to, _t, _begin, _end, o_out);
+}
+
+#else
+//----------------------------------------------------------------------------------------------------------------------
+size_t composeTransformsAVX2(MatrixOrder, const TransformArrays &, size_t _begin, size_t, float *)
+{
+  return _begin;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t interpolateAVX2(TransformBatch::Interpolation, const TransformArrays &, const TransformArrays &, float,
+                       size_t _begin, size_t, const QuaternionArrays &)
+{
+  return _begin;
+}
+#endif
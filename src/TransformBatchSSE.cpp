@@ -0,0 +1,89 @@
+/// @file TransformBatchSSE.cpp
+/// @brief SSE2 kernel for TransformBatch, 4 transforms per iteration
+#define TRANSFORMBATCH_SIMD_KERNEL
+#include "TransformBatchKernel.h"
+
+#if defined(TRANSFORMBATCH_HAS_SSE)
+#include <emmintrin.h>
+
+namespace
+{
+struct SSEOps
+{
+  using V = __m128;
+  using I = __m128i;
+  static constexpr size_t width = 4;
+
+  static V load(const float *_p) { return _mm_loadu_ps(_p); }
+  static void store(float *_p, V _a) { _mm_storeu_ps(_p, _a); }
+  static V set1(float _v) { return _mm_set1_ps(_v); }
+  static V zero() { return _mm_setzero_ps(); }
+  static V add(V _a, V _b) { return _mm_add_ps(_a, _b); }
+  static V sub(V _a, V _b) { return _mm_sub_ps(_a, _b); }
+  static V mul(V _a, V _b) { return _mm_mul_ps(_a, _b); }
+  static V div(V _a, V _b) { return _mm_div_ps(_a, _b); }
+  static V sqrt(V _a) { return _mm_sqrt_ps(_a); }
+  static V neg(V _a) { return _mm_xor_ps(_a, _mm_set1_ps(-0.0f)); }
+  static V notZero(V _a) { return _mm_cmpneq_ps(_a, _mm_setzero_ps()); }
+  static V select(V _mask, V _a, V _b) { return _mm_or_ps(_mm_and_ps(_mask, _a), _mm_andnot_ps(_mask, _b)); }
+  static V lessThan(V _a, V _b) { return _mm_cmplt_ps(_a, _b); }
+  static I roundToInt(V _a) { return _mm_cvtps_epi32(_a); }
+  static V toFloat(I _a) { return _mm_cvtepi32_ps(_a); }
+  static I addInt(I _a, int _b) { return _mm_add_epi32(_a, _mm_set1_epi32(_b)); }
+  static V bitSet(I _a, int _bit)
+  {
+    I b = _mm_set1_epi32(_bit);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_a, b), b));
+  }
+  static V negateIf(V _v, I _a, int _bit)
+  {
+    return _mm_xor_ps(_v, _mm_and_ps(bitSet(_a, _bit), _mm_set1_ps(-0.0f)));
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief _m holds element k of 4 matrices, transpose in blocks of 4 to write them one after the other
+  //----------------------------------------------------------------------------------------------------------------------
+  static void storeMatrices(const V *_m, float *_out)
+  {
+    for (int k = 0; k < 16; k += 4)
+    {
+      V a = _m[k];
+      V b = _m[k + 1];
+      V c = _m[k + 2];
+      V d = _m[k + 3];
+      _MM_TRANSPOSE4_PS(a, b, c, d);
+      _mm_storeu_ps(_out + k, a);
+      _mm_storeu_ps(_out + 16 + k, b);
+      _mm_storeu_ps(_out + 32 + k, c);
+      _mm_storeu_ps(_out + 48 + k, d);
+    }
+  }
+};
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t composeTransformsSSE(MatrixOrder _order, const TransformArrays &_params, size_t _begin, size_t _end, float *_out)
+{
+  return composeOrder<SSEOps>(_order, _params, _begin, _end, _out);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t interpolateSSE(TransformBatch::Interpolation _mode, const TransformArrays &_from, const TransformArrays &_to,
+                      float _t, size_t _begin, size_t _end, const QuaternionArrays &o_out)
+{
+  return interpolateMode<SSEOps>(_mode, _from, _to, _t, _begin, _end, o_out);
+}
+
+#else
+//----------------------------------------------------------------------------------------------------------------------
+size_t composeTransformsSSE(MatrixOrder, const TransformArrays &, size_t _begin, size_t, float *)
+{
+  return _begin;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t interpolateSSE(TransformBatch::Interpolation, const TransformArrays &, const TransformArrays &, float,
+                      size_t _begin, size_t, const QuaternionArrays &)
+{
+  return _begin;
+}
+#endif
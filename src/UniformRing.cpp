@@ -0,0 +1,198 @@
+/// @file UniformRing.cpp
+/// @brief implementation of the persistently mapped uniform ring
+#include "UniformRing.h"
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+double secondsSince(std::chrono::steady_clock::time_point _start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+} // end anon namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+UniformRing::UniformRing(GLuint _binding, size_t _sliceBytes, size_t _slicesPerFrame)
+  : m_binding(_binding), m_sliceBytes(_sliceBytes), m_slicesPerFrame(_slicesPerFrame),
+    m_statsStart(std::chrono::steady_clock::now())
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+UniformRing::~UniformRing()
+{
+  // releaseGL should already have been called, the GL objects can't be freed without a context
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool UniformRing::initializeGL(bool _persistent)
+{
+  GLint alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  const size_t align = static_cast<size_t>(alignment > 0 ? alignment : 256);
+  m_stride = (m_sliceBytes + align - 1) / align * align;
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  glGenBuffers(1, &m_buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  if (_persistent && (major > 4 || (major == 4 && minor >= 4)))
+  {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const auto bytes = static_cast<GLsizeiptr>(m_stride * m_slicesPerFrame * Frames);
+    glBufferStorage(GL_UNIFORM_BUFFER, bytes, nullptr, flags);
+    m_mapped = static_cast<char *>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, bytes, flags));
+  }
+  if (m_mapped == nullptr)
+  {
+    // an immutable buffer can't be respecified, start again with a mutable one
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glDeleteBuffers(1, &m_buffer);
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_sliceBytes), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer);
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  m_section = 0;
+  m_slice = 0;
+  m_boundSection = Frames;
+  return persistent();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void UniformRing::releaseGL()
+{
+  for (auto &fence : m_fences)
+  {
+    if (fence != nullptr)
+    {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (m_buffer != 0)
+  {
+    if (m_mapped != nullptr)
+    {
+      glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+      glUnmapBuffer(GL_UNIFORM_BUFFER);
+      glBindBuffer(GL_UNIFORM_BUFFER, 0);
+      m_mapped = nullptr;
+    }
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void UniformRing::wait(GLsync &_fence)
+{
+  GLenum status = glClientWaitSync(_fence, 0, 0);
+  if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+  {
+    ++m_stats.fenceWaits;
+    auto start = std::chrono::steady_clock::now();
+    // flush so the fence is sure to be reached, then wait as long as it takes
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    do
+    {
+      status = glClientWaitSync(_fence, flags, 1000000);
+      flags = 0;
+    } while (status == GL_TIMEOUT_EXPIRED);
+    m_stats.waitSeconds += secondsSince(start);
+  }
+  glDeleteSync(_fence);
+  _fence = nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void UniformRing::upload(const void *_data)
+{
+  ++m_stats.uploads;
+  m_stats.bytes += m_sliceBytes;
+  if (m_mapped == nullptr)
+  {
+    // orphan and refill, the same as ngl's setUniformBuffer
+    auto start = std::chrono::steady_clock::now();
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(m_sliceBytes), _data, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer);
+    m_stats.copySeconds += secondsSince(start);
+    return;
+  }
+  if (m_slice == m_slicesPerFrame)
+  {
+    // out of slices, wait for the draws already made from this section before reusing it
+    ++m_stats.overflows;
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    wait(fence);
+    m_slice = 0;
+  }
+  if (m_slice == 0 && m_fences[m_section] != nullptr)
+  {
+    wait(m_fences[m_section]);
+  }
+  const size_t offset = (m_section * m_slicesPerFrame + m_slice) * m_stride;
+  auto start = std::chrono::steady_clock::now();
+  std::memcpy(m_mapped + offset, _data, m_sliceBytes);
+  m_stats.copySeconds += secondsSince(start);
+  glBindBufferRange(GL_UNIFORM_BUFFER, m_binding, m_buffer, static_cast<GLintptr>(offset),
+                    static_cast<GLsizeiptr>(m_sliceBytes));
+  m_boundSection = m_section;
+  ++m_slice;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void UniformRing::endFrame()
+{
+  ++m_stats.frames;
+  if (m_mapped == nullptr || m_boundSection == Frames)
+  {
+    return;
+  }
+  // frames that don't upload keep drawing from the last slice bound, so its section is fenced
+  // every frame, the newest fence covers all the earlier ones
+  if (m_fences[m_boundSection] != nullptr)
+  {
+    glDeleteSync(m_fences[m_boundSection]);
+  }
+  m_fences[m_boundSection] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  if (m_slice != 0)
+  {
+    m_section = (m_section + 1) % Frames;
+    m_slice = 0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void UniformRing::resetStats()
+{
+  m_stats = Stats();
+  m_statsStart = std::chrono::steady_clock::now();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+double UniformRing::uploadMBPerSecond() const
+{
+  double seconds = secondsSince(m_statsStart);
+  return seconds > 0.0 ? m_stats.bytes / seconds / (1024.0 * 1024.0) : 0.0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::string UniformRing::summary() const
+{
+  std::ostringstream out;
+  out.setf(std::ios::fixed);
+  out.precision(3);
+  out << (persistent() ? "ubo ring " : "ubo orphan ") << m_stats.uploads << " uploads "
+      << uploadMBPerSecond() << " MB/s, " << m_stats.fenceWaits << " fence waits (" << m_stats.waitSeconds * 1000.0
+      << " ms)";
+  if (m_stats.overflows != 0)
+  {
+    out << " " << m_stats.overflows << " overflows";
+  }
+  return out.str();
+}
@@ -1,8 +1,18 @@
 #include <QApplication>
+#include <cstring>
+#include <iostream>
 #include "MainWindow.h"
 
 int main(int argc, char **argv)
 {
+  // a replay needs no display, like the benchmarks it defaults to the offscreen platform
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--replay") == 0 && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+  }
   // create an OpenGL format specifier
   QSurfaceFormat format;
   // set the number of samples for multisampling
@@ -28,10 +38,60 @@ int main(int argc, char **argv)
   QSurfaceFormat::setDefaultFormat(format);
   // make an instance of the QApplication
   QApplication a(argc, argv);
+  // --threaded draws the scene on a render thread, it can only be chosen at start up
+  auto arguments = a.arguments().mid(1);
+  bool threaded = arguments.removeAll("--threaded") > 0;
+  // --software starts with the object drawn by the cpu rasterizer
+  bool software = arguments.removeAll("--software") > 0;
+  // --record file logs the parameter changes, --replay file (any number of times) plays logs
+  // back at their recorded speed, or as fast as the frames are drawn with --flat-out
+  bool flatOut = arguments.removeAll("--flat-out") > 0;
+  QString record;
+  QString json;
+  QStringList replays;
+  for (int i = 0; i + 1 < arguments.size();)
+  {
+    if (arguments[i] == "--record" || arguments[i] == "--replay" || arguments[i] == "--replay-json")
+    {
+      auto option = arguments.takeAt(i);
+      auto value = arguments.takeAt(i);
+      if (option == "--record")
+      {
+        record = value;
+      }
+      else if (option == "--replay")
+      {
+        replays << value;
+      }
+      else
+      {
+        json = value;
+      }
+    }
+    else
+    {
+      ++i;
+    }
+  }
   // Create a new MainWindow
-  MainWindow w;
+  MainWindow w(nullptr, threaded);
+  w.setSoftwareRendering(software);
   // show it
   w.show();
+  if (!record.isEmpty() && !w.startRecording(record))
+  {
+    std::cerr << "unable to record to " << record.toStdString() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (!replays.isEmpty())
+  {
+    w.replay(replays, flatOut, json);
+  }
+  // any meshes on the command line are added to the mesh list
+  for (auto &fileName : arguments)
+  {
+    w.importMesh(fileName);
+  }
   // hand control over to Qt framework
   return a.exec();
 }
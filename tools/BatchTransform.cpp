@@ -0,0 +1,152 @@
+/// @file BatchTransform.cpp
+/// @brief composes files of transform parameters into matrices without opening a window, see
+/// BatchTransformer.h for the file formats. Prints the records per second and how long each
+/// stage of the pipeline waited on the others.
+/// usage BatchTransform [-t threads] [-c chunk records] [--kernel scalar|sse|avx2] input output
+///       BatchTransform --generate records file   writes random records to try it with
+#include "BatchTransformer.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+{
+//----------------------------------------------------------------------------------------------------------------------
+void usage()
+{
+  std::cerr << "usage BatchTransform [-t threads] [-c chunk records] [--kernel scalar|sse|avx2] input output\n"
+               "      BatchTransform --generate records file\n";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief _count records of every order in binary, or csv if _fileName ends in .csv
+//----------------------------------------------------------------------------------------------------------------------
+bool generate(size_t _count, const std::string &_fileName)
+{
+  std::ofstream out(_fileName, std::ios::binary | std::ios::trunc);
+  const bool csv = _fileName.size() >= 4 && _fileName.compare(_fileName.size() - 4, 4, ".csv") == 0;
+  if (csv)
+  {
+    out << "order,tx,ty,tz,rx,ry,rz,sx,sy,sz,angle,axisx,axisy,axisz\n";
+  }
+  else
+  {
+    BatchTransformer::writeHeader(out);
+  }
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int32_t> order(0, 5);
+  std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+  std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+  std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+  std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+  std::vector<BatchTransformer::Record> block;
+  std::string text;
+  for (size_t done = 0; done < _count && out;)
+  {
+    block.resize(std::min<size_t>(65536, _count - done));
+    for (auto &r : block)
+    {
+      r.order = order(rng);
+      for (int i = 0; i < 3; ++i)
+      {
+        r.translate[i] = position(rng);
+        r.rotate[i] = angle(rng);
+        r.scale[i] = scale(rng);
+      }
+      r.euler[0] = angle(rng);
+      r.euler[1] = axis(rng);
+      r.euler[2] = axis(rng);
+      r.euler[3] = axis(rng);
+    }
+    if (csv)
+    {
+      text.clear();
+      for (auto &r : block)
+      {
+        BatchTransformer::appendCSV(text, r);
+      }
+      out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    else
+    {
+      out.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(block[0])));
+    }
+    done += block.size();
+  }
+  out.close();
+  return !out.fail();
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  size_t threads = 0;
+  size_t chunkRecords = 65536;
+  auto kernel = TransformBatch::bestKernel();
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--generate") == 0 && i + 2 < argc)
+    {
+      const std::string fileName = argv[i + 2];
+      if (!generate(std::stoul(argv[i + 1]), fileName))
+      {
+        std::cerr << "unable to write " << fileName << '\n';
+        return EXIT_FAILURE;
+      }
+      return EXIT_SUCCESS;
+    }
+    else if (std::strcmp(argv[i], "-t") == 0 && hasValue)
+    {
+      threads = std::stoul(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "-c") == 0 && hasValue)
+    {
+      chunkRecords = std::stoul(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "--kernel") == 0 && hasValue)
+    {
+      const std::string name = argv[++i];
+      kernel = name == "scalar" ? TransformBatch::Kernel::SCALAR
+             : name == "sse"    ? TransformBatch::Kernel::SSE
+                                : TransformBatch::Kernel::AVX2;
+    }
+    else if (argv[i][0] == '-')
+    {
+      usage();
+      return EXIT_FAILURE;
+    }
+    else
+    {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.size() != 2)
+  {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  ThreadPool pool(threads);
+  BatchTransformer transformer(pool, chunkRecords);
+  transformer.setKernel(kernel);
+  if (!transformer.transform(files[0], files[1]))
+  {
+    std::cerr << transformer.error() << '\n';
+    return EXIT_FAILURE;
+  }
+  auto &stats = transformer.stats();
+  std::cout << stats.records << " records in " << stats.seconds << " s, " << stats.recordsPerSecond()
+            << " records/s, read " << stats.inputMBPerSecond() << " MB/s, wrote " << stats.outputMBPerSecond()
+            << " MB/s with " << stats.threads << " threads and the "
+            << TransformBatch::kernelName(TransformBatch::isSupported(kernel) ? kernel : TransformBatch::Kernel::SCALAR)
+            << " kernel\n"
+            << "compose " << stats.computeSeconds << " s over the workers, write " << stats.writeSeconds
+            << " s, reader waited " << stats.readWaitSeconds << " s, writer waited " << stats.writeWaitSeconds
+            << " s\n";
+  return EXIT_SUCCESS;
+}